@@ -0,0 +1,292 @@
+#pragma once
+
+#include <algorithm>
+#include <chrono>
+#include <cstdint>
+#include <cstdio>
+#include <ctime>
+#include <fstream>
+#include <functional>
+#include <sstream>
+#include <string>
+#include <utility>
+#include <vector>
+
+#include <backbone/core/pch>
+#include <backbone/lib/config/json.hpp>
+
+/* ------------------------------------------------------------------------------------------------------- */
+
+/**
+ * Hides `value` from the optimizer, so that computing it can't be optimized away.
+ */
+template<typename T>
+inline void
+KeepValue(const T &value) {
+   asm volatile("" : : "r,m"(value) : "memory");
+}
+
+/* ------------------------------------------------------------------------------------------------------- */
+
+/**
+ * @brief
+ * One case: `run` does `iterations` rounds of the operation and returns a checksum of what they produced.
+ * A round may do the operation several times (`items`), timings are reported per operation.
+ */
+class Benchmark {
+public:
+   std::string                     name;
+   std::function<uint64_t(size_t)> run;
+   size_t                          items = 1;   // operations per round
+   size_t                          bytes = 0;   // processed per round, for throughput
+};
+
+/* ------------------------------------------------------------------------------------------------------- */
+
+class BenchConfig {
+public:
+   double      min_time    = 0.1;   // seconds per repetition
+   size_t      repetitions = 5;
+   std::string filter;
+   std::string output;           // JSON report, in addition to what is printed
+   std::string baseline;         // JSON report to compare against
+   double      threshold = 10;   // percent slower than the baseline that counts as a regression
+   bool        json      = false;
+   bool        list      = false;
+};
+
+/* ------------------------------------------------------------------------------------------------------- */
+
+class BenchResult {
+public:
+   std::string name;
+   size_t      iterations;   // operations per repetition
+   double      ns_per_op;    // median of the repetitions
+   double      min_ns_per_op;
+   double      max_ns_per_op;
+   double      mb_per_second;     // zero if the case processes no bytes
+   double      baseline_ns = 0;   // zero without a baseline, or if the baseline lacks this case
+};
+
+/* ------------------------------------------------------------------------------------------------------- */
+
+/**
+ * @brief
+ * Minimal benchmark harness, enough to track the packet codec over time without an external library.
+ *
+ * @details
+ * Every case first finds how many rounds take at least `min_time`, doubling from one, and is then timed
+ * over that many rounds `repetitions` times. The median is what gets reported and compared, the minimum
+ * and maximum show how noisy the host is.
+ *
+ * The JSON report is a `context` object describing the run and a `benchmarks` array with one object per
+ * case. It doubles as the baseline of a later run, which then fails if any case got slower by more than
+ * `threshold` percent.
+ */
+class BenchRunner {
+private:
+   BenchConfig            m_Config;
+   std::vector<Benchmark> m_Benchmarks;
+
+public:
+   BenchRunner(BenchConfig config) : m_Config(std::move(config)) {}
+
+   void
+   add(Benchmark benchmark) {
+      m_Benchmarks.push_back(std::move(benchmark));
+   }
+
+   /**
+    * Runs every case matching the filter and reports them.
+    *
+    * @returns Whether no case regressed against the baseline.
+    */
+   Result<bool>
+   run(const std::vector<std::pair<std::string, std::string>> &context) {
+      std::vector<BenchResult> results;
+      for (const auto &benchmark : m_Benchmarks) {
+         if (benchmark.name.find(m_Config.filter) == std::string::npos) {
+            continue;
+         }
+         if (m_Config.list) {
+            printf("%s\n", benchmark.name.c_str());
+            continue;
+         }
+
+         results.push_back(measure(benchmark));
+         if (!m_Config.json) {
+            print_row(results.back());
+         }
+      }
+
+      if (m_Config.list) {
+         return true;
+      }
+
+      if (!m_Config.baseline.empty()) {
+         auto res = compare(results);
+         RETURN_IF_ERROR(res);
+      }
+
+      auto report = to_json(results, context);
+      if (m_Config.json) {
+         printf("%s", report.c_str());
+      }
+
+      if (!m_Config.output.empty()) {
+         std::ofstream file(m_Config.output, std::ios::trunc);
+         if (!(file << report)) {
+            return Error("Failed to write " + m_Config.output);
+         }
+      }
+
+      bool passed = true;
+      for (const auto &result : results) {
+         if (is_regression(result)) {
+            fprintf(stderr, "Regression: %s\n", result.name.c_str());
+            passed = false;
+         }
+      }
+      return passed;
+   }
+
+private:
+   BenchResult
+   measure(const Benchmark &benchmark) {
+      using Clock = std::chrono::steady_clock;
+
+      auto time = [&](size_t rounds) {
+         auto start    = Clock::now();
+         auto checksum = benchmark.run(rounds);
+         auto elapsed  = std::chrono::duration<double>(Clock::now() - start).count();
+         KeepValue(checksum);
+         return elapsed;
+      };
+
+      size_t rounds = 1;
+      while (time(rounds) < m_Config.min_time && rounds < (size_t(1) << 40)) {
+         rounds *= 2;
+      }
+
+      std::vector<double> samples;
+      for (size_t i = 0; i < std::max<size_t>(m_Config.repetitions, 1); i++) {
+         samples.push_back(time(rounds) * 1e9 / (rounds * benchmark.items));
+      }
+      std::sort(samples.begin(), samples.end());
+
+      double median = samples[samples.size() / 2];
+      if (samples.size() % 2 == 0) {
+         median = (median + samples[samples.size() / 2 - 1]) / 2;
+      }
+
+      double bytes_per_op = static_cast<double>(benchmark.bytes) / benchmark.items;
+      return BenchResult { .name          = benchmark.name,
+                           .iterations    = rounds * benchmark.items,
+                           .ns_per_op     = median,
+                           .min_ns_per_op = samples.front(),
+                           .max_ns_per_op = samples.back(),
+                           .mb_per_second = bytes_per_op * 1e3 / median };
+   }
+
+   Result<void>
+   compare(std::vector<BenchResult> &results) {
+      auto _baseline = JsonValue::parse_file(m_Config.baseline).except("Failed to load the baseline");
+      RETURN_IF_ERROR(_baseline);
+
+      auto *benchmarks = _baseline.get_value().find("benchmarks");
+      if (!benchmarks || !benchmarks->is_array()) {
+         return Error("Baseline has no benchmarks: " + m_Config.baseline);
+      }
+
+      for (const auto &entry : benchmarks->as_array()) {
+         auto *name = entry.find("name");
+         auto *ns   = entry.find("ns_per_op");
+         if (!name || !name->is_string() || !ns || !ns->is_number()) {
+            continue;
+         }
+
+         for (auto &result : results) {
+            if (result.name == name->as_string()) {
+               result.baseline_ns = ns->as_number();
+               if (!m_Config.json) {
+                  printf("%-36s %+7.1f%% vs %.2f ns%s\n",
+                         result.name.c_str(),
+                         get_change(result),
+                         result.baseline_ns,
+                         is_regression(result) ? "   REGRESSION" : "");
+               }
+            }
+         }
+      }
+
+      return Ok();
+   }
+
+   static double
+   get_change(const BenchResult &result) {
+      return (result.ns_per_op / result.baseline_ns - 1) * 100;
+   }
+
+   bool
+   is_regression(const BenchResult &result) const {
+      return result.baseline_ns > 0 && get_change(result) > m_Config.threshold;
+   }
+
+   static void
+   print_row(const BenchResult &result) {
+      char throughput[32] = "";
+      if (result.mb_per_second > 0) {
+         snprintf(throughput, sizeof(throughput), "%.1f MB/s", result.mb_per_second);
+      }
+
+      printf("%-36s %10.2f ns/op %12zu ops %14s   [%.2f .. %.2f]\n",
+             result.name.c_str(),
+             result.ns_per_op,
+             result.iterations,
+             throughput,
+             result.min_ns_per_op,
+             result.max_ns_per_op);
+   }
+
+   std::string
+   to_json(const std::vector<BenchResult>                         &results,
+           const std::vector<std::pair<std::string, std::string>> &context) const {
+      char date[32];
+      auto now = std::time(nullptr);
+      std::strftime(date, sizeof(date), "%Y-%m-%dT%H:%M:%SZ", std::gmtime(&now));
+
+      std::ostringstream out;
+      out << "{\n  \"context\": {\"date\": \"" << date << "\", \"repetitions\": " << m_Config.repetitions
+          << ", \"min_time\": " << m_Config.min_time;
+      for (const auto &[key, value] : context) {
+         out << ", \"" << key << "\": \"" << value << "\"";
+      }
+      out << "},\n  \"benchmarks\": [";
+
+      char line[512];
+      for (size_t i = 0; i < results.size(); i++) {
+         const auto &result = results[i];
+         snprintf(line,
+                  sizeof(line),
+                  "%s\n    {\"name\": \"%s\", \"iterations\": %zu, \"ns_per_op\": %.3f, "
+                  "\"min_ns_per_op\": %.3f, \"max_ns_per_op\": %.3f, \"mb_per_second\": %.1f",
+                  i == 0 ? "" : ",",
+                  result.name.c_str(),
+                  result.iterations,
+                  result.ns_per_op,
+                  result.min_ns_per_op,
+                  result.max_ns_per_op,
+                  result.mb_per_second);
+         out << line;
+         if (result.baseline_ns > 0) {
+            snprintf(line, sizeof(line), ", \"baseline_ns_per_op\": %.3f", result.baseline_ns);
+            out << line;
+         }
+         out << "}";
+      }
+      out << "\n  ]\n}\n";
+      return out.str();
+   }
+};
+
+/* ------------------------------------------------------------------------------------------------------- */
@@ -0,0 +1,482 @@
+/// @brief
+/// Micro benchmarks of the packet codec: header, names, whole messages, the buffer primitives underneath
+/// them and the cost of errors travelling up a `Result` chain. Run by the `bench` target, whose JSON report
+/// can be handed to the next run as its baseline to catch regressions.
+
+#include <arpa/inet.h>
+#include <iostream>
+#include <memory>
+#include <string>
+#include <tuple>
+#include <vector>
+
+#include <backbone/lib/buffer/arena.hpp>
+#include <backbone/lib/buffer/basic.tpp>
+#include <backbone/lib/packet/packet.hpp>
+#include "harness.hpp"
+
+/* ------------------------------------------------------------------------------------------------------- */
+
+using RecordType = PacketRecord::RecordType;
+
+class CorpusRecord {
+public:
+   const char       *name;
+   RecordType        type;
+   std::vector<Byte> rdata;
+};
+
+class CorpusMessage {
+public:
+   const char       *name;
+   std::vector<Byte> bytes;
+};
+
+/* ------------------------------------------------------------------------------------------------------- */
+
+static std::vector<Byte>
+name_rdata(const char *dotted, std::vector<Byte> prefix = {}) {
+   auto name = DomainName::from_string(dotted).panic_if_error("Invalid corpus name").get_value();
+   auto wire = name.get_wire();
+   prefix.insert(prefix.end(), wire.begin(), wire.end());
+   return prefix;
+}
+
+static std::vector<Byte>
+address_rdata(int family, const char *text) {
+   std::vector<Byte> rdata(family == AF_INET ? 4 : 16);
+   inet_pton(family, text, rdata.data());
+   return rdata;
+}
+
+/* ------------------------------------------------------------------------------------------------------- */
+
+/**
+ * A response the way a resolver sees one, names compressed by `Packet::write_to_buffer`.
+ */
+static CorpusMessage
+build_message(const char                      *label,
+              const char                      *question,
+              RecordType                       type,
+              PacketHeader::ResultCode         code,
+              const std::vector<CorpusRecord> &answers,
+              const std::vector<CorpusRecord> &authorities = {},
+              const std::vector<CorpusRecord> &additionals = {}) {
+   auto header = PacketHeader(0x2A2A,
+                              true,
+                              0,
+                              false,
+                              false,
+                              true,
+                              true,
+                              0,
+                              code,
+                              1,
+                              answers.size(),
+                              authorities.size(),
+                              additionals.size());
+
+   auto packet = Packet(header);
+   auto name   = DomainName::from_string(question).panic_if_error("Invalid corpus name").get_value();
+   packet.questions.emplace_back(name, type, 1);
+
+   auto add = [](std::pmr::vector<PacketRecord> &section, const std::vector<CorpusRecord> &records) {
+      for (const auto &record : records) {
+         auto owner = DomainName::from_string(record.name).panic_if_error("Invalid corpus name").get_value();
+         section.push_back(PacketRecord::from_rdata(owner, record.type, 1, 3600, record.rdata)
+                               .panic_if_error("Invalid corpus record")
+                               .get_value());
+      }
+   };
+   add(packet.answers, answers);
+   add(packet.authorities, authorities);
+   add(packet.additionals, additionals);
+
+   PacketBuffer buffer;
+   auto _ = packet.write_to_buffer(buffer).panic_if_error("Failed to encode corpus message");
+
+   auto *data = buffer.get_data();
+   return CorpusMessage { label, { data, data + buffer.get_write_index() } };
+}
+
+/* ------------------------------------------------------------------------------------------------------- */
+
+/**
+ * What a caching resolver typically gets back from upstream: plain and chained answers, a referral with
+ * glue, mail exchangers, TXT and a negative answer. Plus a bare query, which is what the server parses most.
+ */
+static std::vector<CorpusMessage>
+build_corpus() {
+   std::vector<CorpusMessage> corpus;
+
+   auto query = build_message("query", "www.example.com", RecordType::A, PacketHeader::NO_ERROR, {});
+   query.bytes[2] &= 0x7F;   // not a response
+   query.bytes[3] &= 0x7F;
+   corpus.push_back(std::move(query));
+
+   corpus.push_back(build_message(
+       "a",
+       "www.example.com",
+       RecordType::A,
+       PacketHeader::NO_ERROR,
+       { { "www.example.com", RecordType::A, address_rdata(AF_INET, "93.184.216.34") },
+         { "www.example.com", RecordType::A, address_rdata(AF_INET, "93.184.216.35") } }));
+
+   corpus.push_back(build_message(
+       "cname",
+       "www.shop.example.com",
+       RecordType::AAAA,
+       PacketHeader::NO_ERROR,
+       { { "www.shop.example.com", RecordType::CNAME, name_rdata("shop.example.com.cdn.example.net") },
+         { "shop.example.com.cdn.example.net", RecordType::CNAME, name_rdata("edge7.cdn.example.net") },
+         { "edge7.cdn.example.net", RecordType::AAAA, address_rdata(AF_INET6, "2001:db8::7") },
+         { "edge7.cdn.example.net", RecordType::AAAA, address_rdata(AF_INET6, "2001:db8::8") } }));
+
+   std::vector<CorpusRecord> servers, glue;
+   for (const char *server : { "a.gtld-servers.net", "b.gtld-servers.net", "c.gtld-servers.net" }) {
+      servers.push_back({ "com", RecordType::NS, name_rdata(server) });
+      glue.push_back({ server, RecordType::A, address_rdata(AF_INET, "192.0.2.30") });
+      glue.push_back({ server, RecordType::AAAA, address_rdata(AF_INET6, "2001:db8::30") });
+   }
+   corpus.push_back(build_message(
+       "referral", "www.example.com", RecordType::A, PacketHeader::NO_ERROR, {}, servers, glue));
+
+   corpus.push_back(build_message(
+       "mx",
+       "example.com",
+       RecordType::MX,
+       PacketHeader::NO_ERROR,
+       { { "example.com", RecordType::MX, name_rdata("mx1.example.com", { 0, 10 }) },
+         { "example.com", RecordType::MX, name_rdata("mx2.example.com", { 0, 20 }) } },
+       {},
+       { { "mx1.example.com", RecordType::A, address_rdata(AF_INET, "192.0.2.25") },
+         { "mx2.example.com", RecordType::A, address_rdata(AF_INET, "192.0.2.26") } }));
+
+   std::string spf = "v=spf1 ip4:192.0.2.0/24 include:_spf.example.net ~all";
+   std::vector<Byte> txt { static_cast<Byte>(spf.size()) };
+   txt.insert(txt.end(), spf.begin(), spf.end());
+   corpus.push_back(build_message("txt",
+                                  "example.com",
+                                  RecordType::TXT,
+                                  PacketHeader::NO_ERROR,
+                                  { { "example.com", RecordType::TXT, txt } }));
+
+   // SOA RDATA: primary server, mailbox, then serial, refresh, retry, expire and minimum
+   auto soa = name_rdata("ns1.example.com");
+   auto box = name_rdata("hostmaster.example.com");
+   soa.insert(soa.end(), box.begin(), box.end());
+   soa.insert(soa.end(), { 0x78, 0x5C, 0x4B, 0x01, 0, 0, 0x1C, 0x20, 0, 0, 0x0E, 0x10,
+                           0, 0x12, 0x75, 0, 0, 0, 0x0E, 0x10 });
+   corpus.push_back(build_message("nxdomain",
+                                  "missing.example.com",
+                                  RecordType::A,
+                                  PacketHeader::NAME_ERROR,
+                                  {},
+                                  { { "example.com", RecordType::SOA, soa } }));
+
+   return corpus;
+}
+
+/* ------------------------------------------------------------------------------------------------------- */
+
+/**
+ * Packet buffer holding `bytes`, ready to be read from the start.
+ */
+static PacketBuffer
+load_buffer(std::span<const Byte> bytes) {
+   PacketBuffer buffer(BufferPool::TCP_SIZE);
+   auto         _ = buffer.write(bytes);
+   return buffer;
+}
+
+/* ------------------------------------------------------------------------------------------------------- */
+
+static void
+add_header_benchmarks(BenchRunner &runner, const std::vector<CorpusMessage> &corpus) {
+   auto input = std::make_shared<PacketBuffer>(load_buffer(corpus[1].bytes));
+   runner.add({ "header/from_buffer",
+                [input](size_t rounds) {
+                   uint64_t checksum = 0;
+                   for (size_t i = 0; i < rounds; i++) {
+                      auto header = PacketHeader::from_buffer(*input);
+                      checksum += header.get_value().answer_count;
+                   }
+                   return checksum;
+                },
+                1,
+                PacketHeader::SIZE });
+
+   auto output = std::make_shared<PacketBuffer>();
+   auto header = PacketHeader::from_buffer(*input).get_value();
+   runner.add({ "header/write_to_buffer",
+                [output, header](size_t rounds) mutable {
+                   for (size_t i = 0; i < rounds; i++) {
+                      header.id = i;
+                      auto _    = header.write_to_buffer(*output);
+                   }
+                   return output->get_write_index();
+                },
+                1,
+                PacketHeader::SIZE });
+}
+
+/* ------------------------------------------------------------------------------------------------------- */
+
+static void
+add_name_benchmarks(BenchRunner &runner) {
+   /*
+    * A question name, then names pointing into it: "api.example.com" behind one pointer and
+    * "v2.api.example.com" behind a chain of two.
+    */
+   std::vector<Byte> message(12, 0);
+   auto              plain = name_rdata("www.example.com");
+   message.insert(message.end(), plain.begin(), plain.end());
+
+   size_t pointer = message.size();
+   message.insert(message.end(), { 3, 'a', 'p', 'i', 0xC0, 16 });   // "api" + "example.com"
+
+   size_t chain = message.size();
+   message.insert(message.end(), { 2, 'v', '2', 0xC0, static_cast<Byte>(pointer) });
+
+   auto buffer = std::make_shared<PacketBuffer>(load_buffer(message));
+   auto arena  = std::make_shared<QueryArena>();
+
+   for (auto [name, position, bytes] : { std::tuple { "name/read_name", size_t(12), plain.size() },
+                                         std::tuple { "name/read_name/pointer", pointer, size_t(6) },
+                                         std::tuple { "name/read_name/pointer_chain", chain, size_t(5) } }) {
+      runner.add({ name,
+                   [buffer, arena, position](size_t rounds) {
+                      uint64_t checksum = 0;
+                      for (size_t i = 0; i < rounds; i++) {
+                         auto _    = buffer->seek_read(position);
+                         auto name = buffer->read_name(arena->get_allocator());
+                         checksum += name.get_value().get_length();
+                         arena->reset();
+                      }
+                      return checksum;
+                   },
+                   1,
+                   bytes });
+   }
+}
+
+/* ------------------------------------------------------------------------------------------------------- */
+
+static void
+add_packet_benchmarks(BenchRunner &runner, const std::vector<CorpusMessage> &corpus) {
+   auto arena = std::make_shared<QueryArena>();
+
+   auto parse = [arena](std::shared_ptr<std::vector<PacketBuffer>> buffers) {
+      return [arena, buffers](size_t rounds) {
+         uint64_t checksum = 0;
+         for (size_t i = 0; i < rounds; i++) {
+            for (auto &buffer : *buffers) {
+               auto packet = Packet::from_buffer(buffer, arena->get_allocator());
+               checksum += packet.get_value().answers.size();
+               arena->reset();
+            }
+         }
+         return checksum;
+      };
+   };
+
+   auto   all   = std::make_shared<std::vector<PacketBuffer>>();
+   size_t total = 0;
+   for (const auto &message : corpus) {
+      auto one = std::make_shared<std::vector<PacketBuffer>>();
+      one->push_back(load_buffer(message.bytes));
+      all->push_back(load_buffer(message.bytes));
+      total += message.bytes.size();
+
+      runner.add({ std::string("packet/from_buffer/") + message.name, parse(one), 1, message.bytes.size() });
+   }
+   runner.add({ "packet/from_buffer/corpus", parse(all), corpus.size(), total });
+
+   // Encoding the parsed messages again, name compression included
+   auto packets = std::make_shared<std::vector<Packet>>();
+   for (auto &buffer : *all) {
+      auto packet = Packet::from_buffer(buffer).panic_if_error("Corpus message does not parse");
+      packets->push_back(std::move(packet.get_value()));
+   }
+
+   auto output = std::make_shared<PacketBuffer>();
+   runner.add({ "packet/write_to_buffer/corpus",
+                [packets, output](size_t rounds) {
+                   uint64_t checksum = 0;
+                   for (size_t i = 0; i < rounds; i++) {
+                      for (const auto &packet : *packets) {
+                         auto _ = packet.write_to_buffer(*output);
+                         checksum += output->get_write_index();
+                      }
+                   }
+                   return checksum;
+                },
+                corpus.size(),
+                total });
+}
+
+/* ------------------------------------------------------------------------------------------------------- */
+
+static void
+add_buffer_benchmarks(BenchRunner &runner) {
+   // A round is a sweep over the whole buffer, a single access is too short to time on its own
+   static constexpr size_t SIZE = 512;
+   using Buffer                 = BasicBuffer<Byte, SIZE>;
+
+   auto buffer = std::make_shared<Buffer>(Byte(0x5A));
+
+   auto sweep = [&](const char *name, size_t width, auto operation) {
+      runner.add({ name,
+                   [buffer, operation](size_t rounds) {
+                      uint64_t checksum = 0;
+                      for (size_t i = 0; i < rounds; i++) {
+                         auto _ = buffer->seek_read(0);
+                         _      = buffer->seek_write(0);
+                         for (size_t j = 0; j < SIZE / sizeof(uint32_t); j++) {
+                            checksum += operation(*buffer);
+                         }
+                         KeepValue(checksum);
+                      }
+                      return checksum;
+                   },
+                   SIZE / sizeof(uint32_t),
+                   SIZE / sizeof(uint32_t) * width });
+   };
+
+   sweep("buffer/read", 1, [](Buffer &buffer) { return buffer.read().get_value(); });
+   sweep("buffer/read_uint16", 2, [](Buffer &buffer) { return buffer.read_uint16().get_value(); });
+   sweep("buffer/read_uint32", 4, [](Buffer &buffer) { return buffer.read_uint32().get_value(); });
+   sweep("buffer/read_uint32_unchecked", 4, [](Buffer &buffer) { return buffer.read_uint32_unchecked(); });
+   sweep("buffer/write", 1, [](Buffer &buffer) { return buffer.write(Byte(1)).is_error(); });
+   sweep("buffer/write_uint16", 2, [](Buffer &buffer) { return buffer.write_uint16(0x0102).is_error(); });
+   sweep("buffer/write_uint32", 4, [](Buffer &buffer) { return buffer.write_uint32(0x01020304).is_error(); });
+   sweep("buffer/write_uint32_unchecked", 4, [](Buffer &buffer) {
+      buffer.write_uint32_unchecked(0x01020304);
+      return 0;
+   });
+   sweep("buffer/read_range", 4, [](Buffer &buffer) { return buffer.read_range(4).get_value()[3]; });
+}
+
+/* ------------------------------------------------------------------------------------------------------- */
+
+/*
+ * Layers of a parser, each adding its context to an error coming from below the way the packet types do.
+ */
+[[gnu::noinline]] static Result<uint32_t>
+parse_leaf(uint32_t value) {
+   if (value == 0) {
+      return Error(PACKET_READ_CORRUPTED_BUFFER, "Buffer overflowed");
+   }
+   return value;
+}
+
+template<int DEPTH>
+[[gnu::noinline]] static Result<uint32_t>
+parse_layer(uint32_t value) {
+   if constexpr (DEPTH == 0) {
+      return parse_leaf(value);
+   } else {
+      auto res = parse_layer<DEPTH - 1>(value).except("Failed to parse layer");
+      RETURN_IF_ERROR(res);
+      return res.get_value() + 1;
+   }
+}
+
+[[gnu::noinline]] static Result<uint32_t>
+parse_described(uint32_t value) {
+   auto res = parse_layer<3>(value).except("Failed to parse record " + std::to_string(value));
+   RETURN_IF_ERROR(res);
+   return res.get_value();
+}
+
+/* ------------------------------------------------------------------------------------------------------- */
+
+static void
+add_result_benchmarks(BenchRunner &runner) {
+   auto chain = [&](const char *name, auto parse, uint32_t value) {
+      runner.add({ name,
+                   [parse, value](size_t rounds) {
+                      // Read back on every round, so that the outcome can't be known up front
+                      volatile uint32_t input    = value;
+                      uint64_t          checksum = 0;
+                      for (size_t i = 0; i < rounds; i++) {
+                         auto res = parse(input);
+                         checksum += res.is_error() ? res.get_error().size() : res.get_value();
+                      }
+                      return checksum;
+                   } });
+   };
+
+   chain("result/value", parse_leaf, 1);
+   chain("result/value/depth_4", parse_layer<4>, 1);
+   chain("result/error", parse_leaf, 0);
+   chain("result/error/depth_4", parse_layer<4>, 0);
+   chain("result/error/depth_12", parse_layer<12>, 0);   // beyond `Error::MAX_UNITS`
+   chain("result/error/runtime_message", parse_described, 0);
+}
+
+/* ------------------------------------------------------------------------------------------------------- */
+
+int
+main(int argc, char **argv) {
+   BenchConfig config;
+
+   for (int i = 1; i < argc; i++) {
+      std::string arg       = argv[i];
+      bool        has_value = i + 1 < argc;
+
+      if (arg == "--filter" && has_value) {
+         config.filter = argv[++i];
+      } else if (arg == "--min-time" && has_value) {
+         config.min_time = std::stod(argv[++i]);
+      } else if (arg == "--repetitions" && has_value) {
+         config.repetitions = std::stoul(argv[++i]);
+      } else if (arg == "--output" && has_value) {
+         config.output = argv[++i];
+      } else if (arg == "--baseline" && has_value) {
+         config.baseline = argv[++i];
+      } else if (arg == "--threshold" && has_value) {
+         config.threshold = std::stod(argv[++i]);
+      } else if (arg == "--json") {
+         config.json = true;
+      } else if (arg == "--list") {
+         config.list = true;
+      } else {
+         std::cout << "Usage: " << argv[0]
+                   << " [--filter <substring>] [--min-time <seconds>] [--repetitions <count>] [--json]"
+                   << " [--output <report.json>] [--baseline <report.json>] [--threshold <percent>] [--list]"
+                   << std::endl;
+         return EXIT_FAILURE;
+      }
+   }
+
+#ifndef __OPTIMIZE__
+   std::cerr << "Warning: built without optimizations, configure with -DCMAKE_BUILD_TYPE=Release"
+             << std::endl;
+#endif
+
+   auto corpus = build_corpus();
+
+   BenchRunner runner(config);
+   add_header_benchmarks(runner, corpus);
+   add_name_benchmarks(runner);
+   add_packet_benchmarks(runner, corpus);
+   add_buffer_benchmarks(runner);
+   add_result_benchmarks(runner);
+
+#ifdef __OPTIMIZE__
+   const char *optimized = "true";
+#else
+   const char *optimized = "false";
+#endif
+
+   auto passed = runner.run({ { "compiler", __VERSION__ }, { "optimized", optimized } });
+   if (passed.is_error()) {
+      passed.get_error().print("Benchmark");
+      return EXIT_FAILURE;
+   }
+
+   return passed.get_value() ? 0 : EXIT_FAILURE;
+}
+
+/* ------------------------------------------------------------------------------------------------------- */
@@ -0,0 +1,515 @@
+/// @brief
+/// End-to-end check of forwarding against stand-in upstream resolvers. Runs three of them on 127.0.0.1,
+/// each answering after a delay of its own or dropping every query, points a recursive server at them with
+/// `--forward` and checks who got which query: the fastest upstream must get them all, a primary that is
+/// late must be raced to the second best one, and an upstream that stops answering must be left alone
+/// and only probed now and then. Exits with a failure if any check fails, which is what the `forwarder`
+/// test looks at.
+
+#include <algorithm>
+#include <arpa/inet.h>
+#include <array>
+#include <atomic>
+#include <chrono>
+#include <iostream>
+#include <mutex>
+#include <optional>
+#include <poll.h>
+#include <span>
+#include <string>
+#include <sys/socket.h>
+#include <thread>
+#include <tuple>
+#include <vector>
+
+#include <backbone/lib/packet/packet.hpp>
+#include <backbone/lib/packet/view.hpp>
+#include <backbone/lib/server/server.hpp>
+#include <backbone/lib/server/socket.hpp>
+
+/* ------------------------------------------------------------------------------------------------------- */
+
+using Clock      = std::chrono::steady_clock;
+using RecordType = PacketRecord::RecordType;
+
+/* ------------------------------------------------------------------------------------------------------- */
+
+/**
+ * @brief
+ * Stand-in upstream resolvers, each on its own port of 127.0.0.1, answering every A question with
+ * 192.0.2.1.
+ *
+ * @details
+ * Every server answers after its own delay, or not at all while it is set to drop, both of which can
+ * change while the servers run. The time every query came in is kept per server, so the checks see who
+ * was asked and when. All servers share one thread.
+ */
+class StandInForwarders {
+public:
+   static constexpr size_t COUNT = 3;
+
+private:
+   struct Pending {
+      Clock::time_point due;
+      int               fd;
+      std::vector<Byte> response;
+      sockaddr_storage  peer;
+      socklen_t         peer_length;
+   };
+
+   std::vector<UdpSocket> m_Sockets;
+   std::atomic<bool>      m_Stop;
+   std::thread            m_Thread;
+
+   std::mutex                                         m_Lock;
+   std::array<std::chrono::milliseconds, COUNT>       m_Delays {};
+   std::array<bool, COUNT>                            m_Drops {};
+   std::array<std::vector<Clock::time_point>, COUNT> m_Queries;
+
+public:
+   StandInForwarders() : m_Stop(false) {}
+   StandInForwarders(const StandInForwarders &) = delete;
+   ~StandInForwarders() { stop(); }
+
+   Result<void>
+   start() {
+      for (size_t i = 0; i < COUNT; i++) {
+         auto socket = UdpSocket::bind("127.0.0.1", 0, false).except("Failed to bind a stand-in");
+         RETURN_IF_ERROR(socket);
+         m_Sockets.push_back(std::move(socket.get_value()));
+      }
+
+      m_Thread = std::thread([this]() { run(); });
+      return Ok();
+   }
+
+   void
+   stop() {
+      m_Stop.store(true);
+      if (m_Thread.joinable()) {
+         m_Thread.join();
+      }
+   }
+
+   /**
+    * "address:port" of every server, to forward to.
+    */
+   std::vector<std::string>
+   get_addresses() const {
+      std::vector<std::string> addresses;
+      for (const auto &socket : m_Sockets) {
+         addresses.push_back("127.0.0.1:" + std::to_string(socket.get_port()));
+      }
+      return addresses;
+   }
+
+   void
+   set_delay(size_t index, std::chrono::milliseconds delay) {
+      std::lock_guard lock(m_Lock);
+      m_Delays[index] = delay;
+   }
+
+   void
+   set_drop(size_t index, bool drop) {
+      std::lock_guard lock(m_Lock);
+      m_Drops[index] = drop;
+   }
+
+   /**
+    * When server `index` got each of its queries so far, answered or not.
+    */
+   std::vector<Clock::time_point>
+   get_queries(size_t index) {
+      std::lock_guard lock(m_Lock);
+      return m_Queries[index];
+   }
+
+private:
+   static std::optional<std::vector<Byte>>
+   respond(std::span<const Byte> request) {
+      auto _view = PacketView::from_bytes(request);
+      if (!_view || _view.get_value().query_response() || _view.get_value().question_count() != 1) {
+         return std::nullopt;
+      }
+      const auto &view     = _view.get_value();
+      const auto  question = *view.questions().begin();
+      bool        has_a    = question.type == PacketQuestion::A;
+
+      auto header = PacketHeader(view.id(),
+                                 true,
+                                 view.op_code(),
+                                 false,
+                                 false,
+                                 view.recursion_desired(),
+                                 true,
+                                 0,
+                                 PacketHeader::NO_ERROR,
+                                 1,
+                                 has_a ? 1 : 0,
+                                 0,
+                                 0);
+
+      // The question goes back as it came, in its own case
+      auto question_bytes = view.get_question_bytes();
+      auto response       = std::vector<Byte>(PacketHeader::SIZE);
+      header.to_bytes(std::span<Byte, PacketHeader::SIZE>(response.data(), PacketHeader::SIZE));
+      response.insert(response.end(), question_bytes.begin(), question_bytes.end());
+
+      // Owner compressed to the question name, IN, TTL 60, 192.0.2.1
+      if (has_a) {
+         response.insert(response.end(), { 0xC0, 0x0C, 0, 1, 0, 1, 0, 0, 0, 60, 0, 4, 192, 0, 2, 1 });
+      }
+      return response;
+   }
+
+   void
+   run() {
+      std::vector<pollfd> fds;
+      for (const auto &socket : m_Sockets) {
+         fds.push_back({ .fd = socket.get_fd(), .events = POLLIN, .revents = 0 });
+      }
+
+      std::vector<Pending>   pending;
+      std::array<Byte, 4096> buffer;
+      while (!m_Stop.load()) {
+         /* Sleep until the next response is due or a query comes in */
+         int timeout = 10;
+         for (const auto &entry : pending) {
+            auto wait = std::chrono::ceil<std::chrono::milliseconds>(entry.due - Clock::now());
+            timeout   = std::clamp<int>(wait.count(), 0, timeout);
+         }
+         poll(fds.data(), fds.size(), timeout);
+
+         for (size_t i = 0; i < m_Sockets.size(); i++) {
+            int fd = fds[i].fd;
+            while (true) {
+               Pending   entry {};
+               auto     *peer   = reinterpret_cast<sockaddr *>(&entry.peer);
+               socklen_t length = sizeof(entry.peer);
+               ssize_t   count  = recvfrom(fd, buffer.data(), buffer.size(), MSG_DONTWAIT, peer, &length);
+               if (count < 0) {
+                  break;
+               }
+
+               std::chrono::milliseconds delay;
+               bool                      drop;
+               {
+                  std::lock_guard lock(m_Lock);
+                  m_Queries[i].push_back(Clock::now());
+                  delay = m_Delays[i];
+                  drop  = m_Drops[i];
+               }
+
+               auto response = respond({ buffer.data(), size_t(count) });
+               if (response && !drop) {
+                  entry.due         = Clock::now() + delay;
+                  entry.fd          = fd;
+                  entry.response    = std::move(response.value());
+                  entry.peer_length = length;
+                  pending.push_back(std::move(entry));
+               }
+            }
+         }
+
+         auto now = Clock::now();
+         std::erase_if(pending, [now](const Pending &entry) {
+            if (entry.due > now) {
+               return false;
+            }
+            sendto(entry.fd,
+                   entry.response.data(),
+                   entry.response.size(),
+                   0,
+                   reinterpret_cast<const sockaddr *>(&entry.peer),
+                   entry.peer_length);
+            return true;
+         });
+      }
+   }
+};
+
+/* ------------------------------------------------------------------------------------------------------- */
+
+/**
+ * @brief
+ * Client of the server under test, asking one question at a time.
+ */
+class Client {
+private:
+   UdpSocket m_Socket;
+   uint16_t  m_Port;
+   uint16_t  m_Id;
+
+public:
+   Client(UdpSocket socket, uint16_t port) : m_Socket(std::move(socket)), m_Port(port), m_Id(0) {}
+
+   static Result<Client>
+   create(uint16_t port) {
+      auto socket = UdpSocket::bind("127.0.0.1", 0, false).except("Failed to bind a client socket");
+      RETURN_IF_ERROR(socket);
+      return Client(std::move(socket.get_value()), port);
+   }
+
+   /**
+    * Asks for the A record of `name` and checks that it comes back as 192.0.2.1.
+    */
+   Result<void>
+   ask(const std::string &name) {
+      auto header = PacketHeader(
+          ++m_Id, false, 0, false, false, true, false, 0, PacketHeader::NO_ERROR, 1, 0, 0, 0);
+      auto packet = Packet(header);
+      auto _name  = DomainName::from_string(name).except("Invalid question name");
+      RETURN_IF_ERROR(_name);
+      packet.questions.emplace_back(_name.get_value(), RecordType::A, 1);
+
+      PacketBuffer buffer;
+      auto         res = packet.write_to_buffer(buffer).except("Failed to encode a query");
+      RETURN_IF_ERROR(res);
+
+      sockaddr_in server { .sin_family = AF_INET, .sin_port = htons(m_Port), .sin_addr = {}, .sin_zero = {} };
+      inet_pton(AF_INET, "127.0.0.1", &server.sin_addr);
+      if (sendto(m_Socket.get_fd(),
+                 buffer.get_data(),
+                 buffer.get_write_index(),
+                 0,
+                 reinterpret_cast<const sockaddr *>(&server),
+                 sizeof(server)) < 0) {
+         return Error("Failed to send a query");
+      }
+
+      pollfd poll_fd { .fd = m_Socket.get_fd(), .events = POLLIN, .revents = 0 };
+      if (poll(&poll_fd, 1, 5000) <= 0) {
+         return Error("No response for " + name);
+      }
+
+      PacketBuffer input(BufferPool::TCP_SIZE);
+      ssize_t      count = recv(m_Socket.get_fd(), input.get_data(), input.get_capacity(), 0);
+      if (count < 0) {
+         return Error("Failed to receive a response");
+      }
+      auto _ = input.seek_write(count);
+
+      auto response = Packet::from_buffer(input).except("Invalid response");
+      RETURN_IF_ERROR(response);
+      const auto &answer = response.get_value();
+      if (answer.header.id != m_Id) {
+         return Error("Response to another query");
+      }
+      if (answer.header.response_code != PacketHeader::NO_ERROR || answer.answers.size() != 1) {
+         return Error("Expected a single answer for " + name + ", got rcode "
+                      + std::to_string(answer.header.response_code) + " with "
+                      + std::to_string(answer.answers.size()) + " answers");
+      }
+
+      std::array<Byte, 4> expected = { 192, 0, 2, 1 };
+      if (!std::ranges::equal(answer.answers[0].get_address(), expected)) {
+         return Error("Wrong address for " + name);
+      }
+      return Ok();
+   }
+};
+
+/* ------------------------------------------------------------------------------------------------------- */
+
+// Stand-in forwarders by index
+static constexpr size_t SLOW = 0, FAST = 1, MEDIUM = 2;
+
+static constexpr auto QUERY_TIMEOUT  = std::chrono::milliseconds(400);
+static constexpr auto MIN_RACE_DELAY = std::chrono::milliseconds(30);
+static constexpr auto MIN_BACKOFF    = std::chrono::milliseconds(600);
+
+/**
+ * Every question asks for a name of its own, so that none is answered from the cache.
+ */
+static std::string
+next_name() {
+   static size_t next = 0;
+   return "n" + std::to_string(next++) + ".check";
+}
+
+/**
+ * Asks `count` questions one after the other.
+ */
+static Result<void>
+ask(Client &client, size_t count) {
+   for (size_t i = 0; i < count; i++) {
+      auto res = client.ask(next_name());
+      RETURN_IF_ERROR(res);
+   }
+   return Ok();
+}
+
+static Result<void>
+expect_count(StandInForwarders &forwarders, size_t index, size_t before, size_t count) {
+   auto actual = forwarders.get_queries(index).size() - before;
+   if (actual != count) {
+      return Error("Expected " + std::to_string(count) + " queries at forwarder " + std::to_string(index)
+                   + ", got " + std::to_string(actual));
+   }
+   return Ok();
+}
+
+/* ------------------------------------------------------------------------------------------------------- */
+
+/**
+ * Once every forwarder has been measured, all questions go to the fastest one.
+ */
+static Result<void>
+check_fastest(StandInForwarders &forwarders, Server &server) {
+   auto client = Client::create(server.get_port());
+   RETURN_IF_ERROR(client);
+   auto res = ask(client.get_value(), 6);
+   RETURN_IF_ERROR(res);
+
+   auto slow = forwarders.get_queries(SLOW).size();
+   auto fast = forwarders.get_queries(FAST).size();
+   res       = ask(client.get_value(), 20);
+   RETURN_IF_ERROR(res);
+   res = expect_count(forwarders, FAST, fast, 20);
+   RETURN_IF_ERROR(res);
+   return expect_count(forwarders, SLOW, slow, 0);
+}
+
+/**
+ * The fastest forwarder suddenly takes long to answer: the question is raced to the second fastest, which
+ * answers first, and the client doesn't wait for the first one.
+ */
+static Result<void>
+check_race(StandInForwarders &forwarders, Server &server) {
+   auto client = Client::create(server.get_port());
+   RETURN_IF_ERROR(client);
+   auto res = ask(client.get_value(), 6);
+   RETURN_IF_ERROR(res);
+
+   forwarders.set_delay(FAST, QUERY_TIMEOUT - std::chrono::milliseconds(100));
+   auto stats  = server.get_resolver()->get_stats();
+   auto slow   = forwarders.get_queries(SLOW).size();
+   auto fast   = forwarders.get_queries(FAST).size();
+   auto medium = forwarders.get_queries(MEDIUM).size();
+
+   auto start = Clock::now();
+   res        = client.get_value().ask(next_name());
+   RETURN_IF_ERROR(res);
+   auto elapsed = std::chrono::duration_cast<std::chrono::milliseconds>(Clock::now() - start);
+   if (elapsed >= std::chrono::milliseconds(200)) {
+      return Error("The answer took " + std::to_string(elapsed.count()) + "ms");
+   }
+
+   auto after = server.get_resolver()->get_stats();
+   if (after.races != stats.races + 1 || after.races_won != stats.races_won + 1) {
+      return Error("Expected one race won by the second server, got "
+                   + std::to_string(after.races - stats.races) + " races and "
+                   + std::to_string(after.races_won - stats.races_won) + " won");
+   }
+
+   res = expect_count(forwarders, FAST, fast, 1);
+   RETURN_IF_ERROR(res);
+   res = expect_count(forwarders, MEDIUM, medium, 1);
+   RETURN_IF_ERROR(res);
+   return expect_count(forwarders, SLOW, slow, 0);
+}
+
+/**
+ * The fastest forwarder stops answering. Clients keep getting answers from the others, and once it has
+ * timed out often enough it is marked down: it gets nothing for `MIN_BACKOFF`, then a single probe, and
+ * nothing for twice as long after that probe fails as well.
+ */
+static Result<void>
+check_down(StandInForwarders &forwarders, Server &server) {
+   auto client = Client::create(server.get_port());
+   RETURN_IF_ERROR(client);
+   auto res = ask(client.get_value(), 6);
+   RETURN_IF_ERROR(res);
+
+   forwarders.set_drop(FAST, true);
+   auto before = forwarders.get_queries(FAST).size();
+   auto end    = Clock::now() + std::chrono::milliseconds(3500);
+   while (Clock::now() < end) {
+      res = client.get_value().ask(next_name());
+      RETURN_IF_ERROR(res);
+      std::this_thread::sleep_for(std::chrono::milliseconds(100));
+   }
+
+   // Margins for the queries that were already on their way when the state of the server changed
+   auto queries = forwarders.get_queries(FAST);
+   queries.erase(queries.begin(), queries.begin() + before);
+   auto gap = [&](size_t i) {
+      return std::chrono::duration_cast<std::chrono::milliseconds>(queries[i + 1] - queries[i]);
+   };
+
+   size_t down = 0;
+   while (down + 1 < queries.size() && gap(down) < MIN_BACKOFF * 4 / 5) {
+      down++;
+   }
+   if (down + 1 < 3) {
+      return Error("Marked down after " + std::to_string(down + 1) + " queries already");
+   }
+   if (down + 1 >= queries.size()) {
+      return Error("Never marked down, or never probed, in " + std::to_string(queries.size()) + " queries");
+   }
+   if (gap(down) >= MIN_BACKOFF * 2) {
+      return Error("Probed only " + std::to_string(gap(down).count()) + "ms after being marked down");
+   }
+
+   // The probe is given the query timeout, then the doubled backoff runs
+   size_t probe = down + 1;
+   if (probe + 1 < queries.size() && gap(probe) < QUERY_TIMEOUT + MIN_BACKOFF * 2 * 4 / 5) {
+      return Error("Queried again " + std::to_string(gap(probe).count()) + "ms after a failed probe");
+   }
+   return Ok();
+}
+
+/* ------------------------------------------------------------------------------------------------------- */
+
+int
+main() {
+   std::vector<std::tuple<const char *, Result<void> (*)(StandInForwarders &, Server &)>> checks = {
+      { "fastest forwarder", check_fastest },
+      { "late forwarder raced", check_race },
+      { "dropping forwarder down and probed", check_down },
+   };
+
+   int failed = 0;
+   for (const auto &[name, check] : checks) {
+      StandInForwarders forwarders;
+      forwarders.start().panic_if_error("Failed to start the stand-in forwarders");
+      forwarders.set_delay(SLOW, std::chrono::milliseconds(60));
+      forwarders.set_delay(FAST, std::chrono::milliseconds(5));
+      forwarders.set_delay(MEDIUM, std::chrono::milliseconds(30));
+
+      ServerConfig config;
+      config.address                         = "127.0.0.1";
+      config.port                            = 0;
+      config.threads                         = 1;
+      config.pin_threads                     = false;
+      config.tcp.threads                     = 0;
+      config.recursive                       = true;
+      config.resolver.query_timeout          = QUERY_TIMEOUT;
+      config.resolver.forward.servers        = forwarders.get_addresses();
+      config.resolver.forward.min_race_delay = MIN_RACE_DELAY;
+      config.resolver.forward.min_backoff    = MIN_BACKOFF;
+
+      Server server(config);
+      server.start().panic_if_error("Failed to start the server");
+
+      auto res = check(forwarders, server);
+      std::cout << (res ? "ok     " : "FAILED ") << name << std::endl;
+      if (!res) {
+         res.get_error().print(name);
+         failed++;
+      }
+
+      server.stop();
+      server.wait();
+      forwarders.stop();
+
+      if (!res) {
+         std::cout << std::endl;
+         server.get_resolver()->get_stats().print();
+      }
+   }
+
+   return failed == 0 ? EXIT_SUCCESS : EXIT_FAILURE;
+}
+
+/* ------------------------------------------------------------------------------------------------------- */
@@ -0,0 +1,227 @@
+/// @brief
+/// Macro benchmark for the UDP front end. Starts an in-process server on the loopback interface for every
+/// requested engine, floods it from a set of client threads and reports throughput together with the
+/// number of system calls the server needed per packet.
+
+#include <arpa/inet.h>
+#include <chrono>
+#include <cstring>
+#include <iostream>
+#include <netinet/in.h>
+#include <sys/socket.h>
+#include <thread>
+#include <unistd.h>
+
+#include <backbone/lib/server/server.hpp>
+
+/* ------------------------------------------------------------------------------------------------------- */
+
+class LoadConfig {
+public:
+   std::vector<EngineType> engines  = { EngineType::SOCKET, EngineType::URING };
+   size_t                  threads  = 1;
+   size_t                  clients  = 2;
+   double                  duration = 2.0;
+   bool                    json     = false;
+};
+
+/* ------------------------------------------------------------------------------------------------------- */
+
+class LoadResult {
+public:
+   const char *engine;
+   uint64_t    queries;
+   uint64_t    responses;
+   double      seconds;
+   ServerStats stats;
+};
+
+/* ------------------------------------------------------------------------------------------------------- */
+
+static std::vector<Byte>
+build_query(uint16_t id) {
+   std::vector<Byte> query = { static_cast<Byte>(id >> 8), static_cast<Byte>(id), 0x01, 0x00, 0, 1, 0, 0,
+                               0,
+                               0,
+                               0,
+                               0 };
+   for (const char *label : { "www", "example", "custom" }) {
+      query.push_back(strlen(label));
+      query.insert(query.end(), label, label + strlen(label));
+   }
+   query.insert(query.end(), { 0, 0, 1, 0, 1 });
+   return query;
+}
+
+/* ------------------------------------------------------------------------------------------------------- */
+
+static void
+run_client(uint16_t port, const std::atomic<bool> &running, uint64_t &queries, uint64_t &responses) {
+   constexpr size_t WINDOW = 32;
+
+   int fd = socket(AF_INET, SOCK_DGRAM, 0);
+
+   sockaddr_in address {};
+   address.sin_family      = AF_INET;
+   address.sin_port        = htons(port);
+   address.sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+   connect(fd, reinterpret_cast<sockaddr *>(&address), sizeof(address));
+
+   timeval timeout { .tv_sec = 0, .tv_usec = 10 * 1000 };
+   setsockopt(fd, SOL_SOCKET, SO_RCVTIMEO, &timeout, sizeof(timeout));
+
+   auto                                      query = build_query(0x1234);
+   std::array<iovec, WINDOW>                 out_vectors;
+   std::array<mmsghdr, WINDOW>               out_messages {};
+   std::array<std::array<Byte, 512>, WINDOW> in_buffers;
+   std::array<iovec, WINDOW>                 in_vectors;
+   std::array<mmsghdr, WINDOW>               in_messages {};
+   for (size_t i = 0; i < WINDOW; i++) {
+      out_vectors[i]                     = { query.data(), query.size() };
+      out_messages[i].msg_hdr.msg_iov    = &out_vectors[i];
+      out_messages[i].msg_hdr.msg_iovlen = 1;
+      in_vectors[i]                      = { in_buffers[i].data(), in_buffers[i].size() };
+      in_messages[i].msg_hdr.msg_iov     = &in_vectors[i];
+      in_messages[i].msg_hdr.msg_iovlen  = 1;
+   }
+
+   /* Keep a window of queries in flight, topping it up as responses come back */
+   size_t in_flight = 0;
+   while (running.load(std::memory_order_relaxed)) {
+      if (in_flight < WINDOW) {
+         int sent = sendmmsg(fd, out_messages.data(), WINDOW - in_flight, 0);
+         if (sent > 0) {
+            queries += sent;
+            in_flight += sent;
+         }
+      }
+
+      int received = recvmmsg(fd, in_messages.data(), WINDOW, MSG_WAITFORONE, nullptr);
+      if (received > 0) {
+         responses += received;
+         in_flight -= std::min<size_t>(in_flight, received);
+      } else {
+         in_flight = 0;   // assume everything outstanding was lost
+      }
+   }
+
+   close(fd);
+}
+
+/* ------------------------------------------------------------------------------------------------------- */
+
+static Result<LoadResult>
+run_engine(EngineType engine, const LoadConfig &config) {
+   ServerConfig server_config;
+   server_config.address     = "127.0.0.1";
+   server_config.port        = 0;
+   server_config.threads     = config.threads;
+   server_config.pin_threads = false;
+   server_config.engine      = engine;
+
+   Server server(server_config);
+   auto   res = server.start();
+   RETURN_IF_ERROR(res);
+
+   std::atomic<bool>     running(true);
+   std::vector<uint64_t> queries(config.clients, 0), responses(config.clients, 0);
+   std::vector<std::thread> clients;
+
+   auto start = std::chrono::steady_clock::now();
+   for (size_t i = 0; i < config.clients; i++) {
+      clients.emplace_back(
+          [&, i]() { run_client(server.get_port(), running, queries[i], responses[i]); });
+   }
+
+   std::this_thread::sleep_for(std::chrono::duration<double>(config.duration));
+   running.store(false);
+   for (auto &client : clients) {
+      client.join();
+   }
+   auto elapsed = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+
+   server.stop();
+   server.wait();
+
+   LoadResult result { GetEngineName(engine), 0, 0, elapsed, server.get_stats() };
+   for (size_t i = 0; i < config.clients; i++) {
+      result.queries += queries[i];
+      result.responses += responses[i];
+   }
+   return result;
+}
+
+/* ------------------------------------------------------------------------------------------------------- */
+
+static void
+print_result(const LoadResult &result, bool json) {
+   double qps      = result.responses / result.seconds;
+   double received = std::max<uint64_t>(result.stats.received, 1);
+   double recv_per = result.stats.recv_syscalls / received;
+   double send_per = result.stats.send_syscalls / received;
+
+   if (json) {
+      printf("{\"engine\":\"%s\",\"queries\":%lu,\"responses\":%lu,\"seconds\":%.3f,\"qps\":%.0f,"
+             "\"recv_syscalls_per_packet\":%.4f,\"send_syscalls_per_packet\":%.4f}\n",
+             result.engine,
+             result.queries,
+             result.responses,
+             result.seconds,
+             qps,
+             recv_per,
+             send_per);
+      return;
+   }
+
+   printf("%-10s %12.0f qps   %8.4f recv syscalls/pkt   %8.4f send syscalls/pkt   (%lu sent, %lu answered)\n",
+          result.engine,
+          qps,
+          recv_per,
+          send_per,
+          result.queries,
+          result.responses);
+}
+
+/* ------------------------------------------------------------------------------------------------------- */
+
+int
+main(int argc, char **argv) {
+   LoadConfig config;
+
+   for (int i = 1; i < argc; i++) {
+      std::string arg       = argv[i];
+      bool        has_value = i + 1 < argc;
+
+      if (arg == "--engine" && has_value) {
+         auto engine = ParseEngineType(argv[++i]);
+         engine.panic_if_error("Invalid engine");
+         config.engines = { engine.get_value() };
+      } else if (arg == "--threads" && has_value) {
+         config.threads = std::stoul(argv[++i]);
+      } else if (arg == "--clients" && has_value) {
+         config.clients = std::stoul(argv[++i]);
+      } else if (arg == "--duration" && has_value) {
+         config.duration = std::stod(argv[++i]);
+      } else if (arg == "--json") {
+         config.json = true;
+      } else {
+         std::cout << "Usage: " << argv[0]
+                   << " [--engine socket|io_uring] [--threads <count>] [--clients <count>]"
+                   << " [--duration <seconds>] [--json]" << std::endl;
+         return EXIT_FAILURE;
+      }
+   }
+
+   for (auto engine : config.engines) {
+      auto result = run_engine(engine, config);
+      if (!result) {
+         result.get_error().print(std::string("Engine ") + GetEngineName(engine) + " failed");
+         continue;
+      }
+      print_result(result.get_value(), config.json);
+   }
+
+   return 0;
+}
+
+/* ------------------------------------------------------------------------------------------------------- */
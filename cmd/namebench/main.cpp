@@ -0,0 +1,215 @@
+/// @brief
+/// Micro benchmark for the name kernel. Scans a fixed set of question names with the vector kernel and the
+/// scalar one, checks that both agree on every name (and that every name survives a round trip through
+/// `DomainName`) and reports the time each takes per name.
+
+#include <chrono>
+#include <cstring>
+#include <iostream>
+#include <random>
+#include <string>
+#include <vector>
+
+#include <backbone/lib/packet/domain.hpp>
+
+/* ------------------------------------------------------------------------------------------------------- */
+
+class BenchConfig {
+public:
+   size_t names      = 4096;
+   size_t iterations = 200;
+   bool   json       = false;
+};
+
+/* ------------------------------------------------------------------------------------------------------- */
+
+class BenchResult {
+public:
+   const char *kernel;
+   double      ns_per_name;
+   double      mb_per_second;
+};
+
+/* ------------------------------------------------------------------------------------------------------- */
+
+/**
+ * A query the way it arrives: header, then the question name in mixed case. Every fourth one gets a second
+ * question pointing into the first, so that compression pointers are part of the mix.
+ */
+class Message {
+public:
+   std::vector<Byte> bytes;
+   size_t            position;
+};
+
+/* ------------------------------------------------------------------------------------------------------- */
+
+static std::vector<Message>
+build_messages(size_t count) {
+   static const char ALPHABET[] = "abcdefghijklmnopqrstuvwxyzABCDEFGHIJKLMNOPQRSTUVWXYZ0123456789-_";
+
+   std::mt19937                       random(42);
+   std::uniform_int_distribution<int> labels(2, 5), length(1, 16), long_label(17, 63), character(0, 63);
+
+   std::vector<Message> messages(count);
+   for (size_t n = 0; n < count; n++) {
+      auto &bytes = messages[n].bytes;
+      bytes.assign(12, 0);
+
+      int label_count = labels(random);
+      for (int i = 0; i < label_count; i++) {
+         int len = (random() % 8 == 0) ? long_label(random) : length(random);
+         bytes.push_back(len);
+         for (int j = 0; j < len; j++) {
+            bytes.push_back(ALPHABET[character(random)]);
+         }
+      }
+      bytes.push_back(0);
+      bytes.insert(bytes.end(), { 0, 1, 0, 1 });
+      messages[n].position = 12;
+
+      if (n % 4 == 3) {
+         // "www" in front of the first name
+         messages[n].position = bytes.size();
+         bytes.insert(bytes.end(), { 3, 'W', 'w', 'W', 0xC0, 12, 0, 1, 0, 1 });
+      }
+   }
+   return messages;
+}
+
+/* ------------------------------------------------------------------------------------------------------- */
+
+/**
+ * Runs both kernels over every message and over every single byte corruption of a few of them.
+ */
+static bool
+verify(const std::vector<Message> &messages) {
+   NameKernel::Output vector_out, scalar_out;
+
+   auto same = [&](std::span<const Byte> bytes, size_t position) {
+      auto vector = NameKernel::scan(bytes, position, vector_out);
+      auto scalar = NameKernel::scan_scalar(bytes, position, scalar_out);
+      if (vector.is_error() || scalar.is_error()) {
+         return vector.is_error() == scalar.is_error();
+      }
+
+      auto &a    = vector.get_value();
+      auto &b    = scalar.get_value();
+      auto  wire = std::span<const Byte>(scalar_out.wire.data(), b.length);
+      return a.hash == b.hash && a.length == b.length && a.label_count == b.label_count && a.end == b.end &&
+             std::memcmp(vector_out.wire.data(), scalar_out.wire.data(), b.length) == 0 &&
+             std::memcmp(vector_out.offsets.data(), scalar_out.offsets.data(), b.label_count) == 0 &&
+             NameKernel::hash(wire) == b.hash;
+   };
+
+   // A name parsed back from its own dotted notation has to be the very same name
+   auto round_trip = [&](const Message &message) {
+      auto scan = NameKernel::scan(message.bytes, message.position, vector_out);
+      auto name = DomainName(vector_out, scan.get_value());
+      auto text = DomainName::from_string(name.to_string());
+      return !text.is_error() && text.get_value() == name && name.intern() == name;
+   };
+
+   for (size_t n = 0; n < messages.size(); n++) {
+      const auto &message = messages[n];
+      if (!same(message.bytes, message.position) || !round_trip(message)) {
+         std::cerr << "Kernels disagree on message " << n << std::endl;
+         return false;
+      }
+
+      if (n % 64 != 0) {
+         continue;
+      }
+
+      for (size_t i = 12; i < message.bytes.size(); i++) {
+         for (int value : { 0x00, 0x20, 0x2E, 0x41, 0x5A, 0x7F, 0x80, 0xC0, 0xFF }) {
+            auto corrupted = message.bytes;
+            corrupted[i]   = value;
+            if (!same(corrupted, message.position)) {
+               std::cerr << "Kernels disagree on message " << n << " corrupted at " << i << std::endl;
+               return false;
+            }
+         }
+      }
+   }
+
+   return true;
+}
+
+/* ------------------------------------------------------------------------------------------------------- */
+
+template<typename Scan>
+static BenchResult
+run_kernel(const char *kernel, Scan scan, const std::vector<Message> &messages, const BenchConfig &config) {
+   NameKernel::Output out;
+   uint64_t           checksum = 0;
+   size_t             bytes    = 0;
+
+   auto start = std::chrono::steady_clock::now();
+   for (size_t iteration = 0; iteration < config.iterations; iteration++) {
+      for (const auto &message : messages) {
+         auto res = scan(message.bytes, message.position, out);
+         checksum += res.get_value().hash;
+         bytes += res.get_value().length;
+      }
+   }
+   auto elapsed = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+
+   // Keeps the loop from being optimized away
+   volatile uint64_t sink = checksum;
+   (void)sink;
+
+   double scans = static_cast<double>(config.iterations) * messages.size();
+   return BenchResult { kernel, elapsed * 1e9 / scans, bytes / elapsed / 1e6 };
+}
+
+/* ------------------------------------------------------------------------------------------------------- */
+
+static void
+print_result(const BenchResult &result, bool json) {
+   if (json) {
+      printf("{\"kernel\":\"%s\",\"ns_per_name\":%.2f,\"mb_per_second\":%.1f}\n",
+             result.kernel,
+             result.ns_per_name,
+             result.mb_per_second);
+      return;
+   }
+
+   printf("%-8s %8.2f ns/name   %8.1f MB/s\n", result.kernel, result.ns_per_name, result.mb_per_second);
+}
+
+/* ------------------------------------------------------------------------------------------------------- */
+
+int
+main(int argc, char **argv) {
+   BenchConfig config;
+
+   for (int i = 1; i < argc; i++) {
+      std::string arg       = argv[i];
+      bool        has_value = i + 1 < argc;
+
+      if (arg == "--names" && has_value) {
+         config.names = std::stoul(argv[++i]);
+      } else if (arg == "--iterations" && has_value) {
+         config.iterations = std::stoul(argv[++i]);
+      } else if (arg == "--json") {
+         config.json = true;
+      } else {
+         std::cout << "Usage: " << argv[0] << " [--names <count>] [--iterations <count>] [--json]"
+                   << std::endl;
+         return EXIT_FAILURE;
+      }
+   }
+
+   auto messages = build_messages(config.names);
+   if (!verify(messages)) {
+      return EXIT_FAILURE;
+   }
+
+   print_result(run_kernel("scalar", NameKernel::scan_scalar, messages, config), config.json);
+   print_result(run_kernel(NameKernel::get_isa(), NameKernel::scan, messages, config), config.json);
+
+   return 0;
+}
+
+/* ------------------------------------------------------------------------------------------------------- */
@@ -0,0 +1,900 @@
+/// @brief
+/// End-to-end check of iterative resolution against stand-in name servers. Serves a root, `test.`,
+/// `other.` and `sub.test.` from 127.0.0.1 to 127.0.0.4, points a recursive server at them as its root
+/// hints and asks it questions covering coalescing, glueless delegations, CNAMEs across zones, negative
+/// answers, EDNS0 clients, answers too large for a datagram and the case of question names. The name
+/// servers count every question they get, so the checks see what went upstream. Exits with a failure if
+/// any check fails, which is what the `resolver` test looks at.
+
+#include <algorithm>
+#include <arpa/inet.h>
+#include <array>
+#include <atomic>
+#include <chrono>
+#include <iostream>
+#include <map>
+#include <mutex>
+#include <optional>
+#include <poll.h>
+#include <span>
+#include <string>
+#include <sys/socket.h>
+#include <thread>
+#include <unistd.h>
+#include <tuple>
+#include <vector>
+
+#include <backbone/lib/packet/packet.hpp>
+#include <backbone/lib/server/server.hpp>
+#include <backbone/lib/server/socket.hpp>
+
+/* ------------------------------------------------------------------------------------------------------- */
+
+using Clock      = std::chrono::steady_clock;
+using RecordType = PacketRecord::RecordType;
+
+/* ------------------------------------------------------------------------------------------------------- */
+
+static std::vector<Byte>
+name_rdata(const std::string &dotted) {
+   auto name = DomainName::from_string(dotted).panic_if_error("Invalid name").get_value();
+   auto wire = name.get_wire();
+   return { wire.begin(), wire.end() };
+}
+
+static std::vector<Byte>
+address_rdata(const char *text) {
+   std::vector<Byte> rdata(4);
+   inet_pton(AF_INET, text, rdata.data());
+   return rdata;
+}
+
+static std::vector<Byte>
+soa_rdata(const std::string &zone) {
+   // Primary server, mailbox, then serial, refresh, retry, expire and a minimum of 60 seconds
+   auto suffix  = zone == "." ? "" : "." + zone;
+   auto rdata   = name_rdata("ns1" + suffix);
+   auto mailbox = name_rdata("hostmaster" + suffix);
+   rdata.insert(rdata.end(), mailbox.begin(), mailbox.end());
+   rdata.insert(rdata.end(), { 0, 0, 0, 1, 0, 0, 0, 2, 0, 0, 0, 3, 0, 0, 0, 4, 0, 0, 0, 60 });
+   return rdata;
+}
+
+/* ------------------------------------------------------------------------------------------------------- */
+
+class StandInRecord {
+public:
+   std::string       name;
+   RecordType        type;
+   std::vector<Byte> rdata;
+};
+
+class StandInReply {
+public:
+   PacketHeader::ResultCode   code          = PacketHeader::NO_ERROR;
+   bool                       authoritative = true;
+   std::vector<StandInRecord> answers;
+   std::vector<StandInRecord> authorities;
+   std::vector<StandInRecord> additionals;
+   std::chrono::milliseconds  delay { 0 };
+};
+
+/* ------------------------------------------------------------------------------------------------------- */
+
+/**
+ * @brief
+ * Four stand-in name servers, each on its own loopback address, answering from a fixed table.
+ *
+ * @details
+ * - 127.0.0.1 is the root. It refers `test.` to `ns1.test.` (127.0.0.2) and `other.` to `ns1.other.`
+ *   (127.0.0.3), both with glue, and has no other names.
+ * - 127.0.0.2 serves `test.`: `www` (A, answered after `DELAY` so that concurrent questions pile up),
+ *   `alias` (CNAME to `www.test.`), `ext` (CNAME to `www.other.`), a referral for `sub.test.` to
+ *   `ns2.other.` without glue, `big` and `huge` with `BIG` and `HUGE` A records, and `lower`, whose
+ *   question is echoed in lowercase like a spoofer not knowing its case would.
+ * - 127.0.0.3 serves `other.`: `www`, `ns1` and `ns2`, which is 127.0.0.4.
+ * - 127.0.0.4 serves `sub.test.`: `host`.
+ *
+ * Everything else is NXDOMAIN, or NODATA for names that exist, with the SOA of the zone. All servers
+ * share one thread and one port, and answer over TCP too. Over UDP, responses larger than the payload size
+ * of the query's OPT record (512 bytes without one) are truncated down to the question.
+ */
+class StandInServers {
+public:
+   static constexpr auto   DELAY = std::chrono::milliseconds(300);
+   static constexpr size_t BIG   = 60;    // fits into an EDNS0 datagram, not into a plain one
+   static constexpr size_t HUGE  = 100;   // only fits into a TCP message
+
+private:
+   struct Pending {
+      Clock::time_point due;
+      int               fd;
+      std::vector<Byte> response;
+      sockaddr_storage  peer;
+      socklen_t         peer_length;
+   };
+
+   std::vector<UdpSocket>   m_Sockets;
+   std::vector<TcpListener> m_Listeners;
+   uint16_t                 m_Port;
+   std::atomic<bool>      m_Stop;
+   std::thread            m_Thread;
+
+   std::mutex                                                      m_Lock;
+   std::map<std::tuple<size_t, std::string, uint16_t, bool>, size_t> m_Counts;
+   size_t                                                          m_Uppercase = 0;
+
+public:
+   StandInServers() : m_Port(0), m_Stop(false) {}
+   StandInServers(const StandInServers &) = delete;
+   ~StandInServers() { stop(); }
+
+   /**
+    * Binds 127.0.0.1 to a free port and the other addresses to the same one, then starts serving.
+    */
+   Result<void>
+   start() {
+      for (size_t i = 0; i < 4; i++) {
+         auto address = "127.0.0." + std::to_string(i + 1);
+         auto socket  = UdpSocket::bind(address, m_Port, false).except("Failed to bind " + address);
+         RETURN_IF_ERROR(socket);
+
+         m_Port = socket.get_value().get_port();
+         m_Sockets.push_back(std::move(socket.get_value()));
+
+         auto listener = TcpListener::bind(address, m_Port, false).except("Failed to listen on " + address);
+         RETURN_IF_ERROR(listener);
+         m_Listeners.push_back(std::move(listener.get_value()));
+      }
+
+      m_Thread = std::thread([this]() { run(); });
+      return Ok();
+   }
+
+   void
+   stop() {
+      m_Stop.store(true);
+      if (m_Thread.joinable()) {
+         m_Thread.join();
+      }
+   }
+
+   uint16_t
+   get_port() const {
+      return m_Port;
+   }
+
+   /**
+    * Questions for `name` and `type` server `index` (0 for 127.0.0.1) got so far, over UDP or over TCP.
+    */
+   size_t
+   get_count(size_t index, const std::string &name, RecordType type, bool tcp = false) {
+      std::lock_guard lock(m_Lock);
+      auto            it = m_Counts.find({ index, name, type, tcp });
+      return it == m_Counts.end() ? 0 : it->second;
+   }
+
+   /**
+    * Questions so far whose name had an uppercase letter.
+    */
+   size_t
+   get_uppercase() {
+      std::lock_guard lock(m_Lock);
+      return m_Uppercase;
+   }
+
+private:
+   static bool
+   is_below(const std::string &name, const std::string &zone) {
+      return name == zone || (name.size() > zone.size() && name.ends_with("." + zone));
+   }
+
+   static StandInReply
+   answer(size_t index, const std::string &name, RecordType type) {
+      StandInReply reply;
+      auto         missing = [&](const std::string &zone, bool exists) {
+         reply.code        = exists ? PacketHeader::NO_ERROR : PacketHeader::NAME_ERROR;
+         reply.authorities = { { zone, RecordType::SOA, soa_rdata(zone) } };
+      };
+
+      switch (index) {
+         case 0:
+            if (is_below(name, "test")) {
+               reply.authoritative = false;
+               reply.authorities   = { { "test", RecordType::NS, name_rdata("ns1.test") } };
+               reply.additionals   = { { "ns1.test", RecordType::A, address_rdata("127.0.0.2") } };
+            } else if (is_below(name, "other")) {
+               reply.authoritative = false;
+               reply.authorities   = { { "other", RecordType::NS, name_rdata("ns1.other") } };
+               reply.additionals   = { { "ns1.other", RecordType::A, address_rdata("127.0.0.3") } };
+            } else {
+               missing(".", name == ".");
+            }
+            break;
+
+         case 1:
+            if (is_below(name, "sub.test")) {
+               reply.authoritative = false;
+               reply.authorities   = { { "sub.test", RecordType::NS, name_rdata("ns2.other") } };
+            } else if (name == "www.test" && type == RecordType::A) {
+               reply.answers = { { name, RecordType::A, address_rdata("192.0.2.1") } };
+               reply.delay   = DELAY;
+            } else if (name == "alias.test") {
+               reply.answers = { { name, RecordType::CNAME, name_rdata("www.test") } };
+            } else if (name == "ext.test") {
+               reply.answers = { { name, RecordType::CNAME, name_rdata("www.other") } };
+            } else if (name == "lower.test" && type == RecordType::A) {
+               reply.answers = { { name, RecordType::A, address_rdata("192.0.2.4") } };
+            } else if ((name == "big.test" || name == "huge.test") && type == RecordType::A) {
+               for (size_t i = 0; i < (name == "big.test" ? BIG : HUGE); i++) {
+                  auto address = "192.0.2." + std::to_string(i + 1);
+                  reply.answers.push_back({ name, RecordType::A, address_rdata(address.c_str()) });
+               }
+            } else {
+               missing("test", name == "test" || name == "www.test" || name == "ns1.test");
+            }
+            break;
+
+         case 2:
+            if (name == "www.other" && type == RecordType::A) {
+               reply.answers = { { name, RecordType::A, address_rdata("192.0.2.2") } };
+            } else if (name == "ns1.other" && type == RecordType::A) {
+               reply.answers = { { name, RecordType::A, address_rdata("127.0.0.3") } };
+            } else if (name == "ns2.other" && type == RecordType::A) {
+               reply.answers = { { name, RecordType::A, address_rdata("127.0.0.4") } };
+            } else {
+               missing("other",
+                       name == "other" || name == "www.other" || name == "ns1.other" || name == "ns2.other");
+            }
+            break;
+
+         default:
+            if (name == "host.sub.test" && type == RecordType::A) {
+               reply.answers = { { name, RecordType::A, address_rdata("192.0.2.3") } };
+            } else {
+               missing("sub.test", name == "sub.test" || name == "host.sub.test");
+            }
+            break;
+      }
+
+      return reply;
+   }
+
+   std::optional<std::vector<Byte>>
+   respond(size_t index, std::span<const Byte> request, bool tcp, std::chrono::milliseconds &delay) {
+      PacketBuffer buffer(BufferPool::TCP_SIZE);
+      auto         _      = buffer.write(request);
+      auto         _query = Packet::from_buffer(buffer);
+      if (!_query || _query.get_value().questions.size() != 1) {
+         return std::nullopt;
+      }
+      const auto &query    = _query.get_value();
+      const auto &question = query.questions[0];
+      auto        name     = question.get_name().to_string();
+      auto        reply    = answer(index, name, question.get_type());
+
+      auto length    = question.get_name().get_wire().size();
+      auto echoed    = request.subspan(PacketHeader::SIZE, length);
+      bool uppercase = std::any_of(echoed.begin(), echoed.end(), [](Byte byte) {
+         return byte >= 'A' && byte <= 'Z';
+      });
+      {
+         std::lock_guard lock(m_Lock);
+         m_Counts[{ index, name, question.get_type(), tcp }]++;
+         m_Uppercase += uppercase;
+      }
+
+      size_t limit = tcp ? BufferPool::TCP_SIZE : BufferPool::UDP_SIZE;
+      for (const auto &record : query.additionals) {
+         if (record.get_type() == RecordType::OPT && !tcp) {
+            limit = std::max<size_t>(limit, record.get_class());
+         }
+      }
+
+      auto header = PacketHeader(query.header.id,
+                                 true,
+                                 0,
+                                 reply.authoritative,
+                                 false,
+                                 query.header.recursion_desired,
+                                 false,
+                                 0,
+                                 reply.code,
+                                 1,
+                                 reply.answers.size(),
+                                 reply.authorities.size(),
+                                 reply.additionals.size());
+
+      auto packet = Packet(header);
+      packet.questions.push_back(question);
+
+      auto add = [](std::pmr::vector<PacketRecord> &section, const std::vector<StandInRecord> &records) {
+         for (const auto &record : records) {
+            auto owner = DomainName::from_string(record.name).panic_if_error("Invalid name").get_value();
+            section.push_back(PacketRecord::from_rdata(owner, record.type, 1, 300, record.rdata)
+                                  .panic_if_error("Invalid record")
+                                  .get_value());
+         }
+      };
+      add(packet.answers, reply.answers);
+      add(packet.authorities, reply.authorities);
+      add(packet.additionals, reply.additionals);
+
+      PacketBuffer output(BufferPool::TCP_SIZE);
+      _ = packet.write_to_buffer(output).panic_if_error("Failed to encode a response");
+      if (output.get_write_index() > limit) {
+         packet.header.truncated_message = true;
+         packet.header.answer_count      = 0;
+         packet.header.authority_count   = 0;
+         packet.header.additional_count  = 0;
+         packet.answers.clear();
+         packet.authorities.clear();
+         packet.additionals.clear();
+
+         output = PacketBuffer(BufferPool::TCP_SIZE);
+         _      = packet.write_to_buffer(output).panic_if_error("Failed to encode a response");
+      }
+
+      // Names come out of a message in lowercase, while the question has to be echoed in its own case
+      auto *data = output.get_data();
+      if (name != "lower.test") {
+         std::copy(echoed.begin(), echoed.end(), data + PacketHeader::SIZE);
+      }
+
+      delay = reply.delay;
+      return std::vector<Byte>(data, data + output.get_write_index());
+   }
+
+   /**
+    * Answers the one query of a TCP connection right away, whatever the delay of the answer.
+    */
+   void
+   serve_connection(size_t index, int fd) {
+      auto read = [fd](Byte *data, size_t length) {
+         for (size_t done = 0; done < length;) {
+            pollfd  poll_fd { .fd = fd, .events = POLLIN, .revents = 0 };
+            ssize_t count = poll(&poll_fd, 1, 1000) > 0 ? ::recv(fd, data + done, length - done, 0) : 0;
+            if (count <= 0) {
+               return false;
+            }
+            done += count;
+         }
+         return true;
+      };
+
+      std::array<Byte, 2>    prefix;
+      std::array<Byte, 4096> request;
+      size_t                 length = 0;
+      if (read(prefix.data(), 2) && (length = (prefix[0] << 8) | prefix[1]) <= request.size() &&
+          read(request.data(), length)) {
+         std::chrono::milliseconds delay(0);
+         auto response = respond(index, { request.data(), length }, true, delay);
+         if (response) {
+            std::vector<Byte> message = { Byte(response->size() >> 8), Byte(response->size() & 0xFF) };
+            message.insert(message.end(), response->begin(), response->end());
+            [[maybe_unused]] ssize_t sent = ::send(fd, message.data(), message.size(), MSG_NOSIGNAL);
+         }
+      }
+      ::close(fd);
+   }
+
+   void
+   run() {
+      std::vector<pollfd> fds;
+      for (const auto &socket : m_Sockets) {
+         fds.push_back({ .fd = socket.get_fd(), .events = POLLIN, .revents = 0 });
+      }
+      for (const auto &listener : m_Listeners) {
+         fds.push_back({ .fd = listener.get_fd(), .events = POLLIN, .revents = 0 });
+      }
+
+      std::vector<Pending>   pending;
+      std::array<Byte, 4096> buffer;
+      while (!m_Stop.load()) {
+         poll(fds.data(), fds.size(), 10);
+
+         for (size_t i = 0; i < m_Listeners.size(); i++) {
+            for (int fd; (fd = m_Listeners[i].accept()) >= 0;) {
+               serve_connection(i, fd);
+            }
+         }
+
+         for (size_t i = 0; i < m_Sockets.size(); i++) {
+            int fd = fds[i].fd;
+            while (true) {
+               Pending   entry {};
+               auto     *peer   = reinterpret_cast<sockaddr *>(&entry.peer);
+               socklen_t length = sizeof(entry.peer);
+               ssize_t   count  = recvfrom(fd, buffer.data(), buffer.size(), MSG_DONTWAIT, peer, &length);
+               if (count < 0) {
+                  break;
+               }
+
+               std::chrono::milliseconds delay(0);
+               auto response = respond(i, { buffer.data(), size_t(count) }, false, delay);
+               if (response) {
+                  entry.due         = Clock::now() + delay;
+                  entry.fd          = fd;
+                  entry.response    = std::move(response.value());
+                  entry.peer_length = length;
+                  pending.push_back(std::move(entry));
+               }
+            }
+         }
+
+         auto now = Clock::now();
+         std::erase_if(pending, [now](const Pending &entry) {
+            if (entry.due > now) {
+               return false;
+            }
+            sendto(entry.fd,
+                   entry.response.data(),
+                   entry.response.size(),
+                   0,
+                   reinterpret_cast<const sockaddr *>(&entry.peer),
+                   entry.peer_length);
+            return true;
+         });
+      }
+   }
+};
+
+/* ------------------------------------------------------------------------------------------------------- */
+
+/**
+ * @brief
+ * Client of the server under test, one socket per outstanding question, or a connection of its own for
+ * questions asked over TCP.
+ */
+class Client {
+private:
+   UdpSocket m_Socket;
+   uint16_t  m_Port;
+   uint16_t  m_Id;
+
+public:
+   Client(UdpSocket socket, uint16_t port, uint16_t id)
+       : m_Socket(std::move(socket)), m_Port(port), m_Id(id) {}
+
+   static Result<Client>
+   create(uint16_t port, uint16_t id) {
+      auto socket = UdpSocket::bind("127.0.0.1", 0, false).except("Failed to bind a client socket");
+      RETURN_IF_ERROR(socket);
+      return Client(std::move(socket.get_value()), port, id);
+   }
+
+   /**
+    * Query for `name` and `type`, offering EDNS0 with a UDP payload of `payload` bytes unless it is 0.
+    */
+   Result<std::vector<Byte>>
+   encode(const std::string &name, RecordType type, uint16_t payload = 0) {
+      auto header = PacketHeader(
+          m_Id, false, 0, false, false, true, false, 0, PacketHeader::NO_ERROR, 1, 0, 0, 0);
+      auto packet = Packet(header);
+      auto _name  = DomainName::from_string(name).except("Invalid question name");
+      RETURN_IF_ERROR(_name);
+      packet.questions.emplace_back(_name.get_value(), type, 1);
+
+      PacketBuffer buffer;
+      auto         res = packet.write_to_buffer(buffer).except("Failed to encode a query");
+      RETURN_IF_ERROR(res);
+
+      std::vector<Byte> query(buffer.get_data(), buffer.get_data() + buffer.get_write_index());
+      if (payload > 0) {
+         // OPT record: root owner, the payload size in place of the class, no flags nor options
+         query[11] = 1;
+         query.insert(query.end(), { 0, 0, Byte(RecordType::OPT), Byte(payload >> 8), Byte(payload & 0xFF) });
+         query.insert(query.end(), { 0, 0, 0, 0, 0, 0 });
+      }
+      return query;
+   }
+
+   sockaddr_in
+   get_server() const {
+      sockaddr_in server { .sin_family = AF_INET, .sin_port = htons(m_Port), .sin_addr = {}, .sin_zero = {} };
+      inet_pton(AF_INET, "127.0.0.1", &server.sin_addr);
+      return server;
+   }
+
+   Result<void>
+   send(const std::string &name, RecordType type, uint16_t payload = 0) {
+      auto query = encode(name, type, payload);
+      RETURN_IF_ERROR(query);
+
+      auto        server  = get_server();
+      const auto &message = query.get_value();
+      if (sendto(m_Socket.get_fd(),
+                 message.data(),
+                 message.size(),
+                 0,
+                 reinterpret_cast<const sockaddr *>(&server),
+                 sizeof(server)) < 0) {
+         return Error("Failed to send a query");
+      }
+      return Ok();
+   }
+
+   Result<Packet>
+   receive(std::chrono::milliseconds timeout = std::chrono::seconds(5)) {
+      pollfd poll_fd { .fd = m_Socket.get_fd(), .events = POLLIN, .revents = 0 };
+      if (poll(&poll_fd, 1, timeout.count()) <= 0) {
+         return Error("No response within " + std::to_string(timeout.count()) + "ms");
+      }
+
+      PacketBuffer buffer(BufferPool::TCP_SIZE);
+      ssize_t      count = recv(m_Socket.get_fd(), buffer.get_data(), buffer.get_capacity(), 0);
+      if (count < 0) {
+         return Error("Failed to receive a response");
+      }
+      auto _ = buffer.seek_write(count);
+
+      auto packet = Packet::from_buffer(buffer).except("Invalid response");
+      RETURN_IF_ERROR(packet);
+      if (packet.get_value().header.id != m_Id) {
+         return Error("Response to another query");
+      }
+      return packet;
+   }
+
+   Result<Packet>
+   ask(const std::string &name, RecordType type, uint16_t payload = 0) {
+      auto res = send(name, type, payload);
+      RETURN_IF_ERROR(res);
+      return receive();
+   }
+
+   Result<Packet>
+   ask_tcp(const std::string &name, RecordType type) {
+      auto query = encode(name, type);
+      RETURN_IF_ERROR(query);
+
+      int fd = ::socket(AF_INET, SOCK_STREAM | SOCK_CLOEXEC, 0);
+      if (fd < 0) {
+         return Error("Failed to create a TCP socket");
+      }
+      timeval timeout { .tv_sec = 5, .tv_usec = 0 };
+      setsockopt(fd, SOL_SOCKET, SO_RCVTIMEO, &timeout, sizeof(timeout));
+
+      auto read = [fd](Byte *data, size_t length) {
+         for (size_t done = 0; done < length;) {
+            ssize_t count = ::recv(fd, data + done, length - done, 0);
+            if (count <= 0) {
+               return false;
+            }
+            done += count;
+         }
+         return true;
+      };
+
+      /* One length-prefixed message each way */
+      auto                server  = get_server();
+      auto               &message = query.get_value();
+      std::array<Byte, 2> prefix  = { Byte(message.size() >> 8), Byte(message.size() & 0xFF) };
+      message.insert(message.begin(), prefix.begin(), prefix.end());
+
+      PacketBuffer buffer(BufferPool::TCP_SIZE);
+      bool         ok = ::connect(fd, reinterpret_cast<const sockaddr *>(&server), sizeof(server)) == 0 &&
+                ::send(fd, message.data(), message.size(), MSG_NOSIGNAL) == ssize_t(message.size()) &&
+                read(prefix.data(), 2) && read(buffer.get_data(), (prefix[0] << 8) | prefix[1]);
+      ::close(fd);
+      if (!ok) {
+         return Error("No response over TCP");
+      }
+      auto _ = buffer.seek_write((prefix[0] << 8) | prefix[1]);
+
+      auto packet = Packet::from_buffer(buffer).except("Invalid response");
+      RETURN_IF_ERROR(packet);
+      if (packet.get_value().header.id != m_Id) {
+         return Error("Response to another query");
+      }
+      return packet;
+   }
+};
+
+/* ------------------------------------------------------------------------------------------------------- */
+
+/**
+ * Checks that `response` answers with `code` and ends its answer section in an A record of `address`,
+ * after the CNAMEs in `chain`.
+ */
+static Result<void>
+expect_answer(const Packet &response, const std::vector<std::string> &chain, const char *address) {
+   if (response.header.response_code != PacketHeader::NO_ERROR) {
+      return Error("Expected NOERROR, got rcode " + std::to_string(response.header.response_code));
+   }
+   if (response.answers.size() != chain.size() + 1) {
+      return Error("Expected " + std::to_string(chain.size() + 1) + " answers, got "
+                   + std::to_string(response.answers.size()));
+   }
+
+   for (size_t i = 0; i < chain.size(); i++) {
+      const auto &record = response.answers[i];
+      auto        target = name_rdata(chain[i]);
+      if (record.get_type() != RecordType::CNAME || !std::ranges::equal(record.get_target(), target)) {
+         return Error("Answer " + std::to_string(i + 1) + " is not a CNAME to " + chain[i]);
+      }
+   }
+
+   const auto &last     = response.answers.back();
+   auto        expected = address_rdata(address);
+   if (last.get_type() != RecordType::A || !std::ranges::equal(last.get_address(), expected)) {
+      return Error(std::string("Last answer is not an A record of ") + address);
+   }
+   return Ok();
+}
+
+/**
+ * Checks that `response` is negative (NXDOMAIN, or NODATA with `code` NOERROR) and carries the SOA of
+ * `zone` to cache it by.
+ */
+static Result<void>
+expect_negative(const Packet &response, PacketHeader::ResultCode code, const std::string &zone) {
+   if (response.header.response_code != code) {
+      return Error("Expected rcode " + std::to_string(code) + ", got "
+                   + std::to_string(response.header.response_code));
+   }
+   if (!response.answers.empty()) {
+      return Error("Expected no answers, got " + std::to_string(response.answers.size()));
+   }
+
+   auto apex = DomainName::from_string(zone).panic_if_error("Invalid zone").get_value();
+   for (const auto &record : response.authorities) {
+      if (record.get_type() == RecordType::SOA && record.get_name() == apex) {
+         return Ok();
+      }
+   }
+   return Error("No SOA of " + zone + " in the authority section");
+}
+
+static Result<void>
+expect_count(StandInServers    &servers,
+             size_t             index,
+             const std::string &name,
+             RecordType         type,
+             size_t             count,
+             bool               tcp = false) {
+   auto actual = servers.get_count(index, name, type, tcp);
+   if (actual != count) {
+      return Error("Expected " + std::to_string(count) + (tcp ? " TCP" : " UDP") + " upstream queries for "
+                   + name + ", got " + std::to_string(actual));
+   }
+   return Ok();
+}
+
+/* ------------------------------------------------------------------------------------------------------- */
+
+// Stand-in name servers by index, 0 being the root
+static constexpr size_t TEST = 1, OTHER = 2, SUB = 3;
+static constexpr size_t CONCURRENT = 50;
+
+/**
+ * `CONCURRENT` clients ask for the same name at once, while its name server takes `DELAY` to answer. They
+ * must all get the answer from a single upstream query, and a client asking later gets it from the cache.
+ */
+static Result<void>
+check_coalescing(StandInServers &servers, uint16_t port) {
+   std::vector<Client> clients;
+   for (size_t i = 0; i < CONCURRENT; i++) {
+      auto client = Client::create(port, 0x1000 + i);
+      RETURN_IF_ERROR(client);
+      clients.push_back(std::move(client.get_value()));
+   }
+
+   for (auto &client : clients) {
+      auto res = client.send("www.test", RecordType::A);
+      RETURN_IF_ERROR(res);
+   }
+   for (auto &client : clients) {
+      auto response = client.receive();
+      RETURN_IF_ERROR(response);
+      auto res = expect_answer(response.get_value(), {}, "192.0.2.1");
+      RETURN_IF_ERROR(res);
+   }
+
+   auto res = expect_count(servers, TEST, "www.test", RecordType::A, 1);
+   RETURN_IF_ERROR(res);
+
+   auto late = Client::create(port, 0x2000);
+   RETURN_IF_ERROR(late);
+   auto response = late.get_value().ask("www.test", RecordType::A);
+   RETURN_IF_ERROR(response);
+   res = expect_answer(response.get_value(), {}, "192.0.2.1");
+   RETURN_IF_ERROR(res);
+   return expect_count(servers, TEST, "www.test", RecordType::A, 1);
+}
+
+/**
+ * `sub.test.` is delegated to `ns2.other.` without glue, so the resolver has to resolve the name server
+ * in another zone before it can continue.
+ */
+static Result<void>
+check_glueless(StandInServers &servers, uint16_t port) {
+   auto client = Client::create(port, 0x3000);
+   RETURN_IF_ERROR(client);
+   auto response = client.get_value().ask("host.sub.test", RecordType::A);
+   RETURN_IF_ERROR(response);
+   auto res = expect_answer(response.get_value(), {}, "192.0.2.3");
+   RETURN_IF_ERROR(res);
+   res = expect_count(servers, OTHER, "ns2.other", RecordType::A, 1);
+   RETURN_IF_ERROR(res);
+   return expect_count(servers, SUB, "host.sub.test", RecordType::A, 1);
+}
+
+/**
+ * A CNAME within `test.`, and one into `other.` that has to be followed from the root.
+ */
+static Result<void>
+check_cname(StandInServers &servers, uint16_t port) {
+   auto client = Client::create(port, 0x4000);
+   RETURN_IF_ERROR(client);
+
+   auto response = client.get_value().ask("alias.test", RecordType::A);
+   RETURN_IF_ERROR(response);
+   auto res = expect_answer(response.get_value(), { "www.test" }, "192.0.2.1");
+   RETURN_IF_ERROR(res);
+
+   response = client.get_value().ask("ext.test", RecordType::A);
+   RETURN_IF_ERROR(response);
+   res = expect_answer(response.get_value(), { "www.other" }, "192.0.2.2");
+   RETURN_IF_ERROR(res);
+   return expect_count(servers, OTHER, "www.other", RecordType::A, 1);
+}
+
+/**
+ * NXDOMAIN and NODATA come back with the SOA of their zone and are cached: asking again doesn't go
+ * upstream.
+ */
+static Result<void>
+check_negative(StandInServers &servers, uint16_t port) {
+   auto client = Client::create(port, 0x5000);
+   RETURN_IF_ERROR(client);
+
+   for (int round = 0; round < 2; round++) {
+      auto response = client.get_value().ask("missing.test", RecordType::A);
+      RETURN_IF_ERROR(response);
+      auto res = expect_negative(response.get_value(), PacketHeader::NAME_ERROR, "test");
+      RETURN_IF_ERROR(res);
+
+      response = client.get_value().ask("www.test", RecordType::AAAA);
+      RETURN_IF_ERROR(response);
+      res = expect_negative(response.get_value(), PacketHeader::NO_ERROR, "test");
+      RETURN_IF_ERROR(res);
+   }
+
+   auto res = expect_count(servers, TEST, "missing.test", RecordType::A, 1);
+   RETURN_IF_ERROR(res);
+   return expect_count(servers, TEST, "www.test", RecordType::AAAA, 1);
+}
+
+/**
+ * Clients offering EDNS0 get answers beyond 512 bytes over UDP, up to the payload size they advertise,
+ * first from upstream and then from the cache. Answers larger than that, or any larger than 512 bytes for
+ * clients without EDNS0, come back truncated.
+ */
+static Result<void>
+check_edns(StandInServers &, uint16_t port) {
+   auto client = Client::create(port, 0x8000);
+   RETURN_IF_ERROR(client);
+
+   for (int round = 0; round < 2; round++) {
+      for (auto [name, payload, count] : { std::tuple { "big.test", 1232, StandInServers::BIG },
+                                           std::tuple { "huge.test", 1232, size_t(0) },
+                                           std::tuple { "big.test", 600, size_t(0) },
+                                           std::tuple { "big.test", 0, size_t(0) } }) {
+         auto response = client.get_value().ask(name, RecordType::A, payload);
+         RETURN_IF_ERROR(response);
+
+         const auto &answers   = response.get_value().answers;
+         bool        truncated = response.get_value().header.truncated_message;
+         if (truncated != (count == 0) || answers.size() != count) {
+            return Error("Expected " + std::to_string(count) + " answers for " + name + " with a payload of "
+                         + std::to_string(payload) + ", got " + std::to_string(answers.size())
+                         + (truncated ? " truncated" : ""));
+         }
+      }
+   }
+   return Ok();
+}
+
+/**
+ * `big.test.` only fits into a datagram thanks to EDNS0, `huge.test.` doesn't fit at all and has to be
+ * asked again over TCP. Either way, every record must reach the client.
+ */
+static Result<void>
+check_large(StandInServers &servers, uint16_t port) {
+   auto client = Client::create(port, 0x6000);
+   RETURN_IF_ERROR(client);
+
+   for (auto [name, count] : { std::pair { "big.test", StandInServers::BIG },
+                               std::pair { "huge.test", StandInServers::HUGE } }) {
+      auto response = client.get_value().ask_tcp(name, RecordType::A);
+      RETURN_IF_ERROR(response);
+
+      const auto &answers = response.get_value().answers;
+      if (response.get_value().header.truncated_message || answers.size() != count) {
+         return Error("Expected " + std::to_string(count) + " answers for " + name + ", got "
+                      + std::to_string(answers.size()));
+      }
+   }
+
+   auto res = expect_count(servers, TEST, "big.test", RecordType::A, 1);
+   RETURN_IF_ERROR(res);
+   res = expect_count(servers, TEST, "big.test", RecordType::A, 0, true);
+   RETURN_IF_ERROR(res);
+   res = expect_count(servers, TEST, "huge.test", RecordType::A, 1);
+   RETURN_IF_ERROR(res);
+   return expect_count(servers, TEST, "huge.test", RecordType::A, 1, true);
+}
+
+/**
+ * Question names go upstream in mixed case, and a response that doesn't echo it is not taken: `lower.test.`
+ * fails although its name server answers.
+ */
+static Result<void>
+check_case(StandInServers &servers, uint16_t port) {
+   if (servers.get_uppercase() == 0) {
+      return Error("No question went upstream with an uppercase letter");
+   }
+
+   auto client = Client::create(port, 0x7000);
+   RETURN_IF_ERROR(client);
+   auto response = client.get_value().ask("lower.test", RecordType::A);
+   RETURN_IF_ERROR(response);
+   auto code = response.get_value().header.response_code;
+   if (code != PacketHeader::SERVER_FAILURE) {
+      return Error("Expected SERVFAIL, got rcode " + std::to_string(code));
+   }
+   return expect_count(servers, TEST, "lower.test", RecordType::A, 1);
+}
+
+/* ------------------------------------------------------------------------------------------------------- */
+
+int
+main() {
+   StandInServers servers;
+   servers.start().panic_if_error("Failed to start the stand-in name servers");
+
+   ServerConfig config;
+   config.address             = "127.0.0.1";
+   config.port                = 0;
+   config.threads             = 2;
+   config.pin_threads         = false;
+   config.tcp.threads         = 1;
+   config.recursive           = true;
+   config.resolver.root_hints = { "127.0.0.1:" + std::to_string(servers.get_port()) };
+   config.resolver.port       = servers.get_port();
+
+   Server server(config);
+   server.start().panic_if_error("Failed to start the server");
+   auto port = server.get_port();
+
+   std::vector<std::tuple<const char *, Result<void> (*)(StandInServers &, uint16_t)>> checks = {
+      { "coalescing", check_coalescing },
+      { "glueless delegation", check_glueless },
+      { "cname across zones", check_cname },
+      { "nxdomain and nodata", check_negative },
+      { "edns0 clients", check_edns },
+      { "answers beyond a datagram", check_large },
+      { "question case", check_case },
+   };
+
+   int failed = 0;
+   for (const auto &[name, check] : checks) {
+      auto res = check(servers, port);
+      std::cout << (res ? "ok     " : "FAILED ") << name << std::endl;
+      if (!res) {
+         res.get_error().print(name);
+         failed++;
+      }
+   }
+
+   server.stop();
+   server.wait();
+   servers.stop();
+
+   std::cout << std::endl;
+   server.get_resolver()->get_stats().print();
+   return failed == 0 ? EXIT_SUCCESS : EXIT_FAILURE;
+}
+
+/* ------------------------------------------------------------------------------------------------------- */
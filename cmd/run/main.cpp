@@ -1,6 +1,6 @@
 #include <iostream>
 
-#include <backbone/lib/buffer/basic.tcc>
+#include <backbone/lib/buffer/basic.tpp>
 
 int
 main() {
@@ -8,16 +8,16 @@ main() {
 
    // FILL
    for (int i = 0; i < 3; i++) {
-      auto _ = buf.Write(i + 'a');
+      auto _ = buf.write(i + 'a');
    }
 
    // READ
    for (int i = 0; i < 3; i++) {
-      auto result = buf.Read();
+      auto result = buf.read();
       if (!result) {
-         result.error->Print();
+         result.get_error().print();
       } else {
-         std::cout << "Value: " << result.value << std::endl;
+         std::cout << "Value: " << result.get_value() << std::endl;
       }
    }
 
@@ -0,0 +1,197 @@
+#include <atomic>
+#include <chrono>
+#include <csignal>
+#include <cstring>
+#include <iostream>
+#include <sstream>
+#include <thread>
+
+#include <backbone/lib/cache/snapshot.hpp>
+#include <backbone/lib/server/server.hpp>
+
+/* ------------------------------------------------------------------------------------------------------- */
+
+static std::atomic<bool> g_Stop   = false;
+static std::atomic<bool> g_Reload = false;
+
+static void
+handle_signal(int signal) {
+   if (signal == SIGHUP) {
+      g_Reload.store(true);
+   } else {
+      g_Stop.store(true);
+   }
+}
+
+/* ------------------------------------------------------------------------------------------------------- */
+
+static void
+print_usage(const char *program) {
+   std::cout << "Usage: " << program << " [--address <ip>] [--port <port>] [--threads <count>] [--no-pin]"
+             << " [--engine socket|io_uring] [--cache-size <entries>] [--cache-policy lru|lfu|hybrid]"
+             << " [--zone <zone.bin>] [--tcp-threads <count>] [--tcp-idle-timeout <ms>]"
+             << " [--recursive] [--root-hints <ip[:port]>,...] [--upstream-port <port>]"
+             << " [--forward <ip[:port]>,...] [--no-race] [--serve-stale <seconds>] [--prefetch-hits <count>]"
+             << " [--cache-snapshot <file>] [--snapshot-interval <seconds>] [--negative-cache-size <entries>]"
+             << " [--rate-limit <responses/s>] [--rate-limit-slip <n>]" << std::endl;
+   std::cout << "Send SIGHUP to reload the zone file without restarting." << std::endl;
+}
+
+/* ------------------------------------------------------------------------------------------------------- */
+
+static std::vector<std::string>
+split_list(const std::string &text) {
+   std::vector<std::string> items;
+   std::stringstream        stream(text);
+   for (std::string item; std::getline(stream, item, ',');) {
+      items.push_back(item);
+   }
+   return items;
+}
+
+/* ------------------------------------------------------------------------------------------------------- */
+
+int
+main(int argc, char **argv) {
+   ServerConfig config;
+
+   std::string          snapshot;
+   std::chrono::seconds snapshot_interval(300);
+
+   for (int i = 1; i < argc; i++) {
+      std::string arg       = argv[i];
+      bool        has_value = i + 1 < argc;
+
+      if (arg == "--address" && has_value) {
+         config.address = argv[++i];
+      } else if (arg == "--port" && has_value) {
+         config.port = std::stoi(argv[++i]);
+      } else if (arg == "--threads" && has_value) {
+         config.threads = std::stoul(argv[++i]);
+      } else if (arg == "--engine" && has_value) {
+         auto engine = ParseEngineType(argv[++i]);
+         engine.panic_if_error("Invalid engine");
+         config.engine = engine.get_value();
+      } else if (arg == "--cache-size" && has_value) {
+         config.cache.capacity = std::stoul(argv[++i]);
+      } else if (arg == "--cache-policy" && has_value) {
+         auto policy = ParseEvictionPolicy(argv[++i]);
+         policy.panic_if_error("Invalid cache policy");
+         config.cache.policy = policy.get_value();
+      } else if (arg == "--rate-limit" && has_value) {
+         config.rate_limit.responses_per_second = std::stoul(argv[++i]);
+      } else if (arg == "--rate-limit-slip" && has_value) {
+         config.rate_limit.slip = std::stoul(argv[++i]);
+      } else if (arg == "--negative-cache-size" && has_value) {
+         config.negative_cache.capacity = std::stoul(argv[++i]);
+      } else if (arg == "--serve-stale" && has_value) {
+         config.cache.stale_window = std::chrono::seconds(std::stoul(argv[++i]));
+      } else if (arg == "--prefetch-hits" && has_value) {
+         config.cache.prefetch_hits = std::stoul(argv[++i]);
+      } else if (arg == "--cache-snapshot" && has_value) {
+         snapshot = argv[++i];
+      } else if (arg == "--snapshot-interval" && has_value) {
+         snapshot_interval = std::chrono::seconds(std::stoul(argv[++i]));
+      } else if (arg == "--zone" && has_value) {
+         config.zone = argv[++i];
+      } else if (arg == "--tcp-threads" && has_value) {
+         config.tcp.threads = std::stoul(argv[++i]);
+      } else if (arg == "--tcp-idle-timeout" && has_value) {
+         config.tcp.idle_timeout = std::chrono::milliseconds(std::stoul(argv[++i]));
+      } else if (arg == "--recursive") {
+         config.recursive = true;
+      } else if (arg == "--root-hints" && has_value) {
+         config.recursive           = true;
+         config.resolver.root_hints = split_list(argv[++i]);
+      } else if (arg == "--forward" && has_value) {
+         config.recursive                = true;
+         config.resolver.forward.servers = split_list(argv[++i]);
+      } else if (arg == "--no-race") {
+         config.resolver.forward.race = false;
+      } else if (arg == "--upstream-port" && has_value) {
+         config.resolver.port = std::stoi(argv[++i]);
+      } else if (arg == "--no-pin") {
+         config.pin_threads = false;
+      } else {
+         print_usage(argv[0]);
+         return EXIT_FAILURE;
+      }
+   }
+
+   Server server(config);
+   server.start().panic_if_error("Failed to start the server");
+
+   std::signal(SIGINT, handle_signal);
+   std::signal(SIGTERM, handle_signal);
+   std::signal(SIGHUP, handle_signal);
+
+   std::cout << "Listening on " << config.address << ":" << server.get_port() << " ("
+             << GetEngineName(config.engine) << ", " << config.tcp.threads << " TCP workers)" << std::endl;
+
+   // Workers are serving already, but nothing they cache in the meantime is replaced by older entries
+   auto *cache = snapshot.empty() ? nullptr : server.get_cache();
+   if (cache) {
+      auto loaded = CacheSnapshot::load(*cache, snapshot);
+      if (loaded) {
+         std::cout << "Restored " << loaded.get_value() << " cached answers from " << snapshot << std::endl;
+      } else {
+         loaded.get_error().print();
+      }
+   }
+   auto next_snapshot = std::chrono::steady_clock::now() + snapshot_interval;
+   bool retired_zones = false;
+
+   /* Signals only raise flags, the actual work happens here, off the workers' threads */
+   while (!g_Stop.load()) {
+      if (g_Reload.exchange(false) && !config.zone.empty()) {
+         auto res = server.reload_zone();
+         if (res) {
+            std::cout << "Reloaded " << config.zone << std::endl;
+            retired_zones = true;
+         } else {
+            res.get_error().print();
+         }
+      }
+      // The previous zone stays mapped until the last worker still reading it has moved on
+      if (retired_zones) {
+         retired_zones = server.reclaim_zones() > 0;
+      }
+      if (cache && std::chrono::steady_clock::now() >= next_snapshot) {
+         auto saved = CacheSnapshot::save(*cache, snapshot);
+         if (!saved) {
+            saved.get_error().print();
+         }
+         next_snapshot = std::chrono::steady_clock::now() + snapshot_interval;
+      }
+      std::this_thread::sleep_for(std::chrono::milliseconds(100));
+   }
+
+   server.stop();
+   server.wait();
+
+   if (cache) {
+      auto saved = CacheSnapshot::save(*cache, snapshot);
+      if (saved) {
+         std::cout << "Saved " << saved.get_value() << " cached answers to " << snapshot << std::endl;
+      } else {
+         saved.get_error().print();
+      }
+   }
+
+   server.get_stats().print();
+   if (auto *answers = server.get_cache()) {
+      std::cout << std::endl;
+      answers->get_stats().print("Answer");
+   }
+   if (auto *negative = server.get_negative_cache()) {
+      std::cout << std::endl;
+      negative->get_stats().print("Negative");
+   }
+   if (auto *resolver = server.get_resolver()) {
+      std::cout << std::endl;
+      resolver->get_stats().print();
+   }
+   return 0;
+}
+
+/* ------------------------------------------------------------------------------------------------------- */
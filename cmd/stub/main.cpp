@@ -0,0 +1,204 @@
+/// @brief
+/// Stand-in upstream resolver for trying out forwarding locally. Answers every A question with the same
+/// address (and anything else with an empty answer) after a configurable delay, and silently drops a
+/// configurable share of the queries, so slow and lossy upstreams can be put behind `--forward`.
+
+#include <algorithm>
+#include <arpa/inet.h>
+#include <array>
+#include <atomic>
+#include <chrono>
+#include <csignal>
+#include <iostream>
+#include <optional>
+#include <poll.h>
+#include <queue>
+#include <random>
+#include <sys/socket.h>
+
+#include <backbone/lib/packet/view.hpp>
+#include <backbone/lib/server/socket.hpp>
+
+/* ------------------------------------------------------------------------------------------------------- */
+
+using Clock = std::chrono::steady_clock;
+
+class StubConfig {
+public:
+   std::string address = "127.0.0.1";
+   uint16_t    port    = 5300;
+   double      delay   = 0;   // milliseconds
+   double      jitter  = 0;   // milliseconds, added uniformly on top of the delay
+   double      drop    = 0;   // share of queries never answered
+   std::string answer  = "192.0.2.1";
+};
+
+/* ------------------------------------------------------------------------------------------------------- */
+
+class Pending {
+public:
+   Clock::time_point due;
+   std::vector<Byte> response;
+   sockaddr_storage  peer;
+   socklen_t         peer_length;
+
+   bool
+   operator>(const Pending &other) const {
+      return due > other.due;
+   }
+};
+
+/* ------------------------------------------------------------------------------------------------------- */
+
+static std::atomic<bool> g_Stop = false;
+
+static void
+handle_signal(int) {
+   g_Stop.store(true);
+}
+
+/* ------------------------------------------------------------------------------------------------------- */
+
+static std::optional<std::vector<Byte>>
+build_response(std::span<const Byte> request, const in_addr &answer) {
+   auto _view = PacketView::from_bytes(request);
+   if (!_view || _view.get_value().query_response() || _view.get_value().question_count() != 1) {
+      return std::nullopt;
+   }
+   const auto &view     = _view.get_value();
+   const auto  question = *view.questions().begin();
+   bool        has_a    = question.type == PacketQuestion::A;
+
+   auto header = PacketHeader(view.id(),
+                              true,
+                              view.op_code(),
+                              false,
+                              false,
+                              view.recursion_desired(),
+                              true,
+                              0,
+                              PacketHeader::NO_ERROR,
+                              1,
+                              has_a ? 1 : 0,
+                              0,
+                              0);
+
+   auto question_bytes = view.get_question_bytes();
+   auto response       = std::vector<Byte>(PacketHeader::SIZE);
+   header.to_bytes(std::span<Byte, PacketHeader::SIZE>(response.data(), PacketHeader::SIZE));
+   response.insert(response.end(), question_bytes.begin(), question_bytes.end());
+
+   // Owner compressed to the question name, IN, TTL 60, 4 bytes of address
+   if (has_a) {
+      response.insert(response.end(), { 0xC0, 0x0C, 0, 1, 0, 1, 0, 0, 0, 60, 0, 4 });
+      auto *bytes = reinterpret_cast<const Byte *>(&answer.s_addr);
+      response.insert(response.end(), bytes, bytes + 4);
+   }
+   return response;
+}
+
+/* ------------------------------------------------------------------------------------------------------- */
+
+int
+main(int argc, char **argv) {
+   StubConfig config;
+
+   for (int i = 1; i < argc; i++) {
+      std::string arg       = argv[i];
+      bool        has_value = i + 1 < argc;
+
+      if (arg == "--address" && has_value) {
+         config.address = argv[++i];
+      } else if (arg == "--port" && has_value) {
+         config.port = std::stoi(argv[++i]);
+      } else if (arg == "--delay" && has_value) {
+         config.delay = std::stod(argv[++i]);
+      } else if (arg == "--jitter" && has_value) {
+         config.jitter = std::stod(argv[++i]);
+      } else if (arg == "--drop" && has_value) {
+         config.drop = std::stod(argv[++i]);
+      } else if (arg == "--answer" && has_value) {
+         config.answer = argv[++i];
+      } else {
+         std::cout << "Usage: " << argv[0] << " [--address <ip>] [--port <port>] [--delay <ms>]"
+                   << " [--jitter <ms>] [--drop <0..1>] [--answer <ipv4>]" << std::endl;
+         return EXIT_FAILURE;
+      }
+   }
+
+   in_addr answer {};
+   if (inet_pton(AF_INET, config.answer.c_str(), &answer) != 1) {
+      std::cout << "Invalid answer address: " << config.answer << std::endl;
+      return EXIT_FAILURE;
+   }
+
+   auto socket = UdpSocket::bind(config.address, config.port, false);
+   socket.panic_if_error("Failed to bind");
+   int fd = socket.get_value().get_fd();
+
+   std::signal(SIGINT, handle_signal);
+   std::signal(SIGTERM, handle_signal);
+
+   std::cout << "Stub upstream on " << config.address << ":" << socket.get_value().get_port()
+             << " (delay " << config.delay << "ms, jitter " << config.jitter << "ms, drop " << config.drop
+             << ")" << std::endl;
+
+   std::mt19937                           random(std::random_device {}());
+   std::uniform_real_distribution<double> uniform(0, 1);
+   std::priority_queue<Pending, std::vector<Pending>, std::greater<Pending>> pending;
+   std::array<Byte, 4096>                                                    buffer;
+   uint64_t received = 0, dropped = 0, answered = 0;
+
+   while (!g_Stop.load()) {
+      /* Sleep until the next response is due or a query comes in */
+      int timeout = 100;
+      if (!pending.empty()) {
+         auto wait = std::chrono::ceil<std::chrono::milliseconds>(pending.top().due - Clock::now());
+         timeout   = std::clamp<int>(wait.count(), 0, timeout);
+      }
+      pollfd poll_fd { .fd = fd, .events = POLLIN, .revents = 0 };
+      poll(&poll_fd, 1, timeout);
+
+      while (true) {
+         Pending   entry {};
+         auto     *peer   = reinterpret_cast<sockaddr *>(&entry.peer);
+         socklen_t length = sizeof(entry.peer);
+         ssize_t   count  = recvfrom(fd, buffer.data(), buffer.size(), MSG_DONTWAIT, peer, &length);
+         if (count < 0) {
+            break;
+         }
+         received++;
+
+         auto response = build_response({ buffer.data(), size_t(count) }, answer);
+         if (!response || uniform(random) < config.drop) {
+            dropped++;
+            continue;
+         }
+
+         double delay      = config.delay + config.jitter * uniform(random);
+         entry.due         = Clock::now() + std::chrono::microseconds(int64_t(delay * 1000));
+         entry.response    = std::move(response.value());
+         entry.peer_length = length;
+         pending.push(std::move(entry));
+      }
+
+      auto now = Clock::now();
+      while (!pending.empty() && pending.top().due <= now) {
+         const auto &entry = pending.top();
+         sendto(fd,
+                entry.response.data(),
+                entry.response.size(),
+                0,
+                reinterpret_cast<const sockaddr *>(&entry.peer),
+                entry.peer_length);
+         answered++;
+         pending.pop();
+      }
+   }
+
+   std::cout << "Received: " << received << ", answered: " << answered << ", dropped: " << dropped
+             << std::endl;
+   return 0;
+}
+
+/* ------------------------------------------------------------------------------------------------------- */
@@ -0,0 +1,42 @@
+#include <chrono>
+#include <iostream>
+
+#include <backbone/lib/config/loader.hpp>
+
+/* ------------------------------------------------------------------------------------------------------- */
+
+static void
+print_usage(const char *program) {
+   std::cout << "Usage: " << program << " <config.json> <zone.bin>" << std::endl;
+}
+
+/* ------------------------------------------------------------------------------------------------------- */
+
+int
+main(int argc, char **argv) {
+   if (argc != 3) {
+      print_usage(argv[0]);
+      return EXIT_FAILURE;
+   }
+
+   auto start = std::chrono::steady_clock::now();
+
+   auto config = JsonValue::parse_file(argv[1]);
+   config.panic_if_error("Failed to read the config");
+
+   ZoneBuilder builder;
+   LoadZoneConfig(config.get_value(), builder).panic_if_error("Invalid config");
+   builder.write(argv[2]).panic_if_error("Failed to write the zone");
+
+   // Open what was written, which validates it the same way the server will
+   auto zone = Zone::open(argv[2]);
+   zone.panic_if_error("Compiled zone does not load");
+
+   auto elapsed = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+   std::cout << "Compiled " << zone.get_value().get_record_count() << " records into "
+             << zone.get_value().get_node_count() << " nodes (" << argv[2] << ") in " << elapsed << "s"
+             << std::endl;
+   return 0;
+}
+
+/* ------------------------------------------------------------------------------------------------------- */
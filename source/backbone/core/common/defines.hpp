@@ -1,6 +1,6 @@
 #pragma once
 
-#define RETURN_IF_ERROR(result)  \
-   if (result.is_error()) {      \
-      return result.get_error(); \
+#define RETURN_IF_ERROR(result)             \
+   if (result.is_error()) {                 \
+      return std::move(result).get_error(); \
    }
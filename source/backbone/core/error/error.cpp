@@ -8,62 +8,103 @@
 
 /* ------------------------------------------------------------------------------------------------------- */
 
-Error::Error() : m_Errors() {}
+Error::Error() {}
 
 /* ------------------------------------------------------------------------------------------------------- */
 
-Error::Error(const ErrorUnit &unit) { m_Errors.push_back(unit); }
+Error::Error(const ErrorUnit &unit) : Error() { push(unit); }
 
 /* ------------------------------------------------------------------------------------------------------- */
 
-Error::Error(const std::vector<ErrorUnit> &errors) : m_Errors(errors) {}
+Error::Error(ErrorCode code, std::source_location location) : Error() { push(ErrorUnit(code, location)); }
 
 /* ------------------------------------------------------------------------------------------------------- */
 
-Error::Error(std::string message, std::source_location location) {
-   m_Errors.push_back(ErrorUnit(message.c_str(), location));
+Error::Error(const char *message, std::source_location location) : Error() {
+   push(ErrorUnit(message, location));
 }
 
 /* ------------------------------------------------------------------------------------------------------- */
 
-Error::Error(ErrorCode code, std::source_location location) { m_Errors.push_back(ErrorUnit(code, location)); }
+Error::Error(std::string message, std::source_location location) : Error() {
+   push(UNDEFINED, std::move(message), location);
+}
+
+/* ------------------------------------------------------------------------------------------------------- */
+
+Error::Error(ErrorCode code, const char *message, std::source_location location) : Error() {
+   push(ErrorUnit(code, message, location));
+}
 
 /* ------------------------------------------------------------------------------------------------------- */
 
-Error::Error(ErrorCode code, std::string message, std::source_location location) {
-   m_Errors.push_back(ErrorUnit(code, message.c_str(), location));
+Error::Error(ErrorCode code, std::string message, std::source_location location) : Error() {
+   push(code, std::move(message), location);
 }
 
 /* ------------------------------------------------------------------------------------------------------- */
 
 void
 Error::push(const ErrorUnit &unit) {
-   m_Errors.push_back(unit);
+   size_t index = m_Count;
+   if (m_Count < MAX_UNITS) {
+      m_Count++;
+   } else {
+      index = MAX_UNITS - 1;
+      m_Dropped++;
+   }
+
+   m_Codes[index]     = static_cast<int16_t>(unit.GetCode());
+   m_Messages[index]  = unit.GetRawMessage();
+   m_Locations[index] = unit.GetLocation();
+}
+
+/* ------------------------------------------------------------------------------------------------------- */
+
+void
+Error::push(ErrorCode code, std::string message, std::source_location location) {
+   // Deque elements never move, so the frame can point straight at the stored string
+   if (!m_Strings) {
+      m_Strings = std::make_shared<std::deque<std::string>>();
+   }
+   m_Strings->push_back(std::move(message));
+
+   push(ErrorUnit(code, m_Strings->back().c_str(), location));
 }
 
 /* ------------------------------------------------------------------------------------------------------- */
 
 void
 Error::clear() {
-   m_Errors.clear();
+   m_Count   = 0;
+   m_Dropped = 0;
+   m_Strings.reset();
 }
 
 /* ------------------------------------------------------------------------------------------------------- */
 
-Error::operator bool() const { return m_Errors.size() > 0; }
+Error::operator bool() const { return size() > 0; }
 
 /* ------------------------------------------------------------------------------------------------------- */
 
-const ErrorUnit &
+ErrorUnit
 Error::first() const {
-   return m_Errors[0];
+   if (m_Count == 0) {
+      return ErrorUnit();
+   }
+   return ErrorUnit(static_cast<ErrorCode>(m_Codes[0]), m_Messages[0], m_Locations[0]);
 }
 
 /* ------------------------------------------------------------------------------------------------------- */
 
-const ErrorUnit &
+ErrorUnit
 Error::last() const {
-   return m_Errors[m_Errors.size() - 1];
+   if (m_Count == 0) {
+      return ErrorUnit();
+   }
+
+   size_t index = m_Count - 1;
+   return ErrorUnit(static_cast<ErrorCode>(m_Codes[index]), m_Messages[index], m_Locations[index]);
 }
 
 /* ------------------------------------------------------------------------------------------------------- */
@@ -78,7 +119,7 @@ Error::print(const std::string &title) const {
    char instructions[100];
    sprintf(instructions,
            "(1) = Bottom most layer   &   (%d) = Top most layer",
-           static_cast<int>(m_Errors.size()));
+           static_cast<int>(size()));
    PrintAtCenter(instructions, "|*--*[", "]*--*|");
 
    /* print separator */
@@ -89,8 +130,14 @@ Error::print(const std::string &title) const {
       PrintAtCenter(title, "[", "]", false, true);
    }
 
-   for (int i = 0; i < m_Errors.size(); i++) {
-      const auto &error = m_Errors[i];
+   int count   = static_cast<int>(size());
+   int dropped = m_Dropped;
+   for (int i = 0; i < count; i++) {
+      ErrorUnit error(static_cast<ErrorCode>(m_Codes[i]), m_Messages[i], m_Locations[i]);
+
+      if (dropped > 0 && i == count - 1) {
+         printf("\n      ... %d more", dropped);
+      }
 
       int indent = 1                    // (
                    + 2                  // "00"
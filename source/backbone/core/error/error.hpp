@@ -1,46 +1,87 @@
-#pragma once
-
-#include <string>
-#include <vector>
-#include <source_location>
-
-#include "unit.hpp"
-
-/* ------------------------------------------------------------------------------------------------------- */
-
-class Error {
-private:
-   std::vector<ErrorUnit> m_Errors;
-
-public:
-   Error();
-   Error(const ErrorUnit &unit);
-   Error(std::string message, std::source_location location = std::source_location::current());
-   explicit Error(const std::vector<ErrorUnit> &errors);
-   explicit Error(ErrorCode code, std::source_location location = std::source_location::current());
-   explicit Error(ErrorCode            code,
-                  std::string          message,
-                  std::source_location location = std::source_location::current());
-
-   void
-   push(const ErrorUnit &unit);
-
-   void
-   clear();
-
-   operator bool() const;
-
-   const ErrorUnit &
-   first() const;
-
-   const ErrorUnit &
-   last() const;
-
-   void
-   print(const std::string &title = "") const;
-
-   void
-   panic(const std::string &title = "") const;
-};
-
-/* ------------------------------------------------------------------------------------------------------- */
+#pragma once
+
+#include <array>
+#include <cstdint>
+#include <deque>
+#include <memory>
+#include <string>
+#include <source_location>
+
+#include "unit.hpp"
+
+/* ------------------------------------------------------------------------------------------------------- */
+
+/**
+ * @brief
+ * Error trace, from the bottom most layer (where it was raised) to the top most one.
+ *
+ * @details
+ * The trace is stored inline, column by column so that the frames pack tightly, and raising an error or
+ * adding context to it with string literals never allocates: errors raised for every malformed packet
+ * cost a few stores. Messages built at runtime (`std::string`) are kept in a side storage, allocated on
+ * first use and shared between copies. Once the trace is full the newest frame replaces the last one,
+ * keeping the root cause, and the number of frames that were dropped is reported when printed.
+ */
+class Error {
+public:
+   static constexpr size_t MAX_UNITS = 4;
+
+private:
+   std::array<const char *, MAX_UNITS>         m_Messages  = {};
+   std::array<std::source_location, MAX_UNITS> m_Locations = {};
+   std::array<int16_t, MAX_UNITS>              m_Codes     = {};
+   uint16_t                                    m_Count     = 0;
+   uint16_t                                    m_Dropped   = 0;
+   std::shared_ptr<std::deque<std::string>>    m_Strings;   // null until a runtime message is pushed
+
+public:
+   Error();
+   Error(const Error &other)     = default;
+   Error(Error &&other) noexcept = default;
+   ~Error()                      = default;
+   Error(const ErrorUnit &unit);
+   explicit Error(ErrorCode code, std::source_location location = std::source_location::current());
+   explicit Error(const char *message, std::source_location location = std::source_location::current());
+   explicit Error(std::string message, std::source_location location = std::source_location::current());
+   explicit Error(ErrorCode            code,
+                  const char          *message,
+                  std::source_location location = std::source_location::current());
+   explicit Error(ErrorCode            code,
+                  std::string          message,
+                  std::source_location location = std::source_location::current());
+
+   Error &
+   operator=(const Error &other) = default;
+   Error &
+   operator=(Error &&other) noexcept = default;
+
+   void
+   push(const ErrorUnit &unit);
+
+   void
+   push(ErrorCode code, std::string message, std::source_location location);
+
+   void
+   clear();
+
+   operator bool() const;
+
+   size_t
+   size() const {
+      return m_Count;
+   }
+
+   ErrorUnit
+   first() const;
+
+   ErrorUnit
+   last() const;
+
+   void
+   print(const std::string &title = "") const;
+
+   void
+   panic(const std::string &title = "") const;
+};
+
+/* ------------------------------------------------------------------------------------------------------- */
@@ -2,17 +2,21 @@
 
 /* ------------------------------------------------------------------------------------------------------- */
 
+ErrorUnit::ErrorUnit() : m_Code(UNKNOWN), m_Message(""), m_Location() {}
+
+/* ------------------------------------------------------------------------------------------------------- */
+
 ErrorUnit::ErrorUnit(ErrorCode code, std::source_location location)
     : m_Code(code), m_Message(""), m_Location(location) {}
 
 /* ------------------------------------------------------------------------------------------------------- */
 
-ErrorUnit::ErrorUnit(std::string message, std::source_location location)
+ErrorUnit::ErrorUnit(const char *message, std::source_location location)
     : m_Code(UNDEFINED), m_Message(message), m_Location(location) {}
 
 /* ------------------------------------------------------------------------------------------------------- */
 
-ErrorUnit::ErrorUnit(ErrorCode code, std::string message, std::source_location location)
+ErrorUnit::ErrorUnit(ErrorCode code, const char *message, std::source_location location)
     : m_Code(code), m_Message(message), m_Location(location) {}
 
 /* ------------------------------------------------------------------------------------------------------- */
@@ -31,6 +35,13 @@ ErrorUnit::GetMessage() const {
 
 /* ------------------------------------------------------------------------------------------------------- */
 
+const char *
+ErrorUnit::GetRawMessage() const {
+   return m_Message;
+}
+
+/* ------------------------------------------------------------------------------------------------------- */
+
 const std::source_location &
 ErrorUnit::GetLocation() const {
    return m_Location;
@@ -7,17 +7,26 @@
 
 /* ------------------------------------------------------------------------------------------------------- */
 
+/**
+ * @brief
+ * One frame of an error trace: a code, a message and where it was raised.
+ *
+ * @details
+ * The message is only referenced, never copied. It is either a string literal or a string owned by the
+ * `Error` the frame belongs to, so frames are trivially copyable and creating one never allocates.
+ */
 class ErrorUnit {
 private:
    ErrorCode            m_Code;
-   std::string          m_Message;
+   const char          *m_Message;
    std::source_location m_Location;
 
 public:
+   ErrorUnit();
    ErrorUnit(ErrorCode code, std::source_location location = std::source_location::current());
-   ErrorUnit(std::string message, std::source_location location = std::source_location::current());
+   ErrorUnit(const char *message, std::source_location location = std::source_location::current());
    ErrorUnit(ErrorCode            code,
-             std::string          message,
+             const char          *message,
              std::source_location location = std::source_location::current());
 
    ErrorCode
@@ -26,6 +35,9 @@ public:
    std::string
    GetMessage() const;
 
+   const char *
+   GetRawMessage() const;
+
    const std::source_location &
    GetLocation() const;
 
@@ -1,196 +1,322 @@
-#pragma once
-
-#include <memory>
-#include <functional>
-#include <utility>
-#include <tuple>
-#include <optional>
-#include <source_location>
-
-#include "../error/error.hpp"
-#include "../common/helpers.hpp"
-
-// General template for Result
-template<typename T>
-class [[nodiscard]] Result {
-private:
-   std::optional<T>     value;
-   std::optional<Error> error;
-
-public:
-   Result(T value) : value(std::move(value)), error(std::nullopt) {}
-   Result(const Error &error) : value(std::nullopt), error(std::move(error)) {}
-   Result(T value, const Error &error) : value(std::move(value)), error(std::move(error)) {}
-
-   Result(const Result<T> &other)     = default;
-   Result(Result<T> &&other) noexcept = default;
-   ~Result()                          = default;
-
-   Result<T> &
-   operator=(const Result<T> &other) = default;
-   Result<T> &
-   operator=(Result<T> &&other) noexcept = default;
-
-   explicit
-   operator bool() const {
-      return !error.has_value();
-   }
-
-   inline T &
-   get_value() {
-      if (!value.has_value()) {
-         throw std::runtime_error("Attempted to access value from an error Result");
-      }
-      return value.value();
-   }
-
-   inline const Error &
-   get_error() const {
-      if (!error.has_value()) {
-         throw std::runtime_error("Attempted to access error from a value Result");
-      }
-      return error.value();
-   }
-
-   inline bool
-   is_error() const {
-      return error.has_value();
-   }
-
-   inline const Result<T> &
-   except_fn(const std::function<void(Error)> &handler) const {
-      if (is_error()) {
-         handler(error.value());
-      }
-      return *this;
-   }
-
-   inline Result<T> &
-   except(const std::string &message, std::source_location location = std::source_location::current()) {
-      if (is_error()) {
-         error->push({ UNDEFINED, message, location });
-      }
-      return *this;
-   }
-
-   inline Result<T> &
-   except(ErrorCode            ec,
-          const std::string   &message,
-          std::source_location location = std::source_location::current()) {
-      if (is_error()) {
-         error->push({ ec, message, location });
-      }
-      return *this;
-   }
-
-   inline Result<T> &
-   with_fallback(const T &fallback) {
-      if (!value) {
-         value = fallback;
-      }
-      return *this;
-   }
-
-   inline Result<T> &
-   panic_if_error(const std::string &title = "") {
-      if (is_error()) {
-         get_error().panic(title);
-      }
-      return *this;
-   }
-
-   inline std::tuple<std::optional<T>, Ref<Error>>
-   as_tuple() const {
-      return { value, error };
-   }
-
-   inline static Result<T>
-   ok(T value) {
-      return Result<T>(std::move(value));
-   }
-};
-
-// Specialization for void
-template<>
-class [[nodiscard]] Result<void> {
-private:
-   std::optional<Error> error;
-
-public:
-   Result() : error(std::nullopt) {}
-   Result(const Error &error) : error(std::move(error)) {}
-
-   Result(const Result<void> &other)     = default;
-   Result(Result<void> &&other) noexcept = default;
-   ~Result()                             = default;
-
-   Result<void> &
-   operator=(const Result<void> &other) = default;
-   Result<void> &
-   operator=(Result<void> &&other) noexcept = default;
-
-   explicit
-   operator bool() const {
-      return !error.has_value();
-   }
-
-   inline const Error &
-   get_error() const {
-      if (!error) {
-         throw std::runtime_error("Attempted to access error from a value Result");
-      }
-      return error.value();
-   }
-
-   inline bool
-   is_error() const {
-      return error.has_value();
-   }
-
-   inline const Result<void> &
-   except_fn(const std::function<void(Error)> &handler) const {
-      if (is_error()) {
-         handler(error.value());
-      }
-      return *this;
-   }
-
-   inline Result<void> &
-   except(const std::string &message, std::source_location location = std::source_location::current()) {
-      if (is_error()) {
-         error->push({ UNKNOWN, message, location });
-      }
-      return *this;
-   }
-
-   inline Result<void> &
-   except(ErrorCode            ec,
-          const std::string   &message,
-          std::source_location location = std::source_location::current()) {
-      if (is_error()) {
-         error->push({ ec, message, location });
-      }
-      return *this;
-   }
-
-   inline Result<void> &
-   panic_if_error(const std::string &title = "") {
-      if (is_error()) {
-         get_error().panic(title);
-      }
-      return *this;
-   }
-
-   static Result<void>
-   ok() {
-      return Result<void>();
-   }
-};
-
-// Helper function to return Ok() for Result<void>
-inline Result<void>
-Ok() {
-   return Result<void>::ok();
-}
-
-using VoidResult = Result<void>;
+#pragma once
+
+#include <expected>
+#include <functional>
+#include <memory>
+#include <optional>
+#include <source_location>
+#include <stdexcept>
+#include <string>
+#include <tuple>
+#include <utility>
+
+#include "../error/error.hpp"
+#include "../common/helpers.hpp"
+
+/* ------------------------------------------------------------------------------------------------------- */
+
+/**
+ * @brief
+ * Either a value or an `Error`, never both.
+ *
+ * @details
+ * Built on `std::expected`, so a result is as large as the bigger of the two and holds a single flag.
+ * `except` adds a frame to the error trace only when there is an error; given a string literal it costs
+ * nothing on success and never allocates on failure.
+ */
+template<typename T>
+class [[nodiscard]] Result {
+private:
+   std::expected<T, Error> m_Value;
+
+public:
+   Result(T value) : m_Value(std::move(value)) {}
+   Result(Error error) : m_Value(std::unexpect, std::move(error)) {}
+
+   Result(const Result<T> &other)     = default;
+   Result(Result<T> &&other) noexcept = default;
+   ~Result()                          = default;
+
+   Result<T> &
+   operator=(const Result<T> &other) = default;
+   Result<T> &
+   operator=(Result<T> &&other) noexcept = default;
+
+   explicit
+   operator bool() const {
+      return m_Value.has_value();
+   }
+
+   inline T &
+   get_value() {
+      if (!m_Value) {
+         throw std::runtime_error("Attempted to access value from an error Result");
+      }
+      return *m_Value;
+   }
+
+   inline const T &
+   get_value() const {
+      if (!m_Value) {
+         throw std::runtime_error("Attempted to access value from an error Result");
+      }
+      return *m_Value;
+   }
+
+   inline const Error &
+   get_error() const & {
+      if (m_Value) {
+         throw std::runtime_error("Attempted to access error from a value Result");
+      }
+      return m_Value.error();
+   }
+
+   /**
+    * Moves the error out, so that passing it up a layer doesn't copy its trace.
+    */
+   inline Error
+   get_error() && {
+      if (m_Value) {
+         throw std::runtime_error("Attempted to access error from a value Result");
+      }
+      return std::move(m_Value.error());
+   }
+
+   inline bool
+   is_error() const {
+      return !m_Value.has_value();
+   }
+
+   inline const Result<T> &
+   except_fn(const std::function<void(const Error &)> &handler) const {
+      if (is_error()) {
+         handler(m_Value.error());
+      }
+      return *this;
+   }
+
+   inline Result<T> &
+   except(const char *message, std::source_location location = std::source_location::current()) & {
+      if (is_error()) {
+         m_Value.error().push({ UNDEFINED, message, location });
+      }
+      return *this;
+   }
+
+   inline Result<T> &
+   except(std::string message, std::source_location location = std::source_location::current()) & {
+      if (is_error()) {
+         m_Value.error().push(UNDEFINED, std::move(message), location);
+      }
+      return *this;
+   }
+
+   inline Result<T> &
+   except(ErrorCode            ec,
+          const char          *message,
+          std::source_location location = std::source_location::current()) & {
+      if (is_error()) {
+         m_Value.error().push({ ec, message, location });
+      }
+      return *this;
+   }
+
+   inline Result<T> &
+   except(ErrorCode            ec,
+          std::string          message,
+          std::source_location location = std::source_location::current()) & {
+      if (is_error()) {
+         m_Value.error().push(ec, std::move(message), location);
+      }
+      return *this;
+   }
+
+   /**
+    * Replaces an error with `fallback`.
+    */
+   inline Result<T> &
+   with_fallback(const T &fallback) & {
+      if (!m_Value) {
+         m_Value = fallback;
+      }
+      return *this;
+   }
+
+   inline Result<T> &
+   panic_if_error(const std::string &title = "") & {
+      if (is_error()) {
+         get_error().panic(title);
+      }
+      return *this;
+   }
+
+   /*
+    * Same as above for temporaries, so that `auto value = Call().except(...)` moves the value out instead
+    * of copying it (which would also drop the allocator of an allocator-aware value).
+    */
+
+   inline Result<T> &&
+   except(const char *message, std::source_location location = std::source_location::current()) && {
+      return std::move(except(message, location));
+   }
+
+   inline Result<T> &&
+   except(std::string message, std::source_location location = std::source_location::current()) && {
+      return std::move(except(std::move(message), location));
+   }
+
+   inline Result<T> &&
+   except(ErrorCode            ec,
+          const char          *message,
+          std::source_location location = std::source_location::current()) && {
+      return std::move(except(ec, message, location));
+   }
+
+   inline Result<T> &&
+   except(ErrorCode            ec,
+          std::string          message,
+          std::source_location location = std::source_location::current()) && {
+      return std::move(except(ec, std::move(message), location));
+   }
+
+   inline Result<T> &&
+   with_fallback(const T &fallback) && {
+      return std::move(with_fallback(fallback));
+   }
+
+   inline Result<T> &&
+   panic_if_error(const std::string &title = "") && {
+      return std::move(panic_if_error(title));
+   }
+
+   inline std::tuple<std::optional<T>, std::optional<Error>>
+   as_tuple() const {
+      if (m_Value) {
+         return { *m_Value, std::nullopt };
+      }
+      return { std::nullopt, m_Value.error() };
+   }
+
+   inline static Result<T>
+   ok(T value) {
+      return Result<T>(std::move(value));
+   }
+};
+
+/* ------------------------------------------------------------------------------------------------------- */
+
+// Specialization for void
+template<>
+class [[nodiscard]] Result<void> {
+private:
+   std::expected<void, Error> m_Value;
+
+public:
+   Result() : m_Value() {}
+   Result(Error error) : m_Value(std::unexpect, std::move(error)) {}
+
+   Result(const Result<void> &other)     = default;
+   Result(Result<void> &&other) noexcept = default;
+   ~Result()                             = default;
+
+   Result<void> &
+   operator=(const Result<void> &other) = default;
+   Result<void> &
+   operator=(Result<void> &&other) noexcept = default;
+
+   explicit
+   operator bool() const {
+      return m_Value.has_value();
+   }
+
+   inline const Error &
+   get_error() const & {
+      if (m_Value) {
+         throw std::runtime_error("Attempted to access error from a value Result");
+      }
+      return m_Value.error();
+   }
+
+   /**
+    * Moves the error out, so that passing it up a layer doesn't copy its trace.
+    */
+   inline Error
+   get_error() && {
+      if (m_Value) {
+         throw std::runtime_error("Attempted to access error from a value Result");
+      }
+      return std::move(m_Value.error());
+   }
+
+   inline bool
+   is_error() const {
+      return !m_Value.has_value();
+   }
+
+   inline const Result<void> &
+   except_fn(const std::function<void(const Error &)> &handler) const {
+      if (is_error()) {
+         handler(m_Value.error());
+      }
+      return *this;
+   }
+
+   inline Result<void> &
+   except(const char *message, std::source_location location = std::source_location::current()) {
+      if (is_error()) {
+         m_Value.error().push({ UNKNOWN, message, location });
+      }
+      return *this;
+   }
+
+   inline Result<void> &
+   except(std::string message, std::source_location location = std::source_location::current()) {
+      if (is_error()) {
+         m_Value.error().push(UNKNOWN, std::move(message), location);
+      }
+      return *this;
+   }
+
+   inline Result<void> &
+   except(ErrorCode            ec,
+          const char          *message,
+          std::source_location location = std::source_location::current()) {
+      if (is_error()) {
+         m_Value.error().push({ ec, message, location });
+      }
+      return *this;
+   }
+
+   inline Result<void> &
+   except(ErrorCode            ec,
+          std::string          message,
+          std::source_location location = std::source_location::current()) {
+      if (is_error()) {
+         m_Value.error().push(ec, std::move(message), location);
+      }
+      return *this;
+   }
+
+   inline Result<void> &
+   panic_if_error(const std::string &title = "") {
+      if (is_error()) {
+         get_error().panic(title);
+      }
+      return *this;
+   }
+
+   static Result<void>
+   ok() {
+      return Result<void>();
+   }
+};
+
+/* ------------------------------------------------------------------------------------------------------- */
+
+// Helper function to return Ok() for Result<void>
+inline Result<void>
+Ok() {
+   return Result<void>::ok();
+}
+
+using VoidResult = Result<void>;
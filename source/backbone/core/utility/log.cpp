@@ -13,8 +13,12 @@ GetShellColumns() {
    struct winsize ws;
    int            fd;
    fd = open("/dev/tty", O_RDWR);
-   if (fd < 0 || ioctl(fd, TIOCGWINSZ, &ws) < 0)
-      err(8, "/dev/tty");
+   if (fd < 0 || ioctl(fd, TIOCGWINSZ, &ws) < 0 || ws.ws_col == 0) {
+      // Daemons and pipes have no terminal, fall back to the classic width instead of bailing out
+      if (fd >= 0)
+         close(fd);
+      return 80;
+   }
    const int shellColumns = ws.ws_col;
    close(fd);
 
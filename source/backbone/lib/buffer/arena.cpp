@@ -0,0 +1,9 @@
+#include "arena.hpp"
+
+/* ------------------------------------------------------------------------------------------------------- */
+
+QueryArena::QueryArena(size_t capacity)
+    : m_Block(new Byte[capacity]), m_Capacity(capacity),
+      m_Resource(m_Block.get(), capacity, std::pmr::new_delete_resource()) {}
+
+/* ------------------------------------------------------------------------------------------------------- */
@@ -0,0 +1,59 @@
+#pragma once
+
+#include <memory_resource>
+
+#include <backbone/core/pch>
+
+/* ------------------------------------------------------------------------------------------------------- */
+
+/**
+ * @brief
+ * Bump allocator for everything a single query allocates, released as a whole once the query is done.
+ *
+ * @details
+ * Allocations are carved out of one block owned by the arena, deallocation does nothing and `reset` makes
+ * the whole block available again, so parsing a packet or building a response never reaches the global
+ * allocator. A query that needs more than the block spills to the heap, and the spilled memory is handed
+ * back on `reset` as well: a worker holds on to exactly one block between queries, whatever came before.
+ *
+ * Anything allocated from the arena must not outlive the next `reset`.
+ */
+class QueryArena {
+public:
+   static constexpr size_t DEFAULT_CAPACITY = 16 * 1024;
+
+private:
+   UniqueRef<Byte[]>                   m_Block;
+   size_t                              m_Capacity;
+   std::pmr::monotonic_buffer_resource m_Resource;
+
+public:
+   QueryArena(size_t capacity = DEFAULT_CAPACITY);
+   QueryArena(const QueryArena &) = delete;
+   ~QueryArena()                  = default;
+
+   std::pmr::memory_resource *
+   get_resource() {
+      return &m_Resource;
+   }
+
+   std::pmr::polymorphic_allocator<>
+   get_allocator() {
+      return &m_Resource;
+   }
+
+   size_t
+   get_capacity() const {
+      return m_Capacity;
+   }
+
+   /**
+    * Releases everything allocated since the last reset.
+    */
+   void
+   reset() {
+      m_Resource.release();
+   }
+};
+
+/* ------------------------------------------------------------------------------------------------------- */
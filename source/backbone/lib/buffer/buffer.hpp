@@ -1,97 +1,88 @@
 #pragma once
 
+#include <concepts>
+#include <span>
+
 #include <backbone/core/pch>
 
 /* ------------------------------------------------------------------------------------------------------- */
 
-template<typename T, size_t MAX_SIZE>
-class IReadableBuffer {
-public:
-   virtual T
-   get() = 0;
-
-   virtual Result<T>
-   get_at(size_t index) = 0;
-
-   virtual Result<std::vector<T>>
-   get_range(size_t start, size_t end) = 0;
-
-   virtual Result<T>
-   read() = 0;
-
-   virtual Result<T>
-   read_at(size_t index) = 0;
-
-   virtual Result<std::vector<T>>
-   read_range(size_t start, size_t end) = 0;
-
-   virtual size_t
-   get_read_index() = 0;
-
-   virtual size_t
-   get_read_remaining() = 0;
-
-   virtual Result<void>
-   seek_read(size_t index) = 0;
-
-   virtual Result<uint16_t>
-   read_uint16() = 0;
-
-   virtual Result<uint32_t>
-   read_uint32() = 0;
+/**
+ * @brief
+ * Buffer with a read cursor over elements of type `T`.
+ *
+ * @details
+ * Checked operations return a `Result`. Hot paths check once for everything they are about to read with
+ * `ensure_read` and then use the `_unchecked` operations, which are plain loads. Range reads hand out views
+ * into the buffer rather than copies, valid until the buffer is next written to.
+ */
+template<typename B, typename T>
+concept ReadableBuffer = requires(B buffer, const B const_buffer, size_t index, std::span<T> out) {
+   { const_buffer.get_read_index() } -> std::same_as<size_t>;
+   { const_buffer.get_read_remaining() } -> std::same_as<size_t>;
+   { buffer.seek_read(index) } -> std::same_as<Result<void>>;
+   { buffer.ensure_read(index) } -> std::same_as<Result<void>>;
+
+   { buffer.get_at(index) } -> std::same_as<Result<T>>;
+   { buffer.get_range(index, index) } -> std::same_as<Result<std::span<const T>>>;
+
+   { buffer.read() } -> std::same_as<Result<T>>;
+   { buffer.read(out) } -> std::same_as<Result<void>>;
+   { buffer.read_range(index) } -> std::same_as<Result<std::span<const T>>>;
+   { buffer.read_uint16() } -> std::same_as<Result<uint16_t>>;
+   { buffer.read_uint32() } -> std::same_as<Result<uint32_t>>;
+
+   { buffer.read_unchecked() } -> std::same_as<T>;
+   { buffer.read_uint16_unchecked() } -> std::same_as<uint16_t>;
+   { buffer.read_uint32_unchecked() } -> std::same_as<uint32_t>;
 };
 
 /* ------------------------------------------------------------------------------------------------------- */
 
-template<typename T, size_t MAX_SIZE>
-class IWritableBuffer {
-public:
-   virtual Result<void>
-   write(T value) = 0;
-
-   virtual Result<void>
-   write_at(size_t index, T value) = 0;
-
-   virtual Result<void>
-   write_range(size_t start, size_t end, std::vector<T> values) = 0;
-
-   virtual size_t
-   get_write_index() = 0;
-
-   virtual size_t
-   get_write_remaining() = 0;
-
-   virtual Result<void>
-   seek_write(size_t index) = 0;
-
-   virtual Result<void>
-   write_uint16(uint16_t value) = 0;
-
-   virtual Result<void>
-   write_uint32(uint32_t value) = 0;
+/**
+ * @brief
+ * Buffer with a write cursor over elements of type `T`, the counterpart of `ReadableBuffer`.
+ */
+template<typename B, typename T>
+concept WritableBuffer =
+    requires(B buffer, const B const_buffer, size_t index, T value, std::span<const T> in) {
+   { const_buffer.get_write_index() } -> std::same_as<size_t>;
+   { const_buffer.get_write_remaining() } -> std::same_as<size_t>;
+   { buffer.seek_write(index) } -> std::same_as<Result<void>>;
+   { buffer.ensure_write(index) } -> std::same_as<Result<void>>;
+
+   { buffer.write(value) } -> std::same_as<Result<void>>;
+   { buffer.write(in) } -> std::same_as<Result<void>>;
+   { buffer.write_at(index, value) } -> std::same_as<Result<void>>;
+   { buffer.write_range(index, in) } -> std::same_as<Result<void>>;
+   { buffer.write_uint16(uint16_t {}) } -> std::same_as<Result<void>>;
+   { buffer.write_uint32(uint32_t {}) } -> std::same_as<Result<void>>;
+
+   buffer.write_unchecked(value);
+   buffer.write_uint16_unchecked(uint16_t {});
+   buffer.write_uint32_unchecked(uint32_t {});
 };
 
 /* ------------------------------------------------------------------------------------------------------- */
 
-template<typename T, size_t MAX_SIZE>
-class ISerializableBuffer {
-public:
-   virtual Result<std::vector<T>>
-   serialize() = 0;
-
-   virtual Result<void>
-   deserialize(std::vector<T> data) = 0;
+/**
+ * @brief
+ * Buffer whose written contents can be viewed and replaced as a whole.
+ */
+template<typename B, typename T>
+concept SerializableBuffer = requires(B buffer, const B const_buffer, std::span<const T> data) {
+   { const_buffer.serialize() } -> std::same_as<std::span<const T>>;
+   { buffer.deserialize(data) } -> std::same_as<Result<void>>;
 };
 
 /* ------------------------------------------------------------------------------------------------------- */
 
-template<typename T, size_t MAX_SIZE>
-class IBuffer : public IReadableBuffer<T, MAX_SIZE>,
-                public IWritableBuffer<T, MAX_SIZE>,
-                public ISerializableBuffer<T, MAX_SIZE> {
-public:
-   virtual size_t
-   get_capacity() = 0;
-};
+template<typename B, typename T>
+concept Buffer = ReadableBuffer<B, T> && WritableBuffer<B, T> && SerializableBuffer<B, T> &&
+                 requires(B buffer, const B const_buffer) {
+                    { const_buffer.get_capacity() } -> std::same_as<size_t>;
+                    { buffer.get_data() } -> std::same_as<T *>;
+                    { const_buffer.get_data() } -> std::same_as<const T *>;
+                 };
 
 /* ------------------------------------------------------------------------------------------------------- */
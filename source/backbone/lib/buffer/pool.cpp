@@ -0,0 +1,77 @@
+#include "pool.hpp"
+
+#include <cassert>
+#include <vector>
+
+/* ------------------------------------------------------------------------------------------------------- */
+
+namespace {
+
+thread_local bool t_ListsDestroyed = false;
+
+/**
+ * Free blocks of the calling thread, handed back to the allocator when the thread exits.
+ */
+struct FreeLists {
+   std::array<std::vector<Byte *>, BufferPool::SIZES.size()> lists;
+
+   FreeLists() {
+      for (auto &list : lists) {
+         list.reserve(BufferPool::MAX_FREE);
+      }
+   }
+
+   ~FreeLists() {
+      for (auto &list : lists) {
+         for (Byte *block : list) {
+            delete[] block;
+         }
+      }
+      t_ListsDestroyed = true;
+   }
+};
+
+thread_local FreeLists t_FreeLists;
+
+}   // namespace
+
+/* ------------------------------------------------------------------------------------------------------- */
+
+BufferPool::Block
+BufferPool::acquire(size_t capacity) {
+   assert(capacity <= SIZES.back());
+
+   size_t size_class = 0;
+   while (size_class + 1 < SIZES.size() && SIZES[size_class] < capacity) {
+      size_class++;
+   }
+
+   auto &list = t_FreeLists.lists[size_class];
+   if (!list.empty()) {
+      Byte *block = list.back();
+      list.pop_back();
+      return Block(block, static_cast<uint8_t>(size_class));
+   }
+
+   // Default initialized, so nothing is written to the block until it is actually used
+   return Block(new Byte[SIZES[size_class]], static_cast<uint8_t>(size_class));
+}
+
+/* ------------------------------------------------------------------------------------------------------- */
+
+void
+BufferPool::release(Byte *data, uint8_t size_class) {
+   if (!data) {
+      return;
+   }
+
+   // Blocks outliving their thread's lists (e.g. held by other thread locals) go straight back
+   if (t_ListsDestroyed || t_FreeLists.lists[size_class].size() >= MAX_FREE) {
+      delete[] data;
+      return;
+   }
+
+   t_FreeLists.lists[size_class].push_back(data);
+}
+
+/* ------------------------------------------------------------------------------------------------------- */
@@ -0,0 +1,87 @@
+#pragma once
+
+#include <array>
+#include <cstdint>
+#include <span>
+#include <utility>
+
+#include <backbone/core/pch>
+
+/* ------------------------------------------------------------------------------------------------------- */
+
+/**
+ * @brief
+ * Recycles message sized blocks of memory so that buffers never go through the allocator on the hot path.
+ *
+ * @details
+ * Blocks come in a few fixed size classes, one for each message size DNS actually deals with: classic UDP,
+ * the EDNS0 payload size recommended for avoiding fragmentation, large EDNS0 payloads and TCP messages.
+ * Every thread keeps its own free list per class, so acquiring and releasing a block is a couple of
+ * pointer moves without any locking. A block released on another thread than the one it was acquired on
+ * simply joins that thread's list. Blocks are never cleared, their contents are whatever was left there.
+ */
+class BufferPool {
+public:
+   static constexpr size_t UDP_SIZE   = 512;
+   static constexpr size_t EDNS_SIZE  = 1232;
+   static constexpr size_t LARGE_SIZE = 4096;
+   static constexpr size_t TCP_SIZE   = 65535;
+
+   static constexpr std::array<size_t, 4> SIZES = { UDP_SIZE, EDNS_SIZE, LARGE_SIZE, TCP_SIZE };
+
+   /**
+    * Free blocks kept per class and thread, beyond that released blocks go back to the allocator.
+    */
+   static constexpr size_t MAX_FREE = 256;
+
+   /**
+    * Exclusive owner of one pooled block, handing it back to the pool when destroyed.
+    */
+   class Block {
+   private:
+      Byte   *m_Data;
+      uint8_t m_Class;
+
+   public:
+      Block() : m_Data(nullptr), m_Class(0) {}
+      Block(Byte *data, uint8_t size_class) : m_Data(data), m_Class(size_class) {}
+      Block(const Block &) = delete;
+      Block(Block &&other) noexcept
+          : m_Data(std::exchange(other.m_Data, nullptr)), m_Class(other.m_Class) {}
+
+      ~Block() {
+         BufferPool::release(m_Data, m_Class);
+      }
+
+      Block &
+      operator=(const Block &) = delete;
+      Block &
+      operator=(Block &&other) noexcept {
+         if (this != &other) {
+            BufferPool::release(m_Data, m_Class);
+            m_Data  = std::exchange(other.m_Data, nullptr);
+            m_Class = other.m_Class;
+         }
+         return *this;
+      }
+
+      std::span<Byte>
+      get_span() const {
+         return { m_Data, m_Data ? SIZES[m_Class] : 0 };
+      }
+   };
+
+public:
+   /**
+    * Hands out a block of the smallest class holding at least `capacity` bytes. `capacity` must not exceed
+    * the largest class, no DNS message can be larger than that.
+    */
+   static Block
+   acquire(size_t capacity);
+
+private:
+   static void
+   release(Byte *data, uint8_t size_class);
+};
+
+/* ------------------------------------------------------------------------------------------------------- */
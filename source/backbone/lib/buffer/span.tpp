@@ -0,0 +1,358 @@
+#pragma once
+
+#include "buffer.hpp"
+
+#include <algorithm>
+#include <utility>
+
+/* ------------------------------------------------------------------------------------------------------- */
+
+/**
+ * @brief
+ * Read and write cursors over storage owned by someone else.
+ *
+ * @details
+ * Holds everything `BasicBuffer` and the pooled `PacketBuffer` have in common, only where the elements
+ * live and how large the storage is differs between them. Nothing here is virtual: code that works on
+ * buffers is templated on the `Buffer` concepts instead, so every call is inlined at its use. Cursors may
+ * point anywhere from 0 to the capacity, reads are not limited to what was written.
+ *
+ * Copying would alias the storage, so span buffers can only be moved, which leaves the source empty.
+ */
+template<typename T>
+class SpanBuffer {
+private:
+   T     *m_Data;
+   size_t m_Capacity;
+
+   size_t m_ReadIndex;
+   size_t m_WriteIndex;
+
+public:
+   SpanBuffer(std::span<T> storage)
+       : m_Data(storage.data()), m_Capacity(storage.size()), m_ReadIndex(0), m_WriteIndex(0) {}
+
+   SpanBuffer(const SpanBuffer &) = delete;
+   SpanBuffer(SpanBuffer &&other) noexcept
+       : m_Data(std::exchange(other.m_Data, nullptr)), m_Capacity(std::exchange(other.m_Capacity, 0)),
+         m_ReadIndex(std::exchange(other.m_ReadIndex, 0)),
+         m_WriteIndex(std::exchange(other.m_WriteIndex, 0)) {}
+   ~SpanBuffer() = default;
+
+   SpanBuffer &
+   operator=(const SpanBuffer &) = delete;
+   SpanBuffer &
+   operator=(SpanBuffer &&other) noexcept {
+      m_Data       = std::exchange(other.m_Data, nullptr);
+      m_Capacity   = std::exchange(other.m_Capacity, 0);
+      m_ReadIndex  = std::exchange(other.m_ReadIndex, 0);
+      m_WriteIndex = std::exchange(other.m_WriteIndex, 0);
+      return *this;
+   }
+
+   size_t
+   get_capacity() const {
+      return m_Capacity;
+   }
+
+   T *
+   get_data() {
+      return m_Data;
+   }
+
+   const T *
+   get_data() const {
+      return m_Data;
+   }
+
+   /* --------------------------------------------------------------------------------------------------- */
+
+   T
+   get() const {
+      return m_Data[m_ReadIndex];
+   }
+
+   Result<T>
+   get_at(size_t index) const {
+      if (index >= m_Capacity) {
+         return Error("Index out of bounds");
+      }
+
+      return m_Data[index];
+   }
+
+   /**
+    * Views the elements in `[start, end)` without moving the read index.
+    */
+   Result<std::span<const T>>
+   get_range(size_t start, size_t end) const {
+      if (start > end || end > m_Capacity) {
+         return Error("Range out of bounds");
+      }
+
+      return std::span<const T>(m_Data + start, end - start);
+   }
+
+   size_t
+   get_read_index() const {
+      return m_ReadIndex;
+   }
+
+   size_t
+   get_read_remaining() const {
+      return m_Capacity - m_ReadIndex;
+   }
+
+   Result<void>
+   seek_read(size_t index) {
+      if (index > m_Capacity) {
+         return Error("Index out of bounds");
+      }
+
+      m_ReadIndex = index;
+
+      return Ok();
+   }
+
+   /**
+    * Checks that `count` elements can be read, after which that many may be read unchecked.
+    */
+   Result<void>
+   ensure_read(size_t count) const {
+      if (count > m_Capacity - m_ReadIndex) {
+         return Error("Read index out of bounds");
+      }
+
+      return Ok();
+   }
+
+   Result<T>
+   read() {
+      auto res = ensure_read(1);
+      RETURN_IF_ERROR(res);
+
+      return read_unchecked();
+   }
+
+   /**
+    * Copies the next `out.size()` elements into `out`.
+    */
+   Result<void>
+   read(std::span<T> out) {
+      auto res = ensure_read(out.size());
+      RETURN_IF_ERROR(res);
+
+      std::copy_n(m_Data + m_ReadIndex, out.size(), out.data());
+      m_ReadIndex += out.size();
+
+      return Ok();
+   }
+
+   Result<T>
+   read_at(size_t index) const {
+      return get_at(index);
+   }
+
+   /**
+    * Views the next `count` elements and moves the read index past them.
+    */
+   Result<std::span<const T>>
+   read_range(size_t count) {
+      auto res = ensure_read(count);
+      RETURN_IF_ERROR(res);
+
+      std::span<const T> range(m_Data + m_ReadIndex, count);
+      m_ReadIndex += count;
+
+      return range;
+   }
+
+   Result<uint16_t>
+   read_uint16() {
+      auto res = ensure_read(2);
+      RETURN_IF_ERROR(res);
+
+      return read_uint16_unchecked();
+   }
+
+   Result<uint32_t>
+   read_uint32() {
+      auto res = ensure_read(4);
+      RETURN_IF_ERROR(res);
+
+      return read_uint32_unchecked();
+   }
+
+   T
+   read_unchecked() {
+      return m_Data[m_ReadIndex++];
+   }
+
+   uint16_t
+   read_uint16_unchecked() {
+      uint16_t value = (m_Data[m_ReadIndex] << 8) | m_Data[m_ReadIndex + 1];
+      m_ReadIndex += 2;
+
+      return value;
+   }
+
+   uint32_t
+   read_uint32_unchecked() {
+      uint32_t value = (m_Data[m_ReadIndex] << 24) | (m_Data[m_ReadIndex + 1] << 16) |
+                       (m_Data[m_ReadIndex + 2] << 8) | m_Data[m_ReadIndex + 3];
+      m_ReadIndex += 4;
+
+      return value;
+   }
+
+   /* --------------------------------------------------------------------------------------------------- */
+
+   size_t
+   get_write_index() const {
+      return m_WriteIndex;
+   }
+
+   size_t
+   get_write_remaining() const {
+      return m_Capacity - m_WriteIndex;
+   }
+
+   Result<void>
+   seek_write(size_t index) {
+      if (index > m_Capacity) {
+         return Error("Index out of bounds");
+      }
+
+      m_WriteIndex = index;
+
+      return Ok();
+   }
+
+   /**
+    * Checks that `count` elements can be written, after which that many may be written unchecked.
+    */
+   Result<void>
+   ensure_write(size_t count) const {
+      if (count > m_Capacity - m_WriteIndex) {
+         return Error("Write index out of bounds");
+      }
+
+      return Ok();
+   }
+
+   Result<void>
+   write(T value) {
+      auto res = ensure_write(1);
+      RETURN_IF_ERROR(res);
+
+      write_unchecked(std::move(value));
+
+      return Ok();
+   }
+
+   /**
+    * Appends every element of `values`.
+    */
+   Result<void>
+   write(std::span<const T> values) {
+      auto res = ensure_write(values.size());
+      RETURN_IF_ERROR(res);
+
+      std::copy_n(values.data(), values.size(), m_Data + m_WriteIndex);
+      m_WriteIndex += values.size();
+
+      return Ok();
+   }
+
+   Result<void>
+   write_at(size_t index, T value) {
+      if (index >= m_Capacity) {
+         return Error("Index out of bounds");
+      }
+
+      m_Data[index] = std::move(value);
+
+      return Ok();
+   }
+
+   /**
+    * Writes `values` starting at `start` and moves the write index right after them.
+    */
+   Result<void>
+   write_range(size_t start, std::span<const T> values) {
+      if (start > m_Capacity || values.size() > m_Capacity - start) {
+         return Error("Range out of bounds");
+      }
+
+      std::copy_n(values.data(), values.size(), m_Data + start);
+      m_WriteIndex = start + values.size();
+
+      return Ok();
+   }
+
+   Result<void>
+   write_uint16(uint16_t value) {
+      auto res = ensure_write(2);
+      RETURN_IF_ERROR(res);
+
+      write_uint16_unchecked(value);
+
+      return Ok();
+   }
+
+   Result<void>
+   write_uint32(uint32_t value) {
+      auto res = ensure_write(4);
+      RETURN_IF_ERROR(res);
+
+      write_uint32_unchecked(value);
+
+      return Ok();
+   }
+
+   void
+   write_unchecked(T value) {
+      m_Data[m_WriteIndex++] = std::move(value);
+   }
+
+   void
+   write_uint16_unchecked(uint16_t value) {
+      m_Data[m_WriteIndex++] = (value >> 8) & 0xFF;
+      m_Data[m_WriteIndex++] = value & 0xFF;
+   }
+
+   void
+   write_uint32_unchecked(uint32_t value) {
+      m_Data[m_WriteIndex++] = (value >> 24) & 0xFF;
+      m_Data[m_WriteIndex++] = (value >> 16) & 0xFF;
+      m_Data[m_WriteIndex++] = (value >> 8) & 0xFF;
+      m_Data[m_WriteIndex++] = value & 0xFF;
+   }
+
+   /* --------------------------------------------------------------------------------------------------- */
+
+   /**
+    * Views everything written so far, up to the write index.
+    */
+   std::span<const T>
+   serialize() const {
+      return std::span<const T>(m_Data, m_WriteIndex);
+   }
+
+   /**
+    * Replaces the contents with `data` and moves the write index right after it.
+    */
+   Result<void>
+   deserialize(std::span<const T> data) {
+      if (data.size() > m_Capacity) {
+         return Error("Data size exceeds buffer capacity");
+      }
+
+      std::copy_n(data.data(), data.size(), m_Data);
+      m_WriteIndex = data.size();
+
+      return Ok();
+   }
+};
+
+/* ------------------------------------------------------------------------------------------------------- */
@@ -0,0 +1,20 @@
+#include "answer.hpp"
+
+/* ------------------------------------------------------------------------------------------------------- */
+
+CacheKey::CacheKey(DomainName name, PacketQuestion::QueryType type, uint16_t class_)
+    : name(std::move(name)), type(type), class_(class_) {}
+
+/* ------------------------------------------------------------------------------------------------------- */
+
+size_t
+CacheKeyHash::operator()(const CacheKey &key) const {
+   // The name is hashed already, mix in type and class
+   uint64_t hash = key.name.get_hash();
+   hash ^= (static_cast<uint64_t>(key.type) << 16) | key.class_;
+   hash *= 0x9E3779B97F4A7C15ull;
+
+   return hash ^ (hash >> 32);
+}
+
+/* ------------------------------------------------------------------------------------------------------- */
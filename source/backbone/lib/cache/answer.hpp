@@ -0,0 +1,67 @@
+#pragma once
+
+#include <cstdint>
+#include <string>
+#include <vector>
+
+#include <backbone/core/pch>
+#include <backbone/lib/packet/domain.hpp>
+#include <backbone/lib/packet/question.hpp>
+#include <backbone/lib/packet/record.hpp>
+#include "cache.tpp"
+#include "wire.hpp"
+
+/* ------------------------------------------------------------------------------------------------------- */
+
+/**
+ * @brief
+ * Identity of a cached answer: (qname, qtype, qclass).
+ *
+ * @details
+ * The name is a `DomainName`, so it is lowercase and hashed already, and keys only compare their names'
+ * bytes when the hashes match. Keys stored in the cache for long should hold interned names, which the
+ * cache then shares with every other key and record naming the same name.
+ */
+class CacheKey {
+public:
+   DomainName                name;
+   PacketQuestion::QueryType type;
+   uint16_t                  class_;
+
+public:
+   CacheKey(DomainName name, PacketQuestion::QueryType type, uint16_t class_);
+   ~CacheKey() = default;
+
+   bool
+   operator==(const CacheKey &other) const = default;
+};
+
+/* ------------------------------------------------------------------------------------------------------- */
+
+class CacheKeyHash {
+public:
+   size_t
+   operator()(const CacheKey &key) const;
+};
+
+/* ------------------------------------------------------------------------------------------------------- */
+
+/**
+ * @brief
+ * Cached answer: the records themselves and, optionally, the response they were sent in.
+ */
+class CachedAnswer {
+public:
+   std::vector<PacketRecord> records;
+
+   /**
+    * Encoded response replayed on a hit. Without it a hit has to encode the records again.
+    */
+   std::optional<WireResponse> wire;
+};
+
+/* ------------------------------------------------------------------------------------------------------- */
+
+using AnswerCache = ShardedCache<CacheKey, CachedAnswer, CacheKeyHash>;
+
+/* ------------------------------------------------------------------------------------------------------- */
@@ -0,0 +1,553 @@
+#pragma once
+
+#include <algorithm>
+#include <bit>
+#include <chrono>
+#include <mutex>
+#include <optional>
+#include <thread>
+#include <unordered_map>
+#include <vector>
+
+#include "config.hpp"
+
+/* ------------------------------------------------------------------------------------------------------- */
+
+/**
+ * @brief
+ * Lock-striped cache with per-entry TTL and a configurable eviction policy.
+ *
+ * @details
+ * Keys are spread over a power-of-two number of shards by hash, each shard being guarded by its own mutex.
+ * Workers looking up different names therefore almost never contend, and no operation ever takes more
+ * than one shard lock.
+ *
+ * Every shard keeps its entries in a dense slot array threaded by an intrusive recency list and indexed by
+ * an `unordered_map`. The dense array is what makes the sampling based policies cheap: LFU draws random
+ * slots, HYBRID walks the least recently used end of the list, and both evict the candidate with the
+ * lowest access frequency. Frequencies are saturating counters that are halved once the shard has seen
+ * eight accesses per slot, so that yesterday's popular names eventually become evictable.
+ *
+ * Expired entries are removed lazily when looked up or when they turn up as eviction candidates. With a
+ * stale window configured, an entry lives on for that long past its expiry so that `lookup` can still
+ * serve it (RFC 8767), while `get` and `visit` treat it as a miss.
+ *
+ * Every entry also counts its hits since it was stored. `lookup` uses that to tell the caller when a
+ * popular entry is about to expire, or when a stale one has been served, so that it gets resolved again
+ * before (or right after) clients have to wait for it. Such a refresh is only asked for once per
+ * `REFRESH_INTERVAL` and entry, however many lookups see it.
+ *
+ * `visit_shard` and `restore` let the whole cache be saved and loaded again, popularity included, one
+ * shard lock at a time.
+ */
+template<typename K, typename V, typename Hash = std::hash<K>>
+class ShardedCache {
+public:
+   using Clock     = std::chrono::steady_clock;
+   using TimePoint = Clock::time_point;
+
+   class Hit {
+   public:
+      V        value;
+      uint32_t ttl;   // seconds left before the entry expires
+   };
+
+   /**
+    * Everything about an entry besides its key and value, as `visit_shard` hands it out and `restore`
+    * takes it back.
+    */
+   class EntryState {
+   public:
+      uint32_t expires_in;   // seconds
+      uint32_t ttl;          // the full TTL it was stored with
+      uint32_t hits;
+      uint16_t frequency;
+   };
+
+private:
+   static constexpr uint32_t NIL              = UINT32_MAX;
+   static constexpr size_t   EVICTION_SAMPLES = 8;
+   static constexpr uint16_t MAX_FREQUENCY    = UINT16_MAX;
+
+public:
+   /**
+    * How long a refresh that was asked for is given before the next lookup asks again.
+    */
+   static constexpr auto REFRESH_INTERVAL = std::chrono::seconds(5);
+
+private:
+
+   using Index = std::unordered_map<K, uint32_t, Hash>;
+
+   struct Slot {
+      typename Index::iterator entry;
+      V                        value;
+      TimePoint                expires_at;
+      TimePoint                refresh_at;   // no refresh is asked for before then
+      uint32_t                 ttl;
+      uint32_t                 hits;   // since the value was stored
+      uint32_t                 prev;
+      uint32_t                 next;
+      uint16_t                 frequency;
+   };
+
+   struct alignas(64) Shard {
+      std::mutex        mutex;
+      Index             index;
+      std::vector<Slot> slots;
+      uint32_t          head = NIL;   // most recently used
+      uint32_t          tail = NIL;   // least recently used
+      size_t            capacity;
+      uint64_t          accesses = 0;
+      uint64_t          seed     = 0x9E3779B97F4A7C15;
+      CacheStats        stats;
+   };
+
+   EvictionPolicy       m_Policy;
+   std::chrono::seconds m_StaleWindow;
+   uint32_t             m_StaleTtl;
+   uint32_t             m_PrefetchHits;
+   double               m_PrefetchWindow;
+
+   size_t             m_ShardBits;
+   UniqueRef<Shard[]> m_Shards;
+   size_t             m_ShardCount;
+   Hash               m_Hash;
+
+public:
+   ShardedCache(CacheConfig config = CacheConfig())
+       : m_Policy(config.policy), m_StaleWindow(config.stale_window), m_StaleTtl(config.stale_ttl),
+         m_PrefetchHits(config.prefetch_hits), m_PrefetchWindow(config.prefetch_window) {
+      size_t shards = config.shards;
+      if (shards == 0) {
+         shards = 4 * std::max(1u, std::thread::hardware_concurrency());
+      }
+      shards = std::bit_ceil(std::clamp<size_t>(shards, 1, std::max<size_t>(config.capacity, 1)));
+
+      m_ShardCount = shards;
+      m_ShardBits  = std::countr_zero(shards);
+      m_Shards     = CreateUniqueRef<Shard[]>(shards);
+      for (size_t i = 0; i < shards; i++) {
+         m_Shards[i].capacity = std::max<size_t>(config.capacity / shards, 1);
+         m_Shards[i].seed += i;
+         m_Shards[i].index.reserve(m_Shards[i].capacity);
+         m_Shards[i].slots.reserve(m_Shards[i].capacity);
+      }
+   }
+
+   ShardedCache(const ShardedCache &) = delete;
+   ~ShardedCache()                    = default;
+
+   /**
+    * Returns a copy of the cached value together with its remaining TTL, or nothing on a miss.
+    */
+   std::optional<Hit>
+   get(const K &key, TimePoint now = Clock::now()) {
+      auto                       &shard = get_shard(key);
+      std::lock_guard<std::mutex> lock(shard.mutex);
+
+      auto it = shard.index.find(key);
+      if (it == shard.index.end()) {
+         shard.stats.misses++;
+         return std::nullopt;
+      }
+
+      uint32_t i = it->second;
+      if (is_expired(shard, i, now)) {
+         shard.stats.misses++;
+         return std::nullopt;
+      }
+
+      touch(shard, i);
+      shard.stats.hits++;
+
+      return Hit { shard.slots[i].value, get_ttl(shard.slots[i], now) };
+   }
+
+   /**
+    * Runs `visitor(const V &value, uint32_t ttl)` on a live entry while holding its shard lock, which avoids
+    * copying the value out. Keep the visitor short, it blocks every other access to the shard.
+    *
+    * @returns Whether the entry was found (and visited).
+    */
+   template<typename F>
+   bool
+   visit(const K &key, F &&visitor, TimePoint now = Clock::now()) {
+      auto                       &shard = get_shard(key);
+      std::lock_guard<std::mutex> lock(shard.mutex);
+
+      auto it = shard.index.find(key);
+      if (it == shard.index.end()) {
+         shard.stats.misses++;
+         return false;
+      }
+
+      uint32_t i = it->second;
+      if (is_expired(shard, i, now)) {
+         shard.stats.misses++;
+         return false;
+      }
+
+      touch(shard, i);
+      shard.stats.hits++;
+
+      visitor(static_cast<const V &>(shard.slots[i].value), get_ttl(shard.slots[i], now));
+      return true;
+   }
+
+   /**
+    * Same as `visit`, except that stale entries are visited too (with the stale TTL) and that the caller
+    * is told when to refresh the entry: when it is stale, or when it is popular and close to expiring.
+    */
+   template<typename F>
+   CacheLookup
+   lookup(const K &key, F &&visitor, TimePoint now = Clock::now()) {
+      auto                       &shard = get_shard(key);
+      std::lock_guard<std::mutex> lock(shard.mutex);
+
+      auto it = shard.index.find(key);
+      if (it == shard.index.end()) {
+         shard.stats.misses++;
+         return CacheLookup::MISS;
+      }
+
+      uint32_t i    = it->second;
+      auto    &slot = shard.slots[i];
+
+      bool refresh;
+      if (slot.expires_at > now) {
+         // This hit included, it is only counted further down
+         bool popular = m_PrefetchHits > 0 && slot.hits + 1 >= m_PrefetchHits;
+         auto left    = std::chrono::duration<double>(slot.expires_at - now).count();
+         refresh      = popular && left <= slot.ttl * m_PrefetchWindow;
+         visitor(static_cast<const V &>(slot.value), get_ttl(slot, now));
+      } else if (now < slot.expires_at + m_StaleWindow) {
+         refresh = true;
+         shard.stats.stale_hits++;
+         visitor(static_cast<const V &>(slot.value), m_StaleTtl);
+      } else {
+         remove(shard, i);
+         shard.stats.expirations++;
+         shard.stats.misses++;
+         return CacheLookup::MISS;
+      }
+
+      shard.stats.hits++;
+      if (refresh && now >= slot.refresh_at) {
+         slot.refresh_at = now + REFRESH_INTERVAL;
+         shard.stats.refreshes++;
+      } else {
+         refresh = false;
+      }
+
+      touch(shard, i);
+      return refresh ? CacheLookup::REFRESH : CacheLookup::HIT;
+   }
+
+   /**
+    * Inserts or replaces the value of `key` for `ttl` seconds. A zero TTL means "do not cache".
+    */
+   void
+   put(const K &key, V value, uint32_t ttl, TimePoint now = Clock::now()) {
+      if (ttl == 0) {
+         return;
+      }
+
+      auto                       &shard = get_shard(key);
+      std::lock_guard<std::mutex> lock(shard.mutex);
+
+      TimePoint expires_at = now + std::chrono::seconds(ttl);
+
+      auto it = shard.index.find(key);
+      if (it != shard.index.end()) {
+         touch(shard, it->second);
+
+         // A new value, popular or not, has to earn its hits again
+         auto &slot      = shard.slots[it->second];
+         slot.value      = std::move(value);
+         slot.expires_at = expires_at;
+         slot.refresh_at = TimePoint();
+         slot.ttl        = ttl;
+         slot.hits       = 0;
+         return;
+      }
+
+      if (shard.slots.size() >= shard.capacity) {
+         evict(shard, now);
+      }
+
+      uint32_t i     = shard.slots.size();
+      auto     entry = shard.index.emplace(key, i).first;
+      shard.slots.push_back(Slot { entry, std::move(value), expires_at, TimePoint(), ttl, 0, NIL, NIL, 1 });
+      link_front(shard, i);
+
+      shard.stats.insertions++;
+   }
+
+   /**
+    * Inserts `key` in the state it was saved in, unless it is cached already: whatever is there now is at
+    * least as fresh. Entries restored least recently used first end up in their original order.
+    */
+   void
+   restore(const K &key, V value, const EntryState &state, TimePoint now = Clock::now()) {
+      if (state.expires_in == 0) {
+         return;
+      }
+
+      auto                       &shard = get_shard(key);
+      std::lock_guard<std::mutex> lock(shard.mutex);
+
+      if (shard.index.contains(key)) {
+         return;
+      }
+      if (shard.slots.size() >= shard.capacity) {
+         evict(shard, now);
+      }
+
+      TimePoint expires_at = now + std::chrono::seconds(state.expires_in);
+      uint16_t  frequency  = std::max<uint16_t>(state.frequency, 1);
+
+      uint32_t i     = shard.slots.size();
+      auto     entry = shard.index.emplace(key, i).first;
+      shard.slots.push_back(Slot { entry, std::move(value), expires_at, TimePoint(), state.ttl, state.hits,
+                                   NIL, NIL, frequency });
+      link_front(shard, i);
+
+      shard.stats.insertions++;
+   }
+
+   /**
+    * Calls `visitor(key, value, state)` for every entry of shard `s` that has not expired, least recently
+    * used first. The shard stays locked throughout, so the visitor should copy what it needs and return.
+    */
+   template<typename F>
+   void
+   visit_shard(size_t s, F &&visitor, TimePoint now = Clock::now()) {
+      auto                       &shard = m_Shards[s];
+      std::lock_guard<std::mutex> lock(shard.mutex);
+
+      for (uint32_t i = shard.tail; i != NIL; i = shard.slots[i].prev) {
+         const auto &slot = shard.slots[i];
+         if (slot.expires_at <= now) {
+            continue;
+         }
+
+         auto expires_in = std::chrono::duration_cast<std::chrono::seconds>(slot.expires_at - now).count();
+         auto state      = EntryState { .expires_in = static_cast<uint32_t>(expires_in),
+                                        .ttl        = slot.ttl,
+                                        .hits       = slot.hits,
+                                        .frequency  = slot.frequency };
+         visitor(static_cast<const K &>(slot.entry->first), static_cast<const V &>(slot.value), state);
+      }
+   }
+
+   bool
+   erase(const K &key) {
+      auto                       &shard = get_shard(key);
+      std::lock_guard<std::mutex> lock(shard.mutex);
+
+      auto it = shard.index.find(key);
+      if (it == shard.index.end()) {
+         return false;
+      }
+
+      remove(shard, it->second);
+      return true;
+   }
+
+   void
+   clear() {
+      for (size_t s = 0; s < m_ShardCount; s++) {
+         std::lock_guard<std::mutex> lock(m_Shards[s].mutex);
+         m_Shards[s].index.clear();
+         m_Shards[s].slots.clear();
+         m_Shards[s].head = m_Shards[s].tail = NIL;
+      }
+   }
+
+   CacheStats
+   get_stats() {
+      CacheStats total;
+      for (size_t s = 0; s < m_ShardCount; s++) {
+         std::lock_guard<std::mutex> lock(m_Shards[s].mutex);
+         total += m_Shards[s].stats;
+         total.size += m_Shards[s].slots.size();
+      }
+      return total;
+   }
+
+   size_t
+   get_shard_count() const {
+      return m_ShardCount;
+   }
+
+private:
+   Shard &
+   get_shard(const K &key) {
+      if (m_ShardBits == 0) {
+         return m_Shards[0];
+      }
+
+      // Fibonacci hashing spreads weak hashes, and the top bits stay independent of the map's buckets
+      uint64_t hash = static_cast<uint64_t>(m_Hash(key)) * 0x9E3779B97F4A7C15ull;
+      return m_Shards[hash >> (64 - m_ShardBits)];
+   }
+
+   void
+   link_front(Shard &shard, uint32_t i) {
+      auto &slot = shard.slots[i];
+      slot.prev  = NIL;
+      slot.next  = shard.head;
+      if (shard.head != NIL) {
+         shard.slots[shard.head].prev = i;
+      }
+      shard.head = i;
+      if (shard.tail == NIL) {
+         shard.tail = i;
+      }
+   }
+
+   void
+   unlink(Shard &shard, uint32_t i) {
+      auto &slot = shard.slots[i];
+      if (slot.prev != NIL) {
+         shard.slots[slot.prev].next = slot.next;
+      } else {
+         shard.head = slot.next;
+      }
+      if (slot.next != NIL) {
+         shard.slots[slot.next].prev = slot.prev;
+      } else {
+         shard.tail = slot.prev;
+      }
+   }
+
+   /**
+    * Whether slot `i` has expired, removing it unless it may still be served stale.
+    */
+   bool
+   is_expired(Shard &shard, uint32_t i, TimePoint now) {
+      if (shard.slots[i].expires_at > now) {
+         return false;
+      }
+
+      if (now >= shard.slots[i].expires_at + m_StaleWindow) {
+         remove(shard, i);
+         shard.stats.expirations++;
+      }
+      return true;
+   }
+
+   static uint32_t
+   get_ttl(const Slot &slot, TimePoint now) {
+      return static_cast<uint32_t>(std::chrono::ceil<std::chrono::seconds>(slot.expires_at - now).count());
+   }
+
+   void
+   touch(Shard &shard, uint32_t i) {
+      auto &slot = shard.slots[i];
+      if (slot.frequency < MAX_FREQUENCY) {
+         slot.frequency++;
+      }
+      if (slot.hits < UINT32_MAX) {
+         slot.hits++;
+      }
+
+      if (shard.head != i) {
+         unlink(shard, i);
+         link_front(shard, i);
+      }
+
+      /* Age the frequencies so that old popularity fades away */
+      if (++shard.accesses >= shard.capacity * 8) {
+         for (auto &s : shard.slots) {
+            s.frequency = std::max<uint16_t>(s.frequency / 2, 1);
+         }
+         shard.accesses = 0;
+      }
+   }
+
+   /**
+    * Removes slot `i`, moving the last slot into its place to keep the array dense.
+    */
+   void
+   remove(Shard &shard, uint32_t i) {
+      unlink(shard, i);
+      shard.index.erase(shard.slots[i].entry);
+
+      uint32_t last = shard.slots.size() - 1;
+      if (i != last) {
+         shard.slots[i] = std::move(shard.slots[last]);
+
+         auto &moved = shard.slots[i];
+         if (moved.prev != NIL) {
+            shard.slots[moved.prev].next = i;
+         } else {
+            shard.head = i;
+         }
+         if (moved.next != NIL) {
+            shard.slots[moved.next].prev = i;
+         } else {
+            shard.tail = i;
+         }
+         moved.entry->second = i;
+      }
+      shard.slots.pop_back();
+   }
+
+   uint32_t
+   next_random(Shard &shard) {
+      // xorshift64*, plenty for picking eviction samples
+      shard.seed ^= shard.seed >> 12;
+      shard.seed ^= shard.seed << 25;
+      shard.seed ^= shard.seed >> 27;
+      return (shard.seed * 0x2545F4914F6CDD1Dull) >> 32;
+   }
+
+   void
+   evict(Shard &shard, TimePoint now) {
+      if (shard.slots.empty()) {
+         return;
+      }
+
+      uint32_t victim = shard.tail;
+
+      if (shard.slots[victim].expires_at > now && m_Policy != EvictionPolicy::LRU) {
+         auto better = [&](uint32_t candidate) {
+            const auto &c = shard.slots[candidate];
+            const auto &v = shard.slots[victim];
+            if (v.expires_at <= now) {
+               return false;
+            }
+            return c.expires_at <= now || c.frequency < v.frequency;
+         };
+
+         if (m_Policy == EvictionPolicy::HYBRID) {
+            uint32_t candidate = shard.slots[victim].prev;
+            for (size_t n = 1; n < EVICTION_SAMPLES && candidate != NIL; n++) {
+               if (better(candidate)) {
+                  victim = candidate;
+               }
+               candidate = shard.slots[candidate].prev;
+            }
+         } else {
+            victim = next_random(shard) % shard.slots.size();
+            for (size_t n = 1; n < EVICTION_SAMPLES; n++) {
+               uint32_t candidate = next_random(shard) % shard.slots.size();
+               if (better(candidate)) {
+                  victim = candidate;
+               }
+            }
+         }
+      }
+
+      if (shard.slots[victim].expires_at <= now) {
+         shard.stats.expirations++;
+      } else {
+         shard.stats.evictions++;
+      }
+      remove(shard, victim);
+   }
+};
+
+/* ------------------------------------------------------------------------------------------------------- */
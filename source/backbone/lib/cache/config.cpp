@@ -0,0 +1,65 @@
+#include "config.hpp"
+
+/* ------------------------------------------------------------------------------------------------------- */
+
+CacheStats &
+CacheStats::operator+=(const CacheStats &other) {
+   hits += other.hits;
+   misses += other.misses;
+   insertions += other.insertions;
+   evictions += other.evictions;
+   expirations += other.expirations;
+   stale_hits += other.stale_hits;
+   refreshes += other.refreshes;
+   size += other.size;
+   return *this;
+}
+
+/* ------------------------------------------------------------------------------------------------------- */
+
+double
+CacheStats::hit_ratio() const {
+   uint64_t lookups = hits + misses;
+   return lookups > 0 ? static_cast<double>(hits) / lookups : 0.0;
+}
+
+/* ------------------------------------------------------------------------------------------------------- */
+
+void
+CacheStats::print(const std::string &name) const {
+   /* Print title */
+   char title[100];
+   sprintf(title, "%s Cache Stats", name.c_str());
+   PrintAtCenter(title, "[", "]", true, true);
+   printf("\n");
+
+   /* Print data */
+   printf("Size: %lu\n", size);
+   printf("Hits: %lu\n", hits);
+   printf("Misses: %lu\n", misses);
+   printf("Hit Ratio: %.2f%%\n", hit_ratio() * 100);
+   printf("Insertions: %lu\n", insertions);
+   printf("Evictions: %lu\n", evictions);
+   printf("Expirations: %lu\n", expirations);
+   printf("Stale Hits: %lu\n", stale_hits);
+   printf("Refreshes: %lu\n", refreshes);
+}
+
+/* ------------------------------------------------------------------------------------------------------- */
+
+Result<EvictionPolicy>
+ParseEvictionPolicy(const std::string &name) {
+   if (name == "lru") {
+      return EvictionPolicy::LRU;
+   }
+   if (name == "lfu") {
+      return EvictionPolicy::LFU;
+   }
+   if (name == "hybrid") {
+      return EvictionPolicy::HYBRID;
+   }
+
+   return Error("Unknown eviction policy: " + name);
+}
+
+/* ------------------------------------------------------------------------------------------------------- */
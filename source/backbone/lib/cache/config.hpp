@@ -0,0 +1,108 @@
+#pragma once
+
+#include <chrono>
+#include <cstdint>
+#include <string>
+
+#include <backbone/core/pch>
+
+/* ------------------------------------------------------------------------------------------------------- */
+
+enum class EvictionPolicy {
+   /**
+    * Evict the least recently used entry.
+    */
+   LRU,
+
+   /**
+    * Evict the least frequently used entry out of a random sample of the shard (approximated LFU).
+    */
+   LFU,
+
+   /**
+    * Evict the least frequently used entry out of the least recently used ones, so that a popular entry
+    * survives a short lull while a burst of one-off names can't flush the cache.
+    */
+   HYBRID,
+};
+
+/* ------------------------------------------------------------------------------------------------------- */
+
+class CacheConfig {
+public:
+   /**
+    * Maximum number of entries across all shards.
+    */
+   size_t capacity = 1 << 16;
+
+   /**
+    * Number of independently locked shards, rounded up to a power of two. Zero picks four per core.
+    */
+   size_t shards = 0;
+
+   EvictionPolicy policy = EvictionPolicy::HYBRID;
+
+   /**
+    * How long past its expiry an entry may still be served while it is being refreshed (RFC 8767). Zero
+    * never serves stale data.
+    */
+   std::chrono::seconds stale_window = std::chrono::seconds(0);
+
+   /**
+    * TTL stale data is served with, 30 seconds as RFC 8767 4 recommends. Never more than the records had.
+    */
+   uint32_t stale_ttl = 30;
+
+   /**
+    * Hits since it was stored that make an entry popular enough to be refreshed before it expires. Zero
+    * never refreshes ahead of time.
+    */
+   uint32_t prefetch_hits = 8;
+
+   /**
+    * Share of its TTL a popular entry has left when it gets refreshed.
+    */
+   double prefetch_window = 0.1;
+};
+
+/* ------------------------------------------------------------------------------------------------------- */
+
+/**
+ * @brief
+ * Outcome of `ShardedCache::lookup`.
+ */
+enum class CacheLookup {
+   MISS,
+   HIT,
+   REFRESH,   // a hit, and the entry should be resolved again now
+};
+
+/* ------------------------------------------------------------------------------------------------------- */
+
+class CacheStats {
+public:
+   uint64_t hits        = 0;
+   uint64_t misses      = 0;
+   uint64_t insertions  = 0;
+   uint64_t evictions   = 0;
+   uint64_t expirations = 0;
+   uint64_t stale_hits  = 0;   // hits served past the entry's expiry, counted as hits as well
+   uint64_t refreshes   = 0;   // lookups that asked for a refresh
+   uint64_t size        = 0;
+
+   CacheStats &
+   operator+=(const CacheStats &other);
+
+   double
+   hit_ratio() const;
+
+   void
+   print(const std::string &name = "") const;
+};
+
+/* ------------------------------------------------------------------------------------------------------- */
+
+Result<EvictionPolicy>
+ParseEvictionPolicy(const std::string &name);
+
+/* ------------------------------------------------------------------------------------------------------- */
@@ -0,0 +1,145 @@
+#include "snapshot.hpp"
+
+#include <chrono>
+#include <cstdio>
+#include <cstring>
+#include <fstream>
+
+#include <backbone/lib/packet/packet.hpp>
+
+/* ------------------------------------------------------------------------------------------------------- */
+
+Result<size_t>
+CacheSnapshot::save(AnswerCache &cache, const std::string &path) {
+   auto          temporary = path + ".tmp";
+   std::ofstream file(temporary, std::ios::binary | std::ios::trunc);
+   if (!file) {
+      return Error("Failed to create cache snapshot " + temporary);
+   }
+
+   auto   now      = std::chrono::system_clock::now();
+   Header header   = {};
+   header.version  = VERSION;
+   header.saved_at = std::chrono::duration_cast<std::chrono::seconds>(now.time_since_epoch()).count();
+   std::memcpy(header.magic, MAGIC, sizeof(MAGIC));
+   file.write(reinterpret_cast<const char *>(&header), sizeof(header));
+
+   /* One shard at a time: copied out under its lock, written to the file after */
+   std::vector<Byte> buffer;
+   size_t            count = 0;
+
+   for (size_t s = 0; s < cache.get_shard_count(); s++) {
+      cache.visit_shard(s, [&](const CacheKey &key, const CachedAnswer &answer, const auto &state) {
+         if (!answer.wire) {
+            return;
+         }
+
+         auto name     = key.name.get_wire();
+         auto response = answer.wire->get_bytes();
+
+         Entry entry           = {};
+         entry.expires_in      = state.expires_in;
+         entry.ttl             = state.ttl;
+         entry.hits            = state.hits;
+         entry.frequency       = state.frequency;
+         entry.type            = key.type;
+         entry.class_          = key.class_;
+         entry.response_length = response.size();
+         entry.name_length     = name.size();
+
+         auto *bytes = reinterpret_cast<const Byte *>(&entry);
+         buffer.insert(buffer.end(), bytes, bytes + sizeof(entry));
+         buffer.insert(buffer.end(), name.begin(), name.end());
+         buffer.insert(buffer.end(), response.begin(), response.end());
+         count++;
+      });
+
+      file.write(reinterpret_cast<const char *>(buffer.data()), buffer.size());
+      buffer.clear();
+   }
+
+   file.close();
+   if (!file) {
+      std::remove(temporary.c_str());
+      return Error("Failed to write cache snapshot " + temporary);
+   }
+
+   if (std::rename(temporary.c_str(), path.c_str()) != 0) {
+      std::remove(temporary.c_str());
+      return Error("Failed to replace cache snapshot " + path);
+   }
+
+   return count;
+}
+
+/* ------------------------------------------------------------------------------------------------------- */
+
+Result<size_t>
+CacheSnapshot::load(AnswerCache &cache, const std::string &path) {
+   std::ifstream file(path, std::ios::binary);
+   if (!file) {
+      return size_t(0);
+   }
+
+   Header header;
+   if (!file.read(reinterpret_cast<char *>(&header), sizeof(header)) ||
+       std::memcmp(header.magic, MAGIC, sizeof(MAGIC)) != 0) {
+      return Error("Not a cache snapshot: " + path);
+   }
+   if (header.version != VERSION) {
+      return Error("Unsupported cache snapshot version " + std::to_string(header.version) + ": " + path);
+   }
+
+   auto    now     = std::chrono::system_clock::now();
+   int64_t elapsed = std::chrono::duration_cast<std::chrono::seconds>(now.time_since_epoch()).count() -
+                     header.saved_at;
+   elapsed         = std::max<int64_t>(elapsed, 0);
+
+   std::vector<Byte> name(UINT8_MAX);
+   PacketBuffer      message(BufferPool::TCP_SIZE);
+   size_t            count = 0;
+
+   Entry entry;
+   while (file.read(reinterpret_cast<char *>(&entry), sizeof(entry))) {
+      if (!file.read(reinterpret_cast<char *>(name.data()), entry.name_length) ||
+          !file.read(reinterpret_cast<char *>(message.get_data()), entry.response_length)) {
+         return Error("Truncated cache snapshot: " + path);
+      }
+
+      if (entry.expires_in <= elapsed) {
+         continue;
+      }
+
+      // The response is validated as a whole first, parsing its records can't run off its end after that
+      auto response = std::span<const Byte>(message.get_data(), entry.response_length);
+      auto wire     = WireResponse::from_bytes(response);
+      auto key_name = DomainName::from_wire({ name.data(), entry.name_length });
+      if (!wire || !key_name) {
+         return Error("Corrupted cache snapshot: " + path);
+      }
+
+      auto _ = message.seek_read(0);
+
+      auto packet = Packet::from_buffer(message);
+      if (!packet) {
+         return Error("Corrupted cache snapshot: " + path);
+      }
+
+      auto &answers = packet.get_value().answers;
+      auto  answer  = CachedAnswer { { answers.begin(), answers.end() }, std::move(wire.get_value()) };
+      auto  key     = CacheKey(key_name.get_value().intern(),
+                               static_cast<PacketQuestion::QueryType>(entry.type),
+                               entry.class_);
+
+      auto state = AnswerCache::EntryState { .expires_in = static_cast<uint32_t>(entry.expires_in - elapsed),
+                                             .ttl        = entry.ttl,
+                                             .hits       = entry.hits,
+                                             .frequency  = entry.frequency };
+      cache.restore(key, std::move(answer), state);
+      count++;
+   }
+
+   return count;
+}
+
+/* ------------------------------------------------------------------------------------------------------- */
@@ -0,0 +1,76 @@
+#pragma once
+
+#include <cstdint>
+#include <string>
+
+#include <backbone/core/pch>
+#include "answer.hpp"
+
+/* ------------------------------------------------------------------------------------------------------- */
+
+/**
+ * @brief
+ * On-disk copy of an `AnswerCache`, so a restarted server starts out with the answers and popularity of
+ * the one it replaces instead of an empty cache.
+ *
+ * @details
+ * A snapshot is a `Header` followed by one `Entry` per cached answer, each followed by the key's name in
+ * wire form and the encoded response. The records are not stored separately, they are parsed out of the
+ * response again when the snapshot is loaded. Everything is in host byte order, a snapshot is only ever
+ * read by the machine that wrote it.
+ *
+ * Entries are written shard by shard. Only the shard being copied is locked, and only while its entries
+ * are being copied into a buffer, never while anything is written to the file, so saving a snapshot
+ * costs the workers no more than any other cache operation does. The file is written next to its final
+ * path and renamed over it once complete.
+ *
+ * TTLs are saved as the time left and the snapshot carries the wall clock time it was taken at. Loading
+ * it subtracts the time that has passed since then and drops whatever has expired in the meantime.
+ */
+class CacheSnapshot {
+public:
+   struct Header {
+      char     magic[8];
+      uint32_t version;
+      uint32_t reserved;
+      int64_t  saved_at;   // seconds since the epoch
+   };
+
+   struct Entry {
+      uint32_t expires_in;   // seconds, when the snapshot was taken
+      uint32_t ttl;
+      uint32_t hits;
+      uint16_t frequency;
+      uint16_t type;
+      uint16_t class_;
+      uint16_t response_length;
+      uint8_t  name_length;
+      uint8_t  reserved[3];
+   };
+
+   static_assert(sizeof(Header) == 24);
+   static_assert(sizeof(Entry) == 24);
+
+   static constexpr char     MAGIC[8] = { 'B', 'B', 'C', 'A', 'C', 'H', 'E', '\0' };
+   static constexpr uint32_t VERSION  = 1;
+
+public:
+   /**
+    * Writes every live entry of `cache` to `path`, replacing the previous snapshot.
+    *
+    * @returns Number of entries written.
+    */
+   static Result<size_t>
+   save(AnswerCache &cache, const std::string &path);
+
+   /**
+    * Restores the entries of the snapshot at `path` that have not expired since. Entries already in the
+    * cache are left alone. A missing file is an empty snapshot, not an error.
+    *
+    * @returns Number of entries restored.
+    */
+   static Result<size_t>
+   load(AnswerCache &cache, const std::string &path);
+};
+
+/* ------------------------------------------------------------------------------------------------------- */
@@ -0,0 +1,101 @@
+#include "wire.hpp"
+
+#include <cstring>
+
+/* ------------------------------------------------------------------------------------------------------- */
+
+WireResponse::WireResponse(std::vector<Byte>     bytes,
+                           std::vector<uint16_t> ttl_offsets,
+                           uint16_t              question_length)
+    : m_Bytes(std::move(bytes)), m_TtlOffsets(std::move(ttl_offsets)), m_QuestionLength(question_length) {}
+
+/* ------------------------------------------------------------------------------------------------------- */
+
+Result<WireResponse>
+WireResponse::from_bytes(std::span<const Byte> response) {
+   auto _view = PacketView::from_bytes(response).except("Failed to parse the response to cache");
+   RETURN_IF_ERROR(_view);
+   auto &view = _view.get_value();
+
+   if (view.question_count() != 1) {
+      return Error("Only responses with a single question can be cached on the wire");
+   }
+
+   // The question name is always the first thing after the header and never compressed
+   auto     question        = *view.questions().begin();
+   uint16_t question_length = view.get_question_bytes().size() - 4;
+   if (question.name.get_offset() != 12) {
+      return Error("Unexpected question layout");
+   }
+
+   /* Remember where every TTL lives. The OPT pseudo-record (type 41) reuses the field for flags */
+   std::vector<uint16_t> ttl_offsets;
+   for (auto section : { view.answers(), view.authorities(), view.additionals() }) {
+      for (auto record : section) {
+         if (record.type != 41) {
+            ttl_offsets.push_back(record.data_offset - 6);
+         }
+      }
+   }
+
+   std::vector<Byte> bytes(response.begin(), response.begin() + view.get_size());
+   return WireResponse(std::move(bytes), std::move(ttl_offsets), question_length);
+}
+
+/* ------------------------------------------------------------------------------------------------------- */
+
+Result<size_t>
+WireResponse::write_to(const PacketView &request, uint32_t ttl, PacketBuffer &response, size_t limit) const {
+   auto question = request.get_question_bytes();
+   if (request.question_count() != 1 || question.size() - 4 != m_QuestionLength) {
+      return Error("Request does not match the cached response");
+   }
+
+   bool   truncated = m_Bytes.size() > limit;
+   size_t length    = truncated ? PacketHeader::SIZE + question.size() : m_Bytes.size();
+   if (length > response.get_capacity()) {
+      return Error(PACKET_WRITE_CORRUPTED_BUFFER, "Cached response does not fit into the buffer");
+   }
+
+   Byte *out = response.get_data();
+   std::memcpy(out, m_Bytes.data(), length);
+
+   /* ID */
+   out[0] = request.id() >> 8;
+   out[1] = request.id() & 0xFF;
+
+   /* Recursion desired is echoed from the request */
+   out[2] = (out[2] & ~0x01) | (request.recursion_desired() ? 0x01 : 0x00);
+
+   /* Question name, in the client's spelling */
+   std::memcpy(out + 12, question.data(), m_QuestionLength);
+
+   /* Too long for the client: only the header and the question go out, flagged as truncated */
+   if (truncated) {
+      out[2] |= 0x02;
+      std::memset(out + 6, 0, 6);
+
+      auto res = response.seek_write(length);
+      RETURN_IF_ERROR(res);
+      return length;
+   }
+
+   /* TTLs */
+   for (uint16_t offset : m_TtlOffsets) {
+      uint32_t original = (static_cast<uint32_t>(out[offset]) << 24) | (out[offset + 1] << 16) |
+                          (out[offset + 2] << 8) | out[offset + 3];
+      uint32_t capped = std::min(original, ttl);
+
+      out[offset]     = capped >> 24;
+      out[offset + 1] = capped >> 16;
+      out[offset + 2] = capped >> 8;
+      out[offset + 3] = capped;
+   }
+
+   auto res = response.seek_write(length);
+   RETURN_IF_ERROR(res);
+
+   return length;
+}
+
+/* ------------------------------------------------------------------------------------------------------- */
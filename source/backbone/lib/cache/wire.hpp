@@ -0,0 +1,66 @@
+#pragma once
+
+#include <cstdint>
+#include <span>
+#include <vector>
+
+#include <backbone/core/pch>
+#include <backbone/lib/packet/buffer.hpp>
+#include <backbone/lib/packet/view.hpp>
+
+/* ------------------------------------------------------------------------------------------------------- */
+
+/**
+ * @brief
+ * Fully encoded response kept next to a cached answer so that a hit skips `Packet::write_to_buffer`.
+ *
+ * @details
+ * The bytes are stored exactly as they went out the first time, name compression included. Serving a hit
+ * copies them into the outgoing buffer and patches the few fields that differ between clients: the ID,
+ * the RD flag, the spelling of the question name (DNS 0x20 resolvers rely on getting their own case back)
+ * and the TTLs, which are lowered to the time the entry has left in the cache.
+ */
+class WireResponse {
+private:
+   std::vector<Byte>     m_Bytes;
+   std::vector<uint16_t> m_TtlOffsets;
+   uint16_t              m_QuestionLength;
+
+public:
+   WireResponse() = delete;
+   ~WireResponse() = default;
+
+   /**
+    * Captures an encoded response. Only responses with exactly one question can be replayed.
+    */
+   static Result<WireResponse>
+   from_bytes(std::span<const Byte> response);
+
+   /**
+    * Writes the response to `request` into `response`, with every record TTL capped at `ttl`. A response
+    * longer than `limit` is cut down to the header and the question, flagged as truncated, so that the
+    * client asks again over TCP.
+    *
+    * @returns Size of the encoded response.
+    */
+   Result<size_t>
+   write_to(const PacketView &request, uint32_t ttl, PacketBuffer &response, size_t limit = SIZE_MAX) const;
+
+   size_t
+   get_size() const {
+      return m_Bytes.size();
+   }
+
+   /**
+    * The response as it was captured, which `from_bytes` takes back.
+    */
+   std::span<const Byte>
+   get_bytes() const {
+      return m_Bytes;
+   }
+
+private:
+   WireResponse(std::vector<Byte> bytes, std::vector<uint16_t> ttl_offsets, uint16_t question_length);
+};
+
+/* ------------------------------------------------------------------------------------------------------- */
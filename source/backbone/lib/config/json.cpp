@@ -0,0 +1,322 @@
+#include "json.hpp"
+
+#include <charconv>
+#include <fstream>
+#include <sstream>
+
+/* ------------------------------------------------------------------------------------------------------- */
+
+namespace {
+
+/**
+ * Recursive descent over the text. Positions in error messages are byte offsets.
+ */
+class JsonParser {
+private:
+   static constexpr size_t MAX_DEPTH = 128;
+
+   std::string_view m_Text;
+   size_t           m_Position;
+   size_t           m_Depth;
+
+public:
+   JsonParser(std::string_view text) : m_Text(text), m_Position(0), m_Depth(0) {}
+
+   Result<JsonValue>
+   parse_document() {
+      auto value = parse_value();
+      RETURN_IF_ERROR(value);
+
+      skip_whitespace();
+      if (m_Position != m_Text.size()) {
+         return fail("Unexpected trailing characters");
+      }
+      return value;
+   }
+
+private:
+   Error
+   fail(const std::string &message) const {
+      return Error(message + " at offset " + std::to_string(m_Position));
+   }
+
+   void
+   skip_whitespace() {
+      while (m_Position < m_Text.size() && (m_Text[m_Position] == ' ' || m_Text[m_Position] == '\t' ||
+                                            m_Text[m_Position] == '\n' || m_Text[m_Position] == '\r')) {
+         m_Position++;
+      }
+   }
+
+   bool
+   consume(std::string_view token) {
+      if (m_Text.substr(m_Position, token.size()) == token) {
+         m_Position += token.size();
+         return true;
+      }
+      return false;
+   }
+
+   Result<JsonValue>
+   parse_value() {
+      skip_whitespace();
+      if (m_Position >= m_Text.size()) {
+         return fail("Unexpected end of input");
+      }
+
+      switch (m_Text[m_Position]) {
+      case '{': return parse_object();
+      case '[': return parse_array();
+      case '"': {
+         auto string = parse_string();
+         RETURN_IF_ERROR(string);
+         return JsonValue(std::move(string.get_value()));
+      }
+      case 't':
+         if (consume("true")) {
+            return JsonValue(true);
+         }
+         break;
+      case 'f':
+         if (consume("false")) {
+            return JsonValue(false);
+         }
+         break;
+      case 'n':
+         if (consume("null")) {
+            return JsonValue();
+         }
+         break;
+      default: return parse_number();
+      }
+
+      return fail("Invalid literal");
+   }
+
+   Result<JsonValue>
+   parse_number() {
+      size_t start = m_Position;
+      while (m_Position < m_Text.size() &&
+             std::string_view("+-0123456789.eE").find(m_Text[m_Position]) != std::string_view::npos) {
+         m_Position++;
+      }
+
+      double value = 0;
+      auto [end, ec] = std::from_chars(m_Text.data() + start, m_Text.data() + m_Position, value);
+      if (ec != std::errc() || end != m_Text.data() + m_Position || start == m_Position) {
+         m_Position = start;
+         return fail("Invalid number");
+      }
+      return JsonValue(value);
+   }
+
+   Result<std::string>
+   parse_string() {
+      m_Position++;   // opening quote
+
+      std::string result;
+      while (m_Position < m_Text.size()) {
+         char c = m_Text[m_Position++];
+         if (c == '"') {
+            return result;
+         }
+         if (static_cast<unsigned char>(c) < 0x20) {
+            return fail("Control character in string");
+         }
+         if (c != '\\') {
+            result += c;
+            continue;
+         }
+
+         if (m_Position >= m_Text.size()) {
+            break;
+         }
+         switch (char escape = m_Text[m_Position++]) {
+         case '"':
+         case '\\':
+         case '/': result += escape; break;
+         case 'b': result += '\b'; break;
+         case 'f': result += '\f'; break;
+         case 'n': result += '\n'; break;
+         case 'r': result += '\r'; break;
+         case 't': result += '\t'; break;
+         case 'u': {
+            auto code = parse_hex4();
+            RETURN_IF_ERROR(code);
+            uint32_t point = code.get_value();
+
+            // Surrogate pair
+            if (point >= 0xD800 && point <= 0xDBFF) {
+               if (!consume("\\u")) {
+                  return fail("Unpaired surrogate");
+               }
+               auto low = parse_hex4();
+               RETURN_IF_ERROR(low);
+               if (low.get_value() < 0xDC00 || low.get_value() > 0xDFFF) {
+                  return fail("Invalid surrogate pair");
+               }
+               point = 0x10000 + ((point - 0xD800) << 10) + (low.get_value() - 0xDC00);
+            }
+
+            append_utf8(result, point);
+            break;
+         }
+         default: return fail("Invalid escape sequence");
+         }
+      }
+
+      return fail("Unterminated string");
+   }
+
+   Result<uint32_t>
+   parse_hex4() {
+      if (m_Position + 4 > m_Text.size()) {
+         return fail("Truncated unicode escape");
+      }
+
+      uint32_t value = 0;
+      auto [end, ec] = std::from_chars(m_Text.data() + m_Position, m_Text.data() + m_Position + 4, value, 16);
+      if (ec != std::errc() || end != m_Text.data() + m_Position + 4) {
+         return fail("Invalid unicode escape");
+      }
+      m_Position += 4;
+      return value;
+   }
+
+   static void
+   append_utf8(std::string &out, uint32_t point) {
+      if (point < 0x80) {
+         out += static_cast<char>(point);
+      } else if (point < 0x800) {
+         out += static_cast<char>(0xC0 | (point >> 6));
+         out += static_cast<char>(0x80 | (point & 0x3F));
+      } else if (point < 0x10000) {
+         out += static_cast<char>(0xE0 | (point >> 12));
+         out += static_cast<char>(0x80 | ((point >> 6) & 0x3F));
+         out += static_cast<char>(0x80 | (point & 0x3F));
+      } else {
+         out += static_cast<char>(0xF0 | (point >> 18));
+         out += static_cast<char>(0x80 | ((point >> 12) & 0x3F));
+         out += static_cast<char>(0x80 | ((point >> 6) & 0x3F));
+         out += static_cast<char>(0x80 | (point & 0x3F));
+      }
+   }
+
+   Result<JsonValue>
+   parse_array() {
+      if (++m_Depth > MAX_DEPTH) {
+         return fail("Nesting too deep");
+      }
+      m_Position++;   // [
+
+      JsonValue::Array array;
+      skip_whitespace();
+      if (consume("]")) {
+         m_Depth--;
+         return JsonValue(std::move(array));
+      }
+
+      while (true) {
+         auto value = parse_value();
+         RETURN_IF_ERROR(value);
+         array.push_back(std::move(value.get_value()));
+
+         skip_whitespace();
+         if (consume("]")) {
+            break;
+         }
+         if (!consume(",")) {
+            return fail("Expected ',' or ']'");
+         }
+      }
+
+      m_Depth--;
+      return JsonValue(std::move(array));
+   }
+
+   Result<JsonValue>
+   parse_object() {
+      if (++m_Depth > MAX_DEPTH) {
+         return fail("Nesting too deep");
+      }
+      m_Position++;   // {
+
+      JsonValue::Object object;
+      skip_whitespace();
+      if (consume("}")) {
+         m_Depth--;
+         return JsonValue(std::move(object));
+      }
+
+      while (true) {
+         skip_whitespace();
+         if (m_Position >= m_Text.size() || m_Text[m_Position] != '"') {
+            return fail("Expected a member name");
+         }
+         auto key = parse_string();
+         RETURN_IF_ERROR(key);
+
+         skip_whitespace();
+         if (!consume(":")) {
+            return fail("Expected ':'");
+         }
+
+         auto value = parse_value();
+         RETURN_IF_ERROR(value);
+         object.emplace_back(std::move(key.get_value()), std::move(value.get_value()));
+
+         skip_whitespace();
+         if (consume("}")) {
+            break;
+         }
+         if (!consume(",")) {
+            return fail("Expected ',' or '}'");
+         }
+      }
+
+      m_Depth--;
+      return JsonValue(std::move(object));
+   }
+};
+
+}   // namespace
+
+/* ------------------------------------------------------------------------------------------------------- */
+
+Result<JsonValue>
+JsonValue::parse(std::string_view text) {
+   return JsonParser(text).parse_document();
+}
+
+/* ------------------------------------------------------------------------------------------------------- */
+
+Result<JsonValue>
+JsonValue::parse_file(const std::string &path) {
+   std::ifstream file(path, std::ios::binary);
+   if (!file) {
+      return Error("Failed to open " + path);
+   }
+
+   std::stringstream contents;
+   contents << file.rdbuf();
+
+   return parse(contents.str()).except("Failed to parse " + path);
+}
+
+/* ------------------------------------------------------------------------------------------------------- */
+
+const JsonValue *
+JsonValue::find(std::string_view key) const {
+   if (!is_object()) {
+      return nullptr;
+   }
+
+   for (const auto &[name, value] : as_object()) {
+      if (name == key) {
+         return &value;
+      }
+   }
+   return nullptr;
+}
+
+/* ------------------------------------------------------------------------------------------------------- */
@@ -0,0 +1,102 @@
+#pragma once
+
+#include <string>
+#include <string_view>
+#include <utility>
+#include <variant>
+#include <vector>
+
+#include <backbone/core/pch>
+
+/* ------------------------------------------------------------------------------------------------------- */
+
+/**
+ * @brief
+ * Parsed JSON document. Objects keep their members in document order.
+ */
+class JsonValue {
+public:
+   using Array  = std::vector<JsonValue>;
+   using Object = std::vector<std::pair<std::string, JsonValue>>;
+
+private:
+   std::variant<std::nullptr_t, bool, double, std::string, Array, Object> m_Value;
+
+public:
+   JsonValue() : m_Value(nullptr) {}
+   JsonValue(bool value) : m_Value(value) {}
+   JsonValue(double value) : m_Value(value) {}
+   JsonValue(std::string value) : m_Value(std::move(value)) {}
+   JsonValue(Array value) : m_Value(std::move(value)) {}
+   JsonValue(Object value) : m_Value(std::move(value)) {}
+   ~JsonValue() = default;
+
+   static Result<JsonValue>
+   parse(std::string_view text);
+
+   static Result<JsonValue>
+   parse_file(const std::string &path);
+
+   bool
+   is_null() const {
+      return std::holds_alternative<std::nullptr_t>(m_Value);
+   }
+
+   bool
+   is_bool() const {
+      return std::holds_alternative<bool>(m_Value);
+   }
+
+   bool
+   is_number() const {
+      return std::holds_alternative<double>(m_Value);
+   }
+
+   bool
+   is_string() const {
+      return std::holds_alternative<std::string>(m_Value);
+   }
+
+   bool
+   is_array() const {
+      return std::holds_alternative<Array>(m_Value);
+   }
+
+   bool
+   is_object() const {
+      return std::holds_alternative<Object>(m_Value);
+   }
+
+   bool
+   as_bool() const {
+      return std::get<bool>(m_Value);
+   }
+
+   double
+   as_number() const {
+      return std::get<double>(m_Value);
+   }
+
+   const std::string &
+   as_string() const {
+      return std::get<std::string>(m_Value);
+   }
+
+   const Array &
+   as_array() const {
+      return std::get<Array>(m_Value);
+   }
+
+   const Object &
+   as_object() const {
+      return std::get<Object>(m_Value);
+   }
+
+   /**
+    * Member `key` of an object, or null if this is not an object or has no such member.
+    */
+   const JsonValue *
+   find(std::string_view key) const;
+};
+
+/* ------------------------------------------------------------------------------------------------------- */
@@ -0,0 +1,289 @@
+#include "loader.hpp"
+
+#include <arpa/inet.h>
+#include <sstream>
+
+#include <backbone/lib/packet/question.hpp>
+
+/* ------------------------------------------------------------------------------------------------------- */
+
+static Result<void>
+EncodeName(std::string_view name, std::vector<Byte> &out) {
+   if (!name.empty() && name.back() == '.') {
+      name.remove_suffix(1);
+   }
+   if (name.size() > 253) {
+      return Error("Domain name is too long: " + std::string(name));
+   }
+
+   for (size_t start = 0; start < name.size();) {
+      size_t end = std::min(name.find('.', start), name.size());
+      if (end == start || end - start > 63) {
+         return Error("Invalid label in domain name: " + std::string(name));
+      }
+
+      out.push_back(end - start);
+      out.insert(out.end(), name.begin() + start, name.begin() + end);
+      start = end + 1;
+   }
+   out.push_back(0);
+
+   return Ok();
+}
+
+/* ------------------------------------------------------------------------------------------------------- */
+
+static void
+EncodeUint(std::vector<Byte> &out, uint32_t value, size_t bytes) {
+   for (size_t i = bytes; i-- > 0;) {
+      out.push_back((value >> (i * 8)) & 0xFF);
+   }
+}
+
+/* ------------------------------------------------------------------------------------------------------- */
+
+static Result<uint16_t>
+ParseType(const std::string &name) {
+   static const std::pair<const char *, PacketQuestion::QueryType> types[] = {
+      { "A", PacketQuestion::A },         { "AAAA", PacketQuestion::AAAA }, { "NS", PacketQuestion::NS },
+      { "CNAME", PacketQuestion::CNAME }, { "PTR", PacketQuestion::PTR },   { "MX", PacketQuestion::MX },
+      { "TXT", PacketQuestion::TXT },     { "SOA", PacketQuestion::SOA },
+   };
+
+   for (const auto &[text, type] : types) {
+      if (name == text) {
+         return static_cast<uint16_t>(type);
+      }
+   }
+   return Error("Unsupported record type: " + name);
+}
+
+/* ------------------------------------------------------------------------------------------------------- */
+
+/**
+ * Encodes the presentation format `value` of a record of `type` as wire RDATA.
+ */
+static Result<std::vector<Byte>>
+EncodeData(uint16_t type, const std::string &value) {
+   std::vector<Byte> data;
+
+   switch (type) {
+   case PacketQuestion::A: {
+      in_addr address;
+      if (inet_pton(AF_INET, value.c_str(), &address) != 1) {
+         return Error("Invalid IPv4 address: " + value);
+      }
+      auto *bytes = reinterpret_cast<const Byte *>(&address);
+      data.assign(bytes, bytes + sizeof(address));
+      break;
+   }
+   case PacketQuestion::AAAA: {
+      in6_addr address;
+      if (inet_pton(AF_INET6, value.c_str(), &address) != 1) {
+         return Error("Invalid IPv6 address: " + value);
+      }
+      auto *bytes = reinterpret_cast<const Byte *>(&address);
+      data.assign(bytes, bytes + sizeof(address));
+      break;
+   }
+   case PacketQuestion::NS:
+   case PacketQuestion::CNAME:
+   case PacketQuestion::PTR: {
+      auto res = EncodeName(value, data);
+      RETURN_IF_ERROR(res);
+      break;
+   }
+   case PacketQuestion::MX: {
+      std::istringstream fields(value);
+      uint32_t           preference;
+      std::string        exchange;
+      if (!(fields >> preference >> exchange) || preference > UINT16_MAX) {
+         return Error("Expected '<preference> <exchange>' for MX: " + value);
+      }
+      EncodeUint(data, preference, 2);
+      auto res = EncodeName(exchange, data);
+      RETURN_IF_ERROR(res);
+      break;
+   }
+   case PacketQuestion::TXT: {
+      // Character strings hold at most 255 bytes each
+      for (size_t start = 0; start < value.size() || start == 0; start += 255) {
+         size_t length = std::min<size_t>(255, value.size() - start);
+         data.push_back(length);
+         data.insert(data.end(), value.begin() + start, value.begin() + start + length);
+         if (value.empty()) {
+            break;
+         }
+      }
+      break;
+   }
+   case PacketQuestion::SOA: {
+      std::istringstream fields(value);
+      std::string        mname, rname;
+      uint32_t           numbers[5];
+      if (!(fields >> mname >> rname >> numbers[0] >> numbers[1] >> numbers[2] >> numbers[3] >> numbers[4])) {
+         return Error("Expected '<mname> <rname> <serial> <refresh> <retry> <expire> <minimum>' for SOA");
+      }
+      auto res = EncodeName(mname, data);
+      RETURN_IF_ERROR(res);
+      res = EncodeName(rname, data);
+      RETURN_IF_ERROR(res);
+      for (uint32_t number : numbers) {
+         EncodeUint(data, number, 4);
+      }
+      break;
+   }
+   }
+
+   return data;
+}
+
+/* ------------------------------------------------------------------------------------------------------- */
+
+static bool
+IsUnder(std::string_view name, std::string_view tld) {
+   if (!name.empty() && name.back() == '.') {
+      name.remove_suffix(1);
+   }
+   if (name.size() < tld.size()) {
+      return false;
+   }
+
+   auto suffix = name.substr(name.size() - tld.size());
+   for (size_t i = 0; i < tld.size(); i++) {
+      auto a = static_cast<unsigned char>(suffix[i]), b = static_cast<unsigned char>(tld[i]);
+      if (std::tolower(a) != std::tolower(b)) {
+         return false;
+      }
+   }
+   return name.size() == tld.size() || name[name.size() - tld.size() - 1] == '.';
+}
+
+/* ------------------------------------------------------------------------------------------------------- */
+
+Result<void>
+LoadZoneConfig(const JsonValue &config, ZoneBuilder &builder) {
+   if (!config.is_object()) {
+      return Error("Config must be a JSON object");
+   }
+
+   uint32_t default_ttl = 300;
+   if (auto *ttl = config.find("ttl")) {
+      if (!ttl->is_number() || ttl->as_number() < 0 || ttl->as_number() > INT32_MAX) {
+         return Error("'ttl' must be a non-negative number");
+      }
+      default_ttl = ttl->as_number();
+   }
+
+   /* TLDs */
+   std::vector<std::string> tlds;
+   if (auto *list = config.find("tlds")) {
+      if (!list->is_array()) {
+         return Error("'tlds' must be an array of names");
+      }
+      for (const auto &tld : list->as_array()) {
+         if (!tld.is_string()) {
+            return Error("'tlds' must be an array of names");
+         }
+
+         auto name = tld.as_string();
+         if (!name.empty() && name.back() == '.') {
+            name.pop_back();
+         }
+         auto res = builder.add_apex(name);
+         RETURN_IF_ERROR(res);
+         tlds.push_back(name);
+      }
+   }
+
+   /* Records */
+   std::vector<bool> has_soa(tlds.size(), false);
+
+   auto add = [&](const std::string &name, const JsonValue &entry) -> Result<void> {
+      std::string type_name, value;
+      uint32_t    ttl = default_ttl;
+
+      if (entry.is_string()) {
+         value     = entry.as_string();
+         type_name = value.find(':') == std::string::npos ? "A" : "AAAA";
+      } else if (entry.is_object()) {
+         auto *type = entry.find("type");
+         auto *data = entry.find("value");
+         if (!type || !type->is_string() || !data || !data->is_string()) {
+            return Error("Record of " + name + " needs a string 'type' and 'value'");
+         }
+         type_name = type->as_string();
+         value     = data->as_string();
+
+         if (auto *record_ttl = entry.find("ttl")) {
+            double number = record_ttl->is_number() ? record_ttl->as_number() : -1;
+            if (number < 0 || number > INT32_MAX) {
+               return Error("Record of " + name + " has an invalid 'ttl'");
+            }
+            ttl = record_ttl->as_number();
+         }
+      } else {
+         return Error("Record of " + name + " must be an address or an object");
+      }
+
+      auto type = ParseType(type_name);
+      RETURN_IF_ERROR(type);
+      auto data = EncodeData(type.get_value(), value);
+      if (data.is_error()) {
+         return data.except("Invalid record of " + name).get_error();
+      }
+
+      for (size_t i = 0; i < tlds.size(); i++) {
+         if (type.get_value() == PacketQuestion::SOA && IsUnder(name, tlds[i]) && IsUnder(tlds[i], name)) {
+            has_soa[i] = true;
+         }
+      }
+
+      return builder.add_record(name, type.get_value(), ttl, data.get_value());
+   };
+
+   if (auto *records = config.find("records")) {
+      if (!records->is_object()) {
+         return Error("'records' must be an object keyed by name");
+      }
+
+      for (const auto &[name, entry] : records->as_object()) {
+         bool enclosed = false;
+         for (const auto &tld : tlds) {
+            enclosed = enclosed || IsUnder(name, tld);
+         }
+         if (!enclosed) {
+            return Error(name + " is not under any of the configured TLDs");
+         }
+
+         if (entry.is_array()) {
+            for (const auto &item : entry.as_array()) {
+               auto res = add(name, item);
+               RETURN_IF_ERROR(res);
+            }
+         } else {
+            auto res = add(name, entry);
+            RETURN_IF_ERROR(res);
+         }
+      }
+   }
+
+   /* Every zone needs an SOA for its negative answers */
+   for (size_t i = 0; i < tlds.size(); i++) {
+      if (has_soa[i]) {
+         continue;
+      }
+
+      auto value = "ns." + tlds[i] + " hostmaster." + tlds[i] + " 1 3600 600 86400 " +
+                   std::to_string(default_ttl);
+      auto data = EncodeData(PacketQuestion::SOA, value);
+      RETURN_IF_ERROR(data);
+
+      auto res = builder.add_record(tlds[i], PacketQuestion::SOA, default_ttl, data.get_value());
+      RETURN_IF_ERROR(res);
+   }
+
+   return Ok();
+}
+
+/* ------------------------------------------------------------------------------------------------------- */
@@ -0,0 +1,33 @@
+#pragma once
+
+#include <backbone/core/pch>
+#include <backbone/lib/zone/builder.hpp>
+#include "json.hpp"
+
+/* ------------------------------------------------------------------------------------------------------- */
+
+/**
+ * @brief
+ * Fills `builder` from a `config.json` document.
+ *
+ * @details
+ * ```json
+ * {
+ *    "ttl": 300,
+ *    "tlds": ["example", "custom"],
+ *    "records": {
+ *       "example.custom": "192.168.1.1",
+ *       "api.custom": ["10.0.0.1", "fd00::1"],
+ *       "www.custom": { "type": "CNAME", "value": "example.custom" },
+ *       "custom": [{ "type": "MX", "value": "10 mail.custom", "ttl": 3600 }]
+ *    }
+ * }
+ * ```
+ * Every TLD becomes a zone apex with a generated SOA unless the config gives one. A bare string is an
+ * A or AAAA record depending on the address. Objects take a `type` (A, AAAA, NS, CNAME, PTR, MX, TXT, SOA),
+ * a presentation format `value` and an optional `ttl`. Every name must sit under one of the TLDs.
+ */
+Result<void>
+LoadZoneConfig(const JsonValue &config, ZoneBuilder &builder);
+
+/* ------------------------------------------------------------------------------------------------------- */
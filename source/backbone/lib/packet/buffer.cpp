@@ -1,74 +1,214 @@
 #include "buffer.hpp"
 
+#include <cstring>
+
 /* ------------------------------------------------------------------------------------------------------- */
 
-PacketBuffer::PacketBuffer() : BasicBuffer<uint8_t, 512>(0) {}
+static inline char
+ToLower(char c) {
+   return (c >= 'A' && c <= 'Z') ? c + ('a' - 'A') : c;
+}
 
 /* ------------------------------------------------------------------------------------------------------- */
 
-Result<std::string>
-PacketBuffer::read_qname() {
-   const int max_jumps = 5;
+PacketBuffer::PacketBuffer(size_t capacity) : PacketBuffer(BufferPool::acquire(capacity)) {}
 
-   size_t      pos             = get_read_index();
-   bool        jumped          = false;
-   int         jumps_performed = 0;
-   std::string delim           = "";
+/* ------------------------------------------------------------------------------------------------------- */
 
-   std::string result;
-   while (true) {
-      if (jumps_performed > max_jumps) {
-         return Error("Limit of 5 jumps in a DNS name exceeded.");
-      }
+PacketBuffer::PacketBuffer(BufferPool::Block block)
+    : SpanBuffer<Byte>(block.get_span()), m_Block(std::move(block)), m_Generation(0) {
+   std::memset(m_Names.data(), 0, sizeof(m_Names));
+   clear_names();
+}
 
-      uint8_t len = get_at(pos).with_fallback(0).get_value();
+/* ------------------------------------------------------------------------------------------------------- */
 
-      if ((len & 0xC0) == 0xC0) {
-         if (!jumped) {
-            auto res = seek_read(pos + 2);
-            RETURN_IF_ERROR(res);
-         }
+Result<DomainName>
+PacketBuffer::read_name(std::pmr::polymorphic_allocator<> allocator) {
+   NameKernel::Output name;
 
-         uint8_t b2     = get_at(pos + 1).with_fallback(0).get_value();
-         size_t  offset = (((len ^ 0xC0) << 8) | b2);
-         pos            = offset;
+   auto message = std::span<const Byte>(get_data(), get_capacity());
+   auto _scan   = NameKernel::scan(message, get_read_index(), name);
+   RETURN_IF_ERROR(_scan);
+   auto &scan = _scan.get_value();
 
-         jumped = true;
-         jumps_performed += 1;
+   auto res = seek_read(scan.end);
+   RETURN_IF_ERROR(res);
 
-         continue;
-      } else {
-         pos += 1;
+   return DomainName(name, scan, allocator);
+}
+
+/* ------------------------------------------------------------------------------------------------------- */
+
+Result<void>
+PacketBuffer::write_name(const DomainName &name) {
+   return write_name(name.get_wire(), name.get_label_offsets(), name.get_hash());
+}
+
+/* ------------------------------------------------------------------------------------------------------- */
+
+Result<void>
+PacketBuffer::write_name(std::span<const Byte> wire) {
+   if (wire.size() > 255) {
+      return Error(PACKET_WRITE_CORRUPTED_BUFFER, "Domain name exceeds 255 bytes");
+   }
+
+   std::array<uint8_t, NameKernel::MAX_LABELS> offsets;
+   size_t                                      count = 0;
+   size_t                                      pos   = 0;
+   while (pos < wire.size() && wire[pos] != 0 && count < offsets.size() && !(wire[pos] & 0xC0)) {
+      offsets[count++] = pos;
+      pos += 1 + wire[pos];
+   }
+
+   // Uncompressed, with the root label as its very last byte
+   if (pos + 1 != wire.size() || wire[pos] != 0) {
+      return Error(PACKET_WRITE_CORRUPTED_BUFFER, "Invalid domain name");
+   }
+
+   return write_name(wire, std::span<const uint8_t>(offsets.data(), count), NameKernel::hash(wire));
+}
+
+/* ------------------------------------------------------------------------------------------------------- */
+
+Result<void>
+PacketBuffer::write_name(std::span<const Byte> wire, std::span<const uint8_t> offsets, uint64_t hash) {
+   size_t count = offsets.size();
+
+   /* Longest suffix that was already written. The whole name comes hashed, only its suffixes need it */
+   std::array<uint32_t, NameKernel::MAX_LABELS> hashes;
+   size_t                                       match = count;
+   std::optional<uint16_t>                      pointer;
+   for (size_t i = 0; i < count && !pointer; i++) {
+      auto suffix = wire.subspan(offsets[i]);
+      hashes[i]   = i == 0 ? hash : NameKernel::hash(suffix);
+      pointer     = find_name(hashes[i], suffix);
+      match       = pointer ? i : count;
+   }
+
+   /* Labels in front of it go out literally, followed by the pointer or the root label */
+   size_t literal = match < count ? offsets[match] : wire.size() - 1;
+   size_t needed  = literal + (pointer ? 2 : 1);
+   if (needed > get_write_remaining()) {
+      return Error(PACKET_WRITE_CORRUPTED_BUFFER, "Domain name does not fit into the buffer");
+   }
+
+   size_t offset = get_write_index();
+   Byte  *out    = get_data() + offset;
+   std::memcpy(out, wire.data(), literal);
+   for (size_t i = 0; i < match; i++) {
+      remember_name(hashes[i], offset + offsets[i]);
+   }
 
-         if (len == 0) {
-            break;
+   if (pointer) {
+      out[literal]     = 0xC0 | (pointer.value() >> 8);
+      out[literal + 1] = pointer.value() & 0xFF;
+   } else {
+      out[literal] = 0;
+   }
+
+   return seek_write(offset + needed);
+}
+
+/* ------------------------------------------------------------------------------------------------------- */
+
+void
+PacketBuffer::clear_names() {
+   // Slots are only reset once every generation has been used up
+   if (++m_Generation == 0) {
+      std::memset(m_Names.data(), 0, sizeof(m_Names));
+      m_Generation = 1;
+   }
+}
+
+/* ------------------------------------------------------------------------------------------------------- */
+
+bool
+PacketBuffer::matches_name(size_t offset, std::span<const Byte> suffix) {
+   const Byte *data  = get_data();
+   size_t      end   = get_write_index();
+   size_t      pos   = offset;
+   int         jumps = 0;
+
+   while (pos < end) {
+      uint8_t length = data[pos];
+
+      if ((length & 0xC0) == 0xC0) {
+         if (pos + 1 >= end) {
+            return false;
          }
 
-         result += delim;
+         // Only follow pointers backwards, which also rules out loops
+         size_t target = ((length & 0x3F) << 8) | data[pos + 1];
+         if (target >= pos || ++jumps > 16) {
+            return false;
+         }
 
-         auto str_buffer = get_range(pos, pos + len).except("Failed to read label from buffer.");
-         RETURN_IF_ERROR(str_buffer);
+         pos = target;
+         continue;
+      }
 
-         result += std::string(str_buffer.get_value().begin(), str_buffer.get_value().end());
+      // The suffix is canonical, so it is lowercase and ends in the root label
+      if ((length & 0xC0) || suffix.empty() || suffix[0] != length) {
+         return false;
+      }
+      if (length == 0) {
+         return true;
+      }
+      if (pos + 1 + length > end) {
+         return false;
+      }
 
-         delim = ".";
-         pos += len;
+      for (size_t i = 0; i < length; i++) {
+         if (static_cast<Byte>(ToLower(data[pos + 1 + i])) != suffix[1 + i]) {
+            return false;
+         }
       }
+
+      suffix = suffix.subspan(1 + length);
+      pos += 1 + length;
    }
 
-   if (!jumped) {
-      auto res = seek_read(pos);
-      RETURN_IF_ERROR(res);
+   return false;
+}
+
+/* ------------------------------------------------------------------------------------------------------- */
+
+void
+PacketBuffer::remember_name(uint32_t hash, size_t offset) {
+   // Pointers only have 14 bits for the offset
+   if (offset == 0 || offset >= 0x4000) {
+      return;
    }
 
-   return result;
+   for (size_t i = 0; i < NAME_SLOTS; i++) {
+      auto &slot = m_Names[(hash + i) & (NAME_SLOTS - 1)];
+      if (slot.generation != m_Generation) {
+         slot = { hash, static_cast<uint16_t>(offset), m_Generation };
+         return;
+      }
+   }
+
+   // Table is full, the name simply will not be a compression target
 }
 
 /* ------------------------------------------------------------------------------------------------------- */
 
-Result<void>
-PacketBuffer::write_qname(std::string qname) {
-   return Result<void>();
+std::optional<uint16_t>
+PacketBuffer::find_name(uint32_t hash, std::span<const Byte> suffix) {
+   for (size_t i = 0; i < NAME_SLOTS; i++) {
+      const auto &slot = m_Names[(hash + i) & (NAME_SLOTS - 1)];
+      if (slot.generation != m_Generation) {
+         break;
+      }
+
+      // Slots are checked against the bytes themselves, so hash collisions and stale slots are harmless
+      if (slot.hash == hash && slot.offset < get_write_index() && matches_name(slot.offset, suffix)) {
+         return slot.offset;
+      }
+   }
+
+   return std::nullopt;
 }
 
 /* ------------------------------------------------------------------------------------------------------- */
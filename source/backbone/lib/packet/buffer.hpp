@@ -1,19 +1,116 @@
 #pragma once
 
-#include <backbone/lib/buffer/basic.tpp>
+#include <array>
+#include <memory_resource>
+#include <string_view>
+
+#include <backbone/lib/buffer/pool.hpp>
+#include <backbone/lib/buffer/span.tpp>
+#include "domain.hpp"
 
 /* ------------------------------------------------------------------------------------------------------- */
 
-class PacketBuffer : public BasicBuffer<Byte, 512> {
+/**
+ * @brief
+ * Message buffer on top of a block from the `BufferPool`.
+ *
+ * @details
+ * A packet buffer is the sole owner of its block, so it can be moved but never copied, and the block goes
+ * back to the pool as soon as the buffer is destroyed. The block is not cleared beforehand, only what has
+ * been written is meaningful.
+ */
+class PacketBuffer : public SpanBuffer<Byte> {
+public:
+   static constexpr size_t NAME_SLOTS = 64;   // must be a power of two
+
+private:
+   /**
+    * One previously written name suffix: the hash of its labels and where it starts in the buffer.
+    * Slots of an earlier message (another generation) are empty, so forgetting every name is a single
+    * increment rather than clearing the table.
+    */
+   struct NameSlot {
+      uint32_t hash;
+      uint16_t offset;
+      uint16_t generation;
+   };
+
+   BufferPool::Block                m_Block;
+   std::array<NameSlot, NAME_SLOTS> m_Names;
+   uint16_t                         m_Generation;
+
 public:
-   PacketBuffer();
-   ~PacketBuffer() = default;
+   /**
+    * Takes a block holding at least `capacity` bytes from the pool of the calling thread. The capacity
+    * may end up larger than asked for, messages that have a size limit must enforce it themselves.
+    */
+   PacketBuffer(size_t capacity = BufferPool::UDP_SIZE);
+   PacketBuffer(PacketBuffer &&other) noexcept = default;
+   ~PacketBuffer()                             = default;
+
+   PacketBuffer &
+   operator=(PacketBuffer &&other) noexcept = default;
+
+   /**
+    * Reads the name at the read index, following compression pointers, through the `NameKernel`. The
+    * name is allocated with `allocator`, which is how parsed packets end up in a `QueryArena`.
+    */
+   Result<DomainName>
+   read_name(std::pmr::polymorphic_allocator<> allocator = {});
+
+   /**
+    * Writes `name` at the write index, replacing its longest already written suffix with a compression
+    * pointer (RFC 1035 4.1.4). Every suffix written here is remembered for the names that follow.
+    */
+   Result<void>
+   write_name(const DomainName &name);
+
+   /**
+    * Same as above for a name already in canonical wire form, such as one embedded in RDATA.
+    */
+   Result<void>
+   write_name(std::span<const Byte> wire);
+
+   /**
+    * Forgets every remembered suffix. Must be called whenever a new message starts in this buffer.
+    */
+   void
+   clear_names();
 
-   Result<std::string>
-   read_qname();
+private:
+   PacketBuffer(BufferPool::Block block);
 
    Result<void>
-   write_qname(std::string qname);
+   write_name(std::span<const Byte> wire, std::span<const uint8_t> offsets, uint64_t hash);
+
+   bool
+   matches_name(size_t offset, std::span<const Byte> suffix);
+
+   void
+   remember_name(uint32_t hash, size_t offset);
+
+   std::optional<uint16_t>
+   find_name(uint32_t hash, std::span<const Byte> suffix);
 };
 
 /* ------------------------------------------------------------------------------------------------------- */
+
+/**
+ * @brief
+ * Byte buffer that also knows how to read and write (compressed) domain names, which is everything the
+ * packet types need to parse and serialize themselves.
+ */
+template<typename B>
+concept NameBuffer = Buffer<B, Byte> && requires(B                                 buffer,
+                                                 const DomainName                 &name,
+                                                 std::span<const Byte>             wire,
+                                                 std::pmr::polymorphic_allocator<> allocator) {
+   { buffer.read_name(allocator) } -> std::same_as<Result<DomainName>>;
+   { buffer.write_name(name) } -> std::same_as<Result<void>>;
+   { buffer.write_name(wire) } -> std::same_as<Result<void>>;
+   buffer.clear_names();
+};
+
+static_assert(NameBuffer<PacketBuffer>);
+
+/* ------------------------------------------------------------------------------------------------------- */
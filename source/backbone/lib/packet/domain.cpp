@@ -0,0 +1,349 @@
+#include "domain.hpp"
+
+#include <algorithm>
+#include <cstring>
+#include <mutex>
+#include <unordered_map>
+
+/* ------------------------------------------------------------------------------------------------------- */
+/* DomainName                                                                                              */
+/* ------------------------------------------------------------------------------------------------------- */
+
+DomainName::DomainName(allocator_type allocator) : m_Data(get_root()), m_Allocator(allocator) {}
+
+/* ------------------------------------------------------------------------------------------------------- */
+
+DomainName::DomainName(const NameKernel::Output &out, const NameScan &scan, allocator_type allocator)
+    : m_Data(get_root()), m_Allocator(allocator) {
+   if (scan.label_count == 0) {
+      return;
+   }
+
+   size_t size  = sizeof(Data) + scan.label_count + scan.length;
+   auto  *bytes = static_cast<Byte *>(m_Allocator.allocate_bytes(size, alignof(Data)));
+   m_Data       = new (bytes) Data { scan.hash, scan.length, scan.label_count, false };
+   std::memcpy(bytes + sizeof(Data), out.offsets.data(), scan.label_count);
+   std::memcpy(bytes + sizeof(Data) + scan.label_count, out.wire.data(), scan.length);
+}
+
+/* ------------------------------------------------------------------------------------------------------- */
+
+DomainName::DomainName(const DomainName &other) : DomainName(other, allocator_type()) {}
+
+/* ------------------------------------------------------------------------------------------------------- */
+
+DomainName::DomainName(const DomainName &other, allocator_type allocator)
+    : m_Data(share(other.m_Data, allocator)), m_Allocator(allocator) {}
+
+/* ------------------------------------------------------------------------------------------------------- */
+
+DomainName::DomainName(DomainName &&other) noexcept
+    : m_Data(std::exchange(other.m_Data, get_root())), m_Allocator(other.m_Allocator) {}
+
+/* ------------------------------------------------------------------------------------------------------- */
+
+DomainName::DomainName(DomainName &&other, allocator_type allocator)
+    : m_Data(allocator == other.m_Allocator ? std::exchange(other.m_Data, get_root())
+                                            : share(other.m_Data, allocator)),
+      m_Allocator(allocator) {}
+
+/* ------------------------------------------------------------------------------------------------------- */
+
+DomainName::~DomainName() {
+   release();
+}
+
+/* ------------------------------------------------------------------------------------------------------- */
+
+DomainName &
+DomainName::operator=(const DomainName &other) {
+   if (this != &other) {
+      const Data *data = share(other.m_Data, m_Allocator);
+      release();
+      m_Data = data;
+   }
+   return *this;
+}
+
+/* ------------------------------------------------------------------------------------------------------- */
+
+DomainName &
+DomainName::operator=(DomainName &&other) {
+   if (this == &other) {
+      return *this;
+   }
+
+   // Names from another allocator have to be copied, the allocator of a name never changes
+   if (m_Allocator != other.m_Allocator && !other.m_Data->interned) {
+      return *this = static_cast<const DomainName &>(other);
+   }
+
+   release();
+   m_Data = std::exchange(other.m_Data, get_root());
+   return *this;
+}
+
+/* ------------------------------------------------------------------------------------------------------- */
+
+/**
+ * @brief
+ * Splits the text into labels and hands the result to the `NameKernel`, exactly like a name read from a
+ * message, so that both end up identical.
+ */
+Result<DomainName>
+DomainName::from_string(std::string_view dotted, allocator_type allocator) {
+   if (!dotted.empty() && dotted.back() == '.') {
+      dotted.remove_suffix(1);
+   }
+   if (dotted.empty()) {
+      return DomainName(allocator);
+   }
+   if (dotted.size() > 253) {
+      return Error(FAILED_TO_READ_QNAME, "Domain name exceeds 255 bytes");
+   }
+
+   std::array<Byte, 256> wire;
+   size_t                length = 0;
+   for (size_t start = 0; start <= dotted.size();) {
+      size_t end = std::min(dotted.find('.', start), dotted.size());
+      if (end == start || end - start > 63) {
+         return Error(FAILED_TO_READ_LABEL, "Invalid label length in domain name");
+      }
+
+      wire[length++] = end - start;
+      std::memcpy(wire.data() + length, dotted.data() + start, end - start);
+      length += end - start;
+      start = end + 1;
+   }
+   wire[length++] = 0;
+
+   return from_wire(std::span<const Byte>(wire.data(), length), allocator);
+}
+
+/* ------------------------------------------------------------------------------------------------------- */
+
+Result<DomainName>
+DomainName::from_wire(std::span<const Byte> wire, allocator_type allocator) {
+   NameKernel::Output out;
+   auto               _scan = NameKernel::scan(wire, 0, out);
+   RETURN_IF_ERROR(_scan);
+
+   // A pointer has nothing to point to without the message around it
+   auto &scan = _scan.get_value();
+   if (scan.end != scan.length || scan.end != wire.size()) {
+      return Error(FAILED_TO_READ_QNAME, "Not a single uncompressed name");
+   }
+
+   return DomainName(out, scan, allocator);
+}
+
+/* ------------------------------------------------------------------------------------------------------- */
+
+std::string_view
+DomainName::get_label(size_t index) const {
+   auto wire   = get_wire();
+   auto offset = get_label_offset(index);
+   return std::string_view(reinterpret_cast<const char *>(wire.data() + offset + 1), wire[offset]);
+}
+
+/* ------------------------------------------------------------------------------------------------------- */
+
+bool
+DomainName::is_subdomain_of(const DomainName &other) const {
+   if (other.get_length() > get_length()) {
+      return false;
+   }
+
+   // The suffix has to start right at one of the labels, not somewhere inside a label
+   size_t start   = get_length() - other.get_length();
+   auto   offsets = get_label_offsets();
+   if (start < get_length() - 1 && !std::binary_search(offsets.begin(), offsets.end(), start)) {
+      return false;
+   }
+
+   return std::memcmp(get_wire().data() + start, other.get_wire().data(), other.get_length()) == 0;
+}
+
+/* ------------------------------------------------------------------------------------------------------- */
+
+DomainName
+DomainName::get_suffix(size_t index, allocator_type allocator) const {
+   if (index >= get_label_count()) {
+      return DomainName(allocator);
+   }
+
+   size_t start = get_label_offset(index);
+   size_t count = get_label_count() - index;
+   size_t size  = sizeof(Data) + count + get_length() - start;
+
+   auto *bytes = static_cast<Byte *>(allocator.allocate_bytes(size, alignof(Data)));
+   auto  wire  = get_wire().subspan(start);
+   new (bytes) Data { NameKernel::hash(wire), uint8_t(wire.size()), uint8_t(count), false };
+   for (size_t i = 0; i < count; i++) {
+      bytes[sizeof(Data) + i] = get_label_offset(index + i) - start;
+   }
+   std::memcpy(bytes + sizeof(Data) + count, wire.data(), wire.size());
+
+   DomainName suffix(allocator);
+   suffix.m_Data = reinterpret_cast<const Data *>(bytes);
+   return suffix;
+}
+
+/* ------------------------------------------------------------------------------------------------------- */
+
+DomainName
+DomainName::intern() const {
+   return NameTable::get_global().intern(*this);
+}
+
+/* ------------------------------------------------------------------------------------------------------- */
+
+std::string
+DomainName::to_string() const {
+   if (is_root()) {
+      return ".";
+   }
+
+   std::string result;
+   result.reserve(get_length());
+   for (size_t i = 0; i < get_label_count(); i++) {
+      if (i > 0) {
+         result += '.';
+      }
+      result += get_label(i);
+   }
+   return result;
+}
+
+/* ------------------------------------------------------------------------------------------------------- */
+
+bool
+DomainName::operator==(const DomainName &other) const {
+   if (m_Data == other.m_Data) {
+      return true;
+   }
+   if (m_Data->hash != other.m_Data->hash || m_Data->length != other.m_Data->length) {
+      return false;
+   }
+
+   auto wire = get_wire();
+   return std::memcmp(wire.data(), other.get_wire().data(), wire.size()) == 0;
+}
+
+/* ------------------------------------------------------------------------------------------------------- */
+
+const DomainName::Data *
+DomainName::get_root() {
+   struct Root {
+      Data data;
+      Byte wire[1];
+   };
+
+   static const Byte WIRE[] = { 0 };
+   static const Root ROOT   = { { NameKernel::hash(WIRE), 1, 0, true }, { 0 } };
+   return &ROOT.data;
+}
+
+/* ------------------------------------------------------------------------------------------------------- */
+
+const DomainName::Data *
+DomainName::share(const Data *data, allocator_type allocator) {
+   if (data->interned) {
+      return data;
+   }
+
+   size_t size  = get_size(data);
+   void  *bytes = allocator.allocate_bytes(size, alignof(Data));
+   std::memcpy(bytes, data, size);
+   return static_cast<const Data *>(bytes);
+}
+
+/* ------------------------------------------------------------------------------------------------------- */
+
+void
+DomainName::release() {
+   if (!m_Data->interned) {
+      m_Allocator.deallocate_bytes(const_cast<Data *>(m_Data), get_size(m_Data), alignof(Data));
+      m_Data = get_root();
+   }
+}
+
+/* ------------------------------------------------------------------------------------------------------- */
+/* NameTable                                                                                               */
+/* ------------------------------------------------------------------------------------------------------- */
+
+struct alignas(64) NameTable::Shard {
+   std::mutex                                                   mutex;
+   std::unordered_multimap<uint64_t, const DomainName::Data *> names;
+};
+
+/* ------------------------------------------------------------------------------------------------------- */
+
+NameTable::NameTable(size_t capacity)
+    : m_Shards(CreateUniqueRef<Shard[]>(SHARDS)), m_ShardCapacity(std::max<size_t>(capacity / SHARDS, 1)) {}
+
+/* ------------------------------------------------------------------------------------------------------- */
+
+NameTable::~NameTable() {
+   for (size_t i = 0; i < SHARDS; i++) {
+      for (auto [hash, data] : m_Shards[i].names) {
+         std::pmr::new_delete_resource()->deallocate(
+             const_cast<DomainName::Data *>(data), DomainName::get_size(data), alignof(DomainName::Data));
+      }
+   }
+}
+
+/* ------------------------------------------------------------------------------------------------------- */
+
+DomainName
+NameTable::intern(const DomainName &name) {
+   if (name.is_interned()) {
+      return name;
+   }
+
+   auto                       &shard = m_Shards[name.get_hash() & (SHARDS - 1)];
+   std::lock_guard<std::mutex> lock(shard.mutex);
+
+   auto [first, last] = shard.names.equal_range(name.get_hash());
+   for (auto it = first; it != last; ++it) {
+      auto interned = DomainName(it->second);
+      if (interned == name) {
+         return interned;
+      }
+   }
+
+   if (shard.names.size() >= m_ShardCapacity) {
+      return name;
+   }
+
+   size_t size = DomainName::get_size(name.m_Data);
+   void  *data = std::pmr::new_delete_resource()->allocate(size, alignof(DomainName::Data));
+   std::memcpy(data, name.m_Data, size);
+   static_cast<DomainName::Data *>(data)->interned = true;
+
+   shard.names.emplace(name.get_hash(), static_cast<const DomainName::Data *>(data));
+   return DomainName(static_cast<const DomainName::Data *>(data));
+}
+
+/* ------------------------------------------------------------------------------------------------------- */
+
+size_t
+NameTable::get_size() const {
+   size_t size = 0;
+   for (size_t i = 0; i < SHARDS; i++) {
+      std::lock_guard<std::mutex> lock(m_Shards[i].mutex);
+      size += m_Shards[i].names.size();
+   }
+   return size;
+}
+
+/* ------------------------------------------------------------------------------------------------------- */
+
+NameTable &
+NameTable::get_global() {
+   // Deliberately leaked, see the class comment
+   static NameTable *table = new NameTable();
+   return *table;
+}
+
+/* ------------------------------------------------------------------------------------------------------- */
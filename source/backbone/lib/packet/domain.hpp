@@ -0,0 +1,243 @@
+#pragma once
+
+#include <cstdint>
+#include <memory_resource>
+#include <span>
+#include <string>
+#include <string_view>
+
+#include <backbone/core/pch>
+#include "name.hpp"
+
+/* ------------------------------------------------------------------------------------------------------- */
+
+/**
+ * @brief
+ * Domain name in canonical wire form, together with its hash and where each of its labels starts.
+ *
+ * @details
+ * Everything is computed once, when the name is created, and kept in a single immutable allocation made
+ * with the name's allocator. Comparing two names therefore is a hash comparison first, and looking at a
+ * label or a suffix is an offset away: nothing ever splits the name into labels again. The canonical form
+ * is lowercase, so equality is case-insensitive without any further work.
+ *
+ * Names can be interned in the `NameTable`. An interned name is shared rather than copied, by every name
+ * copied from it and by every other name interned with the same text, and comparing two interned names
+ * that are equal does not even look at the hash.
+ */
+class DomainName {
+public:
+   using allocator_type = std::pmr::polymorphic_allocator<>;
+
+private:
+   /**
+    * Start of the allocation holding a name. The label offsets and the wire form follow right behind.
+    */
+   struct Data {
+      uint64_t hash;
+      uint8_t  length;
+      uint8_t  label_count;
+      bool     interned;   // owned by the `NameTable`, never released by a name
+   };
+
+   const Data    *m_Data;
+   allocator_type m_Allocator;
+
+public:
+   /**
+    * The root name, which needs no allocation.
+    */
+   DomainName(allocator_type allocator = {});
+
+   /**
+    * The name the `NameKernel` has just scanned into `out`.
+    */
+   DomainName(const NameKernel::Output &out, const NameScan &scan, allocator_type allocator = {});
+
+   DomainName(const DomainName &other);
+   DomainName(const DomainName &other, allocator_type allocator);
+   DomainName(DomainName &&other) noexcept;
+   DomainName(DomainName &&other, allocator_type allocator);
+   ~DomainName();
+
+   DomainName &
+   operator=(const DomainName &other);
+   DomainName &
+   operator=(DomainName &&other);
+
+   /**
+    * Parses a name in dotted notation (trailing dot optional, empty or "." being the root).
+    */
+   static Result<DomainName>
+   from_string(std::string_view dotted, allocator_type allocator = {});
+
+   /**
+    * Takes a name in uncompressed wire form, e.g. one embedded in the RDATA of a `PacketRecord`.
+    */
+   static Result<DomainName>
+   from_wire(std::span<const Byte> wire, allocator_type allocator = {});
+
+   allocator_type
+   get_allocator() const {
+      return m_Allocator;
+   }
+
+   uint64_t
+   get_hash() const {
+      return m_Data->hash;
+   }
+
+   /**
+    * Canonical wire form, root label included.
+    */
+   std::span<const Byte>
+   get_wire() const {
+      return { get_offsets() + m_Data->label_count, m_Data->length };
+   }
+
+   size_t
+   get_length() const {
+      return m_Data->length;
+   }
+
+   /**
+    * Number of labels, the root label not counted.
+    */
+   size_t
+   get_label_count() const {
+      return m_Data->label_count;
+   }
+
+   /**
+    * Where label `index` (counting from the left) starts in the wire form. It is also where the suffix
+    * of the name starting with that label begins.
+    */
+   size_t
+   get_label_offset(size_t index) const {
+      return get_offsets()[index];
+   }
+
+   std::span<const uint8_t>
+   get_label_offsets() const {
+      return { get_offsets(), m_Data->label_count };
+   }
+
+   std::string_view
+   get_label(size_t index) const;
+
+   bool
+   is_root() const {
+      return m_Data->label_count == 0;
+   }
+
+   bool
+   is_interned() const {
+      return m_Data->interned;
+   }
+
+   /**
+    * Whether `other` is this name or one of its suffixes, i.e. whether this name lies within `other`.
+    */
+   bool
+   is_subdomain_of(const DomainName &other) const;
+
+   /**
+    * The suffix starting with label `index`, allocated with `allocator`.
+    */
+   DomainName
+   get_suffix(size_t index, allocator_type allocator = {}) const;
+
+   /**
+    * The same name out of the global `NameTable`.
+    */
+   DomainName
+   intern() const;
+
+   /**
+    * Dotted notation without the trailing dot, "." for the root.
+    */
+   std::string
+   to_string() const;
+
+   bool
+   operator==(const DomainName &other) const;
+
+private:
+   explicit DomainName(const Data *interned) : m_Data(interned), m_Allocator() {}
+
+   const uint8_t *
+   get_offsets() const {
+      return reinterpret_cast<const uint8_t *>(m_Data + 1);
+   }
+
+   static size_t
+   get_size(const Data *data) {
+      return sizeof(Data) + data->label_count + data->length;
+   }
+
+   static const Data *
+   get_root();
+
+   /**
+    * Copy of `data` (or `data` itself when interned) for a name using `allocator`.
+    */
+   static const Data *
+   share(const Data *data, allocator_type allocator);
+
+   void
+   release();
+
+   friend class NameTable;
+};
+
+/* ------------------------------------------------------------------------------------------------------- */
+
+class DomainNameHash {
+public:
+   size_t
+   operator()(const DomainName &name) const {
+      return name.get_hash();
+   }
+};
+
+/* ------------------------------------------------------------------------------------------------------- */
+
+/**
+ * @brief
+ * Intern table for names that keep coming back, so that all of them share a single copy.
+ *
+ * @details
+ * The table is split into shards by hash, each guarded by its own mutex, and only ever grows: an interned
+ * name lives as long as the table. Once a shard is full, interning hands out plain copies instead. The
+ * global table is never destroyed, names interned in it may be held by anything including other statics.
+ */
+class NameTable {
+public:
+   static constexpr size_t SHARDS           = 64;
+   static constexpr size_t DEFAULT_CAPACITY = 64 * 1024;
+
+private:
+   struct Shard;
+
+   UniqueRef<Shard[]> m_Shards;
+   size_t             m_ShardCapacity;
+
+public:
+   /**
+    * Table holding up to `capacity` names. It must outlive every name interned in it.
+    */
+   NameTable(size_t capacity = DEFAULT_CAPACITY);
+   NameTable(const NameTable &) = delete;
+   ~NameTable();
+
+   DomainName
+   intern(const DomainName &name);
+
+   size_t
+   get_size() const;
+
+   static NameTable &
+   get_global();
+};
+
+/* ------------------------------------------------------------------------------------------------------- */
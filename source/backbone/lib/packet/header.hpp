@@ -1,15 +1,32 @@
 #pragma once
 
+#include <bit>
 #include <cstdint>
+#include <cstring>
+#include <span>
 
 #include <backbone/core/pch>
 #include "buffer.hpp"
 
 /* ------------------------------------------------------------------------------------------------------- */
 
+/**
+ * @brief
+ * Header of a message (RFC 1035 4.1.1).
+ *
+ * @details
+ * The wire form is decoded with a single unaligned load and a byte swap, the flags are then picked out of
+ * it with constant masks. Fields stay byte-sized rather than bit-fields of their width on the wire, since
+ * every bit-field store is a read-modify-write and that costs more than the few bytes it would save.
+ */
 class PacketHeader {
 public:
-   enum ResultCode {
+   /**
+    * Size of the header on the wire.
+    */
+   static constexpr size_t SIZE = 12;
+
+   enum ResultCode : uint8_t {
       NO_ERROR        = 0,
       FORMAT_ERROR    = 1,
       SERVER_FAILURE  = 2,
@@ -28,6 +45,40 @@ public:
       RESERVED10      = 15,
    };
 
+private:
+   /*
+    * Bits of the flags field:
+    *     1000000000000000 = 1 bit  = 0x8000 = Query/Response
+    *     0111100000000000 = 4 bits = 0x7800 = Operation code
+    *     0000010000000000 = 1 bit  = 0x0400 = Authoritative answer
+    *     0000001000000000 = 1 bit  = 0x0200 = Truncated message
+    *     0000000100000000 = 1 bit  = 0x0100 = Recursion desired
+    *     0000000010000000 = 1 bit  = 0x0080 = Recursion available
+    *     0000000001110000 = 3 bits = 0x0070 = Reserved
+    *     0000000000001111 = 4 bits = 0x000F = Response code
+    */
+   static constexpr uint16_t QUERY_RESPONSE       = 0x8000;
+   static constexpr uint16_t OP_CODE              = 0x7800;
+   static constexpr uint16_t AUTHORITATIVE_ANSWER = 0x0400;
+   static constexpr uint16_t TRUNCATED_MESSAGE    = 0x0200;
+   static constexpr uint16_t RECURSION_DESIRED    = 0x0100;
+   static constexpr uint16_t RECURSION_AVAILABLE  = 0x0080;
+   static constexpr uint16_t RESERVED             = 0x0070;
+   static constexpr uint16_t RESPONSE_CODE        = 0x000F;
+
+   static constexpr int OP_CODE_SHIFT  = 11;
+   static constexpr int RESERVED_SHIFT = 4;
+
+   template<typename T>
+   static constexpr T
+   from_network(T value) {
+      if constexpr (std::endian::native == std::endian::little) {
+         return std::byteswap(value);
+      } else {
+         return value;
+      }
+   }
+
 public:
    /**
     * 16-bits
@@ -154,16 +205,100 @@ public:
                 uint16_t   question_count,
                 uint16_t   answer_count,
                 uint16_t   authority_count,
-                uint16_t   additional_count);
+                uint16_t   additional_count)
+       : id(id), query_response(query_response), op_code(op_code), authoritative_answer(authoritative_answer),
+         truncated_message(truncated_message), recursion_desired(recursion_desired),
+         recursion_available(recursion_available), reserved(reserved), response_code(response_code),
+         question_count(question_count), answer_count(answer_count), authority_count(authority_count),
+         additional_count(additional_count) {}
    ~PacketHeader() = default;
 
-   static Result<PacketHeader> from_buffer(Ref<PacketBuffer>);
+   /**
+    * Decodes the header from its wire form. Every combination of bits is a valid header. Defined inline,
+    * so that the header goes straight from registers to wherever it is used.
+    */
+   static PacketHeader
+   from_bytes(std::span<const Byte, SIZE> bytes);
 
+   /**
+    * Encodes the header into its wire form.
+    */
+   void
+   to_bytes(std::span<Byte, SIZE> bytes) const;
+
+   /**
+    * Parses the header at the start of the buffer, leaving the read index right behind it.
+    */
+   template<ReadableBuffer<Byte> B>
+   static Result<PacketHeader>
+   from_buffer(B &buffer);
+
+   /**
+    * Writes the header at the start of the buffer, leaving the write index right behind it.
+    */
+   template<WritableBuffer<Byte> B>
    Result<void>
-   write_to_buffer(Ref<PacketBuffer> buf) const;
+   write_to_buffer(B &buffer) const;
 
    void
    print(const std::string &name = "") const;
 };
 
+static_assert(sizeof(PacketHeader) == 18);
+
+/* ------------------------------------------------------------------------------------------------------- */
+
+/**
+ * @brief
+ * Decodes the header straight out of two registers: ID, flags, question and answer count in the first,
+ * authority and additional count in the second.
+ */
+inline PacketHeader
+PacketHeader::from_bytes(std::span<const Byte, SIZE> bytes) {
+   uint64_t head;
+   uint32_t tail;
+   std::memcpy(&head, bytes.data(), sizeof(head));
+   std::memcpy(&tail, bytes.data() + sizeof(head), sizeof(tail));
+   head = from_network(head);
+   tail = from_network(tail);
+
+   uint16_t flags = head >> 32;
+   return PacketHeader(head >> 48,
+                       flags & QUERY_RESPONSE,
+                       (flags & OP_CODE) >> OP_CODE_SHIFT,
+                       flags & AUTHORITATIVE_ANSWER,
+                       flags & TRUNCATED_MESSAGE,
+                       flags & RECURSION_DESIRED,
+                       flags & RECURSION_AVAILABLE,
+                       (flags & RESERVED) >> RESERVED_SHIFT,
+                       static_cast<ResultCode>(flags & RESPONSE_CODE),
+                       head >> 16,
+                       head,
+                       tail >> 16,
+                       tail);
+}
+
 /* ------------------------------------------------------------------------------------------------------- */
+
+inline void
+PacketHeader::to_bytes(std::span<Byte, SIZE> bytes) const {
+   uint16_t flags = (query_response ? QUERY_RESPONSE : 0) | ((op_code << OP_CODE_SHIFT) & OP_CODE) |
+                    (authoritative_answer ? AUTHORITATIVE_ANSWER : 0) |
+                    (truncated_message ? TRUNCATED_MESSAGE : 0) |
+                    (recursion_desired ? RECURSION_DESIRED : 0) |
+                    (recursion_available ? RECURSION_AVAILABLE : 0) |
+                    ((reserved << RESERVED_SHIFT) & RESERVED) | (response_code & RESPONSE_CODE);
+
+   uint64_t head = (uint64_t(id) << 48) | (uint64_t(flags) << 32) | (uint64_t(question_count) << 16) |
+                   answer_count;
+   uint32_t tail = (uint32_t(authority_count) << 16) | additional_count;
+
+   // Byte swapping is its own inverse
+   head = from_network(head);
+   tail = from_network(tail);
+   std::memcpy(bytes.data(), &head, sizeof(head));
+   std::memcpy(bytes.data() + sizeof(head), &tail, sizeof(tail));
+}
+
+/* ------------------------------------------------------------------------------------------------------- */
+
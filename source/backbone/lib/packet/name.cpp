@@ -0,0 +1,389 @@
+#include "name.hpp"
+
+#include <algorithm>
+#include <cstring>
+
+#if defined(__AVX2__) || defined(__SSE2__)
+#include <immintrin.h>
+#elif defined(__ARM_NEON) && defined(__aarch64__)
+#include <arm_neon.h>
+#endif
+
+/* ------------------------------------------------------------------------------------------------------- */
+
+namespace {
+
+constexpr uint64_t HASH_SEED       = 0x2D358DCCAA6C78A5ull;
+constexpr uint64_t HASH_MULTIPLIER = 0x9E3779B97F4A7C15ull;
+
+/**
+ * Lowercase form of every byte allowed in a label, zero for the others.
+ */
+constexpr auto LABEL_CHARACTERS = [] {
+   std::array<uint8_t, 256> table {};
+   for (int c = 0x21; c < 0x7F; c++) {
+      table[c] = (c >= 'A' && c <= 'Z') ? c + ('a' - 'A') : c;
+   }
+   table['.'] = 0;
+   return table;
+}();
+
+/**
+ * Loading at `PREFIX_MASK + 32 - n` yields `n` (at most 32) set bytes followed by clear ones.
+ */
+alignas(64) constexpr uint8_t PREFIX_MASK[64] = {
+   0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF,
+   0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF,
+};
+
+/* ------------------------------------------------------------------------------------------------------- */
+
+inline uint64_t
+mix(uint64_t hash, uint64_t word) {
+   hash = (hash ^ word) * HASH_MULTIPLIER;
+   return hash ^ (hash >> 32);
+}
+
+/* ------------------------------------------------------------------------------------------------------- */
+
+/**
+ * Loads eight bytes into a word.
+ */
+inline uint64_t
+load_word(const Byte *data) {
+   uint64_t word;
+   std::memcpy(&word, data, sizeof(word));
+   return word;
+}
+
+/* ------------------------------------------------------------------------------------------------------- */
+
+/**
+ * Loads the last `count` (less than eight) bytes into a word, padded with zeros.
+ */
+inline uint64_t
+load_tail(const Byte *data, size_t count) {
+   uint64_t word = 0;
+   for (size_t i = 0; i < count; i++) {
+      word |= static_cast<uint64_t>(data[i]) << (8 * i);
+   }
+   return word;
+}
+
+/* ------------------------------------------------------------------------------------------------------- */
+
+/**
+ * Copies labels one character at a time. Never touches anything past the label.
+ */
+class ScalarLabels {
+public:
+   static constexpr const char *ISA = "scalar";
+
+   static size_t
+   get_extent(size_t length) {
+      return length;
+   }
+
+   static bool
+   copy(const Byte *source, size_t length, Byte *destination) {
+      bool valid = true;
+      for (size_t i = 0; i < length; i++) {
+         uint8_t c = LABEL_CHARACTERS[source[i]];
+         valid &= c != 0;
+         destination[i] = c;
+      }
+      return valid;
+   }
+};
+
+/* ------------------------------------------------------------------------------------------------------- */
+
+#if defined(__SSE2__)
+
+/**
+ * Copies labels 16 characters at a time. May read and write up to 15 bytes past the label.
+ */
+class Sse2Labels {
+public:
+   static constexpr size_t      WIDTH = 16;
+   static constexpr const char *ISA   = "sse2";
+
+   static size_t
+   get_extent(size_t length) {
+      return (length + WIDTH - 1) & ~(WIDTH - 1);
+   }
+
+   static bool
+   copy(const Byte *source, size_t length, Byte *destination) {
+      const __m128i before_upper = _mm_set1_epi8('A' - 1);
+      const __m128i after_upper  = _mm_set1_epi8('Z' + 1);
+      const __m128i first_valid  = _mm_set1_epi8(0x21);
+      const __m128i dot          = _mm_set1_epi8('.');
+      const __m128i del          = _mm_set1_epi8(0x7F);
+      const __m128i case_bit     = _mm_set1_epi8(0x20);
+
+      __m128i invalid = _mm_setzero_si128();
+      for (size_t i = 0; i < length; i += WIDTH) {
+         __m128i v = _mm_loadu_si128(reinterpret_cast<const __m128i *>(source + i));
+
+         // Signed compares: bytes from 0x80 on are negative, hence below 0x21 as well
+         __m128i bad  = _mm_or_si128(_mm_cmplt_epi8(v, first_valid),
+                                    _mm_or_si128(_mm_cmpeq_epi8(v, dot), _mm_cmpeq_epi8(v, del)));
+         __m128i mask = _mm_loadu_si128(
+             reinterpret_cast<const __m128i *>(PREFIX_MASK + 32 - std::min(length - i, WIDTH)));
+         invalid = _mm_or_si128(invalid, _mm_and_si128(bad, mask));
+
+         __m128i upper = _mm_and_si128(_mm_cmpgt_epi8(v, before_upper), _mm_cmplt_epi8(v, after_upper));
+         v             = _mm_or_si128(v, _mm_and_si128(upper, case_bit));
+         _mm_storeu_si128(reinterpret_cast<__m128i *>(destination + i), v);
+      }
+      return _mm_movemask_epi8(invalid) == 0;
+   }
+};
+
+#endif
+
+/* ------------------------------------------------------------------------------------------------------- */
+
+#if defined(__AVX2__)
+
+/**
+ * Copies labels 32 characters at a time. Most labels fit into 16 characters though, those are left to
+ * `Sse2Labels` so that they don't need twice the room behind them.
+ */
+class Avx2Labels {
+public:
+   static constexpr size_t      WIDTH = 32;
+   static constexpr const char *ISA   = "avx2";
+
+   static size_t
+   get_extent(size_t length) {
+      return length <= Sse2Labels::WIDTH ? Sse2Labels::WIDTH : (length + WIDTH - 1) & ~(WIDTH - 1);
+   }
+
+   static bool
+   copy(const Byte *source, size_t length, Byte *destination) {
+      if (length <= Sse2Labels::WIDTH) {
+         return Sse2Labels::copy(source, length, destination);
+      }
+
+      const __m256i before_upper = _mm256_set1_epi8('A' - 1);
+      const __m256i after_upper  = _mm256_set1_epi8('Z' + 1);
+      const __m256i first_valid  = _mm256_set1_epi8(0x21);
+      const __m256i dot          = _mm256_set1_epi8('.');
+      const __m256i del          = _mm256_set1_epi8(0x7F);
+      const __m256i case_bit     = _mm256_set1_epi8(0x20);
+
+      __m256i invalid = _mm256_setzero_si256();
+      for (size_t i = 0; i < length; i += WIDTH) {
+         __m256i v = _mm256_loadu_si256(reinterpret_cast<const __m256i *>(source + i));
+
+         // Signed compares: bytes from 0x80 on are negative, hence below 0x21 as well
+         __m256i bad = _mm256_or_si256(_mm256_cmpgt_epi8(first_valid, v),
+                                       _mm256_or_si256(_mm256_cmpeq_epi8(v, dot), _mm256_cmpeq_epi8(v, del)));
+         __m256i mask = _mm256_loadu_si256(
+             reinterpret_cast<const __m256i *>(PREFIX_MASK + 32 - std::min(length - i, WIDTH)));
+         invalid = _mm256_or_si256(invalid, _mm256_and_si256(bad, mask));
+
+         __m256i upper =
+             _mm256_and_si256(_mm256_cmpgt_epi8(v, before_upper), _mm256_cmpgt_epi8(after_upper, v));
+         v = _mm256_or_si256(v, _mm256_and_si256(upper, case_bit));
+         _mm256_storeu_si256(reinterpret_cast<__m256i *>(destination + i), v);
+      }
+      return _mm256_movemask_epi8(invalid) == 0;
+   }
+};
+
+using VectorLabels = Avx2Labels;
+
+#elif defined(__SSE2__)
+
+using VectorLabels = Sse2Labels;
+
+#elif defined(__ARM_NEON) && defined(__aarch64__)
+
+/**
+ * Copies labels 16 characters at a time. May read and write up to 15 bytes past the label.
+ */
+class NeonLabels {
+public:
+   static constexpr size_t      WIDTH = 16;
+   static constexpr const char *ISA   = "neon";
+
+   static size_t
+   get_extent(size_t length) {
+      return (length + WIDTH - 1) & ~(WIDTH - 1);
+   }
+
+   static bool
+   copy(const Byte *source, size_t length, Byte *destination) {
+      uint8x16_t invalid = vdupq_n_u8(0);
+      for (size_t i = 0; i < length; i += WIDTH) {
+         uint8x16_t v = vld1q_u8(source + i);
+
+         uint8x16_t bad  = vorrq_u8(vorrq_u8(vcltq_u8(v, vdupq_n_u8(0x21)), vcgtq_u8(v, vdupq_n_u8(0x7E))),
+                                   vceqq_u8(v, vdupq_n_u8('.')));
+         uint8x16_t mask = vld1q_u8(PREFIX_MASK + 32 - std::min(length - i, WIDTH));
+         invalid         = vorrq_u8(invalid, vandq_u8(bad, mask));
+
+         uint8x16_t upper = vcleq_u8(vsubq_u8(v, vdupq_n_u8('A')), vdupq_n_u8('Z' - 'A'));
+         v                = vorrq_u8(v, vandq_u8(upper, vdupq_n_u8(0x20)));
+         vst1q_u8(destination + i, v);
+      }
+      return vmaxvq_u8(invalid) == 0;
+   }
+};
+
+using VectorLabels = NeonLabels;
+
+#else
+
+using VectorLabels = ScalarLabels;
+
+#endif
+
+/* ------------------------------------------------------------------------------------------------------- */
+
+/**
+ * Walks the labels of the name like `PacketView::skip_name` does, handing each one to `Labels` and
+ * hashing the canonical form as soon as a whole word of it has been written.
+ */
+template<typename Labels>
+Result<NameScan>
+scan_name(std::span<const Byte> message, size_t position, NameKernel::Output &out) {
+   const Byte *data = message.data();
+   size_t      size = message.size();
+   Byte       *wire = out.wire.data();
+
+   size_t   pos          = position;
+   size_t   floor        = position;   // pointers must point strictly below this
+   size_t   end_position = 0;
+   bool     jumped       = false;
+   size_t   written      = 0;
+   size_t   hashed       = 0;
+   size_t   count        = 0;
+   uint64_t hash         = HASH_SEED;
+
+   while (true) {
+      if (pos >= size) {
+         return Error(FAILED_TO_READ_QNAME, "Domain name overflowed the message");
+      }
+
+      uint8_t len = data[pos];
+
+      if ((len & 0xC0) == 0xC0) {
+         if (pos + 1 >= size) {
+            return Error(FAILED_TO_READ_QNAME, "Compression pointer overflowed the message");
+         }
+
+         size_t offset = ((len & 0x3F) << 8) | data[pos + 1];
+         if (offset >= floor) {
+            return Error(FAILED_TO_READ_QNAME, "Compression pointer does not point backwards");
+         }
+
+         if (!jumped) {
+            end_position = pos + 2;
+            jumped       = true;
+         }
+
+         pos   = offset;
+         floor = offset;
+         continue;
+      }
+
+      if ((len & 0xC0) != 0) {
+         return Error(FAILED_TO_READ_LABEL, "Unsupported label type");
+      }
+
+      if (written + 1 + len > 255) {
+         return Error(FAILED_TO_READ_QNAME, "Domain name exceeds 255 bytes");
+      }
+
+      if (len == 0) {
+         break;
+      }
+
+      if (size - pos - 1 < len) {
+         return Error(FAILED_TO_READ_LABEL, "Label overflowed the message");
+      }
+
+      out.offsets[count++] = written;
+      wire[written]        = len;
+
+      // Whole vectors are loaded, so a label too close to the end of the message is copied one by one
+      const Byte *label = data + pos + 1;
+      bool        valid;
+      if (size - pos - 1 >= Labels::get_extent(len)) {
+         valid = Labels::copy(label, len, wire + written + 1);
+      } else {
+         valid = ScalarLabels::copy(label, len, wire + written + 1);
+      }
+      if (!valid) {
+         return Error(FAILED_TO_READ_LABEL, "Invalid character in label");
+      }
+      written += 1 + len;
+
+      for (; hashed + 8 <= written; hashed += 8) {
+         hash = mix(hash, load_word(wire + hashed));
+      }
+
+      pos += 1 + len;
+   }
+
+   wire[written++] = 0;
+   for (; hashed + 8 <= written; hashed += 8) {
+      hash = mix(hash, load_word(wire + hashed));
+   }
+   if (hashed < written) {
+      hash = mix(hash, load_tail(wire + hashed, written - hashed));
+   }
+   hash = mix(hash, written);
+
+   auto end = jumped ? end_position : pos + 1;
+   return NameScan { hash,
+                     static_cast<uint16_t>(end),
+                     static_cast<uint8_t>(written),
+                     static_cast<uint8_t>(count) };
+}
+
+}   // namespace
+
+/* ------------------------------------------------------------------------------------------------------- */
+
+Result<NameScan>
+NameKernel::scan(std::span<const Byte> message, size_t position, Output &out) {
+   return scan_name<VectorLabels>(message, position, out);
+}
+
+/* ------------------------------------------------------------------------------------------------------- */
+
+Result<NameScan>
+NameKernel::scan_scalar(std::span<const Byte> message, size_t position, Output &out) {
+   return scan_name<ScalarLabels>(message, position, out);
+}
+
+/* ------------------------------------------------------------------------------------------------------- */
+
+uint64_t
+NameKernel::hash(std::span<const Byte> wire) {
+   uint64_t hash = HASH_SEED;
+
+   size_t i = 0;
+   for (; i + 8 <= wire.size(); i += 8) {
+      hash = mix(hash, load_word(wire.data() + i));
+   }
+   if (i < wire.size()) {
+      hash = mix(hash, load_tail(wire.data() + i, wire.size() - i));
+   }
+
+   return mix(hash, wire.size());
+}
+
+/* ------------------------------------------------------------------------------------------------------- */
+
+const char *
+NameKernel::get_isa() {
+   return VectorLabels::ISA;
+}
+
+/* ------------------------------------------------------------------------------------------------------- */
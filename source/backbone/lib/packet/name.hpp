@@ -0,0 +1,106 @@
+#pragma once
+
+#include <array>
+#include <cstdint>
+#include <span>
+
+#include <backbone/core/pch>
+
+/* ------------------------------------------------------------------------------------------------------- */
+
+/**
+ * @brief
+ * What scanning a name found out about it.
+ */
+class NameScan {
+public:
+   /**
+    * `NameKernel::hash` of the canonical wire form.
+    */
+   uint64_t hash;
+
+   /**
+    * Position right behind the name in the message, i.e. behind its first compression pointer if any.
+    */
+   uint16_t end;
+
+   /**
+    * Length of the canonical wire form, root label included.
+    */
+   uint8_t length;
+
+   uint8_t label_count;
+};
+
+/* ------------------------------------------------------------------------------------------------------- */
+
+/**
+ * @brief
+ * Turns a name from a message into its canonical wire form in a single pass: validating it, folding its
+ * case and hashing it while its labels are being copied.
+ *
+ * @details
+ * The canonical form is the uncompressed label sequence with every ASCII letter in lowercase, so two
+ * names are equal exactly if their canonical forms are equal byte for byte.
+ *
+ * Labels are processed a whole vector register at a time, using AVX2, SSE2 or NEON depending on what the
+ * library is compiled for, with a table driven scalar path for everything else. The scalar path is
+ * always available as `scan_scalar`, both kernels produce exactly the same results.
+ *
+ * A name is accepted under the same rules as `PacketView::from_bytes` applies (labels of at most 63
+ * bytes, at most 255 bytes on the wire, compression pointers pointing strictly backwards) and, on top of
+ * that, only if every label consists of printable ASCII other than `.`. Anything else could not be told
+ * apart from a different name once in dotted notation.
+ *
+ * The hash works on eight bytes at a time, which is what makes it cheaper than hashing bytes one by one,
+ * and is only meant for tables living in this process.
+ */
+class NameKernel {
+public:
+   /**
+    * Room for the longest canonical form plus the last vector store.
+    */
+   static constexpr size_t WIRE_SIZE = 288;
+
+   /**
+    * Most labels a name can have within 255 bytes, the root label not counted.
+    */
+   static constexpr size_t MAX_LABELS = 127;
+
+   class Output {
+   public:
+      std::array<Byte, WIRE_SIZE> wire;
+
+      /**
+       * Where each label (its length byte) starts in `wire`, from left to right.
+       */
+      std::array<uint8_t, MAX_LABELS> offsets;
+   };
+
+public:
+   /**
+    * Scans the name starting at `position` in `message` into `out`.
+    */
+   static Result<NameScan>
+   scan(std::span<const Byte> message, size_t position, Output &out);
+
+   /**
+    * Same as `scan`, without any vector instructions.
+    */
+   static Result<NameScan>
+   scan_scalar(std::span<const Byte> message, size_t position, Output &out);
+
+   /**
+    * Hash of a name already in canonical wire form, equal to that of a scan producing the same form.
+    */
+   static uint64_t
+   hash(std::span<const Byte> wire);
+
+   /**
+    * Instruction set `scan` has been compiled for: "avx2", "sse2", "neon" or "scalar".
+    */
+   static const char *
+   get_isa();
+};
+
+/* ------------------------------------------------------------------------------------------------------- */
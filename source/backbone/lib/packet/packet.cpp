@@ -2,76 +2,87 @@
 
 /* ------------------------------------------------------------------------------------------------------- */
 
-Packet::Packet(PacketHeader                header,
-               std::vector<PacketQuestion> questions,
-               std::vector<PacketRecord>   answers,
-               std::vector<PacketRecord>   authorities,
-               std::vector<PacketRecord>   additionals)
-    : header(header), questions(questions), answers(answers), authorities(authorities),
-      additionals(additionals) {}
+Packet::Packet(PacketHeader header, allocator_type allocator)
+    : header(header), questions(allocator), answers(allocator), authorities(allocator),
+      additionals(allocator) {}
 
 /* ------------------------------------------------------------------------------------------------------- */
 
+Packet::Packet(PacketHeader                     header,
+               std::pmr::vector<PacketQuestion> questions,
+               std::pmr::vector<PacketRecord>   answers,
+               std::pmr::vector<PacketRecord>   authorities,
+               std::pmr::vector<PacketRecord>   additionals)
+    : header(header), questions(std::move(questions)), answers(std::move(answers)),
+      authorities(std::move(authorities)), additionals(std::move(additionals)) {}
+
+/* ------------------------------------------------------------------------------------------------------- */
+
+template<NameBuffer B>
 Result<Packet>
-Packet::from_buffer(Ref<PacketBuffer> buffer) {
+Packet::from_buffer(B &buffer, allocator_type allocator) {
    /* Parse header */
    auto header = PacketHeader::from_buffer(buffer).except("Failed to parse packet header");
    RETURN_IF_ERROR(header);
 
+   auto packet = Packet(header.get_value(), allocator);
+
    /* Parse questions */
-   std::vector<PacketQuestion> questions;
-   for (size_t i = 0; i < header.get_value().question_count; i++) {
+   for (size_t i = 0; i < packet.header.question_count; i++) {
       // Parse question
-      auto question = PacketQuestion::from_buffer(buffer).except("Failed to parse packet question");
+      auto question =
+          PacketQuestion::from_buffer(buffer, allocator).except("Failed to parse packet question");
       RETURN_IF_ERROR(question);
 
       // Add question to the list
-      questions.push_back(question.get_value());
+      packet.questions.push_back(std::move(question.get_value()));
    }
 
    /* Parse answers */
-   std::vector<PacketRecord> answers;
-   for (size_t i = 0; i < header.get_value().answer_count; i++) {
+   for (size_t i = 0; i < packet.header.answer_count; i++) {
       // Parse answer
-      auto answer = PacketRecord::from_buffer(buffer).except("Failed to parse packet answer");
+      auto answer = PacketRecord::from_buffer(buffer, allocator).except("Failed to parse packet answer");
       RETURN_IF_ERROR(answer);
 
       // Add answer to the list
-      answers.push_back(answer.get_value());
+      packet.answers.push_back(std::move(answer.get_value()));
    }
 
    /* Parse authorities */
-   std::vector<PacketRecord> authorities;
-   for (size_t i = 0; i < header.get_value().authority_count; i++) {
+   for (size_t i = 0; i < packet.header.authority_count; i++) {
       // Parse authority
-      auto authority = PacketRecord::from_buffer(buffer).except("Failed to parse packet authority");
+      auto authority =
+          PacketRecord::from_buffer(buffer, allocator).except("Failed to parse packet authority");
       RETURN_IF_ERROR(authority);
 
       // Add authority to the list
-      authorities.push_back(authority.get_value());
+      packet.authorities.push_back(std::move(authority.get_value()));
    }
 
    /* Parse additionals */
-   std::vector<PacketRecord> additionals;
-   for (size_t i = 0; i < header.get_value().additional_count; i++) {
+   for (size_t i = 0; i < packet.header.additional_count; i++) {
       // Parse additional
-      auto additional = PacketRecord::from_buffer(buffer).except("Failed to parse packet additional");
+      auto additional =
+          PacketRecord::from_buffer(buffer, allocator).except("Failed to parse packet additional");
       RETURN_IF_ERROR(additional);
 
       // Add additional to the list
-      additionals.push_back(additional.get_value());
+      packet.additionals.push_back(std::move(additional.get_value()));
    }
 
-   auto packet = Packet(header.get_value(), questions, answers, authorities, additionals);
    return packet;
 }
 
 /* ------------------------------------------------------------------------------------------------------- */
 
+template<NameBuffer B>
 Result<void>
-Packet::write_to_buffer(Ref<PacketBuffer> buffer) const {
+Packet::write_to_buffer(B &buffer) const {
    auto res = Ok();
 
+   // Names of an earlier message in this buffer must not be used as compression targets
+   buffer.clear_names();
+
    /* Write header */
    res = this->header.write_to_buffer(buffer).except("Failed to write packet header");
    RETURN_IF_ERROR(res);
@@ -104,3 +115,12 @@ Packet::write_to_buffer(Ref<PacketBuffer> buffer) const {
 }
 
 /* ------------------------------------------------------------------------------------------------------- */
+
+// Buffers packets are read from and written to
+template Result<Packet>
+Packet::from_buffer(PacketBuffer &buffer, allocator_type allocator);
+
+template Result<void>
+Packet::write_to_buffer(PacketBuffer &buffer) const;
+
+/* ------------------------------------------------------------------------------------------------------- */
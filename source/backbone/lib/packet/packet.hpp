@@ -1,5 +1,7 @@
 #pragma once
 
+#include <memory_resource>
+
 #include "buffer.hpp"
 #include "header.hpp"
 #include "question.hpp"
@@ -7,29 +9,58 @@
 
 /* ------------------------------------------------------------------------------------------------------- */
 
+/**
+ * @brief
+ * Fully parsed message.
+ *
+ * @details
+ * Every section and every name is allocated with the packet's allocator, so parsing a packet into a
+ * `QueryArena` touches the global allocator only when the arena runs out.
+ */
 class Packet {
 public:
-   PacketHeader                header;
-   std::vector<PacketQuestion> questions;
-   std::vector<PacketRecord>   answers;
-   std::vector<PacketRecord>   authorities;
-   std::vector<PacketRecord>   additionals;   // or resources
+   using allocator_type = std::pmr::polymorphic_allocator<>;
+
+public:
+   PacketHeader                     header;
+   std::pmr::vector<PacketQuestion> questions;
+   std::pmr::vector<PacketRecord>   answers;
+   std::pmr::vector<PacketRecord>   authorities;
+   std::pmr::vector<PacketRecord>   additionals;   // or resources
 
 public:
    Packet() = delete;
-   Packet(PacketHeader                header,
-          std::vector<PacketQuestion> questions,
-          std::vector<PacketRecord>   answers,
-          std::vector<PacketRecord>   authorities,
-          std::vector<PacketRecord>   additionals);
-   ~Packet() = default;
+   Packet(PacketHeader header, allocator_type allocator = {});
+   Packet(PacketHeader                     header,
+          std::pmr::vector<PacketQuestion> questions,
+          std::pmr::vector<PacketRecord>   answers,
+          std::pmr::vector<PacketRecord>   authorities,
+          std::pmr::vector<PacketRecord>   additionals);
+   Packet(const Packet &other) = default;
+   Packet(Packet &&other)      = default;
+   ~Packet()                   = default;
+
+   Packet &
+   operator=(const Packet &other) = default;
+   Packet &
+   operator=(Packet &&other) = default;
+
+   allocator_type
+   get_allocator() const {
+      return questions.get_allocator();
+   }
 
 public:
+   /**
+    * Parses a whole message, allocating everything it holds with `allocator`.
+    */
+   template<NameBuffer B>
    static Result<Packet>
-   from_buffer(Ref<PacketBuffer> buffer);
+   from_buffer(B &buffer, allocator_type allocator = {});
 
+   template<NameBuffer B>
    Result<void>
-   write_to_buffer(Ref<PacketBuffer> buffer) const;
+   write_to_buffer(B &buffer) const;
 };
 
 /* ------------------------------------------------------------------------------------------------------- */
@@ -2,45 +2,67 @@
 
 /* ------------------------------------------------------------------------------------------------------- */
 
-PacketQuestion::PacketQuestion(const std::string &name, QueryType type, uint16_t class_)
-    : m_Name(name), m_Type(type), m_Class(class_) {}
+PacketQuestion::PacketQuestion(const DomainName &name,
+                               QueryType         type,
+                               uint16_t          class_,
+                               allocator_type    allocator)
+    : m_Name(name, allocator), m_Type(type), m_Class(class_) {}
 
 /* ------------------------------------------------------------------------------------------------------- */
 
+PacketQuestion::PacketQuestion(const PacketQuestion &other, allocator_type allocator)
+    : m_Name(other.m_Name, allocator), m_Type(other.m_Type), m_Class(other.m_Class) {}
+
+/* ------------------------------------------------------------------------------------------------------- */
+
+PacketQuestion::PacketQuestion(PacketQuestion &&other, allocator_type allocator)
+    : m_Name(std::move(other.m_Name), allocator), m_Type(other.m_Type), m_Class(other.m_Class) {}
+
+/* ------------------------------------------------------------------------------------------------------- */
+
+template<NameBuffer B>
 Result<PacketQuestion>
-PacketQuestion::from_buffer(Ref<PacketBuffer> buf) {
+PacketQuestion::from_buffer(B &buffer, allocator_type allocator) {
    /* Domain Name */
-   auto _name = read_domain_name(buf).except("Invalid domain name");
+   auto _name = buffer.read_name(allocator).except("Invalid domain name");
    RETURN_IF_ERROR(_name);
-   auto name = _name.get_value();
 
-   /* Type */
-   auto _type = buf->read_uint16().except("Invalid query type");
-   RETURN_IF_ERROR(_type);
-   auto type = static_cast<QueryType>(_type.get_value());
+   /* Type and Class */
+   auto res = buffer.ensure_read(4).except("Invalid query type and class");
+   RETURN_IF_ERROR(res);
+   auto type   = static_cast<QueryType>(buffer.read_uint16_unchecked());
+   auto class_ = buffer.read_uint16_unchecked();
 
-   /* Class */
-   auto _class = buf->read_uint16().except("Invalid query class");
-   RETURN_IF_ERROR(_class);
-   auto class_ = _class.get_value();
-
-   auto packet = PacketQuestion(name, type, class_);
-   return packet;
+   auto question   = PacketQuestion(DomainName(allocator), type, class_, allocator);
+   question.m_Name = std::move(_name.get_value());
+   return question;
 }
 
 /* ------------------------------------------------------------------------------------------------------- */
 
+template<NameBuffer B>
 Result<void>
-PacketQuestion::write_to_buffer(Ref<PacketBuffer> buf) const {
-   return Result<void>();
+PacketQuestion::write_to_buffer(B &buffer) const {
+   /* Domain Name */
+   auto res = buffer.write_name(m_Name).except("Failed to write domain name");
+   RETURN_IF_ERROR(res);
+
+   /* Type and Class */
+   res = buffer.ensure_write(4).except("Failed to write query type and class");
+   RETURN_IF_ERROR(res);
+   buffer.write_uint16_unchecked(m_Type);
+   buffer.write_uint16_unchecked(m_Class);
+
+   return Ok();
 }
 
 /* ------------------------------------------------------------------------------------------------------- */
 
-Result<std::string>
-PacketQuestion::read_domain_name(Ref<PacketBuffer> buffer) {
-   auto domain_name = buffer->read_qname().except("Failed to read domain name");
-   return domain_name;
-}
+// Buffers questions are read from and written to
+template Result<PacketQuestion>
+PacketQuestion::from_buffer(PacketBuffer &buffer, allocator_type allocator);
+
+template Result<void>
+PacketQuestion::write_to_buffer(PacketBuffer &buffer) const;
 
 /* ------------------------------------------------------------------------------------------------------- */
@@ -1,11 +1,20 @@
 #pragma once
 
+#include <memory_resource>
+#include <string_view>
+
 #include "buffer.hpp"
 
 /* ------------------------------------------------------------------------------------------------------- */
 
+/**
+ * @brief
+ * Question of a message. Its name is a `DomainName`, so it comes out of a message in lowercase.
+ */
 class PacketQuestion {
 public:
+   using allocator_type = std::pmr::polymorphic_allocator<>;
+
    enum QueryType {
       UNKNOWN = UINT16_MAX,
       A       = 1,
@@ -17,28 +26,54 @@ public:
       MX      = 15,
       TXT     = 16,
       SRV     = 33,
+      OPT     = 41,   // EDNS0 pseudo-record, RFC 6891
       ANY     = 255,
    };
 
 private:
-   std::string m_Name;
-   QueryType   m_Type;
-   uint16_t    m_Class;
+   DomainName m_Name;
+   QueryType  m_Type;
+   uint16_t   m_Class;
 
 public:
    PacketQuestion() = delete;
-   PacketQuestion(const std::string &name, QueryType type, uint16_t class_);
+   PacketQuestion(const DomainName &name, QueryType type, uint16_t class_, allocator_type allocator = {});
+   PacketQuestion(const PacketQuestion &other) = default;
+   PacketQuestion(PacketQuestion &&other)      = default;
+   PacketQuestion(const PacketQuestion &other, allocator_type allocator);
+   PacketQuestion(PacketQuestion &&other, allocator_type allocator);
    ~PacketQuestion() = default;
 
+   PacketQuestion &
+   operator=(const PacketQuestion &other) = default;
+   PacketQuestion &
+   operator=(PacketQuestion &&other) = default;
+
+   const DomainName &
+   get_name() const {
+      return m_Name;
+   }
+
+   QueryType
+   get_type() const {
+      return m_Type;
+   }
+
+   uint16_t
+   get_class() const {
+      return m_Class;
+   }
+
+   /**
+    * Parses the question at the read index, its name allocated with `allocator`.
+    */
+   template<NameBuffer B>
    static Result<PacketQuestion>
-   from_buffer(Ref<PacketBuffer> buf);
+   from_buffer(B &buffer, allocator_type allocator = {});
 
+   template<NameBuffer B>
    Result<void>
-   write_to_buffer(Ref<PacketBuffer> buf) const;
-
-private:
-   static Result<std::string>
-   read_domain_name(Ref<PacketBuffer> buf);
+   write_to_buffer(B &buffer) const;
 };
 
 /* ------------------------------------------------------------------------------------------------------- */
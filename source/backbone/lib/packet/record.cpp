@@ -1,17 +1,431 @@
 #include "record.hpp"
 
+#include <cstring>
+
+/* ------------------------------------------------------------------------------------------------------- */
+
+static inline uint16_t
+load_uint16(const Byte *data) {
+   return (data[0] << 8) | data[1];
+}
+
+/* ------------------------------------------------------------------------------------------------------- */
+
+static inline uint32_t
+load_uint32(const Byte *data) {
+   return (uint32_t(data[0]) << 24) | (data[1] << 16) | (data[2] << 8) | data[3];
+}
+
+/* ------------------------------------------------------------------------------------------------------- */
+
+/**
+ * Length of the canonical name at the start of `wire`, root label included.
+ */
+static size_t
+get_name_length(std::span<const Byte> wire) {
+   size_t pos = 0;
+   while (pos < wire.size() && wire[pos] != 0) {
+      pos += 1 + wire[pos];
+   }
+   return std::min(pos + 1, wire.size());
+}
+
+/* ------------------------------------------------------------------------------------------------------- */
+
+PacketRecord::PacketRecord(DomainName            name,
+                           uint16_t              type,
+                           uint16_t              class_,
+                           uint32_t              ttl,
+                           std::span<const Byte> rdata,
+                           allocator_type        allocator)
+    : m_Name(std::move(name), allocator), m_Type(type), m_Class(class_), m_TTL(ttl), m_Length(0) {
+   assign_rdata(rdata);
+}
+
+/* ------------------------------------------------------------------------------------------------------- */
+
+PacketRecord::PacketRecord(const PacketRecord &other) : PacketRecord(other, allocator_type()) {}
+
+/* ------------------------------------------------------------------------------------------------------- */
+
+PacketRecord::PacketRecord(const PacketRecord &other, allocator_type allocator)
+    : m_Name(other.m_Name, allocator), m_Type(other.m_Type), m_Class(other.m_Class), m_TTL(other.m_TTL),
+      m_Length(0) {
+   assign_rdata(other.get_rdata());
+}
+
+/* ------------------------------------------------------------------------------------------------------- */
+
+PacketRecord::PacketRecord(PacketRecord &&other) noexcept
+    : m_Name(std::move(other.m_Name)), m_Type(other.m_Type), m_Class(other.m_Class), m_TTL(other.m_TTL),
+      m_Length(std::exchange(other.m_Length, 0)), m_Data(other.m_Data) {}
+
+/* ------------------------------------------------------------------------------------------------------- */
+
+PacketRecord::PacketRecord(PacketRecord &&other, allocator_type allocator)
+    : m_Name(std::move(other.m_Name), allocator), m_Type(other.m_Type), m_Class(other.m_Class),
+      m_TTL(other.m_TTL), m_Length(0) {
+   // The name has been moved already, but the allocator of the other record is still that of its RDATA
+   if (allocator == other.get_allocator()) {
+      m_Length = std::exchange(other.m_Length, 0);
+      m_Data   = other.m_Data;
+   } else {
+      assign_rdata(other.get_rdata());
+   }
+}
+
+/* ------------------------------------------------------------------------------------------------------- */
+
+PacketRecord::~PacketRecord() {
+   release_rdata();
+}
+
+/* ------------------------------------------------------------------------------------------------------- */
+
+PacketRecord &
+PacketRecord::operator=(const PacketRecord &other) {
+   if (this != &other) {
+      release_rdata();
+      m_Name  = other.m_Name;
+      m_Type  = other.m_Type;
+      m_Class = other.m_Class;
+      m_TTL   = other.m_TTL;
+      assign_rdata(other.get_rdata());
+   }
+   return *this;
+}
+
+/* ------------------------------------------------------------------------------------------------------- */
+
+PacketRecord &
+PacketRecord::operator=(PacketRecord &&other) {
+   if (this == &other) {
+      return *this;
+   }
+
+   // RDATA from another allocator has to be copied, the allocator of a record never changes
+   if (get_allocator() != other.get_allocator()) {
+      return *this = static_cast<const PacketRecord &>(other);
+   }
+
+   release_rdata();
+   m_Name   = std::move(other.m_Name);
+   m_Type   = other.m_Type;
+   m_Class  = other.m_Class;
+   m_TTL    = other.m_TTL;
+   m_Length = std::exchange(other.m_Length, 0);
+   m_Data   = other.m_Data;
+   return *this;
+}
+
 /* ------------------------------------------------------------------------------------------------------- */
 
 Result<PacketRecord>
-PacketRecord::from_buffer(Ref<PacketBuffer> buffer) {
-   return PacketRecord();
+PacketRecord::from_rdata(const DomainName     &name,
+                         RecordType            type,
+                         uint16_t              class_,
+                         uint32_t              ttl,
+                         std::span<const Byte> rdata,
+                         allocator_type        allocator) {
+   if (rdata.size() > UINT16_MAX) {
+      return Error(PACKET_WRITE_CORRUPTED_BUFFER, "RDATA exceeds 65535 bytes");
+   }
+
+   std::array<Byte, MAX_NAMED_RDATA> scratch;
+   auto _rdata = canonicalize(type, rdata, 0, rdata.size(), scratch).except("Invalid RDATA");
+   RETURN_IF_ERROR(_rdata);
+
+   return PacketRecord(name, type, class_, ttl, _rdata.get_value(), allocator);
 }
 
 /* ------------------------------------------------------------------------------------------------------- */
 
+template<NameBuffer B>
+Result<PacketRecord>
+PacketRecord::from_buffer(B &buffer, allocator_type allocator) {
+   /* Name */
+   auto _name = buffer.read_name(allocator).except("Invalid record name");
+   RETURN_IF_ERROR(_name);
+
+   /* Type, class, TTL and RDATA length */
+   auto res = buffer.ensure_read(10).except("Invalid record type, class, TTL and length");
+   RETURN_IF_ERROR(res);
+   uint16_t type   = buffer.read_uint16_unchecked();
+   uint16_t class_ = buffer.read_uint16_unchecked();
+   uint32_t ttl    = buffer.read_uint32_unchecked();
+   uint16_t length = buffer.read_uint16_unchecked();
+
+   /* RDATA. Names in it may only point backwards, so the message can end right behind it */
+   size_t start = buffer.get_read_index();
+   res          = buffer.ensure_read(length).except("RDATA runs past the end of the message");
+   RETURN_IF_ERROR(res);
+
+   std::array<Byte, MAX_NAMED_RDATA> scratch;
+   auto message = std::span<const Byte>(buffer.get_data(), start + length);
+   auto _rdata  = canonicalize(type, message, start, length, scratch).except("Invalid RDATA");
+   RETURN_IF_ERROR(_rdata);
+
+   res = buffer.seek_read(start + length);
+   RETURN_IF_ERROR(res);
+
+   return PacketRecord(std::move(_name.get_value()), type, class_, ttl, _rdata.get_value(), allocator);
+}
+
+/* ------------------------------------------------------------------------------------------------------- */
+
+template<NameBuffer B>
 Result<void>
-PacketRecord::write_to_buffer(Ref<PacketBuffer> buffer) const {
-   return Result<void>();
+PacketRecord::write_to_buffer(B &buffer) const {
+   /* Name */
+   auto res = buffer.write_name(m_Name).except("Failed to write record name");
+   RETURN_IF_ERROR(res);
+
+   /* Type, class and TTL, the RDATA length follows once known */
+   res = buffer.ensure_write(10).except("Failed to write record type, class, TTL and length");
+   RETURN_IF_ERROR(res);
+   buffer.write_uint16_unchecked(m_Type);
+   buffer.write_uint16_unchecked(m_Class);
+   buffer.write_uint32_unchecked(m_TTL);
+   buffer.write_uint16_unchecked(0);
+
+   /* RDATA */
+   size_t start = buffer.get_write_index();
+   auto   rdata = get_rdata();
+   size_t pos   = 0;
+
+   auto write_embedded = [&]() {
+      size_t length  = get_name_length(rdata.subspan(pos));
+      auto   written = buffer.write_name(rdata.subspan(pos, length));
+      pos += length;
+      return written;
+   };
+
+   switch (m_Type) {
+      case PacketQuestion::NS:
+      case PacketQuestion::CNAME:
+      case PacketQuestion::PTR: res = write_embedded(); break;
+
+      case PacketQuestion::MX:
+         res = buffer.write(rdata.first(2));
+         pos = 2;
+         if (res) {
+            res = write_embedded();
+         }
+         break;
+
+      case PacketQuestion::SOA:
+         res = write_embedded();
+         if (res) {
+            res = write_embedded();
+         }
+         if (res) {
+            res = buffer.write(rdata.subspan(pos));
+         }
+         break;
+
+      // SRV names must not be compressed (RFC 2782), everything else is opaque
+      default: res = buffer.write(rdata); break;
+   }
+   res.except("Failed to write RDATA");
+   RETURN_IF_ERROR(res);
+
+   size_t length                 = buffer.get_write_index() - start;
+   buffer.get_data()[start - 2] = length >> 8;
+   buffer.get_data()[start - 1] = length & 0xFF;
+
+   return Ok();
+}
+
+/* ------------------------------------------------------------------------------------------------------- */
+
+MxData
+PacketRecord::get_mx() const {
+   auto rdata = get_rdata();
+   return MxData { load_uint16(rdata.data()), rdata.subspan(2) };
+}
+
+/* ------------------------------------------------------------------------------------------------------- */
+
+SoaData
+PacketRecord::get_soa() const {
+   auto   rdata   = get_rdata();
+   size_t primary = get_name_length(rdata);
+   size_t mailbox = get_name_length(rdata.subspan(primary));
+
+   const Byte *fields = rdata.data() + primary + mailbox;
+   return SoaData { rdata.first(primary),
+                    rdata.subspan(primary, mailbox),
+                    load_uint32(fields),
+                    load_uint32(fields + 4),
+                    load_uint32(fields + 8),
+                    load_uint32(fields + 12),
+                    load_uint32(fields + 16) };
 }
 
 /* ------------------------------------------------------------------------------------------------------- */
+
+SrvData
+PacketRecord::get_srv() const {
+   auto rdata = get_rdata();
+   return SrvData { load_uint16(rdata.data()),
+                    load_uint16(rdata.data() + 2),
+                    load_uint16(rdata.data() + 4),
+                    rdata.subspan(6) };
+}
+
+/* ------------------------------------------------------------------------------------------------------- */
+
+std::vector<std::string_view>
+PacketRecord::get_texts() const {
+   auto rdata = get_rdata();
+
+   std::vector<std::string_view> texts;
+   for (size_t pos = 0; pos < rdata.size(); pos += 1 + rdata[pos]) {
+      texts.emplace_back(reinterpret_cast<const char *>(rdata.data() + pos + 1), rdata[pos]);
+   }
+   return texts;
+}
+
+/* ------------------------------------------------------------------------------------------------------- */
+
+bool
+PacketRecord::operator==(const PacketRecord &other) const {
+   auto rdata = get_rdata();
+   return m_Type == other.m_Type && m_Class == other.m_Class && m_Length == other.m_Length &&
+          m_Name == other.m_Name && std::memcmp(rdata.data(), other.get_rdata().data(), rdata.size()) == 0;
+}
+
+/* ------------------------------------------------------------------------------------------------------- */
+
+void
+PacketRecord::assign_rdata(std::span<const Byte> rdata) {
+   m_Length = rdata.size();
+   if (m_Length <= INLINE_SIZE) {
+      std::memcpy(m_Data.bytes.data(), rdata.data(), rdata.size());
+      return;
+   }
+
+   m_Data.pointer = static_cast<Byte *>(get_allocator().allocate_bytes(m_Length, 1));
+   std::memcpy(m_Data.pointer, rdata.data(), rdata.size());
+}
+
+/* ------------------------------------------------------------------------------------------------------- */
+
+void
+PacketRecord::release_rdata() {
+   if (m_Length > INLINE_SIZE) {
+      get_allocator().deallocate_bytes(m_Data.pointer, m_Length, 1);
+   }
+   m_Length = 0;
+}
+
+/* ------------------------------------------------------------------------------------------------------- */
+
+/**
+ * @brief
+ * Validates the RDATA against its type and decompresses the names in it.
+ *
+ * @details
+ * Names go through the `NameKernel`, exactly like the owner name, and must end within the RDATA.
+ */
+Result<std::span<const Byte>>
+PacketRecord::canonicalize(uint16_t              type,
+                           std::span<const Byte> message,
+                           size_t                start,
+                           size_t                length,
+                           std::span<Byte>       scratch) {
+   auto   rdata   = message.subspan(start, length);
+   size_t end     = start + length;
+   size_t pos     = start;
+   size_t written = 0;
+
+   NameKernel::Output out;
+
+   auto copy_name = [&]() -> Result<void> {
+      auto _scan = NameKernel::scan(message, pos, out);
+      RETURN_IF_ERROR(_scan);
+      auto &scan = _scan.get_value();
+
+      std::memcpy(scratch.data() + written, out.wire.data(), scan.length);
+      written += scan.length;
+      pos = scan.end;
+      return Ok();
+   };
+
+   auto copy_fixed = [&](size_t count) -> Result<void> {
+      if (end - pos < count) {
+         return Error(PACKET_READ_CORRUPTED_RECORD, "RDATA too short for its type");
+      }
+
+      std::memcpy(scratch.data() + written, message.data() + pos, count);
+      written += count;
+      pos += count;
+      return Ok();
+   };
+
+   auto res = Ok();
+   switch (type) {
+      case PacketQuestion::A:
+      case PacketQuestion::AAAA:
+         if (length != (type == PacketQuestion::A ? 4 : 16)) {
+            return Error(PACKET_READ_CORRUPTED_RECORD, "Invalid address length");
+         }
+         return rdata;
+
+      case PacketQuestion::TXT:
+         // One or more character strings, filling the RDATA exactly
+         for (pos = 0; pos < length; pos += 1 + rdata[pos]) {}
+         if (length == 0 || pos != length) {
+            return Error(PACKET_READ_CORRUPTED_RECORD, "Invalid character strings");
+         }
+         return rdata;
+
+      case PacketQuestion::NS:
+      case PacketQuestion::CNAME:
+      case PacketQuestion::PTR: res = copy_name(); break;
+
+      case PacketQuestion::MX:
+         res = copy_fixed(2);
+         if (res) {
+            res = copy_name();
+         }
+         break;
+
+      case PacketQuestion::SOA:
+         res = copy_name();
+         if (res) {
+            res = copy_name();
+         }
+         if (res) {
+            res = copy_fixed(20);
+         }
+         break;
+
+      case PacketQuestion::SRV:
+         res = copy_fixed(6);
+         if (res) {
+            res = copy_name();
+         }
+         break;
+
+      default: return rdata;
+   }
+   RETURN_IF_ERROR(res);
+
+   if (pos != end) {
+      return Error(PACKET_READ_CORRUPTED_RECORD, "RDATA longer than its contents");
+   }
+
+   return std::span<const Byte>(scratch.data(), written);
+}
+
+/* ------------------------------------------------------------------------------------------------------- */
+
+// Buffers records are read from and written to
+template Result<PacketRecord>
+PacketRecord::from_buffer(PacketBuffer &buffer, allocator_type allocator);
+
+template Result<void>
+PacketRecord::write_to_buffer(PacketBuffer &buffer) const;
+
+/* ------------------------------------------------------------------------------------------------------- */
@@ -1,16 +1,240 @@
 #pragma once
 
+#include <array>
+#include <memory_resource>
+#include <span>
+#include <string_view>
+#include <vector>
+
 #include "buffer.hpp"
+#include "question.hpp"
+
+/* ------------------------------------------------------------------------------------------------------- */
+
+/**
+ * @brief
+ * RDATA of an MX record. The exchange is a name in canonical wire form, see `PacketRecord`.
+ */
+class MxData {
+public:
+   uint16_t              preference;
+   std::span<const Byte> exchange;
+};
 
 /* ------------------------------------------------------------------------------------------------------- */
 
+/**
+ * @brief
+ * RDATA of an SOA record. Both names are in canonical wire form, see `PacketRecord`.
+ */
+class SoaData {
+public:
+   std::span<const Byte> primary;   // MNAME
+   std::span<const Byte> mailbox;   // RNAME
+   uint32_t              serial;
+   uint32_t              refresh;
+   uint32_t              retry;
+   uint32_t              expire;
+   uint32_t              minimum;
+};
+
+/* ------------------------------------------------------------------------------------------------------- */
+
+/**
+ * @brief
+ * RDATA of an SRV record (RFC 2782). The target is a name in canonical wire form, see `PacketRecord`.
+ */
+class SrvData {
+public:
+   uint16_t              priority;
+   uint16_t              weight;
+   uint16_t              port;
+   std::span<const Byte> target;
+};
+
+/* ------------------------------------------------------------------------------------------------------- */
+
+/**
+ * @brief
+ * Resource record of the answer, authority or additional section.
+ *
+ * @details
+ * A record keeps its RDATA in canonical form: exactly as on the wire, except that names embedded in it
+ * (NS, CNAME, PTR, MX, SOA, SRV) are uncompressed and lowercase like any `DomainName`. That way the RDATA
+ * no longer depends on the message it came from, and records can be compared, cached and written into
+ * another message as they are. Types this class does not know are kept as opaque bytes (RFC 3597).
+ *
+ * Records are the bulk of what the cache holds, so they are kept small: RDATA of up to `INLINE_SIZE`
+ * bytes (every A and AAAA record, and short TXT records) is stored within the record itself, anything
+ * longer in a single allocation made with the record's allocator. Typed accessors decode the RDATA on
+ * demand rather than keeping a decoded copy around. Each of them must only be called on a record of the
+ * matching type.
+ */
 class PacketRecord {
 public:
+   using allocator_type = std::pmr::polymorphic_allocator<>;
+   using RecordType     = PacketQuestion::QueryType;
+
+   static constexpr size_t INLINE_SIZE = 16;
+
+   /**
+    * Longest canonical RDATA of a type with embedded names: an SOA with two names of 255 bytes.
+    */
+   static constexpr size_t MAX_NAMED_RDATA = 2 * 255 + 20;
+
+private:
+   DomainName m_Name;   // also holds the allocator of the record
+   uint16_t   m_Type;
+   uint16_t   m_Class;
+   uint32_t   m_TTL;
+   uint16_t   m_Length;
+
+   union {
+      std::array<Byte, INLINE_SIZE> bytes;
+      Byte                         *pointer;
+   } m_Data;
+
+public:
+   PacketRecord() = delete;
+   PacketRecord(const PacketRecord &other);
+   PacketRecord(const PacketRecord &other, allocator_type allocator);
+   PacketRecord(PacketRecord &&other) noexcept;
+   PacketRecord(PacketRecord &&other, allocator_type allocator);
+   ~PacketRecord();
+
+   PacketRecord &
+   operator=(const PacketRecord &other);
+   PacketRecord &
+   operator=(PacketRecord &&other);
+
+   /**
+    * Record with `rdata` in canonical form, which is validated against the type like parsed RDATA is.
+    */
+   static Result<PacketRecord>
+   from_rdata(const DomainName     &name,
+              RecordType            type,
+              uint16_t              class_,
+              uint32_t              ttl,
+              std::span<const Byte> rdata,
+              allocator_type        allocator = {});
+
+   /**
+    * Parses the record at the read index, decompressing the names in its RDATA. Everything is allocated
+    * with `allocator`.
+    */
+   template<NameBuffer B>
    static Result<PacketRecord>
-   from_buffer(Ref<PacketBuffer> buffer);
+   from_buffer(B &buffer, allocator_type allocator = {});
 
+   /**
+    * Writes the record at the write index. Names are compressed where RFC 3597 allows it: the owner, and
+    * the names in the RDATA of the types from RFC 1035.
+    */
+   template<NameBuffer B>
    Result<void>
-   write_to_buffer(Ref<PacketBuffer> buffer) const;
+   write_to_buffer(B &buffer) const;
+
+   allocator_type
+   get_allocator() const {
+      return m_Name.get_allocator();
+   }
+
+   const DomainName &
+   get_name() const {
+      return m_Name;
+   }
+
+   RecordType
+   get_type() const {
+      return static_cast<RecordType>(m_Type);
+   }
+
+   uint16_t
+   get_class() const {
+      return m_Class;
+   }
+
+   uint32_t
+   get_ttl() const {
+      return m_TTL;
+   }
+
+   void
+   set_ttl(uint32_t ttl) {
+      m_TTL = ttl;
+   }
+
+   /**
+    * RDATA in canonical form.
+    */
+   std::span<const Byte>
+   get_rdata() const {
+      return { m_Length <= INLINE_SIZE ? m_Data.bytes.data() : m_Data.pointer, m_Length };
+   }
+
+   /**
+    * Address of an A (4 bytes) or AAAA (16 bytes) record, in network byte order.
+    */
+   std::span<const Byte>
+   get_address() const {
+      return get_rdata();
+   }
+
+   /**
+    * Target of an NS, CNAME or PTR record, in canonical wire form.
+    */
+   std::span<const Byte>
+   get_target() const {
+      return get_rdata();
+   }
+
+   MxData
+   get_mx() const;
+
+   SoaData
+   get_soa() const;
+
+   SrvData
+   get_srv() const;
+
+   /**
+    * Character strings of a TXT record.
+    */
+   std::vector<std::string_view>
+   get_texts() const;
+
+   /**
+    * Same owner, type, class and RDATA. The TTL is not part of what makes a record (RFC 2181 5.2).
+    */
+   bool
+   operator==(const PacketRecord &other) const;
+
+private:
+   PacketRecord(DomainName            name,
+                uint16_t              type,
+                uint16_t              class_,
+                uint32_t              ttl,
+                std::span<const Byte> rdata,
+                allocator_type        allocator);
+
+   void
+   assign_rdata(std::span<const Byte> rdata);
+
+   void
+   release_rdata();
+
+   /**
+    * Canonical form of the `length` bytes of RDATA at `start` in `message`. It is either a view into
+    * `message` or, for types with embedded names, assembled in `scratch`.
+    */
+   static Result<std::span<const Byte>>
+   canonicalize(uint16_t              type,
+                std::span<const Byte> message,
+                size_t                start,
+                size_t                length,
+                std::span<Byte>       scratch);
 };
 
+static_assert(sizeof(PacketRecord) <= 48);
+
 /* ------------------------------------------------------------------------------------------------------- */
@@ -0,0 +1,504 @@
+#include "view.hpp"
+
+/* ------------------------------------------------------------------------------------------------------- */
+
+static inline uint16_t
+load_uint16(const Byte *data) {
+   return (data[0] << 8) | data[1];
+}
+
+/* ------------------------------------------------------------------------------------------------------- */
+
+static inline uint32_t
+load_uint32(const Byte *data) {
+   return (static_cast<uint32_t>(data[0]) << 24) | (data[1] << 16) | (data[2] << 8) | data[3];
+}
+
+/* ------------------------------------------------------------------------------------------------------- */
+
+static inline char
+to_lower(char c) {
+   return (c >= 'A' && c <= 'Z') ? c + ('a' - 'A') : c;
+}
+
+/* ------------------------------------------------------------------------------------------------------- */
+/* NameView                                                                                                */
+/* ------------------------------------------------------------------------------------------------------- */
+
+NameView::iterator::iterator(const Byte *message, size_t position)
+    : m_Message(message), m_Position(position) {
+   follow_pointers();
+}
+
+/* ------------------------------------------------------------------------------------------------------- */
+
+void
+NameView::iterator::follow_pointers() {
+   while ((m_Message[m_Position] & 0xC0) == 0xC0) {
+      m_Position = ((m_Message[m_Position] & 0x3F) << 8) | m_Message[m_Position + 1];
+   }
+}
+
+/* ------------------------------------------------------------------------------------------------------- */
+
+std::string_view
+NameView::iterator::operator*() const {
+   return std::string_view(reinterpret_cast<const char *>(m_Message + m_Position + 1), m_Message[m_Position]);
+}
+
+/* ------------------------------------------------------------------------------------------------------- */
+
+NameView::iterator &
+NameView::iterator::operator++() {
+   m_Position += 1 + m_Message[m_Position];
+   follow_pointers();
+   return *this;
+}
+
+/* ------------------------------------------------------------------------------------------------------- */
+
+NameView::iterator
+NameView::iterator::operator++(int) {
+   auto copy = *this;
+   ++*this;
+   return copy;
+}
+
+/* ------------------------------------------------------------------------------------------------------- */
+
+bool
+NameView::iterator::operator==(const iterator &other) const {
+   // Every name ends on the root label, so all end iterators compare equal to any iterator sitting on it
+   bool at_end       = m_Message == nullptr || m_Message[m_Position] == 0;
+   bool other_at_end = other.m_Message == nullptr || other.m_Message[other.m_Position] == 0;
+   if (at_end || other_at_end) {
+      return at_end == other_at_end;
+   }
+
+   return m_Message == other.m_Message && m_Position == other.m_Position;
+}
+
+/* ------------------------------------------------------------------------------------------------------- */
+
+NameView::iterator
+NameView::begin() const {
+   return iterator(m_Message.data(), m_Offset);
+}
+
+/* ------------------------------------------------------------------------------------------------------- */
+
+NameView::iterator
+NameView::end() const {
+   return iterator();
+}
+
+/* ------------------------------------------------------------------------------------------------------- */
+
+size_t
+NameView::label_count() const {
+   size_t count = 0;
+   for (auto it = begin(); it != end(); ++it) {
+      count++;
+   }
+   return count;
+}
+
+/* ------------------------------------------------------------------------------------------------------- */
+
+size_t
+NameView::dotted_length() const {
+   size_t length = 0;
+   for (auto label : *this) {
+      length += label.size() + (length > 0 ? 1 : 0);
+   }
+   return length;
+}
+
+/* ------------------------------------------------------------------------------------------------------- */
+
+size_t
+NameView::copy_to(std::span<char> out) const {
+   size_t written = 0;
+   for (auto label : *this) {
+      if (written > 0 && written < out.size()) {
+         out[written++] = '.';
+      }
+
+      size_t count = std::min(label.size(), out.size() - written);
+      std::copy_n(label.data(), count, out.data() + written);
+      written += count;
+   }
+   return written;
+}
+
+/* ------------------------------------------------------------------------------------------------------- */
+
+Result<DomainName>
+NameView::to_domain_name(DomainName::allocator_type allocator) const {
+   NameKernel::Output out;
+   auto               _scan = NameKernel::scan(m_Message, m_Offset, out);
+   RETURN_IF_ERROR(_scan);
+
+   return DomainName(out, _scan.get_value(), allocator);
+}
+
+/* ------------------------------------------------------------------------------------------------------- */
+
+bool
+NameView::equals(std::string_view dotted) const {
+   if (!dotted.empty() && dotted.back() == '.') {
+      dotted.remove_suffix(1);
+   }
+
+   size_t position = 0;
+   for (auto label : *this) {
+      if (position > 0) {
+         if (position >= dotted.size() || dotted[position] != '.') {
+            return false;
+         }
+         position++;
+      }
+
+      if (dotted.size() - position < label.size()) {
+         return false;
+      }
+
+      for (size_t i = 0; i < label.size(); i++) {
+         if (to_lower(label[i]) != to_lower(dotted[position + i])) {
+            return false;
+         }
+      }
+      position += label.size();
+   }
+
+   return position == dotted.size();
+}
+
+/* ------------------------------------------------------------------------------------------------------- */
+
+std::string
+NameView::to_string() const {
+   std::string result(dotted_length(), '\0');
+   copy_to(result);
+   return result;
+}
+
+/* ------------------------------------------------------------------------------------------------------- */
+/* PacketView                                                                                              */
+/* ------------------------------------------------------------------------------------------------------- */
+
+PacketView::PacketView(std::span<const Byte> data)
+    : m_Data(data), m_QuestionsOffset(12), m_AnswersOffset(12), m_AuthoritiesOffset(12),
+      m_AdditionalsOffset(12), m_EndOffset(12) {}
+
+/* ------------------------------------------------------------------------------------------------------- */
+
+/**
+ * @brief
+ * Validate the whole message once so that every accessor afterwards can read it unchecked.
+ *
+ * @details
+ * A name is accepted only if all of its labels are at most 63 bytes, its wire length is at most 255 bytes
+ * and every compression pointer points strictly before the label sequence that contains it. The latter
+ * guarantees that following pointers always terminates without needing a jump counter.
+ */
+Result<PacketView>
+PacketView::from_bytes(std::span<const Byte> data) {
+   if (data.size() < 12) {
+      return Error(PACKET_READ_CORRUPTED_HEADER, "Buffer overflowed while reading the header");
+   }
+
+   PacketView view(data);
+   size_t     pos = 12;
+
+   /* Questions */
+   view.m_QuestionsOffset = pos;
+   for (uint16_t i = 0; i < view.question_count(); i++) {
+      auto _pos = skip_name(data, pos).except(PACKET_READ_CORRUPTED_QUESTION, "Invalid domain name");
+      RETURN_IF_ERROR(_pos);
+      pos = _pos.get_value();
+
+      // type (16 bits) + class (16 bits)
+      if (data.size() - pos < 4) {
+         return Error(PACKET_READ_CORRUPTED_QUESTION, "Question overflowed the message");
+      }
+      pos += 4;
+   }
+
+   /* Records */
+   size_t  *offsets[] = { &view.m_AnswersOffset, &view.m_AuthoritiesOffset, &view.m_AdditionalsOffset };
+   uint16_t counts[]  = { view.answer_count(), view.authority_count(), view.additional_count() };
+   for (size_t section = 0; section < 3; section++) {
+      *offsets[section] = pos;
+
+      for (uint16_t i = 0; i < counts[section]; i++) {
+         auto _pos = skip_name(data, pos).except(PACKET_READ_CORRUPTED_RECORD, "Invalid record name");
+         RETURN_IF_ERROR(_pos);
+         pos = _pos.get_value();
+
+         // type (16 bits) + class (16 bits) + ttl (32 bits) + data length (16 bits)
+         if (data.size() - pos < 10) {
+            return Error(PACKET_READ_CORRUPTED_RECORD, "Record overflowed the message");
+         }
+         uint16_t length = load_uint16(&data[pos + 8]);
+         pos += 10;
+
+         if (data.size() - pos < length) {
+            return Error(PACKET_READ_CORRUPTED_RECORD, "Record data overflowed the message");
+         }
+         pos += length;
+      }
+   }
+
+   view.m_EndOffset = pos;
+   return view;
+}
+
+/* ------------------------------------------------------------------------------------------------------- */
+
+Result<size_t>
+PacketView::skip_name(std::span<const Byte> data, size_t position) {
+   size_t pos          = position;
+   size_t floor        = position;   // pointers must point strictly below this
+   size_t wire_length  = 0;
+   size_t end_position = 0;
+   bool   jumped       = false;
+
+   while (true) {
+      if (pos >= data.size()) {
+         return Error(FAILED_TO_READ_QNAME, "Domain name overflowed the message");
+      }
+
+      uint8_t len = data[pos];
+
+      if ((len & 0xC0) == 0xC0) {
+         if (pos + 1 >= data.size()) {
+            return Error(FAILED_TO_READ_QNAME, "Compression pointer overflowed the message");
+         }
+
+         size_t offset = ((len & 0x3F) << 8) | data[pos + 1];
+         if (offset >= floor) {
+            return Error(FAILED_TO_READ_QNAME, "Compression pointer does not point backwards");
+         }
+
+         if (!jumped) {
+            end_position = pos + 2;
+            jumped       = true;
+         }
+
+         pos   = offset;
+         floor = offset;
+         continue;
+      }
+
+      if ((len & 0xC0) != 0) {
+         return Error(FAILED_TO_READ_LABEL, "Unsupported label type");
+      }
+
+      wire_length += 1 + len;
+      if (wire_length > 255) {
+         return Error(FAILED_TO_READ_QNAME, "Domain name exceeds 255 bytes");
+      }
+
+      if (len == 0) {
+         return jumped ? end_position : pos + 1;
+      }
+
+      if (data.size() - pos - 1 < len) {
+         return Error(FAILED_TO_READ_LABEL, "Label overflowed the message");
+      }
+      pos += 1 + len;
+   }
+}
+
+/* ------------------------------------------------------------------------------------------------------- */
+
+size_t
+PacketView::unchecked_skip_name(std::span<const Byte> data, size_t position) {
+   while (true) {
+      uint8_t len = data[position];
+      if ((len & 0xC0) == 0xC0) {
+         return position + 2;
+      }
+      position += 1 + len;
+      if (len == 0) {
+         return position;
+      }
+   }
+}
+
+/* ------------------------------------------------------------------------------------------------------- */
+
+size_t
+PacketView::decode(std::span<const Byte> data, size_t position, QuestionView &out) {
+   out.name = NameView(data, position);
+
+   size_t pos = unchecked_skip_name(data, position);
+   out.type   = static_cast<PacketQuestion::QueryType>(load_uint16(&data[pos]));
+   out.class_ = load_uint16(&data[pos + 2]);
+
+   return pos + 4;
+}
+
+/* ------------------------------------------------------------------------------------------------------- */
+
+size_t
+PacketView::decode(std::span<const Byte> data, size_t position, RecordView &out) {
+   out.name = NameView(data, position);
+
+   size_t   pos    = unchecked_skip_name(data, position);
+   uint16_t length = load_uint16(&data[pos + 8]);
+
+   out.type        = load_uint16(&data[pos]);
+   out.class_      = load_uint16(&data[pos + 2]);
+   out.ttl         = load_uint32(&data[pos + 4]);
+   out.data_offset = pos + 10;
+   out.data        = data.subspan(pos + 10, length);
+
+   return pos + 10 + length;
+}
+
+/* ------------------------------------------------------------------------------------------------------- */
+/* Header accessors                                                                                        */
+/* ------------------------------------------------------------------------------------------------------- */
+
+uint16_t
+PacketView::id() const {
+   return load_uint16(&m_Data[0]);
+}
+
+/* ------------------------------------------------------------------------------------------------------- */
+
+bool
+PacketView::query_response() const {
+   return m_Data[2] & 0x80;
+}
+
+/* ------------------------------------------------------------------------------------------------------- */
+
+uint8_t
+PacketView::op_code() const {
+   return (m_Data[2] >> 3) & 0x0F;
+}
+
+/* ------------------------------------------------------------------------------------------------------- */
+
+bool
+PacketView::authoritative_answer() const {
+   return m_Data[2] & 0x04;
+}
+
+/* ------------------------------------------------------------------------------------------------------- */
+
+bool
+PacketView::truncated_message() const {
+   return m_Data[2] & 0x02;
+}
+
+/* ------------------------------------------------------------------------------------------------------- */
+
+bool
+PacketView::recursion_desired() const {
+   return m_Data[2] & 0x01;
+}
+
+/* ------------------------------------------------------------------------------------------------------- */
+
+bool
+PacketView::recursion_available() const {
+   return m_Data[3] & 0x80;
+}
+
+/* ------------------------------------------------------------------------------------------------------- */
+
+uint8_t
+PacketView::reserved() const {
+   return (m_Data[3] >> 4) & 0x07;
+}
+
+/* ------------------------------------------------------------------------------------------------------- */
+
+PacketHeader::ResultCode
+PacketView::response_code() const {
+   return static_cast<PacketHeader::ResultCode>(m_Data[3] & 0x0F);
+}
+
+/* ------------------------------------------------------------------------------------------------------- */
+
+uint16_t
+PacketView::question_count() const {
+   return load_uint16(&m_Data[4]);
+}
+
+/* ------------------------------------------------------------------------------------------------------- */
+
+uint16_t
+PacketView::answer_count() const {
+   return load_uint16(&m_Data[6]);
+}
+
+/* ------------------------------------------------------------------------------------------------------- */
+
+uint16_t
+PacketView::authority_count() const {
+   return load_uint16(&m_Data[8]);
+}
+
+/* ------------------------------------------------------------------------------------------------------- */
+
+uint16_t
+PacketView::additional_count() const {
+   return load_uint16(&m_Data[10]);
+}
+
+/* ------------------------------------------------------------------------------------------------------- */
+
+PacketHeader
+PacketView::to_header() const {
+   return PacketHeader::from_bytes(m_Data.first<PacketHeader::SIZE>());
+}
+
+/* ------------------------------------------------------------------------------------------------------- */
+/* Sections                                                                                                */
+/* ------------------------------------------------------------------------------------------------------- */
+
+PacketView::Section<QuestionView>
+PacketView::questions() const {
+   return Section<QuestionView>(m_Data, m_QuestionsOffset, question_count());
+}
+
+/* ------------------------------------------------------------------------------------------------------- */
+
+PacketView::Section<RecordView>
+PacketView::answers() const {
+   return Section<RecordView>(m_Data, m_AnswersOffset, answer_count());
+}
+
+/* ------------------------------------------------------------------------------------------------------- */
+
+PacketView::Section<RecordView>
+PacketView::authorities() const {
+   return Section<RecordView>(m_Data, m_AuthoritiesOffset, authority_count());
+}
+
+/* ------------------------------------------------------------------------------------------------------- */
+
+PacketView::Section<RecordView>
+PacketView::additionals() const {
+   return Section<RecordView>(m_Data, m_AdditionalsOffset, additional_count());
+}
+
+/* ------------------------------------------------------------------------------------------------------- */
+
+std::optional<uint16_t>
+PacketView::get_udp_payload_size() const {
+   // The OPT record carries the payload size in place of its class
+   for (auto record : additionals()) {
+      if (record.type == PacketQuestion::OPT) {
+         return record.class_;
+      }
+   }
+   return std::nullopt;
+}
+
+/* ------------------------------------------------------------------------------------------------------- */
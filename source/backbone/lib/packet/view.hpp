@@ -0,0 +1,361 @@
+#pragma once
+
+#include <cstdint>
+#include <optional>
+#include <span>
+#include <string_view>
+
+#include <backbone/core/pch>
+#include "header.hpp"
+#include "domain.hpp"
+#include "question.hpp"
+
+/* ------------------------------------------------------------------------------------------------------- */
+
+/**
+ * @brief
+ * Read-only view over a domain name inside a received message.
+ *
+ * @details
+ * The name is decoded lazily: iterating yields every label as a `std::string_view` pointing straight into
+ * the message, following compression pointers as they are met. Views are only handed out by `PacketView`,
+ * which has already validated the name, so iteration itself never fails.
+ */
+class NameView {
+private:
+   std::span<const Byte> m_Message;
+   size_t                m_Offset;
+
+public:
+   class iterator {
+   private:
+      const Byte *m_Message;
+      size_t      m_Position;
+
+   public:
+      using value_type        = std::string_view;
+      using difference_type   = std::ptrdiff_t;
+      using iterator_category = std::forward_iterator_tag;
+
+      iterator() : m_Message(nullptr), m_Position(0) {}
+      iterator(const Byte *message, size_t position);
+
+      std::string_view
+      operator*() const;
+
+      iterator &
+      operator++();
+
+      iterator
+      operator++(int);
+
+      bool
+      operator==(const iterator &other) const;
+
+   private:
+      void
+      follow_pointers();
+   };
+
+public:
+   NameView() : m_Message(), m_Offset(0) {}
+   NameView(std::span<const Byte> message, size_t offset) : m_Message(message), m_Offset(offset) {}
+
+   iterator
+   begin() const;
+
+   iterator
+   end() const;
+
+   /**
+    * Offset of the first byte of the name (label or pointer) within the message.
+    */
+   size_t
+   get_offset() const {
+      return m_Offset;
+   }
+
+   size_t
+   label_count() const;
+
+   /**
+    * Length of the name in dotted notation, without the trailing dot.
+    */
+   size_t
+   dotted_length() const;
+
+   /**
+    * Writes the dotted form of the name into `out` and returns the number of characters written. The
+    * output is truncated to the capacity of `out`.
+    */
+   size_t
+   copy_to(std::span<char> out) const;
+
+   /**
+    * The name as a `DomainName`, through the `NameKernel`. Fails on names that have no unambiguous dotted
+    * form.
+    */
+   Result<DomainName>
+   to_domain_name(DomainName::allocator_type allocator = {}) const;
+
+   /**
+    * Case-insensitive comparison against a name in dotted notation (trailing dot optional).
+    */
+   bool
+   equals(std::string_view dotted) const;
+
+   std::string
+   to_string() const;
+};
+
+/* ------------------------------------------------------------------------------------------------------- */
+
+class QuestionView {
+public:
+   NameView                  name;
+   PacketQuestion::QueryType type;
+   uint16_t                  class_;
+};
+
+/* ------------------------------------------------------------------------------------------------------- */
+
+class RecordView {
+public:
+   NameView              name;
+   uint16_t              type;
+   uint16_t              class_;
+   uint32_t              ttl;
+   std::span<const Byte> data;
+
+   /**
+    * Offset of the RDATA within the message. Needed to decode names embedded in the RDATA (NS, CNAME,
+    * MX, ...) as they may point back into the message.
+    */
+   size_t data_offset;
+};
+
+/* ------------------------------------------------------------------------------------------------------- */
+
+/**
+ * @brief
+ * Zero-copy, read-only parse of a DNS message.
+ *
+ * @details
+ * `PacketView::from_bytes` performs a single validating pass over the message (header, every name,
+ * every fixed-size field and every RDATA length) without allocating. Once constructed, the header
+ * accessors and the section iterators read the wire bytes in place and cannot fail. The view does not own
+ * the bytes, so the datagram must outlive it.
+ */
+class PacketView {
+private:
+   std::span<const Byte> m_Data;
+
+   size_t m_QuestionsOffset;
+   size_t m_AnswersOffset;
+   size_t m_AuthoritiesOffset;
+   size_t m_AdditionalsOffset;
+   size_t m_EndOffset;
+
+public:
+   /* Section iteration */
+
+   template<typename T>
+   class Section {
+   public:
+      class iterator {
+      private:
+         std::span<const Byte> m_Data;
+         size_t                m_Position;
+         uint16_t              m_Remaining;
+
+      public:
+         using value_type        = T;
+         using difference_type   = std::ptrdiff_t;
+         using iterator_category = std::forward_iterator_tag;
+
+         iterator() : m_Data(), m_Position(0), m_Remaining(0) {}
+         iterator(std::span<const Byte> data, size_t position, uint16_t remaining)
+             : m_Data(data), m_Position(position), m_Remaining(remaining) {}
+
+         T
+         operator*() const;
+
+         iterator &
+         operator++();
+
+         iterator
+         operator++(int) {
+            auto copy = *this;
+            ++*this;
+            return copy;
+         }
+
+         bool
+         operator==(const iterator &other) const {
+            return m_Remaining == other.m_Remaining;
+         }
+      };
+
+   private:
+      std::span<const Byte> m_Data;
+      size_t                m_Offset;
+      uint16_t              m_Count;
+
+   public:
+      Section(std::span<const Byte> data, size_t offset, uint16_t count)
+          : m_Data(data), m_Offset(offset), m_Count(count) {}
+
+      iterator
+      begin() const {
+         return iterator(m_Data, m_Offset, m_Count);
+      }
+
+      iterator
+      end() const {
+         return iterator(m_Data, m_Offset, 0);
+      }
+
+      size_t
+      size() const {
+         return m_Count;
+      }
+
+      bool
+      empty() const {
+         return m_Count == 0;
+      }
+   };
+
+public:
+   PacketView() = delete;
+   ~PacketView() = default;
+
+   static Result<PacketView>
+   from_bytes(std::span<const Byte> data);
+
+   /* Header */
+
+   uint16_t
+   id() const;
+
+   bool
+   query_response() const;
+
+   uint8_t
+   op_code() const;
+
+   bool
+   authoritative_answer() const;
+
+   bool
+   truncated_message() const;
+
+   bool
+   recursion_desired() const;
+
+   bool
+   recursion_available() const;
+
+   uint8_t
+   reserved() const;
+
+   PacketHeader::ResultCode
+   response_code() const;
+
+   uint16_t
+   question_count() const;
+
+   uint16_t
+   answer_count() const;
+
+   uint16_t
+   authority_count() const;
+
+   uint16_t
+   additional_count() const;
+
+   PacketHeader
+   to_header() const;
+
+   /* Sections */
+
+   Section<QuestionView>
+   questions() const;
+
+   Section<RecordView>
+   answers() const;
+
+   Section<RecordView>
+   authorities() const;
+
+   Section<RecordView>
+   additionals() const;
+
+   /**
+    * Largest UDP payload the sender takes, as advertised by the OPT pseudo-record of the message (RFC
+    * 6891). Nothing when it has no OPT record.
+    */
+   std::optional<uint16_t>
+   get_udp_payload_size() const;
+
+   /**
+    * Raw bytes of the question section. Question names can only point into the header or the question
+    * section itself, so the bytes can be copied verbatim to the same offset of a response.
+    */
+   std::span<const Byte>
+   get_question_bytes() const {
+      return m_Data.subspan(m_QuestionsOffset, m_AnswersOffset - m_QuestionsOffset);
+   }
+
+   /**
+    * Bytes of the message covered by the header and the four sections. Anything after it is trailing
+    * garbage that was ignored.
+    */
+   size_t
+   get_size() const {
+      return m_EndOffset;
+   }
+
+   std::span<const Byte>
+   get_data() const {
+      return m_Data;
+   }
+
+private:
+   PacketView(std::span<const Byte> data);
+
+   static Result<size_t>
+   skip_name(std::span<const Byte> data, size_t position);
+
+   static size_t
+   unchecked_skip_name(std::span<const Byte> data, size_t position);
+
+   static size_t
+   decode(std::span<const Byte> data, size_t position, QuestionView &out);
+
+   static size_t
+   decode(std::span<const Byte> data, size_t position, RecordView &out);
+};
+
+/* ------------------------------------------------------------------------------------------------------- */
+
+template<typename T>
+T
+PacketView::Section<T>::iterator::operator*() const {
+   T value;
+   PacketView::decode(m_Data, m_Position, value);
+   return value;
+}
+
+/* ------------------------------------------------------------------------------------------------------- */
+
+template<typename T>
+typename PacketView::Section<T>::iterator &
+PacketView::Section<T>::iterator::operator++() {
+   T value;
+   m_Position = PacketView::decode(m_Data, m_Position, value);
+   m_Remaining--;
+   return *this;
+}
+
+/* ------------------------------------------------------------------------------------------------------- */
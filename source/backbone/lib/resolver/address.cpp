@@ -0,0 +1,122 @@
+#include "address.hpp"
+
+#include <cstring>
+#include <arpa/inet.h>
+#include <netinet/in.h>
+
+/* ------------------------------------------------------------------------------------------------------- */
+
+Result<ServerAddress>
+ServerAddress::parse(const std::string &text, uint16_t default_port) {
+   std::string host = text;
+   uint16_t    port = default_port;
+
+   /* Split off the port: "[v6]:port" or "v4:port". A bare IPv6 address has more than one colon */
+   size_t colon = text.rfind(':');
+   if (!text.empty() && text.front() == '[') {
+      size_t close = text.find(']');
+      if (close == std::string::npos) {
+         return Error("Invalid server address: " + text);
+      }
+      host = text.substr(1, close - 1);
+      if (close + 1 < text.size()) {
+         if (text[close + 1] != ':') {
+            return Error("Invalid server address: " + text);
+         }
+         colon = close + 1;
+      } else {
+         colon = std::string::npos;
+      }
+   } else if (colon != std::string::npos && text.find(':') == colon) {
+      host = text.substr(0, colon);
+   } else {
+      colon = std::string::npos;
+   }
+
+   if (colon != std::string::npos) {
+      char         *end   = nullptr;
+      unsigned long value = strtoul(text.c_str() + colon + 1, &end, 10);
+      if (end == text.c_str() + colon + 1 || *end != '\0' || value == 0 || value > UINT16_MAX) {
+         return Error("Invalid port in server address: " + text);
+      }
+      port = value;
+   }
+
+   ServerAddress address;
+   auto         *v4 = reinterpret_cast<sockaddr_in *>(&address.storage);
+   auto         *v6 = reinterpret_cast<sockaddr_in6 *>(&address.storage);
+   if (inet_pton(AF_INET, host.c_str(), &v4->sin_addr) == 1) {
+      v4->sin_family = AF_INET;
+      v4->sin_port   = htons(port);
+      address.length = sizeof(sockaddr_in);
+   } else if (inet_pton(AF_INET6, host.c_str(), &v6->sin6_addr) == 1) {
+      v6->sin6_family = AF_INET6;
+      v6->sin6_port   = htons(port);
+      address.length  = sizeof(sockaddr_in6);
+   } else {
+      return Error("Invalid server address: " + text);
+   }
+
+   return address;
+}
+
+/* ------------------------------------------------------------------------------------------------------- */
+
+Result<ServerAddress>
+ServerAddress::from_rdata(std::span<const Byte> rdata, uint16_t port) {
+   ServerAddress address;
+   if (rdata.size() == 4) {
+      auto *v4       = reinterpret_cast<sockaddr_in *>(&address.storage);
+      v4->sin_family = AF_INET;
+      v4->sin_port   = htons(port);
+      std::memcpy(&v4->sin_addr, rdata.data(), 4);
+      address.length = sizeof(sockaddr_in);
+   } else if (rdata.size() == 16) {
+      auto *v6        = reinterpret_cast<sockaddr_in6 *>(&address.storage);
+      v6->sin6_family = AF_INET6;
+      v6->sin6_port   = htons(port);
+      std::memcpy(&v6->sin6_addr, rdata.data(), 16);
+      address.length = sizeof(sockaddr_in6);
+   } else {
+      return Error("Address records hold 4 or 16 bytes");
+   }
+
+   return address;
+}
+
+/* ------------------------------------------------------------------------------------------------------- */
+
+bool
+ServerAddress::matches(const sockaddr_storage &peer) const {
+   if (peer.ss_family != storage.ss_family) {
+      return false;
+   }
+
+   if (storage.ss_family == AF_INET) {
+      auto *a = reinterpret_cast<const sockaddr_in *>(&storage);
+      auto *b = reinterpret_cast<const sockaddr_in *>(&peer);
+      return a->sin_port == b->sin_port && a->sin_addr.s_addr == b->sin_addr.s_addr;
+   }
+
+   auto *a = reinterpret_cast<const sockaddr_in6 *>(&storage);
+   auto *b = reinterpret_cast<const sockaddr_in6 *>(&peer);
+   return a->sin6_port == b->sin6_port && std::memcmp(&a->sin6_addr, &b->sin6_addr, 16) == 0;
+}
+
+/* ------------------------------------------------------------------------------------------------------- */
+
+std::string
+ServerAddress::to_string() const {
+   char text[INET6_ADDRSTRLEN] = {};
+   if (storage.ss_family == AF_INET) {
+      auto *v4 = reinterpret_cast<const sockaddr_in *>(&storage);
+      inet_ntop(AF_INET, &v4->sin_addr, text, sizeof(text));
+      return std::string(text) + ":" + std::to_string(ntohs(v4->sin_port));
+   }
+
+   auto *v6 = reinterpret_cast<const sockaddr_in6 *>(&storage);
+   inet_ntop(AF_INET6, &v6->sin6_addr, text, sizeof(text));
+   return "[" + std::string(text) + "]:" + std::to_string(ntohs(v6->sin6_port));
+}
+
+/* ------------------------------------------------------------------------------------------------------- */
@@ -0,0 +1,56 @@
+#pragma once
+
+#include <cstdint>
+#include <span>
+#include <string>
+#include <sys/socket.h>
+
+#include <backbone/core/pch>
+
+/* ------------------------------------------------------------------------------------------------------- */
+
+/**
+ * @brief
+ * IPv4 or IPv6 address and port of an upstream server.
+ */
+class ServerAddress {
+public:
+   sockaddr_storage storage;
+   socklen_t        length;
+
+public:
+   ServerAddress() : storage(), length(0) {}
+
+   /**
+    * Parses "192.0.2.1", "192.0.2.1:5300", "2001:db8::1" or "[2001:db8::1]:5300".
+    */
+   static Result<ServerAddress>
+   parse(const std::string &text, uint16_t default_port = 53);
+
+   /**
+    * Address held by the RDATA of an A (4 bytes) or AAAA (16 bytes) record.
+    */
+   static Result<ServerAddress>
+   from_rdata(std::span<const Byte> address, uint16_t port = 53);
+
+   int
+   get_family() const {
+      return storage.ss_family;
+   }
+
+   const sockaddr *
+   get() const {
+      return reinterpret_cast<const sockaddr *>(&storage);
+   }
+
+   /**
+    * Whether `peer` (as filled in by `recvfrom`) is this address, port included.
+    */
+   bool
+   matches(const sockaddr_storage &peer) const;
+
+   std::string
+   to_string() const;
+};
+
+/* ------------------------------------------------------------------------------------------------------- */
@@ -0,0 +1,232 @@
+#include "forwarder.hpp"
+
+#include <algorithm>
+#include <cmath>
+
+/* ------------------------------------------------------------------------------------------------------- */
+
+ForwarderPool::ForwarderPool(ForwarderConfig config, std::chrono::milliseconds timeout)
+    : m_Config(std::move(config)), m_Timeout(timeout) {}
+
+/* ------------------------------------------------------------------------------------------------------- */
+
+Result<ForwarderPool>
+ForwarderPool::create(ForwarderConfig config, std::chrono::milliseconds timeout) {
+   auto pool = ForwarderPool(std::move(config), timeout);
+
+   for (const auto &text : pool.m_Config.servers) {
+      auto address = ServerAddress::parse(text);
+      RETURN_IF_ERROR(address);
+
+      pool.m_Servers.push_back(Server {
+          .address     = address.get_value(),
+          .srtt        = 0,
+          .rttvar      = 0,
+          .loss        = 0,
+          .measured    = false,
+          .updated_at  = TimePoint(),
+          .outstanding = 0,
+          .failures    = 0,
+          .down_until  = TimePoint(),
+          .backoff     = pool.m_Config.min_backoff,
+          .probing     = false,
+      });
+   }
+   if (pool.m_Servers.empty()) {
+      return Error("The forwarder pool needs at least one server");
+   }
+
+   return pool;
+}
+
+/* ------------------------------------------------------------------------------------------------------- */
+
+size_t
+ForwarderPool::pick(TimePoint now, std::span<const size_t> exclude) const {
+   size_t best      = NONE;
+   double best_cost = 0;
+   size_t wake      = NONE;   // down server due for a probe first
+
+   for (size_t i = 0; i < m_Servers.size(); i++) {
+      if (std::find(exclude.begin(), exclude.end(), i) != exclude.end()) {
+         continue;
+      }
+
+      if (is_down(i, now)) {
+         if (wake == NONE || m_Servers[i].down_until < m_Servers[wake].down_until) {
+            wake = i;
+         }
+         continue;
+      }
+
+      double cost = get_score(m_Servers[i], now);
+      if (best == NONE || cost < best_cost) {
+         best      = i;
+         best_cost = cost;
+      }
+   }
+
+   return best != NONE ? best : wake;
+}
+
+/* ------------------------------------------------------------------------------------------------------- */
+
+std::chrono::milliseconds
+ForwarderPool::get_race_delay(size_t server, TimePoint now) const {
+   return get_race_delay(m_Servers[server], now);
+}
+
+/* ------------------------------------------------------------------------------------------------------- */
+
+std::chrono::milliseconds
+ForwarderPool::get_race_delay(const Server &entry, TimePoint now) const {
+   if (!entry.measured) {
+      return m_Config.max_race_delay;
+   }
+
+   double srtt = get_srtt(entry, now);
+   auto   rto  = std::chrono::milliseconds(static_cast<int64_t>(std::ceil(srtt + 4 * entry.rttvar)));
+   return std::clamp(rto, m_Config.min_race_delay, m_Config.max_race_delay);
+}
+
+/* ------------------------------------------------------------------------------------------------------- */
+
+size_t
+ForwarderPool::find(const ServerAddress &address) const {
+   for (size_t i = 0; i < m_Servers.size(); i++) {
+      if (m_Servers[i].address.matches(address.storage)) {
+         return i;
+      }
+   }
+   return NONE;
+}
+
+/* ------------------------------------------------------------------------------------------------------- */
+
+void
+ForwarderPool::on_query(size_t server, TimePoint now) {
+   auto &entry = m_Servers[server];
+   entry.outstanding++;
+   entry.queries++;
+
+   // A server that was down only gets this one probe until it is known how the probe went
+   if (entry.failures >= m_Config.down_after) {
+      entry.down_until = now + m_Timeout;
+      entry.probing    = true;
+   }
+}
+
+/* ------------------------------------------------------------------------------------------------------- */
+
+void
+ForwarderPool::on_response(size_t server, std::chrono::microseconds rtt, TimePoint now) {
+   auto &entry = m_Servers[server];
+   decay(entry, now);
+   on_sample(entry, rtt);
+   on_settled(entry);
+
+   entry.loss     = 0.875 * entry.loss;
+   entry.failures = 0;
+   entry.backoff  = m_Config.min_backoff;
+   entry.probing  = false;
+   entry.responses++;
+}
+
+/* ------------------------------------------------------------------------------------------------------- */
+
+void
+ForwarderPool::on_timeout(size_t server, TimePoint now) {
+   auto &entry = m_Servers[server];
+   decay(entry, now);
+   on_settled(entry);
+
+   entry.loss = 0.875 * entry.loss + 0.125;
+   entry.failures++;
+   entry.timeouts++;
+
+   // Down now, or still down after a failed probe: stay away for longer every time. Queries sent before
+   // the server went down that time out after it did tell nothing new and leave the backoff alone.
+   if (entry.failures == m_Config.down_after || entry.probing) {
+      entry.down_until = now + entry.backoff;
+      entry.backoff    = std::min(entry.backoff * 2, m_Config.max_backoff);
+      entry.probing    = false;
+   }
+}
+
+/* ------------------------------------------------------------------------------------------------------- */
+
+void
+ForwarderPool::on_sample(Server &server, std::chrono::microseconds rtt) {
+   double sample = rtt.count() / 1000.0;
+
+   if (!server.measured) {
+      server.srtt     = sample;
+      server.rttvar   = sample / 2;
+      server.measured = true;
+   } else {
+      server.rttvar = 0.75 * server.rttvar + 0.25 * std::abs(server.srtt - sample);
+      server.srtt   = 0.875 * server.srtt + 0.125 * sample;
+   }
+}
+
+/* ------------------------------------------------------------------------------------------------------- */
+
+void
+ForwarderPool::on_settled(Server &server) {
+   if (server.outstanding > 0) {
+      server.outstanding--;
+   }
+}
+
+/* ------------------------------------------------------------------------------------------------------- */
+
+double
+ForwarderPool::get_decay(const Server &server, TimePoint now) {
+   double elapsed = std::chrono::duration<double>(now - server.updated_at).count();
+   return std::exp2(-std::max(elapsed, 0.0) / DECAY_HALF_LIFE.count());
+}
+
+/* ------------------------------------------------------------------------------------------------------- */
+
+double
+ForwarderPool::get_floor() const {
+   double floor = INFINITY;
+   for (const auto &server : m_Servers) {
+      if (server.measured) {
+         floor = std::min(floor, server.srtt);
+      }
+   }
+   return floor;
+}
+
+/* ------------------------------------------------------------------------------------------------------- */
+
+double
+ForwarderPool::get_srtt(const Server &server, TimePoint now) const {
+   // Toward the fastest server rather than toward zero, which would have old samples look the best
+   double floor = get_floor();
+   return floor + (server.srtt - floor) * get_decay(server, now);
+}
+
+/* ------------------------------------------------------------------------------------------------------- */
+
+void
+ForwarderPool::decay(Server &server, TimePoint now) {
+   if (server.measured) {
+      server.srtt = get_srtt(server, now);
+   }
+   server.loss       *= get_decay(server, now);
+   server.updated_at = now;
+}
+
+/* ------------------------------------------------------------------------------------------------------- */
+
+double
+ForwarderPool::get_score(const Server &server, TimePoint now) const {
+   // Until the first sample is in, a server has to wait for it like everybody else
+   double srtt = server.measured ? get_srtt(server, now) : server.outstanding > 0 ? m_Timeout.count() : 0;
+   double lost = m_Config.race ? get_race_delay(server, now).count() : m_Timeout.count();
+   return srtt + get_decay(server, now) * server.loss * lost;
+}
+
+/* ------------------------------------------------------------------------------------------------------- */
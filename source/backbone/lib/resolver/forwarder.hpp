@@ -0,0 +1,209 @@
+#pragma once
+
+#include <chrono>
+#include <cstdint>
+#include <span>
+#include <string>
+#include <vector>
+
+#include <backbone/core/pch>
+#include "address.hpp"
+
+/* ------------------------------------------------------------------------------------------------------- */
+
+class ForwarderConfig {
+public:
+   /**
+    * Upstream resolvers, "address[:port]". Empty to resolve iteratively from the root instead.
+    */
+   std::vector<std::string> servers;
+
+   /**
+    * Send the query to the second best server as well when the best one is late to answer.
+    */
+   bool race = true;
+
+   /**
+    * Bounds of how long to wait for the best server before racing the second one.
+    */
+   std::chrono::milliseconds min_race_delay = std::chrono::milliseconds(5);
+   std::chrono::milliseconds max_race_delay = std::chrono::milliseconds(300);
+
+   /**
+    * Consecutive timeouts after which a server is marked down.
+    */
+   size_t down_after = 3;
+
+   /**
+    * A server marked down is left alone for this long before it gets a probe, doubling (up to the
+    * maximum) every time the probe fails as well.
+    */
+   std::chrono::milliseconds min_backoff = std::chrono::seconds(1);
+   std::chrono::milliseconds max_backoff = std::chrono::seconds(60);
+};
+
+/* ------------------------------------------------------------------------------------------------------- */
+
+/**
+ * @brief
+ * Health and speed of every upstream resolver the `Resolver` forwards to, deciding who gets each query.
+ *
+ * @details
+ * Round trip times are smoothed the way TCP does it (RFC 6298): `srtt` follows the samples with a gain of
+ * 1/8 and `rttvar` their deviation with a gain of 1/4. Timeouts feed an exponentially weighted loss rate
+ * with the same gain. A server is ranked by the latency it can be expected to deliver, its `srtt` plus
+ * what a lost query costs weighed by its loss rate. That cost is the query timeout, or only the race
+ * delay when racing, so a lossy server only falls behind a slower but reliable one when its losses
+ * actually hurt more than the slower answers would. The samples of a server age with the time since they
+ * were taken: its loss decays toward none, and its `srtt` toward the lowest `srtt` in the pool. Old losses
+ * are forgiven after a while and a server that was slow once is not held to its old samples forever, yet
+ * it never ranks ahead of a server measured to be faster, as it would if its `srtt` decayed toward zero.
+ * How fast that happens depends on time alone, not on how many queries the pool sends. Servers without a
+ * sample yet rank first, one query at a time, which gets every server measured early on.
+ *
+ * A server that keeps timing out is marked down and skipped until its backoff runs out. It then gets a
+ * single probe: an answer brings it back, another timeout doubles the backoff. When every server is down
+ * the one due for a probe first is used anyway, forwarding never stops altogether.
+ *
+ * The pool is only ever used from the resolver's thread.
+ */
+class ForwarderPool {
+public:
+   using Clock     = std::chrono::steady_clock;
+   using TimePoint = Clock::time_point;
+
+   static constexpr size_t NONE = SIZE_MAX;
+
+   /**
+    * Time it takes the loss of a server, and the distance of its `srtt` to the lowest one in the pool, to
+    * decay to half while it gets no new samples.
+    */
+   static constexpr std::chrono::seconds DECAY_HALF_LIFE = std::chrono::seconds(10);
+
+   class Server {
+   public:
+      ServerAddress address;
+
+      double srtt;     // milliseconds
+      double rttvar;   // milliseconds
+      double loss;     // fraction of recent queries that timed out
+      bool   measured;
+
+      TimePoint updated_at;   // `srtt` and `loss` are as of then, decaying since
+
+      size_t                    outstanding;   // queries in flight
+      size_t                    failures;      // consecutive timeouts
+      TimePoint                 down_until;
+      std::chrono::milliseconds backoff;
+      bool                      probing;       // sent a probe while down, waiting to hear how it went
+
+      uint64_t queries   = 0;
+      uint64_t responses = 0;
+      uint64_t timeouts  = 0;
+   };
+
+private:
+   ForwarderConfig           m_Config;
+   std::chrono::milliseconds m_Timeout;
+   std::vector<Server>       m_Servers;
+
+public:
+   /**
+    * Pool of `config.servers`. `timeout` is how long a single upstream query is given.
+    */
+   static Result<ForwarderPool>
+   create(ForwarderConfig config, std::chrono::milliseconds timeout);
+
+   /**
+    * Best server to send the next query to, leaving out those in `exclude`, or `NONE` once every server
+    * has been excluded.
+    */
+   size_t
+   pick(TimePoint now, std::span<const size_t> exclude = {}) const;
+
+   /**
+    * How long to wait for `server` before racing the query to the next best server: its retransmission
+    * timeout (`srtt + 4 * rttvar`, with `srtt` decayed to `now`), within the configured bounds.
+    */
+   std::chrono::milliseconds
+   get_race_delay(size_t server, TimePoint now) const;
+
+   /**
+    * Index of the server at `address`, or `NONE`.
+    */
+   size_t
+   find(const ServerAddress &address) const;
+
+   void
+   on_query(size_t server, TimePoint now);
+
+   void
+   on_response(size_t server, std::chrono::microseconds rtt, TimePoint now);
+
+   void
+   on_timeout(size_t server, TimePoint now);
+
+   bool
+   is_down(size_t server, TimePoint now) const {
+      return m_Servers[server].failures >= m_Config.down_after && now < m_Servers[server].down_until;
+   }
+
+   const ForwarderConfig &
+   get_config() const {
+      return m_Config;
+   }
+
+   const std::vector<Server> &
+   get_servers() const {
+      return m_Servers;
+   }
+
+   size_t
+   get_size() const {
+      return m_Servers.size();
+   }
+
+private:
+   ForwarderPool(ForwarderConfig config, std::chrono::milliseconds timeout);
+
+   static void
+   on_sample(Server &server, std::chrono::microseconds rtt);
+
+   static void
+   on_settled(Server &server);
+
+   /**
+    * Factor the samples of `server` have decayed by at `now`.
+    */
+   static double
+   get_decay(const Server &server, TimePoint now);
+
+   /**
+    * Lowest `srtt` of the measured servers, which every other `srtt` decays toward.
+    */
+   double
+   get_floor() const;
+
+   /**
+    * `srtt` of a measured `server` as of `now`.
+    */
+   double
+   get_srtt(const Server &server, TimePoint now) const;
+
+   /**
+    * Applies the decay up to `now` to the `srtt` and loss of `server`, before they get a new sample.
+    */
+   void
+   decay(Server &server, TimePoint now);
+
+   std::chrono::milliseconds
+   get_race_delay(const Server &server, TimePoint now) const;
+
+   /**
+    * Expected latency of a query sent to `server` at `now`, in milliseconds.
+    */
+   double
+   get_score(const Server &server, TimePoint now) const;
+};
+
+/* ------------------------------------------------------------------------------------------------------- */
@@ -0,0 +1,1011 @@
+#include "resolver.hpp"
+
+#include <algorithm>
+#include <cerrno>
+#include <cstring>
+#include <random>
+#include <sys/epoll.h>
+#include <sys/eventfd.h>
+#include <unistd.h>
+
+/* ------------------------------------------------------------------------------------------------------- */
+
+Resolver::Resolver(ResolverConfig config, AnswerCache *cache, AnswerCache *negative_cache)
+    : m_Config(std::move(config)), m_Cache(cache), m_NegativeCache(negative_cache), m_Wakeup(-1), m_Epoll(-1),
+      m_NextId(1), m_Random(std::random_device()()), m_Waiting(0), m_Message(BufferPool::TCP_SIZE),
+      m_Response(BufferPool::TCP_SIZE), m_Running(false), m_Requests(0), m_Coalesced(0), m_CacheHits(0),
+      m_Started(0), m_Refreshed(0), m_Failures(0), m_Raced(0), m_RacesWon(0), m_Queries(0), m_Responses(0),
+      m_Timeouts(0), m_Mismatched(0), m_Tcp(0) {}
+
+/* ------------------------------------------------------------------------------------------------------- */
+
+Resolver::~Resolver() {
+   stop();
+
+   // Resolutions hold on to the transport's handles, drop them first
+   m_Resolutions.clear();
+   m_Transport.reset();
+
+   if (m_Epoll >= 0) {
+      ::close(m_Epoll);
+   }
+   if (m_Wakeup >= 0) {
+      ::close(m_Wakeup);
+   }
+}
+
+/* ------------------------------------------------------------------------------------------------------- */
+
+Result<UniqueRef<Resolver>>
+Resolver::create(ResolverConfig config, AnswerCache *cache, AnswerCache *negative_cache) {
+   auto resolver = UniqueRef<Resolver>(new Resolver(std::move(config), cache, negative_cache));
+
+   for (const auto &hint : resolver->m_Config.root_hints) {
+      auto address = ServerAddress::parse(hint);
+      RETURN_IF_ERROR(address);
+      resolver->m_Roots.push_back(address.get_value());
+   }
+   if (resolver->m_Roots.empty()) {
+      return Error("The resolver needs at least one root hint");
+   }
+
+   if (!resolver->m_Config.forward.servers.empty()) {
+      auto pool = ForwarderPool::create(resolver->m_Config.forward, resolver->m_Config.query_timeout);
+      RETURN_IF_ERROR(pool);
+      resolver->m_Forwarders = std::move(pool.get_value());
+   }
+
+   auto transport = UpstreamTransport::create(*resolver, resolver->m_Config.sockets);
+   RETURN_IF_ERROR(transport);
+   resolver->m_Transport = std::move(transport.get_value());
+
+   resolver->m_Wakeup = eventfd(0, EFD_NONBLOCK | EFD_CLOEXEC);
+   resolver->m_Epoll  = epoll_create1(EPOLL_CLOEXEC);
+   if (resolver->m_Wakeup < 0 || resolver->m_Epoll < 0) {
+      return Error(std::string("Failed to set up the resolver's event loop: ") + strerror(errno));
+   }
+
+   auto fds = resolver->m_Transport->get_fds();
+   fds.push_back(resolver->m_Wakeup);
+   for (int fd : fds) {
+      epoll_event event { .events = EPOLLIN, .data = { .fd = fd } };
+      if (epoll_ctl(resolver->m_Epoll, EPOLL_CTL_ADD, fd, &event) < 0) {
+         return Error(std::string("Failed to watch upstream socket: ") + strerror(errno));
+      }
+   }
+
+   return resolver;
+}
+
+/* ------------------------------------------------------------------------------------------------------- */
+
+void
+Resolver::start() {
+   if (!m_Running.exchange(true)) {
+      m_Thread = std::thread([this]() { run(); });
+   }
+}
+
+/* ------------------------------------------------------------------------------------------------------- */
+
+void
+Resolver::stop() {
+   m_Running.store(false);
+   if (m_Thread.joinable()) {
+      m_Thread.join();
+   }
+}
+
+/* ------------------------------------------------------------------------------------------------------- */
+
+void
+Resolver::resolve(CacheKey key, Waiter waiter) {
+   m_Requests.fetch_add(1, std::memory_order_relaxed);
+
+   bool wake;
+   {
+      std::lock_guard<std::mutex> lock(m_Mutex);
+      wake = m_Submitted.empty() && m_Refreshes.empty();
+      m_Submitted.emplace_back(std::move(key), std::move(waiter));
+   }
+
+   // Only the first submission of a batch needs to wake the resolver up
+   if (wake) {
+      uint64_t one = 1;
+      [[maybe_unused]] ssize_t written = write(m_Wakeup, &one, sizeof(one));
+   }
+}
+
+/* ------------------------------------------------------------------------------------------------------- */
+
+void
+Resolver::refresh(CacheKey key) {
+   bool wake;
+   {
+      std::lock_guard<std::mutex> lock(m_Mutex);
+      wake = m_Submitted.empty() && m_Refreshes.empty();
+      m_Refreshes.push_back(std::move(key));
+   }
+
+   if (wake) {
+      uint64_t one = 1;
+      [[maybe_unused]] ssize_t written = write(m_Wakeup, &one, sizeof(one));
+   }
+}
+
+/* ------------------------------------------------------------------------------------------------------- */
+
+void
+Resolver::run() {
+   std::array<epoll_event, MAX_EVENTS> events;
+
+   while (m_Running.load(std::memory_order_relaxed)) {
+      auto now  = Clock::now();
+      auto wait = m_Transport->get_wait(now, std::chrono::milliseconds(100));
+      if (!m_Races.empty()) {
+         auto until = std::chrono::ceil<std::chrono::milliseconds>(m_Races.top().at - now);
+         wait       = std::clamp(until, std::chrono::milliseconds(0), wait);
+      }
+
+      int count = epoll_wait(m_Epoll, events.data(), MAX_EVENTS, wait.count());
+
+      for (int i = 0; i < count; i++) {
+         if (events[i].data.fd == m_Wakeup) {
+            take_submissions();
+         } else {
+            m_Transport->receive(events[i].data.fd);
+         }
+      }
+
+      now = Clock::now();
+      m_Transport->expire(now);
+      race(now);
+      expire(now);
+
+      const auto &stats = m_Transport->get_stats();
+      m_Queries.store(stats.queries, std::memory_order_relaxed);
+      m_Responses.store(stats.responses, std::memory_order_relaxed);
+      m_Timeouts.store(stats.timeouts, std::memory_order_relaxed);
+      m_Mismatched.store(stats.mismatched, std::memory_order_relaxed);
+      m_Tcp.store(stats.tcp, std::memory_order_relaxed);
+   }
+}
+
+/* ------------------------------------------------------------------------------------------------------- */
+
+void
+Resolver::take_submissions() {
+   uint64_t                 value;
+   [[maybe_unused]] ssize_t count = read(m_Wakeup, &value, sizeof(value));
+
+   std::vector<std::pair<CacheKey, Waiter>> submitted;
+   std::vector<CacheKey>                    refreshes;
+   {
+      std::lock_guard<std::mutex> lock(m_Mutex);
+      submitted.swap(m_Submitted);
+      refreshes.swap(m_Refreshes);
+   }
+
+   for (auto &[key, waiter] : submitted) {
+      submit(std::move(key), std::move(waiter));
+   }
+   for (auto &key : refreshes) {
+      submit_refresh(std::move(key));
+   }
+}
+
+/* ------------------------------------------------------------------------------------------------------- */
+
+void
+Resolver::submit(CacheKey key, Waiter waiter) {
+   /* Join the resolution in flight for the same question */
+   auto it = m_InFlight.find(key);
+   if (it != m_InFlight.end()) {
+      m_Resolutions.at(it->second)->waiters.push_back(std::move(waiter));
+      m_Waiting++;
+      m_Coalesced.fetch_add(1, std::memory_order_relaxed);
+      return;
+   }
+
+   /* The answer may have arrived since the worker missed it */
+   auto reply_cached = [&](const CachedAnswer &answer, uint32_t ttl) {
+      if (answer.wire) {
+         reply(waiter, answer.wire.value(), ttl);
+      }
+   };
+   if ((m_Cache && m_Cache->visit(key, reply_cached)) ||
+       (m_NegativeCache && m_NegativeCache->visit(key, reply_cached))) {
+      m_CacheHits.fetch_add(1, std::memory_order_relaxed);
+      return;
+   }
+
+   if (m_Waiting >= m_Config.max_waiters) {
+      reply_error(waiter, PacketHeader::SERVER_FAILURE);
+      return;
+   }
+
+   auto &resolution = create_resolution(key, 0);
+   resolution.waiters.push_back(std::move(waiter));
+   m_Waiting++;
+   begin(resolution);
+}
+
+/* ------------------------------------------------------------------------------------------------------- */
+
+void
+Resolver::submit_refresh(CacheKey key) {
+   // Already being resolved, by a client that missed it or an earlier refresh
+   if (m_InFlight.contains(key)) {
+      return;
+   }
+
+   // The cache still has the entry, so unlike `submit` this goes upstream without looking there first
+   m_Refreshed.fetch_add(1, std::memory_order_relaxed);
+   begin(create_resolution(key, 0));
+}
+
+/* ------------------------------------------------------------------------------------------------------- */
+
+Resolver::Resolution &
+Resolver::create_resolution(const CacheKey &key, size_t depth) {
+   uint64_t id         = m_NextId++;
+   auto     resolution = CreateUniqueRef<Resolution>(Resolution {
+       .id          = id,
+       .key         = key,
+       .depth       = depth,
+       .name        = key.name,
+       .chain       = {},
+       .zone        = DomainName(),
+       .servers     = {},
+       .next_server = 0,
+       .nameservers = {},
+       .queries     = 0,
+       .transaction = 0,
+       .attempts    = {},
+       .tried       = {},
+       .waiters     = {},
+       .dependents  = {},
+   });
+
+   auto &result = *resolution;
+   m_Resolutions.emplace(id, std::move(resolution));
+   m_InFlight.emplace(key, id);
+   m_Deadlines.emplace_back(Clock::now() + m_Config.resolution_timeout, id);
+   m_Started.fetch_add(1, std::memory_order_relaxed);
+   return result;
+}
+
+/* ------------------------------------------------------------------------------------------------------- */
+
+Resolver::Resolution *
+Resolver::find(uint64_t id) {
+   auto it = m_Resolutions.find(id);
+   return it == m_Resolutions.end() ? nullptr : it->second.get();
+}
+
+/* ------------------------------------------------------------------------------------------------------- */
+
+void
+Resolver::begin(Resolution &resolution) {
+   if (m_Forwarders) {
+      forward(resolution);
+      return;
+   }
+
+   auto now = Clock::now();
+
+   resolution.zone    = DomainName();
+   resolution.servers = m_Roots;
+   resolution.nameservers.clear();
+
+   // Longest suffix of the name (the name itself included) that is a known zone cut
+   for (size_t i = 0; i < resolution.name.get_label_count(); i++) {
+      auto it = m_Delegations.find(resolution.name.get_suffix(i));
+      if (it != m_Delegations.end() && it->second.expires_at > now) {
+         resolution.zone    = it->first;
+         resolution.servers = it->second.servers;
+         break;
+      }
+   }
+
+   std::shuffle(resolution.servers.begin(), resolution.servers.end(), m_Random);
+   resolution.next_server = 0;
+   query(resolution);
+}
+
+/* ------------------------------------------------------------------------------------------------------- */
+
+void
+Resolver::query(Resolution &resolution) {
+   while (resolution.next_server < resolution.servers.size() && resolution.queries < m_Config.max_queries) {
+      const auto &server = resolution.servers[resolution.next_server++];
+
+      auto handle = m_Transport->send(server,
+                                      resolution.name,
+                                      resolution.key.type,
+                                      resolution.key.class_,
+                                      false,
+                                      m_Config.query_timeout,
+                                      resolution.id);
+      if (handle) {
+         resolution.transaction = handle.get_value();
+         resolution.queries++;
+         return;
+      }
+   }
+
+   if (!resolution.nameservers.empty() && resolution.queries < m_Config.max_queries) {
+      look_up_nameserver(resolution);
+      return;
+   }
+
+   fail(resolution);
+}
+
+/* ------------------------------------------------------------------------------------------------------- */
+
+void
+Resolver::look_up_nameserver(Resolution &resolution) {
+   while (!resolution.nameservers.empty() && resolution.depth < MAX_DEPTH) {
+      auto key = CacheKey(std::move(resolution.nameservers.back()), PacketQuestion::A, 1);
+      resolution.nameservers.pop_back();
+
+      // Addresses resolved earlier are still in the cache
+      std::vector<PacketRecord> answers;
+      if (m_Cache) {
+         m_Cache->visit(key, [&](const CachedAnswer &answer, uint32_t) { answers = answer.records; });
+      }
+      if (!answers.empty()) {
+         on_nameserver(resolution.id, answers);
+         return;
+      }
+
+      auto it = m_InFlight.find(key);
+      if (it != m_InFlight.end()) {
+         if (it->second == resolution.id) {
+            continue;   // the name server is what this resolution is looking for
+         }
+         m_Resolutions.at(it->second)->dependents.push_back(resolution.id);
+         return;
+      }
+
+      // Registered before it begins, the lookup may well fail right away
+      auto &lookup = create_resolution(key, resolution.depth + 1);
+      lookup.dependents.push_back(resolution.id);
+      begin(lookup);
+      return;
+   }
+
+   fail(resolution);
+}
+
+/* ------------------------------------------------------------------------------------------------------- */
+
+void
+Resolver::forward(Resolution &resolution) {
+   auto now = Clock::now();
+
+   while (resolution.queries < m_Config.max_queries) {
+      size_t server = m_Forwarders->pick(now, resolution.tried);
+      if (server == ForwarderPool::NONE) {
+         break;
+      }
+      resolution.tried.push_back(server);
+
+      auto handle = m_Transport->send(m_Forwarders->get_servers()[server].address,
+                                      resolution.name,
+                                      resolution.key.type,
+                                      resolution.key.class_,
+                                      true,
+                                      m_Config.query_timeout,
+                                      resolution.id);
+      if (!handle) {
+         continue;
+      }
+      m_Forwarders->on_query(server, now);
+      resolution.queries++;
+      resolution.attempts.push_back(Attempt { handle.get_value(), server, now });
+
+      // Only the first query of a resolution is raced, and only if there is anyone left to race it to
+      bool can_race = resolution.tried.size() < m_Forwarders->get_size();
+      if (m_Forwarders->get_config().race && resolution.attempts.size() == 1 && can_race) {
+         auto at = now + m_Forwarders->get_race_delay(server, now);
+         m_Races.push(Race { at, resolution.id, handle.get_value() });
+      }
+      return;
+   }
+
+   if (resolution.attempts.empty()) {
+      fail(resolution);
+   }
+}
+
+/* ------------------------------------------------------------------------------------------------------- */
+
+std::optional<Resolver::Attempt>
+Resolver::take_attempt(std::vector<Attempt> &attempts, const ServerAddress &server) {
+   size_t index = m_Forwarders->find(server);
+   auto   it    = std::find_if(
+       attempts.begin(), attempts.end(), [&](const Attempt &attempt) { return attempt.server == index; });
+   if (it == attempts.end()) {
+      return std::nullopt;
+   }
+
+   auto attempt = *it;
+   attempts.erase(it);
+   return attempt;
+}
+
+/* ------------------------------------------------------------------------------------------------------- */
+
+void
+Resolver::settle_straggler(uint64_t token, const ServerAddress &server, bool answered) {
+   auto it = m_Stragglers.find(token);
+   if (it == m_Stragglers.end()) {
+      return;
+   }
+
+   if (auto attempt = take_attempt(it->second, server)) {
+      auto now = Clock::now();
+      if (answered) {
+         auto rtt = std::chrono::duration_cast<std::chrono::microseconds>(now - attempt->sent_at);
+         m_Forwarders->on_response(attempt->server, rtt, now);
+      } else {
+         m_Forwarders->on_timeout(attempt->server, now);
+      }
+   }
+
+   if (it->second.empty()) {
+      m_Stragglers.erase(it);
+   }
+}
+
+/* ------------------------------------------------------------------------------------------------------- */
+
+void
+Resolver::retry(Resolution &resolution) {
+   if (!m_Forwarders) {
+      query(resolution);
+   } else if (resolution.attempts.empty()) {
+      forward(resolution);
+   }
+}
+
+/* ------------------------------------------------------------------------------------------------------- */
+
+void
+Resolver::race(TimePoint now) {
+   while (!m_Races.empty() && m_Races.top().at <= now) {
+      auto race = m_Races.top();
+      m_Races.pop();
+
+      // Nothing to do if the query has been answered, has timed out or is already being raced
+      auto *resolution = find(race.id);
+      if (!resolution || resolution->attempts.size() != 1 || resolution->attempts[0].handle != race.handle) {
+         continue;
+      }
+
+      m_Raced.fetch_add(1, std::memory_order_relaxed);
+      forward(*resolution);
+   }
+}
+
+/* ------------------------------------------------------------------------------------------------------- */
+
+void
+Resolver::on_nameserver(uint64_t id, const std::vector<PacketRecord> &answers) {
+   auto *resolution = find(id);
+   if (!resolution) {
+      return;
+   }
+
+   resolution->servers.clear();
+   resolution->next_server = 0;
+   for (const auto &record : answers) {
+      if (record.get_type() == PacketQuestion::A || record.get_type() == PacketQuestion::AAAA) {
+         auto address = ServerAddress::from_rdata(record.get_address(), m_Config.port);
+         if (address) {
+            resolution->servers.push_back(address.get_value());
+         }
+      }
+   }
+
+   query(*resolution);
+}
+
+/* ------------------------------------------------------------------------------------------------------- */
+
+void
+Resolver::on_response(uint64_t token, const ServerAddress &server, std::span<const Byte> response) {
+   auto *resolution = find(token);
+   if (!resolution) {
+      if (m_Forwarders) {
+         settle_straggler(token, server, true);
+      }
+      return;
+   }
+
+   if (!m_Forwarders) {
+      resolution->transaction = 0;
+   } else if (auto attempt = take_attempt(resolution->attempts, server)) {
+      auto now = Clock::now();
+      auto rtt = std::chrono::duration_cast<std::chrono::microseconds>(now - attempt->sent_at);
+      m_Forwarders->on_response(attempt->server, rtt, now);
+
+      // The query it was raced against is still waiting
+      if (!resolution->attempts.empty() && attempt->sent_at > resolution->attempts.front().sent_at) {
+         m_RacesWon.fetch_add(1, std::memory_order_relaxed);
+      }
+   }
+
+   // The transport has validated the message already, parsing it into the arena can't run off its end
+   m_Arena.reset();
+   std::memcpy(m_Message.get_data(), response.data(), response.size());
+   auto _ = m_Message.seek_read(0);
+
+   auto _packet = Packet::from_buffer(m_Message, m_Arena.get_allocator());
+   if (!_packet) {
+      retry(*resolution);
+      return;
+   }
+
+   if (m_Forwarders) {
+      process_forwarded(*resolution, _packet.get_value());
+   } else {
+      process(*resolution, _packet.get_value());
+   }
+}
+
+/* ------------------------------------------------------------------------------------------------------- */
+
+void
+Resolver::on_timeout(uint64_t token, const ServerAddress &server) {
+   auto *resolution = find(token);
+   if (!resolution) {
+      if (m_Forwarders) {
+         settle_straggler(token, server, false);
+      }
+      return;
+   }
+
+   if (!m_Forwarders) {
+      resolution->transaction = 0;
+   } else if (auto attempt = take_attempt(resolution->attempts, server)) {
+      m_Forwarders->on_timeout(attempt->server, Clock::now());
+   }
+   retry(*resolution);
+}
+
+/* ------------------------------------------------------------------------------------------------------- */
+
+void
+Resolver::process(Resolution &resolution, const Packet &response) {
+   // Whatever did not fit is missing, so a truncated response is only good for the referral it carries
+   if (response.header.truncated_message) {
+      if (response.answers.empty() && response.header.response_code == PacketHeader::NO_ERROR &&
+          follow_referral(resolution, response)) {
+         return;
+      }
+      query(resolution);
+      return;
+   }
+
+   auto code = response.header.response_code;
+   if (code == PacketHeader::NAME_ERROR) {
+      finish(resolution, PacketHeader::NAME_ERROR, {}, response.authorities);
+      return;
+   }
+   if (code != PacketHeader::NO_ERROR) {
+      query(resolution);   // lame, broken or refusing server
+      return;
+   }
+
+   /* Answers, following the CNAMEs the same response already resolves */
+   const auto &key      = resolution.key;
+   bool        followed = false;
+   while (true) {
+      std::vector<PacketRecord> answers;
+      const PacketRecord       *alias = nullptr;
+      for (const auto &record : response.answers) {
+         if (!(record.get_name() == resolution.name) || record.get_class() != key.class_) {
+            continue;
+         }
+         if (record.get_type() == key.type || key.type == PacketQuestion::ANY) {
+            answers.emplace_back(record, PacketRecord::allocator_type());
+         } else if (record.get_type() == PacketQuestion::CNAME) {
+            alias = &record;
+         }
+      }
+
+      if (!answers.empty()) {
+         finish(resolution, PacketHeader::NO_ERROR, answers, {});
+         return;
+      }
+      if (!alias || key.type == PacketQuestion::CNAME) {
+         break;
+      }
+
+      auto target = DomainName::from_wire(alias->get_target());
+      if (!target || resolution.chain.size() >= MAX_CNAMES) {
+         fail(resolution);
+         return;
+      }
+      resolution.chain.emplace_back(*alias, PacketRecord::allocator_type());
+      resolution.name = std::move(target.get_value());
+      followed        = true;
+   }
+
+   /* The rest of the chain may already be cached, or live in another zone altogether */
+   if (followed) {
+      std::vector<PacketRecord> cached;
+      if (m_Cache) {
+         auto target = CacheKey(resolution.name, key.type, key.class_);
+         m_Cache->visit(target, [&](const CachedAnswer &answer, uint32_t ttl) {
+            for (const auto &record : answer.records) {
+               auto &copy = cached.emplace_back(record, PacketRecord::allocator_type());
+               copy.set_ttl(std::min(copy.get_ttl(), ttl));
+            }
+         });
+      }
+
+      if (!cached.empty()) {
+         finish(resolution, PacketHeader::NO_ERROR, cached, {});
+      } else {
+         begin(resolution);
+      }
+      return;
+   }
+
+   if (follow_referral(resolution, response)) {
+      return;
+   }
+
+   /* No data: either the server says so with authority, or it is lame */
+   bool has_soa = std::any_of(response.authorities.begin(), response.authorities.end(), [](const auto &r) {
+      return r.get_type() == PacketQuestion::SOA;
+   });
+   if (has_soa || response.header.authoritative_answer) {
+      finish(resolution, PacketHeader::NO_ERROR, {}, response.authorities);
+      return;
+   }
+
+   query(resolution);
+}
+
+/* ------------------------------------------------------------------------------------------------------- */
+
+void
+Resolver::process_forwarded(Resolution &resolution, const Packet &response) {
+   // A forwarder answers with everything, the CNAMEs leading to the answer included
+   auto code = response.header.response_code;
+   if (code == PacketHeader::NAME_ERROR) {
+      finish(resolution, PacketHeader::NAME_ERROR, {}, response.authorities);
+   } else if (code == PacketHeader::NO_ERROR && !response.header.truncated_message) {
+      finish(resolution, PacketHeader::NO_ERROR, response.answers, response.authorities);
+   } else {
+      retry(resolution);
+   }
+}
+
+/* ------------------------------------------------------------------------------------------------------- */
+
+bool
+Resolver::follow_referral(Resolution &resolution, const Packet &response) {
+   /* Name servers of a zone between the current zone cut and the name */
+   const DomainName       *zone = nullptr;
+   std::vector<DomainName> targets;
+   uint32_t                ttl = UINT32_MAX;
+   for (const auto &record : response.authorities) {
+      if (record.get_type() != PacketQuestion::NS) {
+         continue;
+      }
+
+      const auto &owner = record.get_name();
+      if (zone ? !(owner == *zone)
+               : (!resolution.name.is_subdomain_of(owner) || !owner.is_subdomain_of(resolution.zone) ||
+                  owner == resolution.zone)) {
+         continue;
+      }
+
+      auto target = DomainName::from_wire(record.get_target());
+      if (target) {
+         zone = &owner;
+         ttl  = std::min(ttl, record.get_ttl());
+         targets.push_back(std::move(target.get_value()));
+      }
+   }
+   if (!zone) {
+      return false;
+   }
+
+   /* Glue, as long as it lies within the zone that was asked, anything else could be forged */
+   std::vector<ServerAddress> servers;
+   for (const auto &record : response.additionals) {
+      auto type = record.get_type();
+      if ((type != PacketQuestion::A && type != PacketQuestion::AAAA) ||
+          !record.get_name().is_subdomain_of(resolution.zone) ||
+          std::find(targets.begin(), targets.end(), record.get_name()) == targets.end()) {
+         continue;
+      }
+
+      auto address = ServerAddress::from_rdata(record.get_address(), m_Config.port);
+      if (address) {
+         servers.push_back(address.get_value());
+      }
+   }
+
+   // Name servers with glue don't need to be looked up
+   std::erase_if(targets, [&](const DomainName &target) {
+      return std::any_of(response.additionals.begin(), response.additionals.end(), [&](const auto &record) {
+         return record.get_name() == target &&
+                (record.get_type() == PacketQuestion::A || record.get_type() == PacketQuestion::AAAA);
+      });
+   });
+
+   std::shuffle(servers.begin(), servers.end(), m_Random);
+   if (!servers.empty()) {
+      remember_delegation(*zone, servers, ttl);
+   }
+
+   resolution.zone        = DomainName(*zone);
+   resolution.servers     = std::move(servers);
+   resolution.next_server = 0;
+   resolution.nameservers = std::move(targets);
+   query(resolution);
+   return true;
+}
+
+/* ------------------------------------------------------------------------------------------------------- */
+
+void
+Resolver::finish(Resolution                   &resolution,
+                 PacketHeader::ResultCode      code,
+                 std::span<const PacketRecord> answers,
+                 std::span<const PacketRecord> authorities) {
+   const auto &key = resolution.key;
+
+   /* The response as it goes into the cache: the CNAMEs followed, then the answers themselves */
+   auto packet = Packet(PacketHeader(0, true, 0, false, false, true, true, 0, code, 1, 0, 0, 0));
+   packet.questions.emplace_back(key.name, key.type, key.class_);
+   packet.answers.assign(resolution.chain.begin(), resolution.chain.end());
+   packet.answers.insert(packet.answers.end(), answers.begin(), answers.end());
+   for (const auto &record : authorities) {
+      if (record.get_type() == PacketQuestion::SOA) {
+         // A negative answer is good for the SOA's TTL or its MINIMUM, whichever is lower (RFC 2308 5)
+         auto &soa = packet.authorities.emplace_back(record);
+         soa.set_ttl(std::min(soa.get_ttl(), soa.get_soa().minimum));
+      }
+   }
+   packet.header.answer_count    = packet.answers.size();
+   packet.header.authority_count = packet.authorities.size();
+
+   auto res = packet.write_to_buffer(m_Response);
+   if (!res) {
+      fail(resolution);
+      return;
+   }
+
+   auto wire = WireResponse::from_bytes({ m_Response.get_data(), m_Response.get_write_index() });
+   if (!wire) {
+      fail(resolution);
+      return;
+   }
+
+   // Without answers of its own, whether behind CNAMEs or not, the response is negative: NXDOMAIN or
+   // NODATA. It can only be cached with an SOA telling for how long
+   bool     negative = answers.empty();
+   uint32_t ttl      = UINT32_MAX;
+   for (const auto &record : packet.answers) {
+      ttl = std::min(ttl, record.get_ttl());
+   }
+   if (negative) {
+      for (const auto &record : packet.authorities) {
+         ttl = std::min(ttl, record.get_ttl());
+      }
+      if (packet.authorities.empty()) {
+         ttl = 0;
+      }
+      ttl = std::min<uint32_t>(ttl, m_Config.max_negative_ttl.count());
+   }
+
+   if (!negative && m_Cache && code == PacketHeader::NO_ERROR) {
+      auto answer = CachedAnswer { { packet.answers.begin(), packet.answers.end() }, wire.get_value() };
+      m_Cache->put(CacheKey(key.name.intern(), key.type, key.class_), std::move(answer), ttl);
+      if (m_NegativeCache) {
+         m_NegativeCache->erase(key);
+      }
+   }
+
+   // Never interned: random names are what negative answers are mostly made of, and interned ones stay
+   if (negative && m_NegativeCache && ttl > 0) {
+      m_NegativeCache->put(key, CachedAnswer { {}, wire.get_value() }, ttl);
+      if (m_Cache) {
+         m_Cache->erase(key);
+      }
+   }
+
+   for (const auto &waiter : resolution.waiters) {
+      reply(waiter, wire.get_value(), ttl);
+   }
+
+   complete(resolution, { packet.answers.begin(), packet.answers.end() });
+}
+
+/* ------------------------------------------------------------------------------------------------------- */
+
+void
+Resolver::fail(Resolution &resolution) {
+   m_Failures.fetch_add(1, std::memory_order_relaxed);
+
+   for (const auto &waiter : resolution.waiters) {
+      reply_error(waiter, PacketHeader::SERVER_FAILURE);
+   }
+
+   complete(resolution, {});
+}
+
+/* ------------------------------------------------------------------------------------------------------- */
+
+void
+Resolver::complete(Resolution &resolution, std::vector<PacketRecord> answers) {
+   if (resolution.transaction) {
+      m_Transport->cancel(resolution.transaction);
+   }
+
+   // Queries that lost a race are left to run their course, how they end still says how their server does
+   if (!resolution.attempts.empty()) {
+      m_Stragglers.emplace(resolution.id, std::move(resolution.attempts));
+   }
+
+   // Gone before the dependents continue, they may start a resolution for the same question again
+   auto dependents = std::move(resolution.dependents);
+   m_Waiting -= resolution.waiters.size();
+   m_InFlight.erase(resolution.key);
+   m_Resolutions.erase(resolution.id);
+
+   for (uint64_t id : dependents) {
+      if (answers.empty()) {
+         auto *dependent = find(id);
+         if (dependent) {
+            look_up_nameserver(*dependent);
+         }
+      } else {
+         on_nameserver(id, answers);
+      }
+   }
+}
+
+/* ------------------------------------------------------------------------------------------------------- */
+
+void
+Resolver::expire(TimePoint now) {
+   // Every resolution gets the same time, so the oldest deadline always comes first
+   while (!m_Deadlines.empty() && m_Deadlines.front().first <= now) {
+      uint64_t id = m_Deadlines.front().second;
+      m_Deadlines.pop_front();
+
+      auto *resolution = find(id);
+      if (resolution) {
+         fail(*resolution);
+      }
+   }
+}
+
+/* ------------------------------------------------------------------------------------------------------- */
+
+void
+Resolver::reply(const Waiter &waiter, const WireResponse &wire, uint32_t ttl) {
+   auto request = PacketView::from_bytes(waiter.request);
+   if (!request) {
+      return;
+   }
+
+   // Too long for the client, the response goes out truncated
+   auto length = wire.write_to(request.get_value(), ttl, m_Response, waiter.max_size);
+   if (!length) {
+      reply_error(waiter, PacketHeader::SERVER_FAILURE);
+      return;
+   }
+
+   send(waiter, length.get_value());
+}
+
+/* ------------------------------------------------------------------------------------------------------- */
+
+void
+Resolver::reply_error(const Waiter &waiter, PacketHeader::ResultCode code) {
+   auto _request = PacketView::from_bytes(waiter.request);
+   if (!_request) {
+      return;
+   }
+   auto &request = _request.get_value();
+
+   auto header = PacketHeader(request.id(),
+                              true,
+                              request.op_code(),
+                              false,
+                              false,
+                              request.recursion_desired(),
+                              true,
+                              0,
+                              code,
+                              1,
+                              0,
+                              0,
+                              0);
+   header.to_bytes(std::span<Byte, PacketHeader::SIZE>(m_Response.get_data(), PacketHeader::SIZE));
+
+   auto question = request.get_question_bytes();
+   std::memcpy(m_Response.get_data() + PacketHeader::SIZE, question.data(), question.size());
+   send(waiter, PacketHeader::SIZE + question.size());
+}
+
+/* ------------------------------------------------------------------------------------------------------- */
+
+void
+Resolver::send(const Waiter &waiter, size_t length) {
+   if (waiter.responder) {
+      waiter.responder->respond(waiter, { m_Response.get_data(), length });
+   }
+}
+
+/* ------------------------------------------------------------------------------------------------------- */
+
+void
+Resolver::remember_delegation(const DomainName &zone, std::vector<ServerAddress> servers, uint32_t ttl) {
+   if (m_Delegations.size() >= MAX_DELEGATIONS) {
+      m_Delegations.clear();
+   }
+
+   auto expires_at     = Clock::now() + std::chrono::seconds(ttl);
+   m_Delegations[zone] = Delegation { std::move(servers), expires_at };
+}
+
+/* ------------------------------------------------------------------------------------------------------- */
+
+ResolverStats
+Resolver::get_stats() const {
+   ResolverStats stats;
+   stats.requests            = m_Requests.load(std::memory_order_relaxed);
+   stats.coalesced           = m_Coalesced.load(std::memory_order_relaxed);
+   stats.cache_hits          = m_CacheHits.load(std::memory_order_relaxed);
+   stats.resolutions         = m_Started.load(std::memory_order_relaxed);
+   stats.refreshes           = m_Refreshed.load(std::memory_order_relaxed);
+   stats.failures            = m_Failures.load(std::memory_order_relaxed);
+   stats.races               = m_Raced.load(std::memory_order_relaxed);
+   stats.races_won           = m_RacesWon.load(std::memory_order_relaxed);
+   stats.upstream.queries    = m_Queries.load(std::memory_order_relaxed);
+   stats.upstream.responses  = m_Responses.load(std::memory_order_relaxed);
+   stats.upstream.timeouts   = m_Timeouts.load(std::memory_order_relaxed);
+   stats.upstream.mismatched = m_Mismatched.load(std::memory_order_relaxed);
+   stats.upstream.tcp        = m_Tcp.load(std::memory_order_relaxed);
+   return stats;
+}
+
+/* ------------------------------------------------------------------------------------------------------- */
+
+void
+ResolverStats::print(const std::string &name) const {
+   /* Print title */
+   char title[100];
+   sprintf(title, "%s Resolver Stats", name.c_str());
+   PrintAtCenter(title, "[", "]", true, true);
+   printf("\n");
+
+   /* Print data */
+   printf("Requests: %lu\n", requests);
+   printf("Coalesced: %lu\n", coalesced);
+   printf("Cache Hits: %lu\n", cache_hits);
+   printf("Resolutions: %lu\n", resolutions);
+   printf("Refreshes: %lu\n", refreshes);
+   printf("Failures: %lu\n", failures);
+   printf("Races: %lu\n", races);
+   printf("Races Won: %lu\n", races_won);
+   printf("Upstream Queries: %lu\n", upstream.queries);
+   printf("Upstream Responses: %lu\n", upstream.responses);
+   printf("Upstream Timeouts: %lu\n", upstream.timeouts);
+   printf("Upstream Mismatched: %lu\n", upstream.mismatched);
+   printf("Upstream over TCP: %lu\n", upstream.tcp);
+}
+
+/* ------------------------------------------------------------------------------------------------------- */
@@ -0,0 +1,398 @@
+#pragma once
+
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+#include <deque>
+#include <mutex>
+#include <optional>
+#include <queue>
+#include <random>
+#include <string>
+#include <thread>
+#include <unordered_map>
+#include <vector>
+
+#include <backbone/core/pch>
+#include <backbone/lib/buffer/arena.hpp>
+#include <backbone/lib/cache/answer.hpp>
+#include <backbone/lib/packet/packet.hpp>
+#include "forwarder.hpp"
+#include "responder.hpp"
+#include "transport.hpp"
+
+/* ------------------------------------------------------------------------------------------------------- */
+
+class ResolverConfig {
+public:
+   /**
+    * Servers iteration starts from, "address[:port]". Defaults to the IPv4 addresses of the root servers.
+    */
+   std::vector<std::string> root_hints = {
+      "198.41.0.4",     "170.247.170.2", "192.33.4.12",   "199.7.91.13",  "192.203.230.10",
+      "192.5.5.241",    "192.112.36.4",  "198.97.190.53", "192.36.148.17", "192.58.128.30",
+      "193.0.14.129",   "199.7.83.42",   "202.12.27.33",
+   };
+
+   /**
+    * Port of every server learned from a referral. Only ever changed to run against local test servers.
+    */
+   uint16_t port = 53;
+
+   /**
+    * Upstream sockets per address family.
+    */
+   size_t sockets = 4;
+
+   /**
+    * How long to wait for one server before asking the next one.
+    */
+   std::chrono::milliseconds query_timeout = std::chrono::milliseconds(800);
+
+   /**
+    * How long a whole resolution may take before its clients get SERVFAIL.
+    */
+   std::chrono::milliseconds resolution_timeout = std::chrono::milliseconds(4000);
+
+   /**
+    * Upstream queries a single resolution may send, following referrals and CNAMEs included.
+    */
+   size_t max_queries = 32;
+
+   /**
+    * Client requests waiting at once. Beyond that new requests get SERVFAIL right away.
+    */
+   size_t max_waiters = 64 * 1024;
+
+   /**
+    * Upper bound of how long a negative answer is cached, whatever its SOA says (RFC 2308 5).
+    */
+   std::chrono::seconds max_negative_ttl = std::chrono::hours(3);
+
+   /**
+    * Upstream resolvers to forward every question to instead of resolving it from the root.
+    */
+   ForwarderConfig forward;
+};
+
+/* ------------------------------------------------------------------------------------------------------- */
+
+class ResolverStats {
+public:
+   uint64_t requests    = 0;   // client requests handed to the resolver
+   uint64_t coalesced   = 0;   // requests that joined a resolution already in flight
+   uint64_t cache_hits  = 0;   // requests answered by the cache once they reached the resolver
+   uint64_t resolutions = 0;
+   uint64_t refreshes   = 0;   // resolutions started to refresh a cached answer, nobody waiting on them
+   uint64_t failures    = 0;   // resolutions that ended in SERVFAIL
+   uint64_t races       = 0;   // forwarded queries also sent to the second best server
+   uint64_t races_won   = 0;   // races the second server answered first
+
+   TransportStats upstream;
+
+   void
+   print(const std::string &name = "") const;
+};
+
+/* ------------------------------------------------------------------------------------------------------- */
+
+/**
+ * @brief
+ * Iterative resolver answering the questions no zone is authoritative for, without ever blocking the
+ * workers that hand them over.
+ *
+ * @details
+ * Workers pass a request they can't answer to `resolve` together with where its response has to go, and
+ * move on. Everything else happens on the resolver's own thread: starting from the closest zone cut it
+ * knows of (or the root hints), it follows referrals and CNAMEs through an `UpstreamTransport`, looking up
+ * the addresses of name servers without glue as resolutions of their own. The final answer goes into the
+ * shared `AnswerCache` before it is sent to every waiting client, so the next request for it is a plain
+ * cache hit on the worker. NXDOMAIN and NODATA go into a cache of their own instead, for as long as their
+ * SOA allows (RFC 2308), so that junk names never push real answers out. Cached answers about to expire,
+ * or already stale, come back through `refresh` and are resolved the same way with nobody waiting, so
+ * clients keep hitting the cache in the meantime.
+ *
+ * There is only ever one resolution per question. Requests arriving while one is in flight, be it from
+ * another client or from a name server lookup, wait for it instead of querying upstream again, so a
+ * popular name expiring from the cache costs a single upstream query however many clients ask for it.
+ *
+ * Upstream queries go out over UDP with EDNS0, and the transport asks again over TCP when a response is
+ * truncated all the same. Should a truncated response make it through anyway, it is only used for its
+ * referral, if any, otherwise the next server is tried.
+ *
+ * With forwarders configured, every question is instead sent to the best upstream resolver of a
+ * `ForwarderPool`, asking for recursion. If that server takes longer than it usually does, the same
+ * question is raced to the second best server and whichever answers first wins, which keeps one slow or
+ * lossy upstream from showing up in the tail latency.
+ */
+class Resolver : private IUpstreamListener {
+public:
+   using Clock     = std::chrono::steady_clock;
+   using TimePoint = Clock::time_point;
+
+   static constexpr size_t MAX_CNAMES = 8;
+   static constexpr size_t MAX_DEPTH  = 4;   // nested name server lookups
+   static constexpr size_t MAX_EVENTS = 64;
+
+   /**
+    * Upper bound of the zone cuts remembered. Once full, the whole table starts over.
+    */
+   static constexpr size_t MAX_DELEGATIONS = 16 * 1024;
+
+private:
+   /**
+    * Forwarded query in flight.
+    */
+   struct Attempt {
+      uint64_t  handle;
+      size_t    server;   // index into the `ForwarderPool`
+      TimePoint sent_at;
+   };
+
+   /**
+    * One question being resolved, on behalf of clients (`waiters`) and other resolutions (`dependents`).
+    */
+   struct Resolution {
+      uint64_t id;
+      CacheKey key;
+      size_t   depth;
+
+      DomainName                name;    // `key.name`, or where the CNAMEs followed so far lead
+      std::vector<PacketRecord> chain;   // those CNAMEs
+
+      DomainName                 zone;   // closest enclosing zone cut known
+      std::vector<ServerAddress> servers;
+      size_t                     next_server;
+      std::vector<DomainName>    nameservers;   // name servers of `zone` whose addresses are unknown
+
+      size_t   queries;
+      uint64_t transaction;   // upstream query in flight, 0 if none
+
+      std::vector<Attempt> attempts;   // when forwarding, the first one sent first
+      std::vector<size_t>  tried;      // forwarders asked so far
+
+      std::vector<Waiter>   waiters;
+      std::vector<uint64_t> dependents;
+   };
+
+   struct Delegation {
+      std::vector<ServerAddress> servers;
+      TimePoint                  expires_at;
+   };
+
+   /**
+    * When to race the forwarded query `handle` of resolution `id`, if it is still the only one by then.
+    */
+   struct Race {
+      TimePoint at;
+      uint64_t  id;
+      uint64_t  handle;
+
+      bool
+      operator>(const Race &other) const {
+         return at > other.at;
+      }
+   };
+
+   ResolverConfig             m_Config;
+   AnswerCache               *m_Cache;
+   AnswerCache               *m_NegativeCache;
+   std::vector<ServerAddress> m_Roots;
+
+   /* Handed over by the workers */
+   std::mutex                                 m_Mutex;
+   std::vector<std::pair<CacheKey, Waiter>>   m_Submitted;
+   std::vector<CacheKey>                      m_Refreshes;
+   int                                        m_Wakeup;
+
+   /* Only touched by the resolver's thread */
+   UniqueRef<UpstreamTransport>                                           m_Transport;
+   int                                                                    m_Epoll;
+   std::unordered_map<uint64_t, UniqueRef<Resolution>>                    m_Resolutions;
+   std::unordered_map<CacheKey, uint64_t, CacheKeyHash>                   m_InFlight;
+   std::unordered_map<DomainName, Delegation, DomainNameHash>             m_Delegations;
+   std::deque<std::pair<TimePoint, uint64_t>>                             m_Deadlines;
+   std::optional<ForwarderPool>                                           m_Forwarders;
+   std::priority_queue<Race, std::vector<Race>, std::greater<Race>>       m_Races;
+   std::unordered_map<uint64_t, std::vector<Attempt>>                     m_Stragglers;
+   uint64_t                                                               m_NextId;
+   std::minstd_rand                                                       m_Random;
+   size_t                                                                 m_Waiting;
+   QueryArena                                                             m_Arena;
+   PacketBuffer                                                           m_Message;
+   PacketBuffer                                                           m_Response;
+
+   std::atomic<bool> m_Running;
+   std::thread       m_Thread;
+
+   std::atomic<uint64_t> m_Requests;
+   std::atomic<uint64_t> m_Coalesced;
+   std::atomic<uint64_t> m_CacheHits;
+   std::atomic<uint64_t> m_Started;
+   std::atomic<uint64_t> m_Refreshed;
+   std::atomic<uint64_t> m_Failures;
+   std::atomic<uint64_t> m_Raced;
+   std::atomic<uint64_t> m_RacesWon;
+   std::atomic<uint64_t> m_Queries;
+   std::atomic<uint64_t> m_Responses;
+   std::atomic<uint64_t> m_Timeouts;
+   std::atomic<uint64_t> m_Mismatched;
+   std::atomic<uint64_t> m_Tcp;
+
+public:
+   Resolver(const Resolver &) = delete;
+   ~Resolver();
+
+   /**
+    * Resolver filling `cache` with the answers it resolves and `negative_cache` with the names and types
+    * that turned out not to exist. Either may be null. Nothing runs before `start`.
+    */
+   static Result<UniqueRef<Resolver>>
+   create(ResolverConfig config, AnswerCache *cache, AnswerCache *negative_cache = nullptr);
+
+   void
+   start();
+
+   /**
+    * Stops the resolver's thread. Requests still waiting never get a response.
+    */
+   void
+   stop();
+
+   /**
+    * Resolves `key` and sends the response to `waiter`. Safe to call from any thread, returns at once.
+    */
+   void
+   resolve(CacheKey key, Waiter waiter);
+
+   /**
+    * Resolves `key` again for the cache alone, unless it is being resolved already. Safe to call from any
+    * thread, returns at once.
+    */
+   void
+   refresh(CacheKey key);
+
+   ResolverStats
+   get_stats() const;
+
+private:
+   Resolver(ResolverConfig config, AnswerCache *cache, AnswerCache *negative_cache);
+
+   void
+   run();
+
+   void
+   take_submissions();
+
+   void
+   submit(CacheKey key, Waiter waiter);
+
+   void
+   submit_refresh(CacheKey key);
+
+   Resolution &
+   create_resolution(const CacheKey &key, size_t depth);
+
+   Resolution *
+   find(uint64_t id);
+
+   /**
+    * Starts over from the closest known zone cut of the resolution's current name.
+    */
+   void
+   begin(Resolution &resolution);
+
+   /**
+    * Asks the next server of the current zone, or looks up the next name server without an address.
+    */
+   void
+   query(Resolution &resolution);
+
+   void
+   look_up_nameserver(Resolution &resolution);
+
+   /**
+    * Sends the question to the best forwarder not asked yet. Fails the resolution once none is left and
+    * nothing is in flight anymore.
+    */
+   void
+   forward(Resolution &resolution);
+
+   /**
+    * Takes the forwarded query answered by, or timed out at, `server` off `attempts`.
+    */
+   std::optional<Attempt>
+   take_attempt(std::vector<Attempt> &attempts, const ServerAddress &server);
+
+   /**
+    * Accounts for a forwarded query that lost its race, answered or not, with the pool.
+    */
+   void
+   settle_straggler(uint64_t token, const ServerAddress &server, bool answered);
+
+   /**
+    * Tries the next server after a failed upstream query. When forwarding, this waits for the other query
+    * of a race instead, if there is one.
+    */
+   void
+   retry(Resolution &resolution);
+
+   void
+   race(TimePoint now);
+
+   void
+   on_response(uint64_t token, const ServerAddress &server, std::span<const Byte> response) override;
+
+   void
+   on_timeout(uint64_t token, const ServerAddress &server) override;
+
+   void
+   process(Resolution &resolution, const Packet &response);
+
+   /**
+    * Takes the response of a forwarder, which has done the whole resolution already.
+    */
+   void
+   process_forwarded(Resolution &resolution, const Packet &response);
+
+   /**
+    * Takes a referral to a zone below the current one, if `response` is one.
+    */
+   bool
+   follow_referral(Resolution &resolution, const Packet &response);
+
+   void
+   finish(Resolution                  &resolution,
+          PacketHeader::ResultCode     code,
+          std::span<const PacketRecord> answers,
+          std::span<const PacketRecord> authorities);
+
+   void
+   fail(Resolution &resolution);
+
+   /**
+    * Removes a finished resolution and hands `answers` to the resolutions depending on it.
+    */
+   void
+   complete(Resolution &resolution, std::vector<PacketRecord> answers);
+
+   void
+   on_nameserver(uint64_t id, const std::vector<PacketRecord> &answers);
+
+   void
+   expire(TimePoint now);
+
+   void
+   reply(const Waiter &waiter, const WireResponse &wire, uint32_t ttl);
+
+   void
+   reply_error(const Waiter &waiter, PacketHeader::ResultCode code);
+
+   void
+   send(const Waiter &waiter, size_t length);
+
+   void
+   remember_delegation(const DomainName &zone, std::vector<ServerAddress> servers, uint32_t ttl);
+};
+
+/* ------------------------------------------------------------------------------------------------------- */
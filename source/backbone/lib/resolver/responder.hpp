@@ -0,0 +1,80 @@
+#pragma once
+
+#include <cstdint>
+#include <cstring>
+#include <span>
+#include <vector>
+#include <sys/socket.h>
+
+#include <backbone/core/pch>
+#include <backbone/lib/buffer/pool.hpp>
+
+/* ------------------------------------------------------------------------------------------------------- */
+
+class Waiter;
+
+/**
+ * @brief
+ * Transport side of a response that is sent after the request has already been handled, e.g. once the
+ * `Resolver` has an answer.
+ *
+ * @details
+ * `respond` is called from whichever thread produced the response, so implementations must be safe to
+ * call from any thread. A response whose client is gone by then is simply discarded.
+ */
+class IResponder {
+public:
+   virtual ~IResponder() = default;
+
+   virtual void
+   respond(const Waiter &waiter, std::span<const Byte> response) = 0;
+};
+
+/* ------------------------------------------------------------------------------------------------------- */
+
+/**
+ * @brief
+ * Who sent the request being handled, as far as answering it later is concerned. Only borrowed for the
+ * duration of `QueryHandler::handle`.
+ */
+class Requester {
+public:
+   IResponder *responder = nullptr;
+
+   const sockaddr *peer        = nullptr;   // datagram transports
+   socklen_t       peer_length = 0;
+   uint64_t        connection  = 0;   // stream transports
+
+   /**
+    * Largest response the transport can carry, anything longer is truncated. Datagram clients get no
+    * more than they advertise with EDNS0 on top of that, which `QueryHandler` works out per request.
+    */
+   size_t max_size = BufferPool::UDP_SIZE;
+};
+
+/* ------------------------------------------------------------------------------------------------------- */
+
+/**
+ * @brief
+ * Request waiting for its response: a copy of the request and of its `Requester`.
+ */
+class Waiter {
+public:
+   std::vector<Byte> request;
+   IResponder       *responder;
+   sockaddr_storage  peer;
+   socklen_t         peer_length;
+   uint64_t          connection;
+   size_t            max_size;
+
+public:
+   Waiter(std::span<const Byte> request, const Requester &requester)
+       : request(request.begin(), request.end()), responder(requester.responder), peer(),
+         peer_length(requester.peer_length), connection(requester.connection), max_size(requester.max_size) {
+      if (requester.peer && peer_length <= sizeof(peer)) {
+         std::memcpy(&peer, requester.peer, peer_length);
+      }
+   }
+};
+
+/* ------------------------------------------------------------------------------------------------------- */
@@ -0,0 +1,467 @@
+#include "transport.hpp"
+
+#include <cerrno>
+#include <cstring>
+#include <netinet/in.h>
+#include <sys/epoll.h>
+#include <unistd.h>
+
+/* ------------------------------------------------------------------------------------------------------- */
+
+UpstreamTransport::UpstreamTransport(IUpstreamListener &listener)
+    : m_Listener(listener), m_Streams(-1), m_Serial(0), m_Random(std::random_device()()), m_Query(),
+      m_Response(BufferPool::LARGE_SIZE) {}
+
+/* ------------------------------------------------------------------------------------------------------- */
+
+UpstreamTransport::~UpstreamTransport() {
+   for (auto &[key, transaction] : m_Transactions) {
+      if (transaction.stream.fd >= 0) {
+         ::close(transaction.stream.fd);
+      }
+   }
+   for (auto &socket : m_Sockets) {
+      ::close(socket.fd);
+   }
+   if (m_Streams >= 0) {
+      ::close(m_Streams);
+   }
+}
+
+/* ------------------------------------------------------------------------------------------------------- */
+
+Result<UniqueRef<UpstreamTransport>>
+UpstreamTransport::create(IUpstreamListener &listener, size_t sockets) {
+   auto transport = UniqueRef<UpstreamTransport>(new UpstreamTransport(listener));
+   sockets        = std::clamp<size_t>(sockets, 1, MAX_SOCKETS / 2);
+
+   auto res = transport->open(AF_INET, sockets);
+   RETURN_IF_ERROR(res);
+
+   transport->m_Streams = epoll_create1(EPOLL_CLOEXEC);
+   if (transport->m_Streams < 0) {
+      return Error(std::string("Failed to create epoll instance: ") + strerror(errno));
+   }
+
+   // Hosts without IPv6 simply can't reach IPv6 servers
+   auto _ = transport->open(AF_INET6, sockets);
+
+   return transport;
+}
+
+/* ------------------------------------------------------------------------------------------------------- */
+
+Result<void>
+UpstreamTransport::open(int family, size_t count) {
+   for (size_t i = 0; i < count; i++) {
+      int fd = ::socket(family, SOCK_DGRAM | SOCK_NONBLOCK | SOCK_CLOEXEC, 0);
+      if (fd < 0) {
+         return Error(std::string("Failed to create upstream socket: ") + strerror(errno));
+      }
+
+      // Port 0: the kernel picks a random ephemeral port for every socket
+      sockaddr_storage storage {};
+      socklen_t        length = sizeof(sockaddr_in);
+      storage.ss_family       = family;
+      if (family == AF_INET6) {
+         int enable = 1;
+         setsockopt(fd, IPPROTO_IPV6, IPV6_V6ONLY, &enable, sizeof(enable));
+         length = sizeof(sockaddr_in6);
+      }
+
+      if (::bind(fd, reinterpret_cast<sockaddr *>(&storage), length) < 0) {
+         ::close(fd);
+         return Error(std::string("Failed to bind upstream socket: ") + strerror(errno));
+      }
+      m_Sockets.push_back({ fd, family });
+   }
+
+   return Ok();
+}
+
+/* ------------------------------------------------------------------------------------------------------- */
+
+Result<uint64_t>
+UpstreamTransport::send(const ServerAddress      &server,
+                        const DomainName         &name,
+                        uint16_t                  type,
+                        uint16_t                  class_,
+                        bool                      recursion_desired,
+                        std::chrono::milliseconds timeout,
+                        uint64_t                  token) {
+   /* Random socket of the right family, then a random ID not in use on it */
+   std::array<uint32_t, MAX_SOCKETS> candidates;
+   size_t                            count = 0;
+   for (size_t i = 0; i < m_Sockets.size(); i++) {
+      if (m_Sockets[i].family == server.get_family()) {
+         candidates[count++] = i;
+      }
+   }
+   if (count == 0) {
+      return Error("No socket for the address family of " + server.to_string());
+   }
+
+   uint32_t key = 0;
+   for (size_t attempt = 0;; attempt++) {
+      uint64_t random = m_Random();
+      key             = (candidates[random % count] << 16) | (random >> 48);
+      if (!m_Transactions.contains(key)) {
+         break;
+      }
+      if (attempt == 16) {
+         return Error("Too many outstanding upstream queries");
+      }
+   }
+
+   /* Random case for every letter of the name */
+   std::bitset<256> upper;
+   for (size_t bit = 0; bit < upper.size(); bit += 64) {
+      upper |= std::bitset<256>(m_Random()) << bit;
+   }
+
+   uint64_t    handle   = (++m_Serial << 32) | key;
+   auto        deadline = Clock::now() + timeout;
+   Transaction transaction {
+      handle, token, server, name, type, class_, recursion_desired, timeout, deadline, upper, {},
+   };
+
+   const auto &socket = m_Sockets[key >> 16];
+   size_t      length = encode(key & 0xFFFF, transaction);
+   if (sendto(socket.fd, m_Query.data(), length, 0, server.get(), server.length) < 0) {
+      return Error(std::string("Failed to send upstream query: ") + strerror(errno));
+   }
+   m_Stats.queries++;
+
+   m_Transactions.emplace(key, std::move(transaction));
+   m_Deadlines.emplace(deadline, handle);
+   return handle;
+}
+
+/* ------------------------------------------------------------------------------------------------------- */
+
+size_t
+UpstreamTransport::encode(uint16_t id, const Transaction &transaction) {
+   auto header = PacketHeader(id, false, 0, false, false, transaction.recursion_desired, false, 0,
+                              PacketHeader::NO_ERROR, 1, 0, 0, 1);
+   header.to_bytes(std::span<Byte, PacketHeader::SIZE>(m_Query.data(), PacketHeader::SIZE));
+
+   size_t length = PacketHeader::SIZE;
+   for (size_t i = 0; i < transaction.name.get_wire().size(); i++) {
+      m_Query[length++] = get_name_byte(transaction, i);
+   }
+   m_Query[length++] = transaction.type >> 8;
+   m_Query[length++] = transaction.type & 0xFF;
+   m_Query[length++] = transaction.class_ >> 8;
+   m_Query[length++] = transaction.class_ & 0xFF;
+
+   /* OPT record (RFC 6891): root owner, the payload size in place of the class, no flags nor options */
+   const Byte opt[11] = {
+      0, 0, PacketQuestion::OPT, EDNS_PAYLOAD >> 8, EDNS_PAYLOAD & 0xFF, 0, 0, 0, 0, 0, 0,
+   };
+   std::memcpy(m_Query.data() + length, opt, sizeof(opt));
+   return length + sizeof(opt);
+}
+
+/* ------------------------------------------------------------------------------------------------------- */
+
+void
+UpstreamTransport::cancel(uint64_t handle) {
+   auto it = m_Transactions.find(static_cast<uint32_t>(handle));
+   if (it != m_Transactions.end() && it->second.handle == handle) {
+      forget(it);
+   }
+}
+
+/* ------------------------------------------------------------------------------------------------------- */
+
+void
+UpstreamTransport::receive(int fd) {
+   if (fd == m_Streams) {
+      std::array<epoll_event, 16> events;
+      int                         count = epoll_wait(m_Streams, events.data(), events.size(), 0);
+      for (int i = 0; i < count; i++) {
+         // Connections are registered by handle, events of one that is already gone find nothing
+         uint64_t handle = events[i].data.u64;
+         auto     it     = m_Transactions.find(static_cast<uint32_t>(handle));
+         if (it != m_Transactions.end() && it->second.handle == handle) {
+            progress(it);
+         }
+      }
+      return;
+   }
+
+   size_t socket = 0;
+   while (socket < m_Sockets.size() && m_Sockets[socket].fd != fd) {
+      socket++;
+   }
+   if (socket == m_Sockets.size()) {
+      return;
+   }
+
+   while (true) {
+      sockaddr_storage peer {};
+      socklen_t        peer_length = sizeof(peer);
+      ssize_t          count       = recvfrom(fd,
+                                 m_Response.data(),
+                                 m_Response.size(),
+                                 MSG_TRUNC,
+                                 reinterpret_cast<sockaddr *>(&peer),
+                                 &peer_length);
+      if (count < 0) {
+         if (errno == EINTR) {
+            continue;
+         }
+         return;   // drained, or an ICMP error that the timeout takes care of
+      }
+
+      if (size_t(count) > m_Response.size()) {
+         m_Stats.mismatched++;
+         continue;
+      }
+      handle_response(socket, { m_Response.data(), size_t(count) }, peer);
+   }
+}
+
+/* ------------------------------------------------------------------------------------------------------- */
+
+void
+UpstreamTransport::handle_response(size_t                  socket,
+                                   std::span<const Byte>   response,
+                                   const sockaddr_storage &peer) {
+   auto _view = PacketView::from_bytes(response);
+   if (!_view || !_view.get_value().query_response() || _view.get_value().question_count() != 1) {
+      m_Stats.mismatched++;
+      return;
+   }
+   auto &view = _view.get_value();
+
+   // Once over TCP, a query no longer takes datagrams
+   auto it = m_Transactions.find((socket << 16) | view.id());
+   if (it == m_Transactions.end() || it->second.stream.fd >= 0 || !it->second.server.matches(peer) ||
+       !is_answer(view, it->second)) {
+      m_Stats.mismatched++;
+      return;
+   }
+
+   if (view.truncated_message()) {
+      connect(it);
+   } else {
+      complete(it, view);
+   }
+}
+
+/* ------------------------------------------------------------------------------------------------------- */
+
+Byte
+UpstreamTransport::get_name_byte(const Transaction &transaction, size_t index) {
+   // Names are kept in lowercase, and no length byte is large enough to pass for a letter
+   Byte byte = transaction.name.get_wire()[index];
+   return transaction.upper[index] && byte >= 'a' && byte <= 'z' ? byte - ('a' - 'A') : byte;
+}
+
+/* ------------------------------------------------------------------------------------------------------- */
+
+bool
+UpstreamTransport::is_answer(const PacketView &view, const Transaction &transaction) {
+   if (!view.query_response() || view.question_count() != 1) {
+      return false;
+   }
+
+   auto question = *view.questions().begin();
+   if (question.type != transaction.type || question.class_ != transaction.class_) {
+      return false;
+   }
+
+   // The first name of a message can't be compressed, so an echo is the very same bytes
+   auto echoed = view.get_question_bytes();
+   auto length = transaction.name.get_wire().size();
+   if (echoed.size() < length) {
+      return false;
+   }
+   for (size_t i = 0; i < length; i++) {
+      if (echoed[i] != get_name_byte(transaction, i)) {
+         return false;
+      }
+   }
+   return true;
+}
+
+/* ------------------------------------------------------------------------------------------------------- */
+
+void
+UpstreamTransport::connect(Transactions::iterator it) {
+   auto &transaction = it->second;
+   auto &server      = transaction.server;
+   m_Stats.tcp++;
+
+   int fd = ::socket(server.get_family(), SOCK_STREAM | SOCK_NONBLOCK | SOCK_CLOEXEC, 0);
+   if (fd < 0) {
+      fail(it);
+      return;
+   }
+   transaction.stream.fd = fd;
+
+   epoll_event event { .events = EPOLLIN | EPOLLOUT, .data = { .u64 = transaction.handle } };
+   if ((::connect(fd, server.get(), server.length) < 0 && errno != EINPROGRESS) ||
+       epoll_ctl(m_Streams, EPOLL_CTL_ADD, fd, &event) < 0) {
+      fail(it);
+      return;
+   }
+
+   /* Same ID and question, behind the two byte length TCP messages start with */
+   size_t length = encode(it->first & 0xFFFF, transaction);
+   auto  &buffer = transaction.stream.buffer;
+   buffer        = { Byte(length >> 8), Byte(length & 0xFF) };
+   buffer.insert(buffer.end(), m_Query.begin(), m_Query.begin() + length);
+
+   // The time it took to come back truncated is not held against the connection
+   transaction.deadline = Clock::now() + transaction.timeout;
+   m_Deadlines.emplace(transaction.deadline, transaction.handle);
+}
+
+/* ------------------------------------------------------------------------------------------------------- */
+
+void
+UpstreamTransport::progress(Transactions::iterator it) {
+   auto &stream = it->second.stream;
+
+   if (!stream.sent) {
+      auto    pending = std::span<const Byte>(stream.buffer).subspan(stream.done);
+      ssize_t count   = ::send(stream.fd, pending.data(), pending.size(), MSG_NOSIGNAL);
+      if (count < 0) {
+         if (errno != EAGAIN && errno != EINTR) {
+            fail(it);
+         }
+         return;
+      }
+
+      stream.done += count;
+      if (stream.done < stream.buffer.size()) {
+         return;
+      }
+
+      epoll_event event { .events = EPOLLIN, .data = { .u64 = it->second.handle } };
+      epoll_ctl(m_Streams, EPOLL_CTL_MOD, stream.fd, &event);
+      stream.sent = true;
+      stream.done = 0;
+      stream.buffer.resize(2);
+   }
+
+   /* The length first, then the message it announces */
+   while (true) {
+      auto    missing = std::span<Byte>(stream.buffer).subspan(stream.done);
+      ssize_t count   = ::recv(stream.fd, missing.data(), missing.size(), 0);
+      if (count <= 0) {
+         if (count == 0 || (errno != EAGAIN && errno != EINTR)) {
+            fail(it);
+         }
+         return;
+      }
+
+      stream.done += count;
+      if (stream.done < stream.buffer.size()) {
+         continue;
+      }
+      if (stream.buffer.size() > 2) {
+         break;
+      }
+
+      size_t length = (stream.buffer[0] << 8) | stream.buffer[1];
+      if (length < PacketHeader::SIZE) {
+         fail(it);
+         return;
+      }
+      stream.buffer.resize(2 + length);
+   }
+
+   auto response = std::span<const Byte>(stream.buffer).subspan(2);
+   auto _view    = PacketView::from_bytes(response);
+   if (!_view || _view.get_value().id() != (it->first & 0xFFFF) ||
+       !is_answer(_view.get_value(), it->second)) {
+      m_Stats.mismatched++;
+      fail(it);
+      return;
+   }
+   complete(it, _view.get_value());
+}
+
+/* ------------------------------------------------------------------------------------------------------- */
+
+void
+UpstreamTransport::complete(Transactions::iterator it, const PacketView &view) {
+   // The transaction is over before the listener gets to see it, it may well send the next query. The
+   // response of a stream lives in its buffer, which has to outlive the call.
+   uint64_t          token  = it->second.token;
+   ServerAddress     server = it->second.server;
+   std::vector<Byte> buffer = std::move(it->second.stream.buffer);
+   forget(it);
+   m_Stats.responses++;
+
+   m_Listener.on_response(token, server, view.get_data());
+}
+
+/* ------------------------------------------------------------------------------------------------------- */
+
+void
+UpstreamTransport::fail(Transactions::iterator it) {
+   uint64_t      token  = it->second.token;
+   ServerAddress server = it->second.server;
+   forget(it);
+   m_Stats.timeouts++;
+
+   m_Listener.on_timeout(token, server);
+}
+
+/* ------------------------------------------------------------------------------------------------------- */
+
+void
+UpstreamTransport::forget(Transactions::iterator it) {
+   // Closing the socket takes it out of the epoll set as well
+   if (it->second.stream.fd >= 0) {
+      ::close(it->second.stream.fd);
+   }
+   m_Transactions.erase(it);
+}
+
+/* ------------------------------------------------------------------------------------------------------- */
+
+void
+UpstreamTransport::expire(TimePoint now) {
+   while (!m_Deadlines.empty() && m_Deadlines.top().first <= now) {
+      uint64_t handle = m_Deadlines.top().second;
+      m_Deadlines.pop();
+
+      // Queries that got their answer, were cancelled or moved on to TCP leave their deadline behind
+      auto it = m_Transactions.find(static_cast<uint32_t>(handle));
+      if (it == m_Transactions.end() || it->second.handle != handle || it->second.deadline > now) {
+         continue;
+      }
+      fail(it);
+   }
+}
+
+/* ------------------------------------------------------------------------------------------------------- */
+
+std::chrono::milliseconds
+UpstreamTransport::get_wait(TimePoint now, std::chrono::milliseconds limit) const {
+   if (m_Deadlines.empty()) {
+      return limit;
+   }
+
+   auto wait = std::chrono::ceil<std::chrono::milliseconds>(m_Deadlines.top().first - now);
+   return std::clamp(wait, std::chrono::milliseconds(0), limit);
+}
+
+/* ------------------------------------------------------------------------------------------------------- */
+
+std::vector<int>
+UpstreamTransport::get_fds() const {
+   std::vector<int> fds;
+   for (const auto &socket : m_Sockets) {
+      fds.push_back(socket.fd);
+   }
+   fds.push_back(m_Streams);
+   return fds;
+}
+
+/* ------------------------------------------------------------------------------------------------------- */
@@ -0,0 +1,254 @@
+#pragma once
+
+#include <array>
+#include <bitset>
+#include <chrono>
+#include <cstdint>
+#include <queue>
+#include <random>
+#include <span>
+#include <unordered_map>
+#include <vector>
+
+#include <backbone/core/pch>
+#include <backbone/lib/buffer/pool.hpp>
+#include <backbone/lib/packet/domain.hpp>
+#include <backbone/lib/packet/header.hpp>
+#include <backbone/lib/packet/view.hpp>
+#include "address.hpp"
+
+/* ------------------------------------------------------------------------------------------------------- */
+
+/**
+ * @brief
+ * Receives the outcome of every query sent through an `UpstreamTransport`. The transaction is over by the
+ * time either method is called, so both may send further queries right away.
+ */
+class IUpstreamListener {
+public:
+   virtual ~IUpstreamListener() = default;
+
+   /**
+    * `response` is a well-formed response to the question that was sent, coming from the server it was
+    * sent to. It is only valid during the call.
+    */
+   virtual void
+   on_response(uint64_t token, const ServerAddress &server, std::span<const Byte> response) = 0;
+
+   virtual void
+   on_timeout(uint64_t token, const ServerAddress &server) = 0;
+};
+
+/* ------------------------------------------------------------------------------------------------------- */
+
+class TransportStats {
+public:
+   uint64_t queries    = 0;
+   uint64_t responses  = 0;
+   uint64_t timeouts   = 0;
+   uint64_t mismatched = 0;   // datagrams not matching any outstanding query
+   uint64_t tcp        = 0;   // truncated responses asked again over TCP
+};
+
+/* ------------------------------------------------------------------------------------------------------- */
+
+/**
+ * @brief
+ * Non-blocking DNS client over a handful of UDP sockets, for talking to upstream servers.
+ *
+ * @details
+ * Every socket is bound to its own ephemeral port once, and each query picks a socket and a message ID at
+ * random. An outstanding query is identified by both, so a response is only accepted from the server the
+ * query went to, on the socket it went out of, with the right ID and echoing the very question that was
+ * asked. Anything else is dropped as spoofed or stale. On top of that, the letters of the question name
+ * go out in random case (DNS 0x20) and the response has to echo them exactly: servers copy the question
+ * verbatim, while a blind spoofer has to guess another bit for every letter on top of the 16 bits of the
+ * ID and the few bits of choosing among the sockets.
+ *
+ * Queries carry an EDNS0 OPT record offering `EDNS_PAYLOAD` bytes, which fits most answers into a single
+ * unfragmented datagram. A response truncated all the same is not reported: the query is asked again
+ * over a TCP connection to the same server, with a fresh timeout, and only the response coming back on
+ * it is. A connection that fails is reported as a timeout.
+ *
+ * The transport does no waiting of its own: the owner watches `get_fds` for readability, calls `receive`
+ * on the one that is ready, and calls `expire` at least every `get_wait` to time queries out. It is meant
+ * to be driven by a single thread.
+ */
+class UpstreamTransport {
+public:
+   using Clock     = std::chrono::steady_clock;
+   using TimePoint = Clock::time_point;
+
+   static constexpr size_t   MAX_SOCKETS  = 64;
+   static constexpr uint16_t EDNS_PAYLOAD = BufferPool::EDNS_SIZE;
+
+private:
+   /**
+    * TCP connection a truncated query is asked again on: the length-prefixed query until it is sent,
+    * then the length-prefixed response as it comes in.
+    */
+   struct Stream {
+      int               fd   = -1;
+      bool              sent = false;
+      size_t            done = 0;
+      std::vector<Byte> buffer;
+   };
+
+   struct Transaction {
+      uint64_t                  handle;
+      uint64_t                  token;
+      ServerAddress             server;
+      DomainName                name;
+      uint16_t                  type;
+      uint16_t                  class_;
+      bool                      recursion_desired;
+      std::chrono::milliseconds timeout;
+      TimePoint                 deadline;
+      std::bitset<256>          upper;   // bytes of the name sent in uppercase, if they are letters
+      Stream                    stream;
+   };
+
+   using Transactions = std::unordered_map<uint32_t, Transaction>;
+
+   struct Socket {
+      int fd;
+      int family;
+   };
+
+   using Deadline = std::pair<TimePoint, uint64_t>;
+
+   IUpstreamListener &m_Listener;
+   std::vector<Socket> m_Sockets;
+   int                 m_Streams;   // epoll instance watching the TCP connections
+
+   /* Keyed by socket index and message ID, which together make up the lower 32 bits of a handle */
+   Transactions                                                                m_Transactions;
+   std::priority_queue<Deadline, std::vector<Deadline>, std::greater<Deadline>> m_Deadlines;
+   uint64_t                                                                    m_Serial;
+   std::mt19937_64                                                             m_Random;
+
+   std::array<Byte, PacketHeader::SIZE + 255 + 4 + 11> m_Query;   // question and OPT record
+   std::vector<Byte>                              m_Response;
+   TransportStats                                 m_Stats;
+
+public:
+   UpstreamTransport(const UpstreamTransport &) = delete;
+   ~UpstreamTransport();
+
+   /**
+    * Transport with `sockets` IPv4 sockets and, where the host supports it, as many IPv6 sockets.
+    */
+   static Result<UniqueRef<UpstreamTransport>>
+   create(IUpstreamListener &listener, size_t sockets);
+
+   /**
+    * Sends the question to `server`. Its outcome is reported to the listener along with `token`, unless
+    * the query is cancelled first.
+    *
+    * @returns Handle of the query, for `cancel`.
+    */
+   Result<uint64_t>
+   send(const ServerAddress      &server,
+        const DomainName         &name,
+        uint16_t                  type,
+        uint16_t                  class_,
+        bool                      recursion_desired,
+        std::chrono::milliseconds timeout,
+        uint64_t                  token);
+
+   /**
+    * Forgets a query, its outcome is never reported. Unknown or finished handles are ignored.
+    */
+   void
+   cancel(uint64_t handle);
+
+   /**
+    * Reads every datagram waiting on `fd` and reports the responses among them, or makes progress on the
+    * TCP connections if `fd` is the one watching them.
+    */
+   void
+   receive(int fd);
+
+   /**
+    * Reports every query whose timeout has passed by `now`.
+    */
+   void
+   expire(TimePoint now);
+
+   /**
+    * Time until the next query times out, at most `limit`.
+    */
+   std::chrono::milliseconds
+   get_wait(TimePoint now, std::chrono::milliseconds limit) const;
+
+   std::vector<int>
+   get_fds() const;
+
+   size_t
+   get_outstanding() const {
+      return m_Transactions.size();
+   }
+
+   const TransportStats &
+   get_stats() const {
+      return m_Stats;
+   }
+
+private:
+   UpstreamTransport(IUpstreamListener &listener);
+
+   Result<void>
+   open(int family, size_t count);
+
+   /**
+    * Encodes the query of `transaction` with message ID `id` into `m_Query`.
+    *
+    * @returns Length of the query.
+    */
+   size_t
+   encode(uint16_t id, const Transaction &transaction);
+
+   void
+   handle_response(size_t socket, std::span<const Byte> response, const sockaddr_storage &peer);
+
+   /**
+    * Byte `index` of the name of `transaction` as it goes out, in the case picked for it.
+    */
+   static Byte
+   get_name_byte(const Transaction &transaction, size_t index);
+
+   /**
+    * Whether `view` is a response echoing the question of `transaction`, down to the case of every letter.
+    */
+   static bool
+   is_answer(const PacketView &view, const Transaction &transaction);
+
+   /**
+    * Asks the query of a truncated response again over TCP.
+    */
+   void
+   connect(Transactions::iterator it);
+
+   void
+   progress(Transactions::iterator it);
+
+   /**
+    * Ends a transaction with its response and reports it.
+    */
+   void
+   complete(Transactions::iterator it, const PacketView &view);
+
+   /**
+    * Ends a transaction without a response and reports it as timed out.
+    */
+   void
+   fail(Transactions::iterator it);
+
+   /**
+    * Closes the connection of a transaction, if any, and forgets it.
+    */
+   void
+   forget(Transactions::iterator it);
+};
+
+/* ------------------------------------------------------------------------------------------------------- */
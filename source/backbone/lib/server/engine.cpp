@@ -0,0 +1,76 @@
+#include "engine.hpp"
+
+#include <array>
+#include <sys/socket.h>
+
+#include "socket_engine.hpp"
+#include "uring_engine.hpp"
+
+/* ------------------------------------------------------------------------------------------------------- */
+
+void
+DatagramResponder::respond(const Waiter &waiter, std::span<const Byte> response) {
+   std::array<Byte, RateLimiter::SLIPPED_SIZE> slipped;
+   if (m_Limiter) {
+      response = m_Limiter->apply_shared(reinterpret_cast<const sockaddr &>(waiter.peer), response, slipped);
+      if (response.empty()) {
+         return;
+      }
+   }
+
+   // Like the worker itself, a response the socket does not take right away is dropped
+   sendto(m_Fd,
+          response.data(),
+          response.size(),
+          MSG_DONTWAIT,
+          reinterpret_cast<const sockaddr *>(&waiter.peer),
+          waiter.peer_length);
+}
+
+/* ------------------------------------------------------------------------------------------------------- */
+
+Result<UniqueRef<IEngine>>
+IEngine::create(
+    EngineType type, UdpSocket socket, QueryHandler handler, WorkerStats &stats, RateLimiter *limiter) {
+   switch (type) {
+   case EngineType::SOCKET: {
+      return UniqueRef<IEngine>(
+          CreateUniqueRef<SocketEngine>(std::move(socket), std::move(handler), stats, limiter));
+   }
+   case EngineType::URING: {
+      auto engine = UringEngine::create(std::move(socket), std::move(handler), stats, limiter);
+      RETURN_IF_ERROR(engine);
+      return UniqueRef<IEngine>(std::move(engine.get_value()));
+   }
+   }
+
+   return Error("Unknown engine type");
+}
+
+/* ------------------------------------------------------------------------------------------------------- */
+
+Result<EngineType>
+ParseEngineType(const std::string &name) {
+   if (name == "socket") {
+      return EngineType::SOCKET;
+   }
+   if (name == "io_uring" || name == "uring") {
+      return EngineType::URING;
+   }
+
+   return Error("Unknown engine: " + name);
+}
+
+/* ------------------------------------------------------------------------------------------------------- */
+
+const char *
+GetEngineName(EngineType type) {
+   switch (type) {
+   case EngineType::SOCKET: return "socket";
+   case EngineType::URING: return "io_uring";
+   }
+
+   return "unknown";
+}
+
+/* ------------------------------------------------------------------------------------------------------- */
@@ -0,0 +1,108 @@
+#pragma once
+
+#include <atomic>
+#include <cstdint>
+#include <string>
+
+#include <backbone/core/pch>
+#include "handler.hpp"
+#include "socket.hpp"
+
+/* ------------------------------------------------------------------------------------------------------- */
+
+/**
+ * @brief
+ * Counters of a single worker. Only the owning worker writes them, everybody else only reads.
+ *
+ * @details
+ * `recv_syscalls` counts every system call made to wait for datagrams and `send_syscalls` every system call
+ * made only to flush responses. An engine that does both in one call (io_uring) accounts it as a receive.
+ * `connections` only counts for TCP, every accepted connection.
+ */
+struct alignas(64) WorkerStats {
+   std::atomic<uint64_t> received      = 0;
+   std::atomic<uint64_t> sent          = 0;
+   std::atomic<uint64_t> dropped       = 0;
+   std::atomic<uint64_t> recv_syscalls = 0;
+   std::atomic<uint64_t> send_syscalls = 0;
+   std::atomic<uint64_t> connections   = 0;
+
+   inline void
+   add(std::atomic<uint64_t> &counter, uint64_t value) {
+      counter.store(counter.load(std::memory_order_relaxed) + value, std::memory_order_relaxed);
+   }
+};
+
+/* ------------------------------------------------------------------------------------------------------- */
+
+/**
+ * @brief
+ * Sends the deferred responses of a datagram worker out of the worker's own socket, straight from the
+ * thread that produced them. `sendto` on a UDP socket is safe alongside the worker's own I/O.
+ *
+ * @details
+ * They go through `limiter` on their way out, if there is one. It is the same one the workers use.
+ */
+class DatagramResponder : public IResponder {
+private:
+   int          m_Fd;
+   RateLimiter *m_Limiter;
+
+public:
+   DatagramResponder(int fd, RateLimiter *limiter) : m_Fd(fd), m_Limiter(limiter) {}
+
+   void
+   respond(const Waiter &waiter, std::span<const Byte> response) override;
+};
+
+/* ------------------------------------------------------------------------------------------------------- */
+
+enum class EngineType {
+   SOCKET,   // recvmmsg/sendmmsg
+   URING,    // io_uring with multishot receive
+};
+
+/* ------------------------------------------------------------------------------------------------------- */
+
+/**
+ * @brief
+ * I/O backend driving one worker: it owns the worker's socket, moves datagrams in and out of the kernel
+ * and runs every request through the worker's `QueryHandler`.
+ *
+ * @details
+ * The interface is only crossed once per worker (`run` loops internally), so the virtual dispatch never
+ * shows up on the per-packet path.
+ */
+class IEngine {
+public:
+   virtual ~IEngine() = default;
+
+   virtual const char *
+   get_name() const = 0;
+
+   /**
+    * Serves datagrams until `running` turns false. Engines wake up at least every 100ms to notice.
+    */
+   virtual void
+   run(const std::atomic<bool> &running) = 0;
+
+   /**
+    * Engine of one worker. `limiter`, if any, limits the responses sent later on the worker's behalf.
+    */
+   static Result<UniqueRef<IEngine>>
+   create(EngineType   type,
+          UdpSocket    socket,
+          QueryHandler handler,
+          WorkerStats &stats,
+          RateLimiter *limiter = nullptr);
+};
+
+/* ------------------------------------------------------------------------------------------------------- */
+
+Result<EngineType>
+ParseEngineType(const std::string &name);
+
+const char *
+GetEngineName(EngineType type);
+
+/* ------------------------------------------------------------------------------------------------------- */
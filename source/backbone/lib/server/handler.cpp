@@ -0,0 +1,336 @@
+#include "handler.hpp"
+
+#include <algorithm>
+#include <cstring>
+
+/* ------------------------------------------------------------------------------------------------------- */
+
+Result<size_t>
+QueryHandler::handle(std::span<const Byte> request, PacketBuffer &response, const Requester *requester) {
+   auto length = write_response(request, response, requester);
+
+   // Only datagram clients can be spoofed, and deferred responses are not written yet
+   if (!m_Limiter || !length || length.get_value() == DEFERRED || !requester || !requester->peer) {
+      return length;
+   }
+
+   return m_Limiter->apply(*requester->peer, { response.get_data(), length.get_value() });
+}
+
+/* ------------------------------------------------------------------------------------------------------- */
+
+Result<size_t>
+QueryHandler::write_response(std::span<const Byte> request,
+                             PacketBuffer         &response,
+                             const Requester      *requester) {
+   // The previous response has been written, nothing allocated for it is needed anymore
+   m_Arena->reset();
+
+   auto _view = PacketView::from_bytes(request);
+   if (!_view) {
+      // Can't even read the header, hence there is nobody to answer to
+      if (request.size() < 12 || (request[2] & 0x80)) {
+         return _view.get_error();
+      }
+
+      uint16_t id      = (request[0] << 8) | request[1];
+      uint8_t  op_code = (request[2] >> 3) & 0x0F;
+      return write_error(id, op_code, PacketHeader::FORMAT_ERROR, response);
+   }
+   auto &view = _view.get_value();
+
+   /* Never answer responses, that is how reflection loops start */
+   if (view.query_response()) {
+      return Error(PACKET_READ_CORRUPTED_HEADER, "Received a response instead of a query");
+   }
+
+   if (view.op_code() != 0) {
+      return write_error(view.id(), view.op_code(), PacketHeader::NOT_IMPLEMENTED, response);
+   }
+
+   if (view.question_count() != 1) {
+      return write_error(view.id(), view.op_code(), PacketHeader::FORMAT_ERROR, response);
+   }
+
+   auto question = *view.questions().begin();
+   auto limit    = get_size_limit(view, requester, response);
+
+   /* Zone and cache */
+   if (m_Zones || m_Cache || m_NegativeCache) {
+      auto answered = write_local(view, question, limit, response);
+      if (answered) {
+         return answered.value();
+      }
+   }
+
+   /* Everything else needs recursion, which only clients that asked for it get */
+   if (m_Resolver && requester && view.recursion_desired()) {
+      // The key crosses over to the resolver's thread, so it can't live in the arena
+      auto name = question.name.to_domain_name();
+      if (name) {
+         auto key        = CacheKey(std::move(name.get_value()), question.type, question.class_);
+         auto waiter     = Waiter(request, *requester);
+         waiter.max_size = limit;
+         m_Resolver->resolve(std::move(key), std::move(waiter));
+         return DEFERRED;
+      }
+   }
+
+   /* No answer source left, so refuse while echoing the question */
+   auto header = PacketHeader(view.id(),
+                              true,
+                              view.op_code(),
+                              false,
+                              false,
+                              view.recursion_desired(),
+                              false,
+                              0,
+                              PacketHeader::REFUSED,
+                              1,
+                              0,
+                              0,
+                              0);
+
+   auto res = header.write_to_buffer(response).except("Failed to write response header");
+   RETURN_IF_ERROR(res);
+
+   auto echo = view.get_question_bytes();
+   if (echo.size() > response.get_write_remaining()) {
+      return Error(PACKET_WRITE_CORRUPTED_BUFFER, "Question does not fit into the response");
+   }
+   std::memcpy(response.get_data() + response.get_write_index(), echo.data(), echo.size());
+
+   res = response.seek_write(response.get_write_index() + echo.size());
+   RETURN_IF_ERROR(res);
+
+   return response.get_write_index();
+}
+
+/* ------------------------------------------------------------------------------------------------------- */
+
+size_t
+QueryHandler::get_size_limit(const PacketView   &request,
+                             const Requester    *requester,
+                             const PacketBuffer &response) {
+   size_t limit = std::min(requester ? requester->max_size : SIZE_MAX, response.get_capacity());
+   if (!requester || !requester->peer) {
+      return limit;
+   }
+
+   // Below 512 bytes the advertised size means 512 bytes (RFC 6891 6.2.5)
+   auto payload = request.get_udp_payload_size().value_or(BufferPool::UDP_SIZE);
+   return std::min<size_t>(limit, std::max<size_t>(payload, BufferPool::UDP_SIZE));
+}
+
+/* ------------------------------------------------------------------------------------------------------- */
+
+std::optional<size_t>
+QueryHandler::write_local(const PacketView   &request,
+                          const QuestionView &question,
+                          size_t              limit,
+                          PacketBuffer       &response) {
+   // Folded and hashed once for both lookups. Names without a dotted form can't be looked up at all
+   auto _name = question.name.to_domain_name(get_allocator());
+   if (!_name) {
+      return std::nullopt;
+   }
+   auto &name = _name.get_value();
+
+   if (m_Zones) {
+      auto zone = m_Zones->read(m_Reader);
+      if (zone.get()) {
+         auto answered = write_authoritative(*zone.get(), request, question, name, limit, response);
+         if (answered) {
+            return answered;
+         }
+      }
+   }
+
+   if (m_Cache || m_NegativeCache) {
+      return write_cached(request, question, std::move(name), limit, response);
+   }
+
+   return std::nullopt;
+}
+
+/* ------------------------------------------------------------------------------------------------------- */
+
+std::optional<size_t>
+QueryHandler::write_authoritative(const Zone         &zone,
+                                  const PacketView   &request,
+                                  const QuestionView &question,
+                                  const DomainName   &name,
+                                  size_t              limit,
+                                  PacketBuffer       &response) {
+   auto match = zone.lookup(name);
+   if (match.kind == ZoneMatch::NOT_AUTHORITATIVE) {
+      return std::nullopt;
+   }
+
+   // Owner names are written as pointers into the echoed question, so it has to be a plain name
+   auto echo = request.get_question_bytes();
+   if (echo.size() != name.get_length() + 4 ||
+       12 + echo.size() > response.get_capacity()) {
+      return std::nullopt;
+   }
+
+   Byte *out = response.get_data();
+   std::memcpy(out + 12, echo.data(), echo.size());
+
+   size_t question_end = 12 + echo.size();
+   size_t position     = question_end;
+   bool   fits         = true;
+
+   auto write_record = [&](uint16_t owner, const ZoneRecord &record, uint32_t ttl) {
+      auto   data   = zone.get_rdata(record);
+      size_t length = (owner == 0 ? 1 : 2) + 10 + data.size();
+      if (position + length > limit) {
+         fits = false;
+         return;
+      }
+
+      Byte *p = out + position;
+      if (owner == 0) {
+         *p++ = 0;
+      } else {
+         *p++ = 0xC0 | (owner >> 8);
+         *p++ = owner & 0xFF;
+      }
+      p[0] = record.type >> 8;
+      p[1] = record.type & 0xFF;
+      p[2] = record.class_ >> 8;
+      p[3] = record.class_ & 0xFF;
+      p[4] = ttl >> 24;
+      p[5] = ttl >> 16;
+      p[6] = ttl >> 8;
+      p[7] = ttl & 0xFF;
+      p[8] = data.size() >> 8;
+      p[9] = data.size() & 0xFF;
+      std::memcpy(p + 10, data.data(), data.size());
+
+      position += length;
+   };
+
+   auto matches = [&](const ZoneRecord &record, uint16_t type) {
+      return (question.class_ == 255 || record.class_ == question.class_) &&
+             (type == PacketQuestion::ANY || record.type == type);
+   };
+
+   /* Answers. Without records of the asked type, a CNAME answers in their place */
+   uint16_t answers = 0, authorities = 0;
+   if (match.kind == ZoneMatch::EXACT || match.kind == ZoneMatch::WILDCARD) {
+      auto records = zone.get_records(match.node);
+      for (const auto &record : records) {
+         if (matches(record, question.type)) {
+            write_record(12, record, record.ttl);
+            answers++;
+         }
+      }
+      for (size_t i = 0; answers == 0 && i < records.size(); i++) {
+         if (matches(records[i], PacketQuestion::CNAME)) {
+            write_record(12, records[i], records[i].ttl);
+            answers++;
+         }
+      }
+   }
+
+   /* No data: the SOA of the zone goes into the authority section, TTL capped by its minimum */
+   if (answers == 0) {
+      // The apex is the last `apex_labels` labels of the name, point at where they start in the question
+      uint16_t owner = 0;
+      if (match.apex_labels > 0) {
+         owner = 12 + name.get_label_offset(name.get_label_count() - match.apex_labels);
+      }
+
+      for (const auto &record : zone.get_records(match.apex)) {
+         if (record.type == PacketQuestion::SOA && record.data_length >= 20) {
+            auto     data    = zone.get_rdata(record);
+            uint32_t minimum = (uint32_t(data[data.size() - 4]) << 24) | (data[data.size() - 3] << 16) |
+                               (data[data.size() - 2] << 8) | data[data.size() - 1];
+            write_record(owner, record, std::min(record.ttl, minimum));
+            authorities++;
+            break;
+         }
+      }
+   }
+
+   /* Whatever does not fit is dropped and the client is told to retry over TCP */
+   if (!fits) {
+      position    = question_end;
+      answers     = 0;
+      authorities = 0;
+   }
+
+   auto code   = match.kind == ZoneMatch::NAME_ERROR ? PacketHeader::NAME_ERROR : PacketHeader::NO_ERROR;
+   auto header = PacketHeader(request.id(),
+                              true,
+                              request.op_code(),
+                              true,
+                              !fits,
+                              request.recursion_desired(),
+                              false,
+                              0,
+                              code,
+                              1,
+                              answers,
+                              authorities,
+                              0);
+
+   auto res = header.write_to_buffer(response);
+   if (!res || !response.seek_write(position)) {
+      return std::nullopt;
+   }
+
+   return position;
+}
+
+/* ------------------------------------------------------------------------------------------------------- */
+
+std::optional<size_t>
+QueryHandler::write_cached(const PacketView   &request,
+                           const QuestionView &question,
+                           DomainName          name,
+                           size_t              limit,
+                           PacketBuffer       &response) {
+   auto key = CacheKey(std::move(name), question.type, question.class_);
+
+   std::optional<size_t> length;
+   auto                  write = [&](const CachedAnswer &answer, uint32_t ttl) {
+      if (answer.wire) {
+         auto _length = answer.wire->write_to(request, ttl, response, limit);
+         if (_length) {
+            length = _length.get_value();
+         }
+      }
+   };
+
+   auto lookup = m_Cache ? m_Cache->lookup(key, write) : CacheLookup::MISS;
+   if (lookup == CacheLookup::MISS && m_NegativeCache) {
+      m_NegativeCache->visit(key, write);
+   }
+
+   // The key crosses over to the resolver's thread, out of the arena with it
+   if (lookup == CacheLookup::REFRESH && m_Resolver) {
+      auto name = DomainName(key.name, DomainName::allocator_type());
+      m_Resolver->refresh(CacheKey(std::move(name), key.type, key.class_));
+   }
+
+   return length;
+}
+
+/* ------------------------------------------------------------------------------------------------------- */
+
+Result<size_t>
+QueryHandler::write_error(uint16_t                 id,
+                          uint8_t                  op_code,
+                          PacketHeader::ResultCode code,
+                          PacketBuffer            &response) {
+   auto header = PacketHeader(id, true, op_code, false, false, false, false, 0, code, 0, 0, 0, 0);
+
+   auto res = header.write_to_buffer(response).except("Failed to write error response");
+   RETURN_IF_ERROR(res);
+
+   return response.get_write_index();
+}
+
+/* ------------------------------------------------------------------------------------------------------- */
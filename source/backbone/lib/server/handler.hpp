@@ -0,0 +1,148 @@
+#pragma once
+
+#include <span>
+
+#include <backbone/core/pch>
+#include <backbone/lib/buffer/arena.hpp>
+#include <backbone/lib/cache/answer.hpp>
+#include <backbone/lib/packet/packet.hpp>
+#include <backbone/lib/packet/view.hpp>
+#include <backbone/lib/resolver/resolver.hpp>
+#include <backbone/lib/zone/store.hpp>
+#include "rate_limit.hpp"
+
+/* ------------------------------------------------------------------------------------------------------- */
+
+/**
+ * @brief
+ * Turns one request datagram into one response datagram.
+ *
+ * @details
+ * The handler is the transport independent part of the query pipeline. Every worker owns its own instance,
+ * so implementations must not rely on any shared mutable state that is not itself thread-safe.
+ *
+ * Names inside the current zone are answered authoritatively from it, everything else goes to the cache,
+ * then to the negative cache the resolver keeps its NXDOMAIN and NODATA answers in.
+ * The zone is pinned through the handler's own reader slot of the `ZoneStore` for one query at a time.
+ * Cache misses asking for recursion go to the `Resolver`, if there is one, and are answered later through
+ * the `Requester` of the transport.
+ *
+ * Responses to datagram clients go through the `RateLimiter`, if there is one, as the very last step:
+ * which class of response a client gets is only known once it has been written. Deferred responses are
+ * limited by the transport that sends them, against the same limiter.
+ *
+ * Whatever a query needs to allocate (parsed packets, names) comes from the handler's `QueryArena`, which
+ * is reset as the next query starts, so a worker's memory does not grow with the number of queries.
+ */
+class QueryHandler {
+public:
+   /**
+    * Length `handle` returns when there is nothing to send right now: the request has been handed to the
+    * resolver, or its response has been dropped by the rate limiter.
+    */
+   static constexpr size_t DEFERRED = 0;
+
+private:
+   AnswerCache          *m_Cache;
+   ZoneStore            *m_Zones;
+   size_t                m_Reader;
+   Resolver             *m_Resolver;
+   AnswerCache          *m_NegativeCache;
+   RateLimiter          *m_Limiter;
+   UniqueRef<QueryArena> m_Arena;
+
+public:
+   QueryHandler(AnswerCache *cache          = nullptr,
+                ZoneStore   *zones          = nullptr,
+                size_t       reader         = 0,
+                Resolver    *resolver       = nullptr,
+                AnswerCache *negative_cache = nullptr,
+                RateLimiter *limiter        = nullptr)
+       : m_Cache(cache), m_Zones(zones), m_Reader(reader), m_Resolver(resolver),
+         m_NegativeCache(negative_cache), m_Limiter(limiter), m_Arena(CreateUniqueRef<QueryArena>()) {}
+   QueryHandler(QueryHandler &&other) = default;
+   ~QueryHandler()                    = default;
+
+   /**
+    * Allocator for anything that lives as long as the current query.
+    */
+   std::pmr::polymorphic_allocator<>
+   get_allocator() {
+      return m_Arena->get_allocator();
+   }
+
+   /**
+    * Parses `request` and writes the response into `response`. Without a `requester` the request is never
+    * deferred.
+    *
+    * @returns Size of the encoded response, or `DEFERRED` when the response is sent later through the
+    * requester. An error means the request must be dropped without a reply (e.g. it is too short to even
+    * carry an ID, or it is itself a response).
+    */
+   Result<size_t>
+   handle(std::span<const Byte> request, PacketBuffer &response, const Requester *requester = nullptr);
+
+   /**
+    * Called by the engine before every batch of requests it passes to `handle`, for what only needs
+    * doing once per batch.
+    */
+   void
+   begin_batch() {
+      if (m_Limiter) {
+         m_Limiter->tick();
+      }
+   }
+
+private:
+   /**
+    * Everything `handle` does but rate limiting.
+    */
+   Result<size_t>
+   write_response(std::span<const Byte> request, PacketBuffer &response, const Requester *requester);
+
+   /**
+    * Longest response the client of `request` takes: what its transport carries and fits into
+    * `response`, and for datagrams no more than the payload size advertised with EDNS0, 512 bytes without
+    * it. Longer responses go out truncated.
+    */
+   static size_t
+   get_size_limit(const PacketView &request, const Requester *requester, const PacketBuffer &response);
+
+   /**
+    * Answers from the zone or else from the cache, looking the question name up in either.
+    */
+   std::optional<size_t>
+   write_local(const PacketView   &request,
+               const QuestionView &question,
+               size_t              limit,
+               PacketBuffer       &response);
+
+   /**
+    * Answers from the zone, unless no zone encloses the name. `name` is the question name.
+    */
+   std::optional<size_t>
+   write_authoritative(const Zone         &zone,
+                       const PacketView   &request,
+                       const QuestionView &question,
+                       const DomainName   &name,
+                       size_t              limit,
+                       PacketBuffer       &response);
+
+   /**
+    * Serves the query straight from a pre-encoded response in the cache, if there is one. `name` is the
+    * question name, which becomes part of the cache key. Entries the cache wants refreshed, stale or
+    * popular and about to expire, are handed to the resolver while the client gets what is cached.
+    * Misses fall back to the negative cache, which is never refreshed ahead of time.
+    */
+   std::optional<size_t>
+   write_cached(const PacketView   &request,
+                const QuestionView &question,
+                DomainName          name,
+                size_t              limit,
+                PacketBuffer       &response);
+
+   Result<size_t>
+   write_error(uint16_t id, uint8_t op_code, PacketHeader::ResultCode code, PacketBuffer &response);
+};
+
+/* ------------------------------------------------------------------------------------------------------- */
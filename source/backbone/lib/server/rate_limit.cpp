@@ -0,0 +1,234 @@
+#include "rate_limit.hpp"
+
+#include <algorithm>
+#include <bit>
+#include <cstring>
+#include <ctime>
+#include <netinet/in.h>
+#include <random>
+
+/* ------------------------------------------------------------------------------------------------------- */
+
+RateLimiter::RateLimiter(const RateLimitConfig &config)
+    : m_Slip(config.slip), m_Now(0), m_Over(0), m_Limited(0), m_Slipped(0) {
+   size_t buckets = std::bit_ceil(std::max<size_t>(config.buckets, WAYS));
+   m_Buckets      = CreateUniqueRef<std::atomic<uint64_t>[]>(buckets);
+   m_SetBits      = std::countr_zero(buckets / WAYS);
+
+   std::random_device random;
+   m_Seed = (static_cast<uint64_t>(random()) << 32) | random();
+
+   // As fine grained as the bucket allows: a second worth of tokens fills it
+   uint32_t rate = std::clamp<uint32_t>(config.responses_per_second, 1, MAX_RATE);
+   m_Cost        = TOKEN_MASK / rate;
+   m_Burst       = rate * m_Cost;
+
+   uint8_t ipv4 = std::min<uint8_t>(config.ipv4_prefix, 32);
+   uint8_t ipv6 = std::min<uint8_t>(config.ipv6_prefix, 56);
+   m_IPv4Mask   = ipv4 == 0 ? 0 : UINT32_MAX << (32 - ipv4);
+   m_IPv6Mask   = ipv6 == 0 ? 0 : UINT64_MAX << (64 - ipv6);
+
+   tick();
+}
+
+/* ------------------------------------------------------------------------------------------------------- */
+
+void
+RateLimiter::tick() {
+   // Coarse is plenty at a one second rate
+   timespec time;
+   clock_gettime(CLOCK_MONOTONIC_COARSE, &time);
+   m_Now.store(time.tv_sec * 1000 + time.tv_nsec / 1000000, std::memory_order_relaxed);
+}
+
+/* ------------------------------------------------------------------------------------------------------- */
+
+size_t
+RateLimiter::apply(const sockaddr &peer, std::span<Byte> response) {
+   switch (check(peer, classify(response), m_Now.load(std::memory_order_relaxed))) {
+      case SEND: return response.size();
+      case SLIP: return truncate(response);
+      default: return 0;
+   }
+}
+
+/* ------------------------------------------------------------------------------------------------------- */
+
+std::span<const Byte>
+RateLimiter::apply_shared(const sockaddr                &peer,
+                          std::span<const Byte>          response,
+                          std::span<Byte, SLIPPED_SIZE> slipped) {
+   tick();
+
+   switch (check(peer, classify(response), m_Now.load(std::memory_order_relaxed))) {
+      case SEND: return response;
+      case SLIP: {
+         // The question always fits, whatever follows it is cut off anyway
+         size_t length = std::min(response.size(), slipped.size());
+         std::copy_n(response.begin(), length, slipped.begin());
+         return slipped.first(truncate(slipped.first(length)));
+      }
+      default: return {};
+   }
+}
+
+/* ------------------------------------------------------------------------------------------------------- */
+
+RateLimiter::Verdict
+RateLimiter::check(const sockaddr &peer, Class kind, uint32_t now) {
+   uint64_t key = get_key(peer, kind);
+   if (key == 0) {
+      return SEND;
+   }
+
+   uint64_t hash = get_hash(key);
+   uint64_t tag  = (hash >> TOKEN_BITS >> TIME_BITS) | 1;
+   auto    *set  = &m_Buckets[(hash & ((size_t(1) << m_SetBits) - 1)) * WAYS];
+   now &= TIME_MASK;
+
+   auto get_elapsed = [now](uint64_t bucket) {
+      return std::min<uint64_t>((now - bucket) & TIME_MASK, 1000);
+   };
+
+   while (true) {
+      /* The prefix's own bucket, or else the one of the set that has been idle the longest */
+      size_t   way = WAYS;
+      uint64_t bucket;
+      for (size_t i = 0; i < WAYS; i++) {
+         bucket = set[i].load(std::memory_order_relaxed);
+         if (bucket >> TOKEN_BITS >> TIME_BITS == tag) {
+            way = i;
+            break;
+         }
+      }
+
+      uint64_t tokens = m_Burst;
+      if (way < WAYS) {
+         // Refilled for the time since the last response, a second at most since that fills it anyway
+         uint64_t left = (bucket >> TIME_BITS) & TOKEN_MASK;
+         tokens        = std::min<uint64_t>(left + get_elapsed(bucket) * m_Burst / 1000, m_Burst);
+      } else {
+         uint64_t idle = 0;
+         for (size_t i = 0; i < WAYS; i++) {
+            uint64_t other   = set[i].load(std::memory_order_relaxed);
+            uint64_t elapsed = other == 0 ? 1000 : get_elapsed(other);
+            if (elapsed >= 1000 && elapsed >= idle) {
+               way    = i;
+               bucket = other;
+               idle   = elapsed;
+            }
+         }
+
+         // Taking over a busy bucket would hand its prefix a fresh burst
+         if (way == WAYS) {
+            return limit();
+         }
+      }
+
+      bool send = tokens >= m_Cost;
+      if (send) {
+         tokens -= m_Cost;
+      }
+
+      uint64_t updated = (tag << TOKEN_BITS << TIME_BITS) | (tokens << TIME_BITS) | now;
+      if (set[way].compare_exchange_weak(bucket, updated, std::memory_order_relaxed)) {
+         return send ? SEND : limit();
+      }
+   }
+}
+
+/* ------------------------------------------------------------------------------------------------------- */
+
+RateLimiter::Verdict
+RateLimiter::limit() {
+   m_Limited.fetch_add(1, std::memory_order_relaxed);
+   if (m_Slip > 0 && (m_Over.fetch_add(1, std::memory_order_relaxed) + 1) % m_Slip == 0) {
+      m_Slipped.fetch_add(1, std::memory_order_relaxed);
+      return SLIP;
+   }
+   return DROP;
+}
+
+/* ------------------------------------------------------------------------------------------------------- */
+
+RateLimiter::Class
+RateLimiter::classify(std::span<const Byte> response) {
+   if (response.size() < 12) {
+      return ERROR;
+   }
+
+   uint8_t code = response[3] & 0x0F;
+   if (code == 3) {
+      return NXDOMAIN;
+   }
+   if (code != 0) {
+      return ERROR;
+   }
+   return (response[6] | response[7]) ? ANSWER : NODATA;
+}
+
+/* ------------------------------------------------------------------------------------------------------- */
+
+size_t
+RateLimiter::truncate(std::span<Byte> response) {
+   if (response.size() < 12) {
+      return response.size();
+   }
+
+   /* Skip the question, if there is one. Responses echo it the way the client sent it */
+   size_t length = 12;
+   if (response[4] == 0 && response[5] == 1) {
+      while (length < response.size() && response[length] != 0 && (response[length] & 0xC0) == 0) {
+         length += 1 + response[length];
+      }
+      bool pointer = length < response.size() && response[length] != 0;
+      length       = std::min(length + (pointer ? 2 : 1) + 4, response.size());
+   }
+
+   response[2] |= 0x02;
+   std::memset(response.data() + 4, 0, 8);
+   response[5] = length > 12 ? 1 : 0;
+   return length;
+}
+
+/* ------------------------------------------------------------------------------------------------------- */
+
+uint64_t
+RateLimiter::get_key(const sockaddr &peer, Class kind) const {
+   // The low byte holds the family and the class, which the prefix never reaches
+   if (peer.sa_family == AF_INET) {
+      uint32_t address;
+      std::memcpy(&address, &reinterpret_cast<const sockaddr_in &>(peer).sin_addr, 4);
+      return (static_cast<uint64_t>(__builtin_bswap32(address) & m_IPv4Mask) << 8) | 0x80 | kind;
+   }
+
+   if (peer.sa_family == AF_INET6) {
+      const auto &address = reinterpret_cast<const sockaddr_in6 &>(peer).sin6_addr;
+
+      // IPv4 clients of a dual stack socket, who would otherwise all share the prefix ::/56
+      if (IN6_IS_ADDR_V4MAPPED(&address)) {
+         uint32_t ipv4;
+         std::memcpy(&ipv4, address.s6_addr + 12, 4);
+         return (static_cast<uint64_t>(__builtin_bswap32(ipv4) & m_IPv4Mask) << 8) | 0x80 | kind;
+      }
+
+      uint64_t high;
+      std::memcpy(&high, address.s6_addr, 8);
+      return (__builtin_bswap64(high) & m_IPv6Mask) | 0x40 | kind;
+   }
+
+   return 0;
+}
+
+/* ------------------------------------------------------------------------------------------------------- */
+
+uint64_t
+RateLimiter::get_hash(uint64_t key) const {
+   // Keyed with the seed, then mixed like MurmurHash3's finalizer
+   uint64_t hash = key ^ m_Seed;
+   hash          = (hash ^ (hash >> 33)) * 0xFF51AFD7ED558CCDull;
+   hash          = (hash ^ (hash >> 33)) * 0xC4CEB9FE1A85EC53ull;
+   return hash ^ (hash >> 33);
+}
+
+/* ------------------------------------------------------------------------------------------------------- */
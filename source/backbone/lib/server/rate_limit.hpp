@@ -0,0 +1,187 @@
+#pragma once
+
+#include <atomic>
+#include <cstdint>
+#include <span>
+#include <sys/socket.h>
+
+#include <backbone/core/pch>
+
+/* ------------------------------------------------------------------------------------------------------- */
+
+class RateLimitConfig {
+public:
+   /**
+    * Responses per second one client prefix gets of each response class, whichever worker sends them.
+    * Zero disables rate limiting.
+    */
+   uint32_t responses_per_second = 0;
+
+   /**
+    * Every `slip`-th response over the limit is sent truncated instead of dropped, so a real client
+    * caught up in it can still retry over TCP. Zero drops them all, one truncates them all.
+    */
+   uint32_t slip = 2;
+
+   /**
+    * Clients are grouped by these prefixes. IPv6 prefixes longer than 56 bits are cut to 56.
+    */
+   uint8_t ipv4_prefix = 24;
+   uint8_t ipv6_prefix = 56;
+
+   /**
+    * Buckets shared by every worker, rounded up to a power of two.
+    */
+   size_t buckets = 256 * 1024;
+};
+
+/* ------------------------------------------------------------------------------------------------------- */
+
+/**
+ * @brief
+ * Response rate limiting: a token bucket per client prefix and response class, in one fixed-size table
+ * shared by every UDP worker and by the responses the resolver sends later.
+ *
+ * @details
+ * Spoofed queries make the server reflect (and amplify) its responses at a victim, and every victim
+ * address within a prefix is the same victim. Responses are therefore counted per /24 or /56 of the
+ * address they go to and per class (answer, NODATA, NXDOMAIN, error), so that a flood of one kind of
+ * response is limited without touching the others. A spoofer picks the source ports, and with them the
+ * `SO_REUSEPORT` worker, so the limit has to hold across workers: all of them check the same table.
+ *
+ * A bucket is a single 64-bit word (tag, tokens and time) updated with compare-and-swap, so checking a
+ * response takes no lock, no allocation and one cache line. The table is two-way set associative and
+ * indexed by a hash keyed with a random seed, so nobody outside can tell which prefixes share a set. A
+ * bucket is only taken over once it has been idle for a second, which is when it would be full anyway: a
+ * prefix colliding with a busy one can't reset it. A prefix that finds both buckets of its set busy is
+ * treated as over the limit. The clock the buckets keep wraps every 17 minutes, so a bucket idle for a
+ * multiple of that may look busy for up to a second.
+ */
+class RateLimiter {
+public:
+   /**
+    * Highest rate, beyond which a second of tokens would not fit into a bucket.
+    */
+   static constexpr uint32_t MAX_RATE = (1 << 20) - 1;
+
+   /**
+    * Longest response `truncate` leaves: header and question.
+    */
+   static constexpr size_t SLIPPED_SIZE = 12 + 255 + 4;
+
+   enum Verdict {
+      SEND,
+      SLIP,   // send it truncated
+      DROP,
+   };
+
+   enum Class : uint8_t {
+      ANSWER,
+      NODATA,
+      NXDOMAIN,
+      ERROR,
+   };
+
+private:
+   /*
+    * Bucket layout, from the top: 24 bits of tag (never zero, a zero word is an unused bucket), 20 bits
+    * of tokens and 20 bits of milliseconds.
+    */
+   static constexpr int      TIME_BITS  = 20;
+   static constexpr int      TOKEN_BITS = 20;
+   static constexpr uint64_t TIME_MASK  = (1 << TIME_BITS) - 1;
+   static constexpr uint64_t TOKEN_MASK = (1 << TOKEN_BITS) - 1;
+   static constexpr size_t   WAYS       = 2;
+
+   UniqueRef<std::atomic<uint64_t>[]> m_Buckets;
+   size_t                             m_SetBits;
+   uint64_t                           m_Seed;
+   uint32_t                           m_Cost;    // tokens are kept in fractions, this many per response
+   uint32_t                           m_Burst;   // one second worth of tokens, in fractions
+   uint32_t                           m_Slip;
+   uint32_t                           m_IPv4Mask;
+   uint64_t                           m_IPv6Mask;
+
+   std::atomic<uint32_t> m_Now;    // milliseconds, as of the last `tick`
+   std::atomic<uint32_t> m_Over;   // responses over the limit so far, for the slip ratio
+   std::atomic<uint64_t> m_Limited;
+   std::atomic<uint64_t> m_Slipped;
+
+public:
+   RateLimiter(const RateLimitConfig &config);
+   RateLimiter(const RateLimiter &) = delete;
+   ~RateLimiter()                   = default;
+
+   /**
+    * Reads the clock `apply` goes by. Once per batch of requests is enough, the buckets refill by the
+    * millisecond.
+    */
+   void
+   tick();
+
+   /**
+    * Rate limits `response`, about to be sent to `peer`.
+    *
+    * @returns Length to send, which is shorter than the response when it has been truncated, or 0 when
+    * it must be dropped.
+    */
+   size_t
+   apply(const sockaddr &peer, std::span<Byte> response);
+
+   /**
+    * Same as `apply`, for a response that can't be changed in place. Reads the clock itself.
+    *
+    * @returns What to send: `response`, its truncated copy in `slipped`, or nothing when it must be
+    * dropped.
+    */
+   std::span<const Byte>
+   apply_shared(const sockaddr &peer, std::span<const Byte> response, std::span<Byte, SLIPPED_SIZE> slipped);
+
+   /**
+    * Takes a token for a response of class `kind` to `peer`. `now` is in milliseconds.
+    */
+   Verdict
+   check(const sockaddr &peer, Class kind, uint32_t now);
+
+   /**
+    * Responses that were over the limit, slipped ones included.
+    */
+   uint64_t
+   get_limited() const {
+      return m_Limited.load(std::memory_order_relaxed);
+   }
+
+   uint64_t
+   get_slipped() const {
+      return m_Slipped.load(std::memory_order_relaxed);
+   }
+
+   static Class
+   classify(std::span<const Byte> response);
+
+   /**
+    * Cuts `response` down to its header and question and sets TC.
+    *
+    * @returns The new length.
+    */
+   static size_t
+   truncate(std::span<Byte> response);
+
+private:
+   /**
+    * The prefix of `peer` combined with `kind`, or zero for an address family that is not limited.
+    */
+   uint64_t
+   get_key(const sockaddr &peer, Class kind) const;
+
+   uint64_t
+   get_hash(uint64_t key) const;
+
+   /**
+    * Counts a response over the limit and decides between slipping and dropping it.
+    */
+   Verdict
+   limit();
+};
+
+/* ------------------------------------------------------------------------------------------------------- */
@@ -0,0 +1,201 @@
+#include "server.hpp"
+
+#include <pthread.h>
+#include <sched.h>
+
+/* ------------------------------------------------------------------------------------------------------- */
+
+Server::Server(ServerConfig config) : m_Config(std::move(config)), m_Port(m_Config.port), m_Running(false) {}
+
+/* ------------------------------------------------------------------------------------------------------- */
+
+Server::~Server() {
+   stop();
+   wait();
+}
+
+/* ------------------------------------------------------------------------------------------------------- */
+
+Result<void>
+Server::start() {
+   size_t cores   = std::max(1u, std::thread::hardware_concurrency());
+   size_t threads = m_Config.threads > 0 ? m_Config.threads : cores;
+   size_t workers = threads + m_Config.tcp.threads;
+
+   // Each cache has a budget of its own, either can be turned off without the other
+   if (m_Config.cache.capacity > 0) {
+      m_Cache = CreateUniqueRef<AnswerCache>(m_Config.cache);
+   }
+   if (m_Config.negative_cache.capacity > 0) {
+      m_NegativeCache = CreateUniqueRef<AnswerCache>(m_Config.negative_cache);
+   }
+
+   m_Zones = CreateUniqueRef<ZoneStore>(workers);
+   if (!m_Config.zone.empty()) {
+      auto res = reload_zone();
+      RETURN_IF_ERROR(res);
+   }
+
+   if (m_Config.recursive) {
+      auto resolver = Resolver::create(m_Config.resolver, m_Cache.get(), m_NegativeCache.get());
+      RETURN_IF_ERROR(resolver);
+      m_Resolver = std::move(resolver.get_value());
+   }
+
+   // One limiter for every UDP worker and for the responses the resolver sends later on their behalf
+   if (m_Config.rate_limit.responses_per_second > 0) {
+      m_Limiter = CreateUniqueRef<RateLimiter>(m_Config.rate_limit);
+   }
+
+   /* Bind every socket and set up every engine first. The first bind resolves port 0 for the rest */
+   m_Stats = CreateUniqueRef<WorkerStats[]>(workers);
+   for (size_t i = 0; i < threads; i++) {
+      auto socket = UdpSocket::bind(m_Config.address, m_Port);
+      RETURN_IF_ERROR(socket);
+      m_Port = socket.get_value().get_port();
+
+      auto handler = QueryHandler(
+          m_Cache.get(), m_Zones.get(), i, m_Resolver.get(), m_NegativeCache.get(), m_Limiter.get());
+      auto engine = IEngine::create(m_Config.engine,
+                                    std::move(socket.get_value()),
+                                    std::move(handler),
+                                    m_Stats[i],
+                                    m_Resolver ? m_Limiter.get() : nullptr);
+      if (!engine) {
+         m_Workers.clear();
+         return engine.get_error();
+      }
+      m_Workers.push_back(std::move(engine.get_value()));
+   }
+
+   for (size_t i = threads; i < workers; i++) {
+      auto listener = TcpListener::bind(m_Config.address, m_Port);
+      RETURN_IF_ERROR(listener);
+
+      auto handler = QueryHandler(m_Cache.get(), m_Zones.get(), i, m_Resolver.get(), m_NegativeCache.get());
+      auto engine  = TcpEngine::create(
+          std::move(listener.get_value()), std::move(handler), m_Stats[i], m_Config.tcp);
+      if (!engine) {
+         m_Workers.clear();
+         return engine.get_error();
+      }
+      m_Workers.push_back(std::move(engine.get_value()));
+   }
+
+   /* Spawn the workers */
+   if (m_Resolver) {
+      m_Resolver->start();
+   }
+   m_Running.store(true);
+   for (size_t i = 0; i < workers; i++) {
+      auto *worker = m_Workers[i].get();
+      m_Threads.emplace_back([this, worker]() { worker->run(m_Running); });
+
+      if (m_Config.pin_threads) {
+         cpu_set_t set;
+         CPU_ZERO(&set);
+         CPU_SET(i % cores, &set);
+         pthread_setaffinity_np(m_Threads.back().native_handle(), sizeof(set), &set);
+      }
+   }
+
+   return Ok();
+}
+
+/* ------------------------------------------------------------------------------------------------------- */
+
+void
+Server::stop() {
+   m_Running.store(false);
+}
+
+/* ------------------------------------------------------------------------------------------------------- */
+
+void
+Server::wait() {
+   for (auto &thread : m_Threads) {
+      if (thread.joinable()) {
+         thread.join();
+      }
+   }
+   m_Threads.clear();
+
+   // Only once no worker hands over anything anymore
+   if (m_Resolver) {
+      m_Resolver->stop();
+   }
+}
+
+/* ------------------------------------------------------------------------------------------------------- */
+
+ServerStats
+Server::get_stats() const {
+   ServerStats stats;
+   stats.engine = GetEngineName(m_Config.engine);
+   for (size_t i = 0; i < m_Workers.size(); i++) {
+      const auto &worker = m_Stats[i];
+      stats.received += worker.received.load(std::memory_order_relaxed);
+      stats.sent += worker.sent.load(std::memory_order_relaxed);
+      stats.dropped += worker.dropped.load(std::memory_order_relaxed);
+      stats.recv_syscalls += worker.recv_syscalls.load(std::memory_order_relaxed);
+      stats.send_syscalls += worker.send_syscalls.load(std::memory_order_relaxed);
+      stats.connections += worker.connections.load(std::memory_order_relaxed);
+   }
+   if (m_Limiter) {
+      stats.rate_limited = m_Limiter->get_limited();
+      stats.slipped      = m_Limiter->get_slipped();
+   }
+   return stats;
+}
+
+/* ------------------------------------------------------------------------------------------------------- */
+
+Result<void>
+Server::reload_zone() {
+   // The expensive part (mapping and validating) happens here, on the caller's thread
+   auto zone = Zone::open(m_Config.zone);
+   RETURN_IF_ERROR(zone);
+
+   set_zone(CreateUniqueRef<const Zone>(std::move(zone.get_value())));
+   return Ok();
+}
+
+/* ------------------------------------------------------------------------------------------------------- */
+
+void
+Server::set_zone(UniqueRef<const Zone> zone) {
+   if (m_Zones) {
+      m_Zones->publish(std::move(zone));
+   }
+}
+
+/* ------------------------------------------------------------------------------------------------------- */
+
+size_t
+Server::reclaim_zones() {
+   return m_Zones ? m_Zones->reclaim() : 0;
+}
+
+/* ------------------------------------------------------------------------------------------------------- */
+
+void
+ServerStats::print(const std::string &name) const {
+   /* Print title */
+   char title[100];
+   sprintf(title, "%s Server Stats", name.c_str());
+   PrintAtCenter(title, "[", "]", true, true);
+   printf("\n");
+
+   /* Print data */
+   printf("Engine: %s\n", engine);
+   printf("Received: %lu\n", received);
+   printf("Sent: %lu\n", sent);
+   printf("Dropped: %lu\n", dropped);
+   printf("Receive Syscalls: %lu\n", recv_syscalls);
+   printf("Send Syscalls: %lu\n", send_syscalls);
+   printf("TCP Connections: %lu\n", connections);
+   printf("Rate Limited: %lu\n", rate_limited);
+   printf("Slipped: %lu\n", slipped);
+}
+
+/* ------------------------------------------------------------------------------------------------------- */
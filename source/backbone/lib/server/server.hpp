@@ -0,0 +1,195 @@
+#pragma once
+
+#include <atomic>
+#include <cstdint>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include <backbone/core/pch>
+#include <backbone/lib/resolver/resolver.hpp>
+#include "engine.hpp"
+#include "tcp_engine.hpp"
+
+/* ------------------------------------------------------------------------------------------------------- */
+
+class ServerConfig {
+public:
+   std::string address = "0.0.0.0";
+   uint16_t    port    = 53;
+
+   /**
+    * Number of worker threads, each with its own socket. Zero means one per available core.
+    */
+   size_t threads = 0;
+
+   /**
+    * Pin worker `i` to core `i % cores`.
+    */
+   bool pin_threads = true;
+
+   /**
+    * I/O backend every worker runs on.
+    */
+   EngineType engine = EngineType::SOCKET;
+
+   /**
+    * Answer cache shared by all workers. A zero capacity disables it.
+    */
+   CacheConfig cache;
+
+   /**
+    * Negative answers (NXDOMAIN and NODATA) are cached apart from the others, within a budget of their
+    * own, so that random or mistyped names can't evict real answers. A zero capacity disables it.
+    */
+   CacheConfig negative_cache = { .capacity = 1 << 14 };
+
+   /**
+    * TCP listeners on the same address and port, served next to the UDP workers.
+    */
+   TcpConfig tcp;
+
+   /**
+    * Compiled zone file (see `backbone-zonec`) answered authoritatively. Empty for none.
+    */
+   std::string zone;
+
+   /**
+    * Resolve questions outside the zone for clients asking for recursion, instead of refusing them.
+    */
+   bool recursive = false;
+
+   ResolverConfig resolver;
+
+   /**
+    * Response rate limiting of the UDP workers, off unless a rate is set.
+    */
+   RateLimitConfig rate_limit;
+};
+
+/* ------------------------------------------------------------------------------------------------------- */
+
+class ServerStats {
+public:
+   uint64_t received      = 0;
+   uint64_t sent          = 0;
+   uint64_t dropped       = 0;
+   uint64_t recv_syscalls = 0;
+   uint64_t send_syscalls = 0;
+   uint64_t connections   = 0;
+   uint64_t rate_limited  = 0;   // responses over the rate limit, dropped or slipped
+   uint64_t slipped       = 0;   // of those, the ones sent truncated
+
+   const char *engine = "";
+
+   void
+   print(const std::string &name = "") const;
+};
+
+/* ------------------------------------------------------------------------------------------------------- */
+
+/**
+ * @brief
+ * Multi-core UDP and TCP front end.
+ *
+ * @details
+ * `start` binds one `SO_REUSEPORT` socket and creates one engine per worker before spawning any thread, so
+ * that a bind or engine setup failure is reported to the caller instead of killing a worker. Workers never
+ * talk to each other: the kernel does the load balancing and each worker owns its buffers, handler and
+ * counters. TCP workers are set up the same way, each with its own listener and `TcpEngine`, after all
+ * the UDP workers. The `Resolver`, when recursion is enabled, is the one piece every worker shares besides
+ * the cache and the zone, and runs on a thread of its own. So is the rate limiter, which every UDP
+ * worker and the responses the resolver sends go through.
+ */
+class Server {
+private:
+   ServerConfig m_Config;
+   uint16_t     m_Port;
+
+   UniqueRef<AnswerCache> m_Cache;
+   UniqueRef<AnswerCache> m_NegativeCache;
+   UniqueRef<ZoneStore>   m_Zones;
+   UniqueRef<Resolver>    m_Resolver;
+
+   std::atomic<bool>               m_Running;
+   UniqueRef<RateLimiter>          m_Limiter;
+   std::vector<UniqueRef<IEngine>> m_Workers;
+   std::vector<std::thread>        m_Threads;
+   UniqueRef<WorkerStats[]>        m_Stats;
+
+public:
+   Server(ServerConfig config);
+   Server(const Server &) = delete;
+   ~Server();
+
+   Result<void>
+   start();
+
+   void
+   stop();
+
+   /**
+    * Blocks until all workers have exited, i.e. until someone calls `stop`.
+    */
+   void
+   wait();
+
+   /**
+    * Actual port the workers are bound to, resolved after `start` when the configured port is 0.
+    */
+   uint16_t
+   get_port() const {
+      return m_Port;
+   }
+
+   ServerStats
+   get_stats() const;
+
+   /**
+    * Reopens the configured zone file and swaps it in. Workers are never paused: queries already running
+    * finish on the old zone and the next ones see the new zone. On failure the old zone stays in place.
+    */
+   Result<void>
+   reload_zone();
+
+   /**
+    * Swaps in `zone` (or removes the zone when null), the same way `reload_zone` does.
+    */
+   void
+   set_zone(UniqueRef<const Zone> zone);
+
+   /**
+    * Unmaps the zones replaced earlier that no worker can still see. Meant to be called periodically
+    * after a reload, off the workers' threads.
+    *
+    * @returns Number of replaced zones still in use.
+    */
+   size_t
+   reclaim_zones();
+
+   /**
+    * Shared answer cache, or null when caching is disabled.
+    */
+   AnswerCache *
+   get_cache() {
+      return m_Cache.get();
+   }
+
+   /**
+    * Cache of negative answers, or null when it or caching as a whole is disabled.
+    */
+   AnswerCache *
+   get_negative_cache() {
+      return m_NegativeCache.get();
+   }
+
+   /**
+    * Resolver shared by all workers, or null when recursion is disabled.
+    */
+   Resolver *
+   get_resolver() {
+      return m_Resolver.get();
+   }
+};
+
+/* ------------------------------------------------------------------------------------------------------- */
@@ -0,0 +1,214 @@
+#include "socket.hpp"
+
+#include <cstring>
+#include <arpa/inet.h>
+#include <netinet/in.h>
+#include <netinet/tcp.h>
+#include <sys/socket.h>
+#include <sys/time.h>
+#include <unistd.h>
+
+/* ------------------------------------------------------------------------------------------------------- */
+
+/**
+ * @brief
+ * Parses a numeric IPv4 or IPv6 address, trying IPv4 first.
+ *
+ * @returns Length of the resulting socket address, 0 if `address` is neither.
+ */
+static socklen_t
+ResolveAddress(const std::string &address, uint16_t port, sockaddr_storage &storage) {
+   storage = {};
+
+   auto *v4 = reinterpret_cast<sockaddr_in *>(&storage);
+   auto *v6 = reinterpret_cast<sockaddr_in6 *>(&storage);
+   if (inet_pton(AF_INET, address.c_str(), &v4->sin_addr) == 1) {
+      v4->sin_family = AF_INET;
+      v4->sin_port   = htons(port);
+      return sizeof(sockaddr_in);
+   }
+   if (inet_pton(AF_INET6, address.c_str(), &v6->sin6_addr) == 1) {
+      v6->sin6_family = AF_INET6;
+      v6->sin6_port   = htons(port);
+      return sizeof(sockaddr_in6);
+   }
+   return 0;
+}
+
+/* ------------------------------------------------------------------------------------------------------- */
+
+static uint16_t
+GetBoundPort(int fd) {
+   sockaddr_storage storage {};
+   socklen_t        length = sizeof(storage);
+   if (getsockname(fd, reinterpret_cast<sockaddr *>(&storage), &length) < 0) {
+      return 0;
+   }
+
+   if (storage.ss_family == AF_INET6) {
+      return ntohs(reinterpret_cast<sockaddr_in6 *>(&storage)->sin6_port);
+   }
+   return ntohs(reinterpret_cast<sockaddr_in *>(&storage)->sin_port);
+}
+
+/* ------------------------------------------------------------------------------------------------------- */
+/* UdpSocket                                                                                               */
+/* ------------------------------------------------------------------------------------------------------- */
+
+UdpSocket::UdpSocket(UdpSocket &&other) noexcept : m_Fd(other.m_Fd) { other.m_Fd = -1; }
+
+/* ------------------------------------------------------------------------------------------------------- */
+
+UdpSocket::~UdpSocket() { close(); }
+
+/* ------------------------------------------------------------------------------------------------------- */
+
+UdpSocket &
+UdpSocket::operator=(UdpSocket &&other) noexcept {
+   if (this != &other) {
+      close();
+      m_Fd       = other.m_Fd;
+      other.m_Fd = -1;
+   }
+   return *this;
+}
+
+/* ------------------------------------------------------------------------------------------------------- */
+
+Result<UdpSocket>
+UdpSocket::bind(const std::string &address, uint16_t port, bool reuse_port) {
+   sockaddr_storage storage;
+   socklen_t        length = ResolveAddress(address, port, storage);
+   if (length == 0) {
+      return Error("Invalid listen address: " + address);
+   }
+
+   UdpSocket socket(::socket(storage.ss_family, SOCK_DGRAM | SOCK_CLOEXEC, 0));
+   if (socket.m_Fd < 0) {
+      return Error(std::string("Failed to create UDP socket: ") + strerror(errno));
+   }
+
+   int enable = 1;
+   if (reuse_port && setsockopt(socket.m_Fd, SOL_SOCKET, SO_REUSEPORT, &enable, sizeof(enable)) < 0) {
+      return Error(std::string("Failed to set SO_REUSEPORT: ") + strerror(errno));
+   }
+
+   // Wake up periodically so that workers can notice a stop request
+   timeval timeout { .tv_sec = 0, .tv_usec = 100 * 1000 };
+   if (setsockopt(socket.m_Fd, SOL_SOCKET, SO_RCVTIMEO, &timeout, sizeof(timeout)) < 0) {
+      return Error(std::string("Failed to set SO_RCVTIMEO: ") + strerror(errno));
+   }
+
+   if (::bind(socket.m_Fd, reinterpret_cast<sockaddr *>(&storage), length) < 0) {
+      return Error(std::string("Failed to bind UDP socket: ") + strerror(errno));
+   }
+
+   return socket;
+}
+
+/* ------------------------------------------------------------------------------------------------------- */
+
+uint16_t
+UdpSocket::get_port() const {
+   return GetBoundPort(m_Fd);
+}
+
+/* ------------------------------------------------------------------------------------------------------- */
+
+void
+UdpSocket::close() {
+   if (m_Fd >= 0) {
+      ::close(m_Fd);
+      m_Fd = -1;
+   }
+}
+
+/* ------------------------------------------------------------------------------------------------------- */
+/* TcpListener                                                                                             */
+/* ------------------------------------------------------------------------------------------------------- */
+
+TcpListener::TcpListener(TcpListener &&other) noexcept : m_Fd(other.m_Fd) { other.m_Fd = -1; }
+
+/* ------------------------------------------------------------------------------------------------------- */
+
+TcpListener::~TcpListener() { close(); }
+
+/* ------------------------------------------------------------------------------------------------------- */
+
+TcpListener &
+TcpListener::operator=(TcpListener &&other) noexcept {
+   if (this != &other) {
+      close();
+      m_Fd       = other.m_Fd;
+      other.m_Fd = -1;
+   }
+   return *this;
+}
+
+/* ------------------------------------------------------------------------------------------------------- */
+
+Result<TcpListener>
+TcpListener::bind(const std::string &address, uint16_t port, bool reuse_port) {
+   sockaddr_storage storage;
+   socklen_t        length = ResolveAddress(address, port, storage);
+   if (length == 0) {
+      return Error("Invalid listen address: " + address);
+   }
+
+   TcpListener listener(::socket(storage.ss_family, SOCK_STREAM | SOCK_NONBLOCK | SOCK_CLOEXEC, 0));
+   if (listener.m_Fd < 0) {
+      return Error(std::string("Failed to create TCP socket: ") + strerror(errno));
+   }
+
+   // Restarting must not have to wait for connections of the previous process to leave TIME_WAIT
+   int enable = 1;
+   if (setsockopt(listener.m_Fd, SOL_SOCKET, SO_REUSEADDR, &enable, sizeof(enable)) < 0) {
+      return Error(std::string("Failed to set SO_REUSEADDR: ") + strerror(errno));
+   }
+   if (reuse_port && setsockopt(listener.m_Fd, SOL_SOCKET, SO_REUSEPORT, &enable, sizeof(enable)) < 0) {
+      return Error(std::string("Failed to set SO_REUSEPORT: ") + strerror(errno));
+   }
+
+   if (::bind(listener.m_Fd, reinterpret_cast<sockaddr *>(&storage), length) < 0) {
+      return Error(std::string("Failed to bind TCP socket: ") + strerror(errno));
+   }
+   if (::listen(listener.m_Fd, BACKLOG) < 0) {
+      return Error(std::string("Failed to listen on TCP socket: ") + strerror(errno));
+   }
+
+   return listener;
+}
+
+/* ------------------------------------------------------------------------------------------------------- */
+
+int
+TcpListener::accept() {
+   int fd = accept4(m_Fd, nullptr, nullptr, SOCK_NONBLOCK | SOCK_CLOEXEC);
+   if (fd < 0) {
+      return -1;
+   }
+
+   // Every response is handed to the kernel in one piece, holding it back only delays pipelined answers
+   int enable = 1;
+   setsockopt(fd, IPPROTO_TCP, TCP_NODELAY, &enable, sizeof(enable));
+   return fd;
+}
+
+/* ------------------------------------------------------------------------------------------------------- */
+
+uint16_t
+TcpListener::get_port() const {
+   return GetBoundPort(m_Fd);
+}
+
+/* ------------------------------------------------------------------------------------------------------- */
+
+void
+TcpListener::close() {
+   if (m_Fd >= 0) {
+      ::close(m_Fd);
+      m_Fd = -1;
+   }
+}
+
+/* ------------------------------------------------------------------------------------------------------- */
@@ -0,0 +1,108 @@
+#pragma once
+
+#include <cstdint>
+#include <string>
+
+#include <backbone/core/pch>
+
+/* ------------------------------------------------------------------------------------------------------- */
+
+/**
+ * @brief
+ * Owning wrapper around a bound UDP socket.
+ *
+ * @details
+ * Sockets are bound with `SO_REUSEPORT` so that every worker thread can own a socket on the same
+ * address and port. The kernel then spreads incoming datagrams across them by flow hash, which keeps each
+ * client pinned to a single worker without any locking in user space.
+ */
+class UdpSocket {
+private:
+   int m_Fd;
+
+public:
+   UdpSocket() : m_Fd(-1) {}
+   explicit UdpSocket(int fd) : m_Fd(fd) {}
+   UdpSocket(const UdpSocket &) = delete;
+   UdpSocket(UdpSocket &&other) noexcept;
+   ~UdpSocket();
+
+   UdpSocket &
+   operator=(const UdpSocket &) = delete;
+   UdpSocket &
+   operator=(UdpSocket &&other) noexcept;
+
+   static Result<UdpSocket>
+   bind(const std::string &address, uint16_t port, bool reuse_port = true);
+
+   int
+   get_fd() const {
+      return m_Fd;
+   }
+
+   /**
+    * Port the socket is bound to. Useful when binding to port 0.
+    */
+   uint16_t
+   get_port() const;
+
+   void
+   close();
+};
+
+/* ------------------------------------------------------------------------------------------------------- */
+
+/**
+ * @brief
+ * Owning wrapper around a non-blocking TCP listening socket.
+ *
+ * @details
+ * Listeners are bound with `SO_REUSEPORT` just like `UdpSocket`s, so every TCP worker owns its own accept
+ * queue and the kernel spreads new connections across them. Accepted connections inherit nothing from the
+ * listener, see `accept`.
+ */
+class TcpListener {
+public:
+   static constexpr int BACKLOG = 1024;
+
+private:
+   int m_Fd;
+
+public:
+   TcpListener() : m_Fd(-1) {}
+   explicit TcpListener(int fd) : m_Fd(fd) {}
+   TcpListener(const TcpListener &) = delete;
+   TcpListener(TcpListener &&other) noexcept;
+   ~TcpListener();
+
+   TcpListener &
+   operator=(const TcpListener &) = delete;
+   TcpListener &
+   operator=(TcpListener &&other) noexcept;
+
+   static Result<TcpListener>
+   bind(const std::string &address, uint16_t port, bool reuse_port = true);
+
+   /**
+    * Next pending connection as a non-blocking socket with Nagle's algorithm disabled, or -1 once the
+    * accept queue is empty (or on any error, which only affects that one connection).
+    */
+   int
+   accept();
+
+   int
+   get_fd() const {
+      return m_Fd;
+   }
+
+   /**
+    * Port the listener is bound to. Useful when binding to port 0.
+    */
+   uint16_t
+   get_port() const;
+
+   void
+   close();
+};
+
+/* ------------------------------------------------------------------------------------------------------- */
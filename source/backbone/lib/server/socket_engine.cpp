@@ -0,0 +1,102 @@
+#include "socket_engine.hpp"
+
+#include <cerrno>
+
+/* ------------------------------------------------------------------------------------------------------- */
+
+SocketEngine::SocketEngine(UdpSocket socket, QueryHandler handler, WorkerStats &stats, RateLimiter *limiter)
+    : m_Socket(std::move(socket)), m_Handler(std::move(handler)), m_Stats(stats),
+      m_Responder(m_Socket.get_fd(), limiter) {
+   for (size_t i = 0; i < BATCH_SIZE; i++) {
+      m_RequestVectors[i] = { m_Requests[i].get_data(), m_Requests[i].get_capacity() };
+
+      // Room for as much as EDNS0 clients may take, the handler keeps every response within their limit
+      m_Responses[i] = PacketBuffer(BufferPool::EDNS_SIZE);
+
+      m_RequestMessages[i]                    = {};
+      m_RequestMessages[i].msg_hdr.msg_iov    = &m_RequestVectors[i];
+      m_RequestMessages[i].msg_hdr.msg_iovlen = 1;
+      m_RequestMessages[i].msg_hdr.msg_name   = &m_Peers[i];
+
+      m_ResponseMessages[i]                    = {};
+      m_ResponseMessages[i].msg_hdr.msg_iov    = &m_ResponseVectors[i];
+      m_ResponseMessages[i].msg_hdr.msg_iovlen = 1;
+   }
+}
+
+/* ------------------------------------------------------------------------------------------------------- */
+
+void
+SocketEngine::run(const std::atomic<bool> &running) {
+   while (running.load(std::memory_order_relaxed)) {
+      // The kernel overwrites the name length with the actual peer size on every receive
+      for (auto &message : m_RequestMessages) {
+         message.msg_hdr.msg_namelen = sizeof(sockaddr_storage);
+      }
+
+      int count = recvmmsg(m_Socket.get_fd(), m_RequestMessages.data(), BATCH_SIZE, MSG_WAITFORONE, nullptr);
+      m_Stats.add(m_Stats.recv_syscalls, 1);
+      if (count <= 0) {
+         continue;   // timeout, interrupt or transient error
+      }
+
+      m_Stats.add(m_Stats.received, count);
+      m_Handler.begin_batch();
+      process_batch(count);
+   }
+}
+
+/* ------------------------------------------------------------------------------------------------------- */
+
+void
+SocketEngine::process_batch(size_t count) {
+   size_t pending = 0;
+
+   for (size_t i = 0; i < count; i++) {
+      const auto &request  = m_RequestMessages[i];
+      auto       &response = m_Responses[pending];
+
+      if (request.msg_hdr.msg_flags & MSG_TRUNC) {
+         m_Stats.add(m_Stats.dropped, 1);
+         continue;
+      }
+
+      auto requester = Requester { .responder   = &m_Responder,
+                                   .peer        = reinterpret_cast<const sockaddr *>(&m_Peers[i]),
+                                   .peer_length = request.msg_hdr.msg_namelen,
+                                   .max_size    = BufferPool::EDNS_SIZE };
+
+      auto _length = m_Handler.handle({ m_Requests[i].get_data(), request.msg_len }, response, &requester);
+      if (!_length) {
+         m_Stats.add(m_Stats.dropped, 1);
+         continue;
+      }
+      if (_length.get_value() == QueryHandler::DEFERRED) {
+         continue;   // answered later by the resolver
+      }
+
+      m_ResponseVectors[pending]                      = { response.get_data(), _length.get_value() };
+      m_ResponseMessages[pending].msg_hdr.msg_name    = &m_Peers[i];
+      m_ResponseMessages[pending].msg_hdr.msg_namelen = request.msg_hdr.msg_namelen;
+      pending++;
+   }
+
+   size_t flushed = 0;
+   while (flushed < pending) {
+      int sent = sendmmsg(m_Socket.get_fd(), m_ResponseMessages.data() + flushed, pending - flushed, 0);
+      m_Stats.add(m_Stats.send_syscalls, 1);
+      if (sent < 0) {
+         if (errno == EINTR) {
+            continue;
+         }
+
+         // The socket buffer is full or the peer is gone, UDP allows us to drop the rest
+         m_Stats.add(m_Stats.dropped, pending - flushed);
+         break;
+      }
+      flushed += sent;
+   }
+   m_Stats.add(m_Stats.sent, flushed);
+}
+
+/* ------------------------------------------------------------------------------------------------------- */
@@ -0,0 +1,58 @@
+#pragma once
+
+#include <array>
+#include <atomic>
+#include <cstdint>
+#include <sys/socket.h>
+
+#include <backbone/core/pch>
+#include "engine.hpp"
+
+/* ------------------------------------------------------------------------------------------------------- */
+
+/**
+ * @brief
+ * Plain socket backend built on `recvmmsg`/`sendmmsg`.
+ *
+ * @details
+ * Datagrams are received straight into a fixed set of `PacketBuffer`s, handled one by one, and every
+ * response of the batch is flushed with `sendmmsg`. All buffers, message headers and peer addresses are
+ * allocated once up front and reused for every batch, and nothing is shared with other workers.
+ */
+class SocketEngine : public IEngine {
+public:
+   static constexpr size_t BATCH_SIZE = 64;
+
+private:
+   UdpSocket         m_Socket;
+   QueryHandler      m_Handler;
+   WorkerStats      &m_Stats;
+   DatagramResponder m_Responder;
+
+   std::array<PacketBuffer, BATCH_SIZE>     m_Requests;
+   std::array<PacketBuffer, BATCH_SIZE>     m_Responses;
+   std::array<sockaddr_storage, BATCH_SIZE> m_Peers;
+   std::array<iovec, BATCH_SIZE>            m_RequestVectors;
+   std::array<iovec, BATCH_SIZE>            m_ResponseVectors;
+   std::array<mmsghdr, BATCH_SIZE>          m_RequestMessages;
+   std::array<mmsghdr, BATCH_SIZE>          m_ResponseMessages;
+
+public:
+   SocketEngine(UdpSocket socket, QueryHandler handler, WorkerStats &stats, RateLimiter *limiter = nullptr);
+   SocketEngine(const SocketEngine &) = delete;
+   ~SocketEngine()                    = default;
+
+   const char *
+   get_name() const override {
+      return "socket";
+   }
+
+   void
+   run(const std::atomic<bool> &running) override;
+
+private:
+   void
+   process_batch(size_t count);
+};
+
+/* ------------------------------------------------------------------------------------------------------- */
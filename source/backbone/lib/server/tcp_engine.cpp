@@ -0,0 +1,381 @@
+#include "tcp_engine.hpp"
+
+#include <cerrno>
+#include <cstring>
+#include <sys/eventfd.h>
+#include <sys/socket.h>
+#include <unistd.h>
+
+/* ------------------------------------------------------------------------------------------------------- */
+
+TcpEngine::Connection::Connection(int fd, uint64_t id)
+    : fd(fd), id(id), position(), last_active(), sent(0), blocked(false), end_of_input(false), deferred(0) {}
+
+/* ------------------------------------------------------------------------------------------------------- */
+
+TcpEngine::Connection::~Connection() {
+   if (fd >= 0) {
+      ::close(fd);
+   }
+}
+
+/* ------------------------------------------------------------------------------------------------------- */
+
+TcpEngine::TcpEngine(TcpListener listener, QueryHandler handler, WorkerStats &stats, const TcpConfig &config)
+    : m_Listener(std::move(listener)), m_Handler(std::move(handler)), m_Stats(stats), m_Config(config),
+      m_Epoll(-1), m_Input(READ_SIZE), m_Response(BufferPool::TCP_SIZE), m_NextId(1), m_Wakeup(-1) {
+   m_Output.reserve(READ_SIZE);
+}
+
+/* ------------------------------------------------------------------------------------------------------- */
+
+TcpEngine::~TcpEngine() {
+   m_Connections.clear();
+   m_Closed.clear();
+   if (m_Epoll >= 0) {
+      ::close(m_Epoll);
+   }
+   if (m_Wakeup >= 0) {
+      ::close(m_Wakeup);
+   }
+}
+
+/* ------------------------------------------------------------------------------------------------------- */
+
+Result<UniqueRef<TcpEngine>>
+TcpEngine::create(TcpListener listener, QueryHandler handler, WorkerStats &stats, const TcpConfig &config) {
+   auto engine =
+       UniqueRef<TcpEngine>(new TcpEngine(std::move(listener), std::move(handler), stats, config));
+
+   engine->m_Epoll = epoll_create1(EPOLL_CLOEXEC);
+   if (engine->m_Epoll < 0) {
+      return Error(std::string("Failed to create epoll instance: ") + strerror(errno));
+   }
+
+   engine->m_Wakeup = eventfd(0, EFD_NONBLOCK | EFD_CLOEXEC);
+   if (engine->m_Wakeup < 0) {
+      return Error(std::string("Failed to create eventfd: ") + strerror(errno));
+   }
+
+   // The listener and the wakeup are the only entries without a connection behind them
+   epoll_event event { .events = EPOLLIN | EPOLLET, .data = { .ptr = nullptr } };
+   if (epoll_ctl(engine->m_Epoll, EPOLL_CTL_ADD, engine->m_Listener.get_fd(), &event) < 0) {
+      return Error(std::string("Failed to watch TCP listener: ") + strerror(errno));
+   }
+
+   event = { .events = EPOLLIN, .data = { .ptr = &engine->m_Wakeup } };
+   if (epoll_ctl(engine->m_Epoll, EPOLL_CTL_ADD, engine->m_Wakeup, &event) < 0) {
+      return Error(std::string("Failed to watch eventfd: ") + strerror(errno));
+   }
+
+   return engine;
+}
+
+/* ------------------------------------------------------------------------------------------------------- */
+
+void
+TcpEngine::run(const std::atomic<bool> &running) {
+   while (running.load(std::memory_order_relaxed)) {
+      int count = epoll_wait(m_Epoll, m_Events.data(), MAX_EVENTS, 100);
+      m_Stats.add(m_Stats.recv_syscalls, 1);
+      m_Now = std::chrono::steady_clock::now();
+
+      for (int i = 0; i < count; i++) {
+         void *entry = m_Events[i].data.ptr;
+         if (!entry) {
+            accept_all();
+            continue;
+         }
+         if (entry == &m_Wakeup) {
+            deliver();
+            continue;
+         }
+
+         auto *connection = static_cast<Connection *>(entry);
+         if (connection->fd < 0) {
+            continue;   // closed by an earlier event of this batch
+         }
+
+         if ((m_Events[i].events & EPOLLERR) || !serve(*connection, m_Events[i].events)) {
+            close(*connection);
+            continue;
+         }
+         touch(*connection);
+      }
+
+      m_Closed.clear();
+      expire();
+   }
+}
+
+/* ------------------------------------------------------------------------------------------------------- */
+
+void
+TcpEngine::accept_all() {
+   while (true) {
+      int fd = m_Listener.accept();
+      if (fd < 0) {
+         return;
+      }
+
+      if (m_Connections.size() >= m_Config.max_connections) {
+         close(m_Connections.front());
+      }
+
+      auto &connection       = m_Connections.emplace_back(fd, m_NextId++);
+      connection.position    = std::prev(m_Connections.end());
+      connection.last_active = m_Now;
+      m_ById.emplace(connection.id, &connection);
+
+      // Registered once for both directions, edge triggered, so nothing is ever re-armed
+      epoll_event event { .events = EPOLLIN | EPOLLOUT | EPOLLRDHUP | EPOLLET,
+                          .data   = { .ptr = &connection } };
+      if (epoll_ctl(m_Epoll, EPOLL_CTL_ADD, fd, &event) < 0) {
+         close(connection);
+         continue;
+      }
+      m_Stats.add(m_Stats.connections, 1);
+   }
+}
+
+/* ------------------------------------------------------------------------------------------------------- */
+
+void
+TcpEngine::respond(const Waiter &waiter, std::span<const Byte> response) {
+   std::vector<Byte> frame;
+   frame.reserve(2 + response.size());
+   frame.push_back(response.size() >> 8);
+   frame.push_back(response.size() & 0xFF);
+   frame.insert(frame.end(), response.begin(), response.end());
+
+   bool wake;
+   {
+      std::lock_guard lock(m_Mutex);
+      wake = m_Completed.empty();
+      m_Completed.emplace_back(waiter.connection, std::move(frame));
+   }
+
+   // The worker takes everything queued at once, so only the first response of a batch wakes it up
+   if (wake) {
+      uint64_t one = 1;
+      [[maybe_unused]] ssize_t written = write(m_Wakeup, &one, sizeof(one));
+   }
+}
+
+/* ------------------------------------------------------------------------------------------------------- */
+
+void
+TcpEngine::deliver() {
+   uint64_t                                             count;
+   std::vector<std::pair<uint64_t, std::vector<Byte>>> completed;
+
+   [[maybe_unused]] ssize_t drained = read(m_Wakeup, &count, sizeof(count));
+   {
+      std::lock_guard lock(m_Mutex);
+      completed.swap(m_Completed);
+   }
+
+   for (auto &[id, frame] : completed) {
+      auto it = m_ById.find(id);
+      if (it == m_ById.end()) {
+         continue;   // closed in the meantime
+      }
+
+      auto &connection = *it->second;
+      connection.deferred--;
+      m_Output.insert(m_Output.end(), frame.begin(), frame.end());
+      m_Stats.add(m_Stats.sent, 1);
+
+      // Served like any other wakeup, which also picks up requests held back by a full output
+      if (!serve(connection, 0)) {
+         close(connection);
+         continue;
+      }
+      touch(connection);
+   }
+
+   // What was closed here stays around with the rest of the batch, later events may still refer to it
+}
+
+/* ------------------------------------------------------------------------------------------------------- */
+
+void
+TcpEngine::touch(Connection &connection) {
+   connection.last_active = m_Now;
+   m_Connections.splice(m_Connections.end(), m_Connections, connection.position);
+}
+
+/* ------------------------------------------------------------------------------------------------------- */
+
+bool
+TcpEngine::serve(Connection &connection, uint32_t events) {
+   // Unless the client has hung up, a short read means the socket is drained: anything arriving later
+   // raises another edge, so the read that would just fail with EAGAIN can be skipped
+   bool hung_up = events & (EPOLLRDHUP | EPOLLHUP);
+
+   while (true) {
+      while (!connection.blocked && !connection.end_of_input) {
+         ssize_t count = recv(connection.fd, m_Input.data(), READ_SIZE, 0);
+         m_Stats.add(m_Stats.recv_syscalls, 1);
+
+         if (count > 0) {
+            consume(connection, { m_Input.data(), size_t(count) });
+            if (size_t(count) < READ_SIZE && !hung_up) {
+               break;
+            }
+         } else if (count == 0) {
+            connection.end_of_input = true;
+         } else if (errno == EAGAIN || errno == EWOULDBLOCK) {
+            break;
+         } else if (errno != EINTR) {
+            return false;
+         }
+      }
+
+      if (!flush(connection)) {
+         return false;
+      }
+      if (!connection.output.empty()) {
+         return true;   // the next EPOLLOUT continues from here
+      }
+
+      // Everything has been sent, the requests held back can be answered now
+      if (connection.blocked) {
+         connection.blocked = false;
+         consume(connection, {});
+         continue;
+      }
+
+      // Once the client is done, the connection is done as soon as all of its answers are out
+      return !is_finished(connection);
+   }
+}
+
+/* ------------------------------------------------------------------------------------------------------- */
+
+void
+TcpEngine::consume(Connection &connection, std::span<const Byte> data) {
+   // Without anything left over from before, the requests are answered straight from the read buffer
+   if (connection.input.empty()) {
+      size_t used = answer(connection, data);
+      connection.input.assign(data.begin() + used, data.end());
+      return;
+   }
+
+   connection.input.insert(connection.input.end(), data.begin(), data.end());
+   size_t used = answer(connection, connection.input);
+   connection.input.erase(connection.input.begin(), connection.input.begin() + used);
+
+   if (connection.input.empty() && connection.input.capacity() > BufferPool::LARGE_SIZE) {
+      connection.input.shrink_to_fit();
+   }
+}
+
+/* ------------------------------------------------------------------------------------------------------- */
+
+size_t
+TcpEngine::answer(Connection &connection, std::span<const Byte> data) {
+   size_t used = 0;
+
+   while (data.size() - used >= 2) {
+      size_t length = (data[used] << 8) | data[used + 1];
+      if (data.size() - used - 2 < length) {
+         break;
+      }
+      if (get_pending(connection) > m_Config.buffer_limit) {
+         connection.blocked = true;
+         break;
+      }
+
+      auto request = data.subspan(used + 2, length);
+      used += 2 + length;
+      m_Stats.add(m_Stats.received, 1);
+
+      auto requester = Requester { .responder  = this,
+                                   .connection = connection.id,
+                                   .max_size   = BufferPool::TCP_SIZE };
+
+      auto _length = m_Handler.handle(request, m_Response, &requester);
+      if (!_length) {
+         m_Stats.add(m_Stats.dropped, 1);
+         continue;
+      }
+      if (_length.get_value() == QueryHandler::DEFERRED) {
+         connection.deferred++;
+         continue;
+      }
+
+      size_t size = _length.get_value();
+      m_Output.push_back(size >> 8);
+      m_Output.push_back(size & 0xFF);
+      m_Output.insert(m_Output.end(), m_Response.get_data(), m_Response.get_data() + size);
+      m_Stats.add(m_Stats.sent, 1);
+   }
+
+   return used;
+}
+
+/* ------------------------------------------------------------------------------------------------------- */
+
+bool
+TcpEngine::flush(Connection &connection) {
+   // New responses are sent straight from the shared buffer, unless older ones are still waiting
+   std::span<const Byte> pending = m_Output;
+   if (!connection.output.empty()) {
+      connection.output.insert(connection.output.end(), m_Output.begin(), m_Output.end());
+      pending = std::span<const Byte>(connection.output).subspan(connection.sent);
+   }
+
+   size_t written = 0;
+   bool   broken  = false;
+   while (written < pending.size()) {
+      ssize_t count = send(connection.fd, pending.data() + written, pending.size() - written, MSG_NOSIGNAL);
+      m_Stats.add(m_Stats.send_syscalls, 1);
+
+      if (count >= 0) {
+         written += count;
+      } else if (errno != EINTR) {
+         broken = errno != EAGAIN && errno != EWOULDBLOCK;
+         break;
+      }
+   }
+
+   if (connection.output.empty()) {
+      connection.output.assign(pending.begin() + written, pending.end());
+   } else {
+      connection.sent += written;
+      if (connection.sent == connection.output.size()) {
+         connection.output.clear();
+         connection.sent = 0;
+         if (connection.output.capacity() > BufferPool::LARGE_SIZE) {
+            connection.output.shrink_to_fit();
+         }
+      }
+   }
+
+   m_Output.clear();
+   return !broken;
+}
+
+/* ------------------------------------------------------------------------------------------------------- */
+
+void
+TcpEngine::close(Connection &connection) {
+   ::close(connection.fd);
+   connection.fd = -1;
+   m_ById.erase(connection.id);
+   m_Closed.splice(m_Closed.end(), m_Connections, connection.position);
+}
+
+/* ------------------------------------------------------------------------------------------------------- */
+
+void
+TcpEngine::expire() {
+   auto deadline = m_Now - m_Config.idle_timeout;
+   while (!m_Connections.empty() && m_Connections.front().last_active < deadline) {
+      close(m_Connections.front());
+   }
+   m_Closed.clear();
+}
+
+/* ------------------------------------------------------------------------------------------------------- */
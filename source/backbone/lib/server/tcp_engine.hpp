@@ -0,0 +1,207 @@
+#pragma once
+
+#include <array>
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+#include <list>
+#include <mutex>
+#include <unordered_map>
+#include <utility>
+#include <vector>
+#include <sys/epoll.h>
+
+#include <backbone/core/pch>
+#include "engine.hpp"
+
+/* ------------------------------------------------------------------------------------------------------- */
+
+class TcpConfig {
+public:
+   /**
+    * Number of TCP workers, each with its own listener. Zero disables TCP.
+    */
+   size_t threads = 1;
+
+   /**
+    * Connections without any traffic for this long are closed (RFC 7766 6.2.3).
+    */
+   std::chrono::milliseconds idle_timeout = std::chrono::seconds(10);
+
+   /**
+    * Unsent response bytes a connection may pile up before its further requests are left unread until
+    * the client catches up.
+    */
+   size_t buffer_limit = 256 * 1024;
+
+   /**
+    * Open connections per worker. Accepting one more closes the one that has been idle the longest.
+    */
+   size_t max_connections = 4096;
+};
+
+/* ------------------------------------------------------------------------------------------------------- */
+
+/**
+ * @brief
+ * epoll backend for DNS over TCP (RFC 7766), feeding every message through the same `QueryHandler` as
+ * the datagram engines.
+ *
+ * @details
+ * Connections are long lived and carry any number of pipelined queries, each framed by a two byte length.
+ * Every complete message read is answered right away and responses go out as soon as they are ready, not
+ * in the order their queries came in, which is what lets a client reuse one connection for everything.
+ * All responses to one read are flushed with a single `send`.
+ *
+ * Requests are read through one buffer shared by every connection of the worker, so a connection only
+ * keeps bytes of its own while a message is split across reads or while its output is backed up. Both
+ * are bounded: a connection whose unsent responses exceed `TcpConfig::buffer_limit` is not read from
+ * until they drain, and every connection idle (or stalled) for longer than `TcpConfig::idle_timeout` is
+ * closed. Connections are kept in order of their last activity, so finding the expired ones only ever
+ * looks at those.
+ *
+ * Responses the resolver produces later are queued by connection ID and picked up by the worker once
+ * an eventfd wakes it up, a connection the client has already closed its side of stays open until they
+ * are all out.
+ */
+class TcpEngine : public IEngine, public IResponder {
+public:
+   static constexpr size_t MAX_EVENTS = 256;
+   static constexpr size_t READ_SIZE  = 64 * 1024;
+
+private:
+   struct Connection;
+   using Connections = std::list<Connection>;
+
+   /**
+    * One client connection. `fd` is -1 once closed, the entry itself lives on until the current batch
+    * of events is done since later events may still refer to it.
+    */
+   struct Connection {
+      int                                   fd;
+      uint64_t                              id;
+      Connections::iterator                 position;
+      std::chrono::steady_clock::time_point last_active;
+
+      std::vector<Byte> input;          // requests read but not answered yet, starting with a length
+      std::vector<Byte> output;         // responses not sent yet
+      size_t            sent;           // bytes of `output` already sent
+      bool              blocked;        // too much output pending, `input` is not being answered
+      bool              end_of_input;   // the client will not send anything anymore
+      size_t            deferred;       // requests handed to the resolver, not answered yet
+
+      Connection(int fd, uint64_t id);
+      Connection(const Connection &) = delete;
+      ~Connection();
+   };
+
+   TcpListener  m_Listener;
+   QueryHandler m_Handler;
+   WorkerStats &m_Stats;
+   TcpConfig    m_Config;
+
+   int                                   m_Epoll;
+   std::array<epoll_event, MAX_EVENTS>   m_Events;
+   Connections                           m_Connections;   // least recently active first
+   Connections                           m_Closed;
+   std::chrono::steady_clock::time_point m_Now;
+
+   std::vector<Byte> m_Input;
+   std::vector<Byte> m_Output;   // responses of the connection being served, not yet handed to it
+   PacketBuffer      m_Response;
+
+   uint64_t                                   m_NextId;
+   std::unordered_map<uint64_t, Connection *> m_ById;
+
+   /* Deferred responses, already framed, handed over by the resolver */
+   std::mutex                                           m_Mutex;
+   std::vector<std::pair<uint64_t, std::vector<Byte>>> m_Completed;
+   int                                                  m_Wakeup;
+
+public:
+   TcpEngine(const TcpEngine &) = delete;
+   ~TcpEngine();
+
+   static Result<UniqueRef<TcpEngine>>
+   create(TcpListener listener, QueryHandler handler, WorkerStats &stats, const TcpConfig &config);
+
+   const char *
+   get_name() const override {
+      return "tcp";
+   }
+
+   void
+   run(const std::atomic<bool> &running) override;
+
+   void
+   respond(const Waiter &waiter, std::span<const Byte> response) override;
+
+private:
+   TcpEngine(TcpListener listener, QueryHandler handler, WorkerStats &stats, const TcpConfig &config);
+
+   void
+   accept_all();
+
+   /**
+    * Sends the deferred responses queued since the last wakeup.
+    */
+   void
+   deliver();
+
+   /**
+    * Moves the connection to the back of the activity order.
+    */
+   void
+   touch(Connection &connection);
+
+   /**
+    * Reads, answers and writes as much as the connection allows right now. `events` are the epoll events
+    * that woke it up.
+    *
+    * @returns Whether the connection stays open.
+    */
+   bool
+   serve(Connection &connection, uint32_t events);
+
+   /**
+    * Whether the connection is done: the client won't send anything anymore and has all of its answers.
+    */
+   bool
+   is_finished(const Connection &connection) const {
+      return connection.end_of_input && connection.deferred == 0 && connection.output.empty();
+   }
+
+   /**
+    * Answers the complete messages at the front of `data` and returns how many bytes were used up. Stops
+    * early, leaving the rest for later, when the connection's output exceeds the buffer limit.
+    */
+   size_t
+   answer(Connection &connection, std::span<const Byte> data);
+
+   /**
+    * Takes `data` that has just been read: answers what can be answered and keeps the rest.
+    */
+   void
+   consume(Connection &connection, std::span<const Byte> data);
+
+   /**
+    * Sends the pending responses, keeping whatever the socket does not take.
+    *
+    * @returns False on a broken connection.
+    */
+   bool
+   flush(Connection &connection);
+
+   size_t
+   get_pending(const Connection &connection) const {
+      return m_Output.size() + connection.output.size() - connection.sent;
+   }
+
+   void
+   close(Connection &connection);
+
+   void
+   expire();
+};
+
+/* ------------------------------------------------------------------------------------------------------- */
@@ -0,0 +1,375 @@
+#include "uring_engine.hpp"
+
+#include <cerrno>
+#include <csignal>
+#include <cstring>
+#include <sys/mman.h>
+#include <sys/syscall.h>
+#include <unistd.h>
+
+/* ------------------------------------------------------------------------------------------------------- */
+
+static constexpr uint64_t RECEIVE_TAG = 1ull << 32;
+static constexpr uint64_t SEND_TAG    = 2ull << 32;
+
+/* ------------------------------------------------------------------------------------------------------- */
+
+static inline unsigned
+load_acquire(unsigned *value) {
+   return std::atomic_ref<unsigned>(*value).load(std::memory_order_acquire);
+}
+
+/* ------------------------------------------------------------------------------------------------------- */
+
+static inline void
+store_release(unsigned *target, unsigned value) {
+   std::atomic_ref<unsigned>(*target).store(value, std::memory_order_release);
+}
+
+/* ------------------------------------------------------------------------------------------------------- */
+
+UringEngine::UringEngine(UdpSocket socket, QueryHandler handler, WorkerStats &stats, RateLimiter *limiter)
+    : m_Socket(std::move(socket)), m_Handler(std::move(handler)), m_Stats(stats),
+      m_Responder(m_Socket.get_fd(), limiter), m_RingFd(-1),
+      m_SqRing(MAP_FAILED), m_SqRingSize(0), m_SqHead(nullptr), m_SqTail(nullptr), m_SqMask(nullptr),
+      m_SqArray(nullptr), m_Sqes(nullptr), m_SqesSize(0), m_SqLocalTail(0), m_SqPending(0),
+      m_CqRing(MAP_FAILED), m_CqRingSize(0), m_CqHead(nullptr), m_CqTail(nullptr), m_CqMask(nullptr),
+      m_Cqes(nullptr), m_BufferRing(nullptr), m_BufferRingSize(0), m_BufferTail(0),
+      m_Slots(SLOT_COUNT * SLOT_SIZE), m_ReceiveHeader {}, m_ReceiveArmed(false) {
+   m_ReceiveHeader.msg_namelen = sizeof(sockaddr_storage);
+
+   m_FreeSendSlots.reserve(SEND_SLOTS);
+   for (size_t i = 0; i < SEND_SLOTS; i++) {
+      m_ResponseHeaders[i] = {};
+
+      m_ResponseHeaders[i].msg_name   = &m_Peers[i];
+      m_ResponseHeaders[i].msg_iov    = &m_ResponseVectors[i];
+      m_ResponseHeaders[i].msg_iovlen = 1;
+
+      // Room for as much as EDNS0 clients may take, the handler keeps every response within their limit
+      m_Responses[i] = PacketBuffer(BufferPool::EDNS_SIZE);
+
+      m_FreeSendSlots.push_back(SEND_SLOTS - 1 - i);
+   }
+}
+
+/* ------------------------------------------------------------------------------------------------------- */
+
+UringEngine::~UringEngine() {
+   if (m_BufferRing) {
+      munmap(m_BufferRing, m_BufferRingSize);
+   }
+   if (m_Sqes) {
+      munmap(m_Sqes, m_SqesSize);
+   }
+   if (m_CqRing != MAP_FAILED && m_CqRing != m_SqRing) {
+      munmap(m_CqRing, m_CqRingSize);
+   }
+   if (m_SqRing != MAP_FAILED) {
+      munmap(m_SqRing, m_SqRingSize);
+   }
+   if (m_RingFd >= 0) {
+      close(m_RingFd);
+   }
+}
+
+/* ------------------------------------------------------------------------------------------------------- */
+
+Result<UniqueRef<UringEngine>>
+UringEngine::create(UdpSocket socket, QueryHandler handler, WorkerStats &stats, RateLimiter *limiter) {
+   auto engine =
+       UniqueRef<UringEngine>(new UringEngine(std::move(socket), std::move(handler), stats, limiter));
+
+   auto res = engine->setup();
+   RETURN_IF_ERROR(res);
+
+   return engine;
+}
+
+/* ------------------------------------------------------------------------------------------------------- */
+
+Result<void>
+UringEngine::setup() {
+   /* Create the ring */
+   io_uring_params params {};
+   params.flags = IORING_SETUP_COOP_TASKRUN;
+
+   m_RingFd = syscall(__NR_io_uring_setup, RING_ENTRIES, &params);
+   if (m_RingFd < 0 && errno == EINVAL) {
+      params   = {};
+      m_RingFd = syscall(__NR_io_uring_setup, RING_ENTRIES, &params);
+   }
+   if (m_RingFd < 0) {
+      return Error(std::string("Failed to set up io_uring: ") + strerror(errno));
+   }
+
+   if (!(params.features & IORING_FEAT_SINGLE_MMAP) || !(params.features & IORING_FEAT_EXT_ARG)) {
+      return Error("io_uring is too old, single mmap and extended enter arguments are required");
+   }
+
+   /* Map the rings, both share one mapping with IORING_FEAT_SINGLE_MMAP */
+   m_SqRingSize = params.sq_off.array + params.sq_entries * sizeof(unsigned);
+   m_CqRingSize = params.cq_off.cqes + params.cq_entries * sizeof(io_uring_cqe);
+   m_SqRingSize = m_CqRingSize = std::max(m_SqRingSize, m_CqRingSize);
+
+   m_SqRing = mmap(nullptr,
+                   m_SqRingSize,
+                   PROT_READ | PROT_WRITE,
+                   MAP_SHARED | MAP_POPULATE,
+                   m_RingFd,
+                   IORING_OFF_SQ_RING);
+   if (m_SqRing == MAP_FAILED) {
+      return Error(std::string("Failed to map the io_uring rings: ") + strerror(errno));
+   }
+   m_CqRing = m_SqRing;
+
+   m_SqesSize = params.sq_entries * sizeof(io_uring_sqe);
+   void *sqes = mmap(nullptr,
+                     m_SqesSize,
+                     PROT_READ | PROT_WRITE,
+                     MAP_SHARED | MAP_POPULATE,
+                     m_RingFd,
+                     IORING_OFF_SQES);
+   if (sqes == MAP_FAILED) {
+      return Error(std::string("Failed to map the io_uring submission entries: ") + strerror(errno));
+   }
+   m_Sqes = static_cast<io_uring_sqe *>(sqes);
+
+   auto *sq  = static_cast<Byte *>(m_SqRing);
+   m_SqHead  = reinterpret_cast<unsigned *>(sq + params.sq_off.head);
+   m_SqTail  = reinterpret_cast<unsigned *>(sq + params.sq_off.tail);
+   m_SqMask  = reinterpret_cast<unsigned *>(sq + params.sq_off.ring_mask);
+   m_SqArray = reinterpret_cast<unsigned *>(sq + params.sq_off.array);
+
+   auto *cq = static_cast<Byte *>(m_CqRing);
+   m_CqHead = reinterpret_cast<unsigned *>(cq + params.cq_off.head);
+   m_CqTail = reinterpret_cast<unsigned *>(cq + params.cq_off.tail);
+   m_CqMask = reinterpret_cast<unsigned *>(cq + params.cq_off.ring_mask);
+   m_Cqes   = reinterpret_cast<io_uring_cqe *>(cq + params.cq_off.cqes);
+
+   m_SqLocalTail = *m_SqTail;
+
+   /* Register the pool of receive slots as provided buffer group 0 */
+   m_BufferRingSize = SLOT_COUNT * sizeof(io_uring_buf);
+   void *ring = mmap(nullptr, m_BufferRingSize, PROT_READ | PROT_WRITE, MAP_ANONYMOUS | MAP_PRIVATE, -1, 0);
+   if (ring == MAP_FAILED) {
+      return Error(std::string("Failed to allocate the io_uring buffer ring: ") + strerror(errno));
+   }
+   m_BufferRing = static_cast<io_uring_buf_ring *>(ring);
+
+   io_uring_buf_reg registration {};
+   registration.ring_addr    = reinterpret_cast<uint64_t>(m_BufferRing);
+   registration.ring_entries = SLOT_COUNT;
+   registration.bgid         = 0;
+   if (syscall(__NR_io_uring_register, m_RingFd, IORING_REGISTER_PBUF_RING, &registration, 1) < 0) {
+      return Error(std::string("Failed to register the io_uring buffer ring: ") + strerror(errno));
+   }
+
+   for (uint16_t id = 0; id < SLOT_COUNT; id++) {
+      recycle_slot(id);
+   }
+
+   return Ok();
+}
+
+/* ------------------------------------------------------------------------------------------------------- */
+
+io_uring_sqe *
+UringEngine::get_sqe() {
+   // Make room by submitting what is queued when the ring is full
+   if (m_SqLocalTail - load_acquire(m_SqHead) >= RING_ENTRIES) {
+      enter(0);
+      if (m_SqLocalTail - load_acquire(m_SqHead) >= RING_ENTRIES) {
+         return nullptr;
+      }
+   }
+
+   unsigned index = m_SqLocalTail & *m_SqMask;
+   auto    *sqe   = &m_Sqes[index];
+   std::memset(sqe, 0, sizeof(*sqe));
+
+   m_SqArray[index] = index;
+   m_SqLocalTail++;
+   m_SqPending++;
+
+   return sqe;
+}
+
+/* ------------------------------------------------------------------------------------------------------- */
+
+/**
+ * @brief
+ * Submit everything queued and, when `min_complete` is non-zero, wait for that many completions or
+ * 100ms, whichever comes first.
+ */
+int
+UringEngine::enter(unsigned min_complete) {
+   store_release(m_SqTail, m_SqLocalTail);
+
+   __kernel_timespec      timeout { .tv_sec = 0, .tv_nsec = 100 * 1000 * 1000 };
+   io_uring_getevents_arg arg {};
+   arg.ts = reinterpret_cast<uint64_t>(&timeout);
+
+   unsigned flags = IORING_ENTER_EXT_ARG | (min_complete > 0 ? IORING_ENTER_GETEVENTS : 0);
+   int res = syscall(__NR_io_uring_enter, m_RingFd, m_SqPending, min_complete, flags, &arg, sizeof(arg));
+
+   if (min_complete > 0) {
+      m_Stats.add(m_Stats.recv_syscalls, 1);
+   } else {
+      m_Stats.add(m_Stats.send_syscalls, 1);
+   }
+
+   if (res >= 0) {
+      m_SqPending -= std::min<unsigned>(res, m_SqPending);
+   }
+   return res;
+}
+
+/* ------------------------------------------------------------------------------------------------------- */
+
+void
+UringEngine::arm_receive() {
+   auto *sqe = get_sqe();
+   if (!sqe) {
+      return;
+   }
+
+   sqe->opcode    = IORING_OP_RECVMSG;
+   sqe->fd        = m_Socket.get_fd();
+   sqe->addr      = reinterpret_cast<uint64_t>(&m_ReceiveHeader);
+   sqe->len       = 1;
+   sqe->flags     = IOSQE_BUFFER_SELECT;
+   sqe->ioprio    = IORING_RECV_MULTISHOT;
+   sqe->buf_group = 0;
+   sqe->user_data = RECEIVE_TAG;
+
+   m_ReceiveArmed = true;
+}
+
+/* ------------------------------------------------------------------------------------------------------- */
+
+void
+UringEngine::recycle_slot(uint16_t id) {
+   // Index the entries by hand: `bufs` is declared through __DECLARE_FLEX_ARRAY, which C++ compilers lay
+   // out one empty struct (and thus 8 bytes) too far
+   auto &buffer = reinterpret_cast<io_uring_buf *>(m_BufferRing)[m_BufferTail & (SLOT_COUNT - 1)];
+   buffer.addr  = reinterpret_cast<uint64_t>(m_Slots.data() + id * SLOT_SIZE);
+   buffer.len   = SLOT_SIZE;
+   buffer.bid   = id;
+
+   m_BufferTail++;
+   std::atomic_ref<uint16_t>(m_BufferRing->tail).store(m_BufferTail, std::memory_order_release);
+}
+
+/* ------------------------------------------------------------------------------------------------------- */
+
+void
+UringEngine::run(const std::atomic<bool> &running) {
+   arm_receive();
+
+   while (running.load(std::memory_order_relaxed)) {
+      enter(1);
+      m_Handler.begin_batch();
+
+      /* Drain every completion that is ready */
+      unsigned head = *m_CqHead;
+      unsigned tail = load_acquire(m_CqTail);
+      for (; head != tail; head++) {
+         const auto &cqe = m_Cqes[head & *m_CqMask];
+         if (cqe.user_data == RECEIVE_TAG) {
+            handle_receive(cqe);
+         } else {
+            handle_send(cqe);
+         }
+      }
+      store_release(m_CqHead, head);
+
+      // The kernel drops a multishot receive on errors such as running out of slots
+      if (!m_ReceiveArmed) {
+         arm_receive();
+      }
+   }
+}
+
+/* ------------------------------------------------------------------------------------------------------- */
+
+void
+UringEngine::handle_receive(const io_uring_cqe &cqe) {
+   if (!(cqe.flags & IORING_CQE_F_MORE)) {
+      m_ReceiveArmed = false;
+   }
+
+   if (cqe.res < 0 || !(cqe.flags & IORING_CQE_F_BUFFER)) {
+      return;
+   }
+
+   uint16_t id   = cqe.flags >> IORING_CQE_BUFFER_SHIFT;
+   Byte    *slot = m_Slots.data() + id * SLOT_SIZE;
+
+   /* The slot starts with the recvmsg header, followed by the peer address and the payload */
+   auto *out     = reinterpret_cast<io_uring_recvmsg_out *>(slot);
+   Byte *name    = slot + sizeof(io_uring_recvmsg_out);
+   Byte *payload = name + m_ReceiveHeader.msg_namelen + m_ReceiveHeader.msg_controllen;
+
+   m_Stats.add(m_Stats.received, 1);
+
+   if ((out->flags & MSG_TRUNC) || out->namelen > sizeof(sockaddr_storage) || m_FreeSendSlots.empty()) {
+      m_Stats.add(m_Stats.dropped, 1);
+      recycle_slot(id);
+      return;
+   }
+
+   uint16_t send_slot = m_FreeSendSlots.back();
+   auto    &response  = m_Responses[send_slot];
+
+   auto requester = Requester { .responder   = &m_Responder,
+                                .peer        = reinterpret_cast<const sockaddr *>(name),
+                                .peer_length = out->namelen,
+                                .max_size    = BufferPool::EDNS_SIZE };
+
+   auto _length = m_Handler.handle({ payload, out->payloadlen }, response, &requester);
+   if (!_length) {
+      m_Stats.add(m_Stats.dropped, 1);
+      recycle_slot(id);
+      return;
+   }
+   if (_length.get_value() == QueryHandler::DEFERRED) {
+      recycle_slot(id);   // answered later by the resolver
+      return;
+   }
+
+   std::memcpy(&m_Peers[send_slot], name, out->namelen);
+   m_ResponseHeaders[send_slot].msg_namelen = out->namelen;
+   m_ResponseVectors[send_slot]             = { response.get_data(), _length.get_value() };
+
+   // The request has been fully consumed, hand the slot back to the kernel right away
+   recycle_slot(id);
+
+   auto *sqe = get_sqe();
+   if (!sqe) {
+      m_Stats.add(m_Stats.dropped, 1);
+      return;
+   }
+   m_FreeSendSlots.pop_back();
+
+   sqe->opcode    = IORING_OP_SENDMSG;
+   sqe->fd        = m_Socket.get_fd();
+   sqe->addr      = reinterpret_cast<uint64_t>(&m_ResponseHeaders[send_slot]);
+   sqe->len       = 1;
+   sqe->user_data = SEND_TAG | send_slot;
+}
+
+/* ------------------------------------------------------------------------------------------------------- */
+
+void
+UringEngine::handle_send(const io_uring_cqe &cqe) {
+   m_FreeSendSlots.push_back(cqe.user_data & 0xFFFF);
+
+   if (cqe.res < 0) {
+      m_Stats.add(m_Stats.dropped, 1);
+   } else {
+      m_Stats.add(m_Stats.sent, 1);
+   }
+}
+
+/* ------------------------------------------------------------------------------------------------------- */
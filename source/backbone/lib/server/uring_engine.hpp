@@ -0,0 +1,117 @@
+#pragma once
+
+#include <array>
+#include <atomic>
+#include <cstdint>
+#include <vector>
+#include <linux/io_uring.h>
+#include <sys/socket.h>
+
+#include <backbone/core/pch>
+#include "engine.hpp"
+
+/* ------------------------------------------------------------------------------------------------------- */
+
+/**
+ * @brief
+ * io_uring backend, driven through the raw system calls so that no extra dependency is needed.
+ *
+ * @details
+ * A single multishot `RECVMSG` stays armed on the socket and picks its destination from a ring of
+ * provided buffers registered with the kernel (`IORING_REGISTER_PBUF_RING`). Each slot of that pool
+ * holds the `io_uring_recvmsg_out` header, the peer address and a full `PacketBuffer` worth of payload.
+ * Responses are queued as `SENDMSG` submissions and the whole batch is submitted together with the wait
+ * for the next completions, so a busy worker makes one `io_uring_enter` per batch in both directions.
+ */
+class UringEngine : public IEngine {
+public:
+   static constexpr unsigned RING_ENTRIES = 1024;
+   static constexpr unsigned SLOT_COUNT   = 512;   // provided receive slots, must be a power of two
+   static constexpr unsigned SEND_SLOTS   = 512;
+   static constexpr size_t   SLOT_SIZE =
+       sizeof(io_uring_recvmsg_out) + sizeof(sockaddr_storage) + BufferPool::UDP_SIZE;
+
+private:
+   UdpSocket         m_Socket;
+   QueryHandler      m_Handler;
+   WorkerStats      &m_Stats;
+   DatagramResponder m_Responder;
+
+   int m_RingFd;
+
+   /* Submission queue */
+   void         *m_SqRing;
+   size_t        m_SqRingSize;
+   unsigned     *m_SqHead;
+   unsigned     *m_SqTail;
+   unsigned     *m_SqMask;
+   unsigned     *m_SqArray;
+   io_uring_sqe *m_Sqes;
+   size_t        m_SqesSize;
+   unsigned      m_SqLocalTail;
+   unsigned      m_SqPending;
+
+   /* Completion queue */
+   void         *m_CqRing;
+   size_t        m_CqRingSize;
+   unsigned     *m_CqHead;
+   unsigned     *m_CqTail;
+   unsigned     *m_CqMask;
+   io_uring_cqe *m_Cqes;
+
+   /* Provided receive buffers */
+   io_uring_buf_ring *m_BufferRing;
+   size_t             m_BufferRingSize;
+   uint16_t           m_BufferTail;
+   std::vector<Byte>  m_Slots;
+   msghdr             m_ReceiveHeader;
+   bool               m_ReceiveArmed;
+
+   /* Responses in flight */
+   std::array<PacketBuffer, SEND_SLOTS>     m_Responses;
+   std::array<sockaddr_storage, SEND_SLOTS> m_Peers;
+   std::array<iovec, SEND_SLOTS>            m_ResponseVectors;
+   std::array<msghdr, SEND_SLOTS>           m_ResponseHeaders;
+   std::vector<uint16_t>                    m_FreeSendSlots;
+
+public:
+   UringEngine(const UringEngine &) = delete;
+   ~UringEngine();
+
+   static Result<UniqueRef<UringEngine>>
+   create(UdpSocket socket, QueryHandler handler, WorkerStats &stats, RateLimiter *limiter = nullptr);
+
+   const char *
+   get_name() const override {
+      return "io_uring";
+   }
+
+   void
+   run(const std::atomic<bool> &running) override;
+
+private:
+   UringEngine(UdpSocket socket, QueryHandler handler, WorkerStats &stats, RateLimiter *limiter);
+
+   Result<void>
+   setup();
+
+   io_uring_sqe *
+   get_sqe();
+
+   int
+   enter(unsigned min_complete);
+
+   void
+   arm_receive();
+
+   void
+   recycle_slot(uint16_t id);
+
+   void
+   handle_receive(const io_uring_cqe &cqe);
+
+   void
+   handle_send(const io_uring_cqe &cqe);
+};
+
+/* ------------------------------------------------------------------------------------------------------- */
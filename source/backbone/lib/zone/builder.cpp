@@ -0,0 +1,205 @@
+#include "builder.hpp"
+
+#include <algorithm>
+#include <cstdio>
+#include <cstring>
+#include <deque>
+#include <fstream>
+
+/* ------------------------------------------------------------------------------------------------------- */
+
+ZoneBuilder::ZoneBuilder() : m_Root(CreateUniqueRef<Entry>()), m_RecordCount(0) {}
+
+/* ------------------------------------------------------------------------------------------------------- */
+
+Result<void>
+ZoneBuilder::add_apex(std::string_view name) {
+   auto entry = insert(name);
+   RETURN_IF_ERROR(entry);
+
+   entry.get_value()->apex = true;
+   return Ok();
+}
+
+/* ------------------------------------------------------------------------------------------------------- */
+
+Result<void>
+ZoneBuilder::add_record(std::string_view      name,
+                        uint16_t              type,
+                        uint32_t              ttl,
+                        std::span<const Byte> data,
+                        uint16_t              class_) {
+   if (data.size() > UINT16_MAX) {
+      return Error("Record data is too large");
+   }
+
+   auto entry = insert(name);
+   RETURN_IF_ERROR(entry);
+
+   entry.get_value()->records.push_back({ type, class_, ttl, std::vector<Byte>(data.begin(), data.end()) });
+   m_RecordCount++;
+   return Ok();
+}
+
+/* ------------------------------------------------------------------------------------------------------- */
+
+Result<ZoneBuilder::Entry *>
+ZoneBuilder::insert(std::string_view name) {
+   if (!name.empty() && name.back() == '.') {
+      name.remove_suffix(1);
+   }
+   if (name.size() > 253) {
+      return Error("Domain name exceeds 255 bytes on the wire");
+   }
+
+   Entry *entry = m_Root.get();
+   for (size_t end = name.size(); end > 0;) {
+      size_t dot   = name.rfind('.', end - 1);
+      size_t start = dot == std::string_view::npos ? 0 : dot + 1;
+      if (start == end || end - start > 63 || (dot != std::string_view::npos && dot == 0)) {
+         return Error("Invalid label in domain name: " + std::string(name));
+      }
+
+      std::string label(name.substr(start, end - start));
+      std::transform(label.begin(), label.end(), label.begin(), [](char c) {
+         return (c >= 'A' && c <= 'Z') ? c + ('a' - 'A') : c;
+      });
+
+      auto &child = entry->children[label];
+      if (!child) {
+         child = CreateUniqueRef<Entry>();
+      }
+      entry = child.get();
+
+      end = dot == std::string_view::npos ? 0 : dot;
+   }
+
+   return entry;
+}
+
+/* ------------------------------------------------------------------------------------------------------- */
+
+std::vector<Byte>
+ZoneBuilder::build_image() const {
+   std::vector<ZoneNode>   nodes;
+   std::vector<Byte>       labels;
+   std::vector<ZoneRecord> records;
+   std::vector<Byte>       rdata;
+
+   /* Flatten breadth first. `pending[i]` is the entry whose children node `i` still has to get */
+   std::deque<const Entry *> pending;
+
+   auto emit_records = [&](ZoneNode &node, const Entry &entry) {
+      std::vector<const Record *> sorted;
+      for (const auto &record : entry.records) {
+         sorted.push_back(&record);
+      }
+      std::stable_sort(sorted.begin(), sorted.end(), [](auto *a, auto *b) { return a->type < b->type; });
+
+      node.first_record = records.size();
+      node.record_count = sorted.size();
+      for (const auto *record : sorted) {
+         records.push_back({ record->type,
+                             record->class_,
+                             record->ttl,
+                             static_cast<uint32_t>(rdata.size()),
+                             static_cast<uint16_t>(record->data.size()),
+                             0 });
+         rdata.insert(rdata.end(), record->data.begin(), record->data.end());
+      }
+   };
+
+   nodes.push_back({ 0, 0, 0, m_Root->apex ? ZoneNode::APEX : uint8_t(0), 0, 0, 0, 0 });
+   emit_records(nodes.back(), *m_Root);
+   pending.push_back(m_Root.get());
+
+   for (size_t i = 0; i < nodes.size(); i++) {
+      const Entry *parent = pending[i];
+
+      nodes[i].first_child = nodes.size();
+      nodes[i].child_count = parent->children.size();
+
+      for (const auto &[label, child] : parent->children) {
+         ZoneNode node = { static_cast<uint32_t>(labels.size()), 0, 0, 0, 0, 0, 0, 0 };
+
+         // Extend the edge over every node that owns nothing and leads to exactly one name
+         const Entry *entry = child.get();
+         labels.push_back(label.size());
+         labels.insert(labels.end(), label.begin(), label.end());
+         node.label_count = 1;
+         while (entry->children.size() == 1 && entry->records.empty() && !entry->apex &&
+                entry->children.begin()->first != "*") {
+            const auto &[next_label, next] = *entry->children.begin();
+            labels.push_back(next_label.size());
+            labels.insert(labels.end(), next_label.begin(), next_label.end());
+            node.label_count++;
+            entry = next.get();
+         }
+
+         node.label_bytes = labels.size() - node.label_offset;
+         node.flags       = entry->apex ? ZoneNode::APEX : 0;
+         emit_records(node, *entry);
+
+         nodes.push_back(node);
+         pending.push_back(entry);
+      }
+   }
+
+   /* Image */
+   auto align = [](size_t offset) { return (offset + 7) & ~size_t(7); };
+
+   Zone::Header header;
+   std::memcpy(header.magic, Zone::MAGIC, sizeof(header.magic));
+   header.version        = Zone::VERSION;
+   header.node_count     = nodes.size();
+   header.nodes_offset   = align(sizeof(Zone::Header));
+   header.labels_offset  = align(header.nodes_offset + nodes.size() * sizeof(ZoneNode));
+   header.labels_size    = labels.size();
+   header.records_offset = align(header.labels_offset + labels.size());
+   header.record_count   = records.size();
+   header.rdata_offset   = align(header.records_offset + records.size() * sizeof(ZoneRecord));
+   header.rdata_size     = rdata.size();
+
+   std::vector<Byte> image(header.rdata_offset + rdata.size(), 0);
+   std::memcpy(image.data(), &header, sizeof(header));
+   std::memcpy(image.data() + header.nodes_offset, nodes.data(), nodes.size() * sizeof(ZoneNode));
+   std::memcpy(image.data() + header.labels_offset, labels.data(), labels.size());
+   std::memcpy(image.data() + header.records_offset, records.data(), records.size() * sizeof(ZoneRecord));
+   std::memcpy(image.data() + header.rdata_offset, rdata.data(), rdata.size());
+
+   return image;
+}
+
+/* ------------------------------------------------------------------------------------------------------- */
+
+Result<Zone>
+ZoneBuilder::build() const {
+   auto image = CreateRef<std::vector<Byte>>(build_image());
+   return Zone::from_image(*image, image);
+}
+
+/* ------------------------------------------------------------------------------------------------------- */
+
+Result<void>
+ZoneBuilder::write(const std::string &path) const {
+   auto image = build_image();
+
+   // Never truncate a file that might be mapped, write a new one next to it and swap it in
+   auto          temporary = path + ".tmp";
+   std::ofstream file(temporary, std::ios::binary | std::ios::trunc);
+   file.write(reinterpret_cast<const char *>(image.data()), image.size());
+   file.close();
+   if (!file) {
+      std::remove(temporary.c_str());
+      return Error("Failed to write zone file " + temporary);
+   }
+
+   if (std::rename(temporary.c_str(), path.c_str()) != 0) {
+      std::remove(temporary.c_str());
+      return Error("Failed to replace zone file " + path);
+   }
+
+   return Ok();
+}
+
+/* ------------------------------------------------------------------------------------------------------- */
@@ -0,0 +1,88 @@
+#pragma once
+
+#include <cstdint>
+#include <map>
+#include <span>
+#include <string>
+#include <string_view>
+#include <vector>
+
+#include <backbone/core/pch>
+#include "zone.hpp"
+
+/* ------------------------------------------------------------------------------------------------------- */
+
+/**
+ * @brief
+ * Collects names and records and lays them out as a `Zone` image.
+ *
+ * @details
+ * The builder keeps a plain one-label-per-node tree while records come in. `build_image` then flattens it
+ * breadth first and merges every chain of nodes that own nothing and have a single child into one edge.
+ * A chain never swallows a `*` child, so when the closest encloser of a missing name is a real node its
+ * wildcard can be found with one more child search. When it is one of the empty non-terminals inside an
+ * edge, it has no wildcard and the name does not exist.
+ */
+class ZoneBuilder {
+private:
+   struct Record {
+      uint16_t          type;
+      uint16_t          class_;
+      uint32_t          ttl;
+      std::vector<Byte> data;
+   };
+
+   struct Entry {
+      std::map<std::string, UniqueRef<Entry>> children;
+      std::vector<Record>                     records;
+      bool                                    apex = false;
+   };
+
+   UniqueRef<Entry> m_Root;
+   size_t           m_RecordCount;
+
+public:
+   ZoneBuilder();
+   ZoneBuilder(const ZoneBuilder &) = delete;
+   ~ZoneBuilder()                   = default;
+
+   /**
+    * Marks `name` as the apex of a zone. Names below it are answered authoritatively.
+    */
+   Result<void>
+   add_apex(std::string_view name);
+
+   /**
+    * Adds a record with its RDATA in wire format. Names inside the RDATA must not be compressed.
+    */
+   Result<void>
+   add_record(std::string_view      name,
+              uint16_t              type,
+              uint32_t              ttl,
+              std::span<const Byte> data,
+              uint16_t              class_ = 1);
+
+   std::vector<Byte>
+   build_image() const;
+
+   Result<Zone>
+   build() const;
+
+   /**
+    * Writes the image to `path`. The file is replaced atomically, so processes that still map the old one
+    * keep serving it undisturbed.
+    */
+   Result<void>
+   write(const std::string &path) const;
+
+   size_t
+   get_record_count() const {
+      return m_RecordCount;
+   }
+
+private:
+   Result<Entry *>
+   insert(std::string_view name);
+};
+
+/* ------------------------------------------------------------------------------------------------------- */
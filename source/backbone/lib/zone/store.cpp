@@ -0,0 +1,49 @@
+#include "store.hpp"
+
+#include <algorithm>
+
+/* ------------------------------------------------------------------------------------------------------- */
+
+ZoneStore::ZoneStore(size_t readers)
+    : m_Current(nullptr), m_Epoch(0), m_Slots(CreateUniqueRef<Slot[]>(readers)), m_SlotCount(readers) {}
+
+/* ------------------------------------------------------------------------------------------------------- */
+
+void
+ZoneStore::publish(UniqueRef<const Zone> zone) {
+   std::lock_guard lock(m_WriterLock);
+
+   m_Current.store(zone.get(), std::memory_order_seq_cst);
+
+   // Readers that announced an epoch up to `retired` may still hold the old zone
+   uint64_t retired = m_Epoch.fetch_add(1, std::memory_order_seq_cst);
+   if (m_Owned) {
+      m_Retired.push_back({ std::move(m_Owned), retired });
+   }
+   m_Owned = std::move(zone);
+
+   reclaim_locked();
+}
+
+/* ------------------------------------------------------------------------------------------------------- */
+
+size_t
+ZoneStore::reclaim() {
+   std::lock_guard lock(m_WriterLock);
+   return reclaim_locked();
+}
+
+/* ------------------------------------------------------------------------------------------------------- */
+
+size_t
+ZoneStore::reclaim_locked() {
+   uint64_t oldest = IDLE;
+   for (size_t i = 0; i < m_SlotCount; i++) {
+      oldest = std::min(oldest, m_Slots[i].epoch.load(std::memory_order_seq_cst));
+   }
+
+   std::erase_if(m_Retired, [oldest](const Retired &retired) { return retired.epoch < oldest; });
+   return m_Retired.size();
+}
+
+/* ------------------------------------------------------------------------------------------------------- */
@@ -0,0 +1,116 @@
+#pragma once
+
+#include <atomic>
+#include <cstdint>
+#include <mutex>
+#include <vector>
+
+#include <backbone/core/pch>
+#include "zone.hpp"
+
+/* ------------------------------------------------------------------------------------------------------- */
+
+/**
+ * @brief
+ * Holds the zone currently being served and swaps in new ones without ever blocking a reader.
+ *
+ * @details
+ * Readers (one fixed slot per worker) announce the epoch they start reading in, load the current zone and
+ * clear their slot when done: two plain atomic stores and a load per query, no lock and no reference count
+ * shared between threads. `publish` swaps the pointer, moves the epoch forward and retires the old zone,
+ * which is only destroyed once no slot still announces an epoch from before the swap. Readers that are in
+ * the middle of a query therefore finish it on the old zone, and the next query sees the new one.
+ *
+ * Writers serialize among themselves on a mutex that readers never touch.
+ */
+class ZoneStore {
+private:
+   static constexpr uint64_t IDLE = UINT64_MAX;
+
+   struct alignas(64) Slot {
+      std::atomic<uint64_t> epoch = IDLE;
+   };
+
+   struct Retired {
+      UniqueRef<const Zone> zone;
+      uint64_t              epoch;
+   };
+
+   std::atomic<const Zone *> m_Current;
+   std::atomic<uint64_t>     m_Epoch;
+   UniqueRef<Slot[]>         m_Slots;
+   size_t                    m_SlotCount;
+
+   std::mutex            m_WriterLock;
+   UniqueRef<const Zone> m_Owned;
+   std::vector<Retired>  m_Retired;
+
+public:
+   /**
+    * Pins the current zone for one reader until it goes out of scope.
+    */
+   class Guard {
+   private:
+      std::atomic<uint64_t> &m_Epoch;
+      const Zone            *m_Zone;
+
+   public:
+      Guard(std::atomic<uint64_t> &epoch, const Zone *zone) : m_Epoch(epoch), m_Zone(zone) {}
+      Guard(const Guard &) = delete;
+
+      ~Guard() {
+         m_Epoch.store(IDLE, std::memory_order_release);
+      }
+
+      const Zone *
+      get() const {
+         return m_Zone;
+      }
+
+      const Zone *
+      operator->() const {
+         return m_Zone;
+      }
+   };
+
+public:
+   ZoneStore(size_t readers);
+   ZoneStore(const ZoneStore &) = delete;
+   ~ZoneStore()                 = default;
+
+   /**
+    * Pins the current zone (null if none was published) for reader `reader`. Each reader slot must only
+    * be used by one thread, and only once at a time.
+    */
+   Guard
+   read(size_t reader) {
+      auto &slot = m_Slots[reader].epoch;
+      slot.store(m_Epoch.load(std::memory_order_acquire), std::memory_order_seq_cst);
+      return Guard(slot, m_Current.load(std::memory_order_seq_cst));
+   }
+
+   /**
+    * Makes `zone` the current zone. The previous one is destroyed as soon as no reader can still see it.
+    */
+   void
+   publish(UniqueRef<const Zone> zone);
+
+   /**
+    * Destroys every retired zone no reader can still see.
+    *
+    * @returns Number of zones still waiting for readers.
+    */
+   size_t
+   reclaim();
+
+   size_t
+   get_reader_count() const {
+      return m_SlotCount;
+   }
+
+private:
+   size_t
+   reclaim_locked();
+};
+
+/* ------------------------------------------------------------------------------------------------------- */
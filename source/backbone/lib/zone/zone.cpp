@@ -0,0 +1,252 @@
+#include "zone.hpp"
+
+#include <array>
+#include <cstring>
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+/* ------------------------------------------------------------------------------------------------------- */
+
+namespace {
+
+/**
+ * Read-only mapping of a whole file, unmapped with its last reference.
+ */
+class MappedFile {
+private:
+   void  *m_Data;
+   size_t m_Size;
+
+public:
+   MappedFile(void *data, size_t size) : m_Data(data), m_Size(size) {}
+   MappedFile(const MappedFile &) = delete;
+
+   ~MappedFile() {
+      munmap(m_Data, m_Size);
+   }
+
+   std::span<const Byte>
+   get_bytes() const {
+      return { static_cast<const Byte *>(m_Data), m_Size };
+   }
+};
+
+}   // namespace
+
+/* ------------------------------------------------------------------------------------------------------- */
+
+Zone::Zone(Ref<const void>             owner,
+           std::span<const ZoneNode>   nodes,
+           std::span<const Byte>       labels,
+           std::span<const ZoneRecord> records,
+           std::span<const Byte>       rdata)
+    : m_Owner(std::move(owner)), m_Nodes(nodes), m_Labels(labels), m_Records(records), m_RData(rdata) {}
+
+/* ------------------------------------------------------------------------------------------------------- */
+
+Result<Zone>
+Zone::from_image(std::span<const Byte> image, Ref<const void> owner) {
+   if (image.size() < sizeof(Header) || reinterpret_cast<uintptr_t>(image.data()) % alignof(Header) != 0) {
+      return Error("Zone image is too small or misaligned");
+   }
+
+   Header header;
+   std::memcpy(&header, image.data(), sizeof(header));
+   if (std::memcmp(header.magic, MAGIC, sizeof(MAGIC)) != 0 || header.version != VERSION) {
+      return Error("Not a zone image or unsupported version");
+   }
+
+   /* Sections */
+   auto section = [&](uint64_t offset, uint64_t size) {
+      return offset % 8 == 0 && offset <= image.size() && size <= image.size() - offset;
+   };
+   if (!section(header.nodes_offset, uint64_t(header.node_count) * sizeof(ZoneNode)) ||
+       !section(header.labels_offset, header.labels_size) ||
+       !section(header.records_offset, header.record_count * sizeof(ZoneRecord)) ||
+       !section(header.rdata_offset, header.rdata_size) || header.node_count == 0) {
+      return Error("Zone image sections are out of bounds");
+   }
+
+   auto nodes = std::span(reinterpret_cast<const ZoneNode *>(image.data() + header.nodes_offset),
+                          header.node_count);
+   auto labels  = image.subspan(header.labels_offset, header.labels_size);
+   auto records = std::span(reinterpret_cast<const ZoneRecord *>(image.data() + header.records_offset),
+                            header.record_count);
+   auto rdata   = image.subspan(header.rdata_offset, header.rdata_size);
+
+   /* Nodes. Children strictly after their parent is what keeps every walk finite */
+   for (size_t i = 0; i < nodes.size(); i++) {
+      const auto &node = nodes[i];
+
+      if (node.first_child <= i && node.child_count > 0) {
+         return Error("Zone node links backwards");
+      }
+      if (uint64_t(node.first_child) + node.child_count > nodes.size() ||
+          uint64_t(node.first_record) + node.record_count > records.size() ||
+          uint64_t(node.label_offset) + node.label_bytes > labels.size()) {
+         return Error("Zone node is out of bounds");
+      }
+      if (i > 0 && node.label_count == 0) {
+         return Error("Zone node has an empty edge");
+      }
+
+      size_t pos = node.label_offset, end = pos + node.label_bytes, count = 0;
+      while (pos < end) {
+         pos += 1 + labels[pos];
+         count++;
+      }
+      if (pos != end || count != node.label_count) {
+         return Error("Zone node labels are corrupted");
+      }
+   }
+
+   /* Records */
+   for (const auto &record : records) {
+      if (uint64_t(record.data_offset) + record.data_length > rdata.size()) {
+         return Error("Zone record data is out of bounds");
+      }
+   }
+
+   return Zone(std::move(owner), nodes, labels, records, rdata);
+}
+
+/* ------------------------------------------------------------------------------------------------------- */
+
+Result<Zone>
+Zone::open(const std::string &path) {
+   int fd = ::open(path.c_str(), O_RDONLY | O_CLOEXEC);
+   if (fd < 0) {
+      return Error("Failed to open zone file " + path + ": " + std::strerror(errno));
+   }
+
+   struct stat info;
+   if (fstat(fd, &info) != 0 || info.st_size < static_cast<off_t>(sizeof(Header))) {
+      ::close(fd);
+      return Error("Zone file " + path + " is too small");
+   }
+
+   // The mapping stays valid after the descriptor is closed
+   void *data = mmap(nullptr, info.st_size, PROT_READ, MAP_SHARED, fd, 0);
+   ::close(fd);
+   if (data == MAP_FAILED) {
+      return Error("Failed to map zone file " + path + ": " + std::strerror(errno));
+   }
+
+   auto mapping = CreateRef<MappedFile>(data, info.st_size);
+   return from_image(mapping->get_bytes(), mapping).except("Invalid zone file " + path);
+}
+
+/* ------------------------------------------------------------------------------------------------------- */
+
+ZoneMatch
+Zone::lookup(std::string_view name) const {
+   auto _name = DomainName::from_string(name);
+   if (!_name) {
+      return { ZoneMatch::NOT_AUTHORITATIVE, NONE, NONE, 0 };
+   }
+   return lookup(_name.get_value());
+}
+
+/* ------------------------------------------------------------------------------------------------------- */
+
+ZoneMatch
+Zone::lookup(const DomainName &name) const {
+   // Labels are already lowercase, matched right to left
+   size_t count = name.get_label_count();
+   auto   label = [&](size_t matched) {
+      return name.get_label(count - 1 - matched);
+   };
+
+   /* Walk down, remembering the deepest zone apex on the way */
+   uint32_t node        = 0;
+   size_t   matched     = 0;
+   uint32_t apex        = (m_Nodes[0].flags & ZoneNode::APEX) ? 0 : NONE;
+   uint8_t  apex_labels = 0;
+   bool     partial     = false;
+   bool     diverged    = false;
+
+   while (matched < count) {
+      uint32_t child = find_child(node, label(matched));
+      if (child == NONE) {
+         break;
+      }
+
+      // The first label of the edge matched already, compare the rest of it
+      const auto &edge = m_Nodes[child];
+      size_t      pos  = edge.label_offset + 1 + m_Labels[edge.label_offset];
+      size_t      k    = 1;
+      for (; k < edge.label_count; k++) {
+         if (matched + k >= count || get_label(pos) != label(matched + k)) {
+            break;
+         }
+         pos += 1 + m_Labels[pos];
+      }
+
+      if (k < edge.label_count) {
+         // Ending inside the edge makes the name an empty non-terminal. Diverging inside it makes one of
+         // those the closest encloser, and it has no `*` child
+         partial  = matched + k >= count;
+         diverged = !partial;
+         break;
+      }
+
+      node = child;
+      matched += edge.label_count;
+      if (edge.flags & ZoneNode::APEX) {
+         apex        = child;
+         apex_labels = matched;
+      }
+   }
+
+   if (apex == NONE) {
+      return { ZoneMatch::NOT_AUTHORITATIVE, node, NONE, 0 };
+   }
+   if (partial) {
+      return { ZoneMatch::EMPTY, node, apex, apex_labels };
+   }
+   if (diverged) {
+      return { ZoneMatch::NAME_ERROR, node, apex, apex_labels };
+   }
+   if (matched == count) {
+      auto kind = m_Nodes[node].record_count > 0 ? ZoneMatch::EXACT : ZoneMatch::EMPTY;
+      return { kind, node, apex, apex_labels };
+   }
+
+   /* Nothing owns the name, `node` is the closest encloser (edges never hide a `*` child, see the builder) */
+   uint32_t wildcard = find_child(node, "*");
+   if (wildcard != NONE) {
+      auto kind = m_Nodes[wildcard].label_count == 1 && m_Nodes[wildcard].record_count > 0
+                          ? ZoneMatch::WILDCARD
+                          : ZoneMatch::EMPTY;
+      return { kind, wildcard, apex, apex_labels };
+   }
+
+   return { ZoneMatch::NAME_ERROR, node, apex, apex_labels };
+}
+
+/* ------------------------------------------------------------------------------------------------------- */
+
+uint32_t
+Zone::find_child(uint32_t node, std::string_view label) const {
+   const auto &parent = m_Nodes[node];
+
+   size_t low = parent.first_child, high = parent.first_child + parent.child_count;
+   while (low < high) {
+      size_t mid = low + (high - low) / 2;
+      int    cmp = get_label(m_Nodes[mid].label_offset).compare(label);
+      if (cmp == 0) {
+         return mid;
+      }
+      if (cmp < 0) {
+         low = mid + 1;
+      } else {
+         high = mid;
+      }
+   }
+
+   return NONE;
+}
+
+/* ------------------------------------------------------------------------------------------------------- */
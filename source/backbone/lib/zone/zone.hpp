@@ -0,0 +1,188 @@
+#pragma once
+
+#include <cstdint>
+#include <span>
+#include <string>
+#include <string_view>
+
+#include <backbone/core/pch>
+#include <backbone/lib/packet/domain.hpp>
+
+/* ------------------------------------------------------------------------------------------------------- */
+
+/**
+ * @brief
+ * Node of the zone trie. The trie is keyed on reversed labels (`custom` -> `api` for `api.custom`) and
+ * compressed: a node is reached over an edge of one or more labels.
+ *
+ * @details
+ * Nodes are laid out breadth first, so the children of a node are contiguous, come after their parent
+ * and are sorted by their first label for binary search. The edge labels are stored in `Zone::labels` as
+ * `[length][lowercase bytes]`, in lookup order.
+ */
+struct ZoneNode {
+   static constexpr uint8_t APEX = 0x01;   // a zone starts here, so this node holds its SOA
+
+   uint32_t label_offset;
+   uint16_t label_bytes;
+   uint8_t  label_count;
+   uint8_t  flags;
+   uint32_t first_child;
+   uint32_t child_count;
+   uint32_t first_record;
+   uint32_t record_count;
+};
+
+static_assert(sizeof(ZoneNode) == 24);
+
+/* ------------------------------------------------------------------------------------------------------- */
+
+/**
+ * @brief
+ * Record owned by a node. RDATA is kept in wire format (uncompressed names) so it is copied out verbatim.
+ */
+struct ZoneRecord {
+   uint16_t type;
+   uint16_t class_;
+   uint32_t ttl;
+   uint32_t data_offset;
+   uint16_t data_length;
+   uint16_t reserved;
+};
+
+static_assert(sizeof(ZoneRecord) == 16);
+
+/* ------------------------------------------------------------------------------------------------------- */
+
+/**
+ * @brief
+ * Outcome of a lookup, found in a single walk down the trie.
+ */
+struct ZoneMatch {
+   enum Kind {
+      NOT_AUTHORITATIVE,   // no zone encloses the name
+      NAME_ERROR,          // the name does not exist (NXDOMAIN)
+      EMPTY,               // the name exists but owns no records (empty non-terminal)
+      EXACT,               // `node` owns the name
+      WILDCARD,            // `node` is the `*` child of the closest encloser
+   };
+
+   Kind     kind;
+   uint32_t node;          // matched node, or the closest encloser when nothing matched
+   uint32_t apex;          // apex of the enclosing zone
+   uint8_t  apex_labels;   // number of rightmost labels of the name that make up the apex
+};
+
+/* ------------------------------------------------------------------------------------------------------- */
+
+/**
+ * @brief
+ * Read-only, immutable zone data: a label-reversed radix trie plus its records.
+ *
+ * @details
+ * The whole zone lives in one flat image (header, nodes, labels, records, RDATA) that is only ever read
+ * through spans, so it can equally come from `ZoneBuilder` or straight from a file. Every offset in the
+ * image is validated once when it is opened, lookups never check bounds again.
+ *
+ * Images hold offsets only, so a compiled zone file (`backbone-zonec`) is mapped read-only and served in
+ * place: startup costs one pass over the nodes, and every process serving the same file shares its pages.
+ *
+ * A lookup costs one binary search over the children per label of the name, no matter how many names the
+ * zone holds.
+ */
+class Zone {
+public:
+   static constexpr uint32_t NONE = UINT32_MAX;
+
+   /**
+    * Layout of the image. All sections are 8-byte aligned and in host byte order.
+    */
+   struct Header {
+      char     magic[8];
+      uint32_t version;
+      uint32_t node_count;
+      uint64_t nodes_offset;
+      uint64_t labels_offset;
+      uint64_t labels_size;
+      uint64_t records_offset;
+      uint64_t record_count;
+      uint64_t rdata_offset;
+      uint64_t rdata_size;
+   };
+
+   static constexpr char     MAGIC[8] = { 'B', 'B', 'Z', 'O', 'N', 'E', '\0', '\0' };
+   static constexpr uint32_t VERSION  = 1;
+
+private:
+   Ref<const void>             m_Owner;
+   std::span<const ZoneNode>   m_Nodes;
+   std::span<const Byte>       m_Labels;
+   std::span<const ZoneRecord> m_Records;
+   std::span<const Byte>       m_RData;
+
+public:
+   Zone() = delete;
+   ~Zone() = default;
+
+   /**
+    * Opens an image. `owner` keeps the memory behind `image` alive for as long as the zone is.
+    */
+   static Result<Zone>
+   from_image(std::span<const Byte> image, Ref<const void> owner);
+
+   /**
+    * Maps a compiled zone file read-only and opens it.
+    */
+   static Result<Zone>
+   open(const std::string &path);
+
+   /**
+    * Looks `name` up, case-insensitively. A trailing dot is optional.
+    */
+   ZoneMatch
+   lookup(std::string_view name) const;
+
+   /**
+    * Looks `name` up without parsing or lowercasing anything, the labels are read straight off the name.
+    */
+   ZoneMatch
+   lookup(const DomainName &name) const;
+
+   std::span<const ZoneRecord>
+   get_records(uint32_t node) const {
+      const auto &n = m_Nodes[node];
+      return m_Records.subspan(n.first_record, n.record_count);
+   }
+
+   std::span<const Byte>
+   get_rdata(const ZoneRecord &record) const {
+      return m_RData.subspan(record.data_offset, record.data_length);
+   }
+
+   size_t
+   get_node_count() const {
+      return m_Nodes.size();
+   }
+
+   size_t
+   get_record_count() const {
+      return m_Records.size();
+   }
+
+private:
+   Zone(Ref<const void>             owner,
+        std::span<const ZoneNode>   nodes,
+        std::span<const Byte>       labels,
+        std::span<const ZoneRecord> records,
+        std::span<const Byte>       rdata);
+
+   uint32_t
+   find_child(uint32_t node, std::string_view label) const;
+
+   std::string_view
+   get_label(uint32_t offset) const {
+      return { reinterpret_cast<const char *>(m_Labels.data()) + offset + 1, m_Labels[offset] };
+   }
+};
+
+/* ------------------------------------------------------------------------------------------------------- */